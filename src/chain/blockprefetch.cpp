@@ -0,0 +1,177 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockprefetch.h"
+
+#include "chain/chain.h"
+#include "commons/util/util.h"
+#include "config/const.h"
+#include "main.h"
+#include "persistence/accountdb.h"
+#include "tx/tx.h"
+
+CBlockPrefetcher blockPrefetcher(DEFAULT_PREFETCH_BLOCKS);
+
+void CBlockPrefetcher::SetWindow(uint32_t nWindowIn) {
+    boost::unique_lock<boost::mutex> lock(mutex);
+    nWindow = nWindowIn;
+}
+
+void CBlockPrefetcher::Prefetch(const CChain &chainMostWork, int32_t tipHeight, CAccountDBCache &accountCache) {
+    AssertLockHeld(cs_main);
+
+    vector<ItemPtr> resolving;
+    int32_t endHeight;
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        nTipHeight = tipHeight;
+        if (nWindow == 0 || fQuit)
+            return;
+
+        for (auto it = mapRequested.begin(); it != mapRequested.end();) {
+            if (it->second <= tipHeight)
+                it = mapRequested.erase(it);
+            else
+                ++it;
+        }
+        resolving.swap(resolveList);
+
+        // the block next to the tip is connected right away, the blocks after it are prefetched
+        endHeight = std::min(chainMostWork.Height(), tipHeight + 1 + (int32_t)nWindow);
+        for (int32_t height = tipHeight + 2; height <= endHeight; height++) {
+            CBlockIndex *pIndex = chainMostWork[height];
+            if (!(pIndex->nStatus & BLOCK_HAVE_DATA) || !mapRequested.emplace(pIndex->GetBlockHash(), height).second)
+                continue;
+
+            ItemPtr pItem  = std::make_shared<CItem>();
+            pItem->hash    = pIndex->GetBlockHash();
+            pItem->height  = height;
+            pItem->pos     = pIndex->GetBlockPos();
+            readQueue.push_back(pItem);
+            condWorker.notify_one();
+        }
+    }
+
+    // the senders registered before the tip are found, the others are left to CheckBlock()
+    for (auto &pItem : resolving) {
+        // CheckBlock() does not verify its signatures either
+        auto itIndex = mapBlockIndex.find(pItem->hash);
+        if (IsStale(*pItem) || (itIndex != mapBlockIndex.end() && IsSignatureAssumedValid(itIndex->second)))
+            continue;
+
+        for (uint32_t index = 1; index < pItem->spBlock->vptx.size(); index++) {
+            CBaseTx *pBaseTx = pItem->spBlock->vptx[index].get();
+            if (!IsSpeculativeTxType(pBaseTx->nTxType) || !pBaseTx->CheckSignatureSize(pBaseTx->signature))
+                continue;
+
+            CPubKey pubKey;
+            CAccount account;
+            if (pBaseTx->txUid.is<CPubKey>())
+                pubKey = pBaseTx->txUid.get<CPubKey>();
+            else if (accountCache.GetAccount(pBaseTx->txUid, account))
+                pubKey = account.owner_pubkey;
+
+            if (pubKey.IsFullyValid())
+                pItem->senders.emplace_back(index, pubKey);
+        }
+    }
+
+    boost::unique_lock<boost::mutex> lock(mutex);
+    for (auto &pItem : resolving) {
+        if (!IsStale(*pItem) && !pItem->senders.empty()) {
+            verifyQueue.push_back(pItem);
+            condWorker.notify_one();
+        }
+    }
+}
+
+void CBlockPrefetcher::Thread() {
+    while (true) {
+        ItemPtr pItem;
+        bool fVerify;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (!fQuit && readQueue.empty() && verifyQueue.empty())
+                condWorker.wait(lock);
+
+            if (fQuit)
+                return;
+
+            // the signatures are of the blocks nearer to the tip
+            fVerify = !verifyQueue.empty();
+            std::deque<ItemPtr> &queue = fVerify ? verifyQueue : readQueue;
+            pItem = queue.front();
+            queue.pop_front();
+            if (IsStale(*pItem))
+                continue;
+        }
+
+        if (fVerify) {
+            Verify(*pItem);
+            continue;
+        }
+
+        Read(*pItem);
+        if (pItem->spBlock) {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (!IsStale(*pItem))
+                resolveList.push_back(pItem);
+        }
+    }
+}
+
+void CBlockPrefetcher::Read(CItem &item) {
+    int64_t nStart = GetTimeMicros();
+    auto spBlock   = std::make_shared<CBlock>();
+    if (!blockReadCache.Peek(item.hash, *spBlock)) {
+        if (!ReadBlockFromDisk(item.pos, *spBlock) || spBlock->GetHash() != item.hash) {
+            // ConnectTip() reads it again and reports the error
+            LogPrint(BCLog::ERROR, "CBlockPrefetcher::Read, failed to read block [%d]: %s\n", item.height,
+                     item.hash.GetHex());
+            return;
+        }
+
+        // the tx hashes are kept by the copies taken from the cache
+        spBlock->BuildMerkleTree();
+        blockReadCache.Add(*spBlock, ::GetSerializeSize(*spBlock, SER_DISK, CLIENT_VERSION));
+    }
+
+    item.spBlock   = spBlock;
+    item.nReadTime = GetTimeMicros() - nStart;
+}
+
+void CBlockPrefetcher::Verify(CItem &item) {
+    int64_t nStart     = GetTimeMicros();
+    uint32_t nVerified = 0;
+    for (const auto &sender : item.senders) {
+        // the block has been connected meanwhile
+        if (IsStale(item))
+            break;
+
+        CBaseTx *pBaseTx = item.spBlock->vptx[sender.first].get();
+        // a failed signature is not cached, CheckBlock() fails the block
+        if (::VerifySignature(pBaseTx->GetHash(), pBaseTx->signature, sender.second))
+            nVerified++;
+    }
+
+    if (SysCfg().IsBenchmark())
+        LogPrint(BCLog::INFO, "- Prefetch block [%d]: read %.2fms, verify %u/%u signatures %.2fms\n", item.height,
+                 item.nReadTime * 0.001, nVerified, item.senders.size(), (GetTimeMicros() - nStart) * 0.001);
+}
+
+void CBlockPrefetcher::Quit() {
+    boost::unique_lock<boost::mutex> lock(mutex);
+    fQuit = true;
+    readQueue.clear();
+    verifyQueue.clear();
+    resolveList.clear();
+    condWorker.notify_all();
+}
+
+void ThreadBlockPrefetch() {
+    RenameThread("coin-prefetch");
+    blockPrefetcher.Thread();
+}
+
+void StopBlockPrefetchThreads() { blockPrefetcher.Quit(); }
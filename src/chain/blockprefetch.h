@@ -0,0 +1,88 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef CHAIN_BLOCKPREFETCH_H
+#define CHAIN_BLOCKPREFETCH_H
+
+#include "commons/uint256.h"
+#include "entities/key.h"
+#include "persistence/block.h"
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+using namespace std;
+
+class CAccountDBCache;
+class CChain;
+
+/**
+ * Prepares the blocks ahead of the active tip while ConnectTip() connects the tip, when more than one block is
+ * to be connected, e.g. in the initial block download or a reindex. The blocks pass three stages:
+ *   1. the prefetch threads read and deserialize the block, hash its txs and build its merkle tree, and put it
+ *      into blockReadCache, where ConnectTip() finds it;
+ *   2. the connect thread looks up the owner pubkeys of the senders in the chain state it holds cs_main for;
+ *   3. the prefetch threads verify the sender signatures into the signature cache, where CheckBlock() finds them.
+ * The connect stage is left with the tx execution and the undo. A block whose senders are registered by the
+ * blocks still ahead of it is checked by CheckBlock() as before, nothing here affects the validation result.
+ */
+class CBlockPrefetcher {
+public:
+    explicit CBlockPrefetcher(uint32_t nWindowIn) : nWindow(nWindowIn) {}
+
+    //! The number of blocks prepared ahead of the block being connected, 0 to disable
+    void SetWindow(uint32_t nWindowIn);
+
+    // Called by the connect thread before connecting the block next to the tip, requires cs_main. Queues the
+    // blocks of chainMostWork after that block, and hands the read blocks over to the signature stage.
+    void Prefetch(const CChain &chainMostWork, int32_t tipHeight, CAccountDBCache &accountCache);
+
+    //! Worker thread
+    void Thread();
+
+    //! Stop all worker threads
+    void Quit();
+
+private:
+    struct CItem {
+        uint256 hash;
+        int32_t height;
+        CDiskBlockPos pos;
+        std::shared_ptr<CBlock> spBlock;          //!< private copy of the block, once read
+        vector<pair<uint32_t, CPubKey>> senders;  //!< tx index -> pubkey of the signature to verify
+        int64_t nReadTime = 0;                    //!< in micro seconds
+    };
+    typedef std::shared_ptr<CItem> ItemPtr;
+
+    void Read(CItem &item);
+    void Verify(CItem &item);
+    bool IsStale(const CItem &item) const { return item.height <= nTipHeight; }
+
+    boost::mutex mutex;
+    boost::condition_variable condWorker;
+
+    std::deque<ItemPtr> readQueue;
+    std::deque<ItemPtr> verifyQueue;
+    vector<ItemPtr> resolveList;              //!< read, waiting for the connect thread to look up the senders
+    std::map<uint256, int32_t> mapRequested;  //!< block hash -> height, of all blocks queued ahead of the tip
+    uint32_t nWindow;
+    std::atomic<int32_t> nTipHeight{0};       //!< the blocks up to it are connected already
+    bool fQuit = false;
+};
+
+extern CBlockPrefetcher blockPrefetcher;
+
+/** Run an instance of the block prefetch thread */
+void ThreadBlockPrefetch();
+/** Stop all block prefetch threads */
+void StopBlockPrefetchThreads();
+
+#endif  // CHAIN_BLOCKPREFETCH_H
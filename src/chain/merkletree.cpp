@@ -9,20 +9,24 @@
 // class CPartialMerkleTree
 
 uint256 CPartialMerkleTree::CalcHash(int32_t height, uint32_t pos, const vector<uint256> &vTxid) {
-    if (height == 0) {
-        // hash at height 0 is the txids themself
+    // hash at height 0 is the txids themself
+    if (height == 0)
         return vTxid[pos];
-    } else {
-        // calculate left hash
-        uint256 left = CalcHash(height - 1, pos * 2, vTxid), right;
-        // calculate right hash if not beyond the end of the array - copy left hash otherwise1
-        if (pos * 2 + 1 < CalcTreeWidth(height - 1))
-            right = CalcHash(height - 1, pos * 2 + 1, vTxid);
-        else
-            right = left;
-        // combine subhashes
-        return Hash(BEGIN(left), END(left), BEGIN(right), END(right));
+
+    // hash the subtree level by level from its txids, each level in one batch. The subtree is cut only at the
+    // end of the array, so the last node of an odd level has no right node and is combined with itself.
+    uint32_t begin = pos << height;
+    uint32_t end   = std::min<uint32_t>((pos + 1) << height, nTransactions);
+    vector<uint256> level(vTxid.begin() + begin, vTxid.begin() + end), next;
+    for (int32_t i = 0; i < height; i++) {
+        if (level.size() & 1)
+            level.push_back(level.back());
+
+        next.resize(level.size() / 2);
+        HashPairs(next.data(), level.data(), next.size());
+        level.swap(next);
     }
+    return level[0];
 }
 
 void CPartialMerkleTree::TraverseAndBuild(int32_t height, uint32_t pos, const vector<uint256> &vTxid, const vector<bool> &vMatch) {
@@ -70,7 +74,7 @@ uint256 CPartialMerkleTree::TraverseAndExtract(int32_t height, uint32_t pos,
         else
             right = left;
         // and combine them before returning
-        return Hash(BEGIN(left), END(left), BEGIN(right), END(right));
+        return HashPair(left, right);
     }
 }
 
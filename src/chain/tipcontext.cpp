@@ -0,0 +1,51 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "tipcontext.h"
+
+#include "main.h"
+#include "miner/miner.h"
+
+CTipContext::CTipContext(CBlockIndex *pTipIn, CSysParamDBCache *pSysParamCache)
+    : pTip(pTipIn),
+      height(pTipIn != nullptr ? pTipIn->height : 0),
+      fuelRate(GetElementForBurn(pTipIn)),
+      blockTime(pTipIn != nullptr ? pTipIn->GetBlockTime() : 0),
+      prevBlockTime(pTipIn != nullptr && pTipIn->pprev != nullptr ? pTipIn->pprev->GetBlockTime() : blockTime),
+      forkVersion(GetFeatureForkVersion(height)),
+      nextForkVersion(GetFeatureForkVersion(height + 1)) {
+    if (pSysParamCache == nullptr)
+        return;
+
+    for (const auto &item : kTxFeeTable) {
+        for (const auto &symbol : {SYMB::WICC, SYMB::WUSD}) {
+            uint64_t fee = 0;
+            if (pSysParamCache->GetMinerFee(item.first, symbol, fee))
+                minerFees.emplace(std::make_pair(item.first, symbol), fee);
+        }
+    }
+}
+
+bool CTipContext::GetMinerFee(TxType txType, const TokenSymbol &symbol, uint64_t &fee) const {
+    auto it = minerFees.find(std::make_pair(txType, symbol));
+    if (it == minerFees.end())
+        return false;
+
+    fee = it->second;
+    return true;
+}
+
+std::shared_ptr<const CTipContext> GetTipContext() {
+    static CCriticalSection csTipContext;
+    static std::shared_ptr<const CTipContext> pTipContext;
+
+    LOCK(csTipContext);
+    CBlockIndex *pTip = chainActive.Tip();
+    if (!pTipContext || pTipContext->pTip != pTip) {
+        pTipContext = std::make_shared<CTipContext>(pTip, pCdMan != nullptr ? pCdMan->pSysParamCache : nullptr);
+        LogPrint(BCLog::DEBUG, "GetTipContext() : height=%d, fuel_rate=%u\n", pTipContext->height, pTipContext->fuelRate);
+    }
+
+    return pTipContext;
+}
@@ -0,0 +1,47 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef CHAIN_TIPCONTEXT_H
+#define CHAIN_TIPCONTEXT_H
+
+#include "commons/types.h"
+#include "config/configuration.h"
+#include "config/txbase.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+
+class CBlockIndex;
+class CSysParamDBCache;
+
+/**
+ * What executing txs on top of the active tip needs from the chain, computed once when the tip changes instead
+ * of for every tx: the fuel rate of the next block, which GetElementForBurn() computes by walking back
+ * -blocksizeforburn blocks, the block times, the feature fork versions, and the miner fees set by proposals in
+ * the tip state. It is immutable, so it is shared by all execution contexts.
+ */
+class CTipContext {
+public:
+    CTipContext(CBlockIndex *pTipIn, CSysParamDBCache *pSysParamCache);
+
+    CBlockIndex *pTip;
+    int32_t height;                          //!< of the tip
+    uint32_t fuelRate;                       //!< of the next block
+    uint32_t blockTime;                      //!< of the tip
+    uint32_t prevBlockTime;                  //!< of the block before the tip
+    FeatureForkVersionEnum forkVersion;      //!< of the tip
+    FeatureForkVersionEnum nextForkVersion;  //!< of the next block
+
+    // the miner fee set by proposals in the tip state, false if the default fee of the tx type applies
+    bool GetMinerFee(TxType txType, const TokenSymbol &symbol, uint64_t &fee) const;
+
+private:
+    std::map<std::pair<TxType, TokenSymbol>, uint64_t> minerFees;
+};
+
+/** The context of the active tip, rebuilt on the first call after the tip changes. Requires cs_main. */
+std::shared_ptr<const CTipContext> GetTipContext();
+
+#endif  // CHAIN_TIPCONTEXT_H
@@ -65,6 +65,7 @@ public:
         //     << "\nacutal blockhash: " << genesisBlockHash.GetHex() << "\r\n";
 
         assert(genesisBlockHash == IniCfg().GetGenesisBlockHash(MAIN_NET));
+        defaultAssumeValid = IniCfg().GetDefaultAssumeValid(MAIN_NET);
         // assert(genesis.GetMerkleRootHash() == IniCfg().GetMerkleRootHash());
 
         vSeeds.push_back(CDNSSeedData("seed1.waykichain.net", "n1.waykichain.net"));
@@ -135,6 +136,7 @@ public:
         //     << "\nacutal blockhash: " << genesisBlockHash.GetHex() << "\r\n";
 
         assert(genesisBlockHash == IniCfg().GetGenesisBlockHash(TEST_NET));
+        defaultAssumeValid = IniCfg().GetDefaultAssumeValid(TEST_NET);
         vSeeds.push_back(CDNSSeedData("seed1.waykitest.net", "n1.waykitest.net"));
         vSeeds.push_back(CDNSSeedData("seed2.waykitest.net", "n2.waykitest.net"));
 
@@ -185,6 +187,7 @@ public:
         genesis.SetMerkleRootHash(genesis.BuildMerkleTree());
         genesisBlockHash = genesis.GetHash();
         assert(genesisBlockHash == IniCfg().GetGenesisBlockHash(REGTEST_NET));
+        defaultAssumeValid = IniCfg().GetDefaultAssumeValid(REGTEST_NET);
 
         vFixedSeeds.clear();
         vSeeds.clear();  // Regtest mode doesn't have any DNS seeds.
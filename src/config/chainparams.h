@@ -181,6 +181,7 @@ public:
     virtual uint64_t GetMaxFee() const { return 1000 * COIN; }
     virtual const CBlock& GenesisBlock() const = 0;
     const uint256& GetGenesisBlockHash() const { return genesisBlockHash; }
+    const uint256& GetDefaultAssumeValid() const { return defaultAssumeValid; }
     bool CreateGenesisBlockRewardTx(vector<std::shared_ptr<CBaseTx> >& vptx, NET_TYPE type);
     bool CreateGenesisDelegateTx(vector<std::shared_ptr<CBaseTx> >& vptx, NET_TYPE type);
     bool CreateFundCoinRewardTx(vector<std::shared_ptr<CBaseTx> >& vptx, NET_TYPE type);
@@ -218,6 +219,7 @@ protected:
     CBaseParams();
 
     uint256 genesisBlockHash;
+    uint256 defaultAssumeValid;
     MessageStartChars pchMessageStart;
     // Raw pub key bytes for the broadcast alert signing key.
     vector<uint8_t> vAlertPubKey;
@@ -39,6 +39,11 @@ uint256 G_CONFIG_TABLE::GetGenesisBlockHash(const NET_TYPE type) const {
     return uint256S(genesisBlockHash[type]);
 }
 
+uint256 G_CONFIG_TABLE::GetDefaultAssumeValid(const NET_TYPE type) const {
+    assert(type >= 0 && type < 3);
+    return uint256S(defaultAssumeValid[type]);
+}
+
 const string G_CONFIG_TABLE::GetAlertPkey(const NET_TYPE type) const {
     assert(type >= 0 && type < 2);
     return AlertPubKey[type];
@@ -195,6 +200,13 @@ string G_CONFIG_TABLE::genesisBlockHash[3] = {
     "7d06f69186e0fe39b9c40417d448fd36b43f193a2cee1ccae7f99b181080ee40",     //testnet
     "0xab8d8b1d11784098108df399b247a0b80049de26af1b9c775d550228351c768d"};  //regtest
 
+// The signatures of its ancestors are assumed valid, see -assumevalid. Set on each release to a block buried
+// deep enough in the main chain and checked against several synced nodes; empty means verifying all.
+string G_CONFIG_TABLE::defaultAssumeValid[3] = {
+    "",     //mainnet
+    "",     //testnet
+    ""};    //regtest
+
 // Merkle Root Hash
 string G_CONFIG_TABLE::MerkleRootHash = "0x16b211137976871bb062e211f08b2f70a60fa8651b609823f298d1a3d3f3e05d";
 
@@ -32,6 +32,7 @@ public:
     const vector<string> GetInitPubKey(const NET_TYPE type) const;
     uint8_t GetGenesisBlockNonce(const NET_TYPE type) const;
     uint256 GetGenesisBlockHash(const NET_TYPE type) const;
+    uint256 GetDefaultAssumeValid(const NET_TYPE type) const;
     string GetDelegateSignature(const NET_TYPE type) const;
     const vector<string> GetDelegatePubKey(const NET_TYPE type) const;
     const uint256 GetMerkleRootHash() const;
@@ -68,6 +69,9 @@ private:
     /* gensis block hash */
     static string genesisBlockHash[3];
 
+    /* default -assumevalid block hash */
+    static string defaultAssumeValid[3];
+
     /* alert public key */
     static string AlertPubKey[2];
 
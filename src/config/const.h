@@ -128,6 +128,32 @@ static const int64_t DEFAULT_DB_CACHE = 100;
 static const int64_t MAX_DB_CACHE = sizeof(void *) > 4 ? 4096 : 1024;
 /** min. -dbcache in (MiB) */
 static const int64_t MIN_DB_CACHE = 4;
+/** -blockreadcache default (MiB) */
+static const int64_t DEFAULT_BLOCK_READ_CACHE = 64;
+/** -maxsigcachesize default (MiB), the option was a number of entries before */
+static const int64_t DEFAULT_MAX_SIG_CACHE_SIZE = 32;
+/** max. -maxsigcachesize (MiB), an old setting in entries (e.g. 50000) must not allocate tens of GB */
+static const int64_t MAX_MAX_SIG_CACHE_SIZE = 1024;
+/** -maxmempool default (MiB) */
+static const int64_t DEFAULT_MAX_MEMPOOL_SIZE = 300;
+/** The half life (in seconds) of the minimum fees per kB raised by the evictions from the full mempool */
+static const int64_t MEMPOOL_MIN_FEE_HALFLIFE = 60 * 60;
+/** -prefetchblocks default */
+static const int32_t DEFAULT_PREFETCH_BLOCKS = 16;
+/** Number of threads preparing the blocks ahead of the active tip */
+static const int32_t BLOCK_PREFETCH_THREADS = 2;
+/** -maxforkcache default (MiB) */
+static const int64_t DEFAULT_MAX_FORK_CACHE_SIZE = 64;
+/** -txadmissionthreads default */
+static const int32_t DEFAULT_TX_ADMISSION_THREADS = 2;
+/** Maximum number of txs taken by one tx admission thread at a time */
+static const uint32_t TX_ADMISSION_BATCH_SIZE = 128;
+/** Maximum number of txs waiting for admission, the txs beyond it are admitted by the message handler */
+static const uint32_t MAX_TX_ADMISSION_QUEUE_SIZE = 20000;
+/** Maximum number of signature checking threads allowed by -par */
+static const int32_t MAX_SIGCHECK_THREADS = 16;
+/** Maximum number of chainstate flushes waiting for the flush thread before a new flush blocks */
+static const uint32_t MAX_PENDING_FLUSHES = 4;
 
 /** Coinbase transaction outputs can only be spent after this number of new blocks (network rule) */
 static const int32_t BLOCK_REWARD_MATURITY = 100;
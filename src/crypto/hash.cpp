@@ -4,6 +4,13 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "hash.h"
+#include "sha256.h"
+
+void HashPairs(uint256 *out, const uint256 *in, size_t pairs) {
+    static_assert(sizeof(uint256) == 32, "the hashes must be packed in 64-byte blocks");
+    if (pairs > 0)
+        SHA256D64(out->begin(), in->begin(), pairs);
+}
 
 inline uint32_t ROTL32(uint32_t x, int8_t r) { return (x << r) | (x >> (32 - r)); }
 
@@ -98,6 +98,20 @@ inline uint256 Hash(const T1 p1begin, const T1 p1end, const T2 p2begin, const T2
     return hash2;
 }
 
+/**
+ * The double SHA256 of each pair of adjacent hashes, out[i] = Hash(in[2 * i], in[2 * i + 1]), as the nodes of a
+ * merkle tree level. The pairs are hashed in batches by the multi-way SHA256 implementation selected by
+ * SHA256AutoDetect(), out must not overlap in.
+ */
+void HashPairs(uint256 *out, const uint256 *in, size_t pairs);
+
+inline uint256 HashPair(const uint256 &left, const uint256 &right) {
+    uint256 in[2] = {left, right};
+    uint256 out;
+    HashPairs(&out, in, 1);
+    return out;
+}
+
 template <typename C>
 inline uint256 Hash(const basic_string<C>& str) {
     return Hash(str.begin(), str.end()) ;
@@ -12,6 +12,7 @@
 #include "init.h"
 #include "config/configuration.h"
 #include "p2p/addrman.h"
+#include "p2p/compactblock.h"
 
 #include "rpc/core/rpcserver.h"
 #include "vm/luavm/lua/lua.h"
@@ -25,6 +26,9 @@
 #include "persistence/txdb.h"
 #include "persistence/contractdb.h"
 #include "tx/tx.h"
+#include "tx/txadmission.h"
+#include "chain/blockprefetch.h"
+#include "crypto/sha256.h"
 #include "commons/util/util.h"
 #include "commons/util/time.h"
 #ifdef USE_UPNP
@@ -140,6 +144,10 @@ void Shutdown() {
     StartContractGeneration("", 0, 0);
 
     StopNode();
+    StopSignatureCheckThreads();
+    StopTxExecuteThreads();
+    StopTxAdmissionThreads();
+    StopBlockPrefetchThreads();
     UnregisterNodeSignals(GetNodeSignals());
 
     {
@@ -152,6 +160,7 @@ void Shutdown() {
 
         if (pCdMan != nullptr) {
             pCdMan->Flush();
+            pCdMan->pTxCache->WriteSnapshot(GetDataDir() / "txcache.dat");
             delete pCdMan;
             pCdMan = nullptr;
         }
@@ -205,7 +214,10 @@ string HelpMessage() {
     string strUsage = _("Options:") + "\n";
     strUsage += "  -?                     " + _("This help message") + "\n";
     strUsage += "  -alertnotify=<cmd>     " + _("Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)") + "\n";
+    strUsage += "  -assumevalid=<hex>     " + _("Skip verifying the tx signatures of the ancestors of this block (0 to verify all, default: the release's block)") + "\n";
+    strUsage += "  -asyncflush            " + _("Write the chain state to disk in a background thread (default: 1)") + "\n";
     strUsage += "  -blocknotify=<cmd>     " + _("Execute command when the best block changes (%s in cmd is replaced by block hash)") + "\n";
+    strUsage += "  -blockreadcache=<n>    " + strprintf(_("Set the cache size of the decoded recent blocks in megabytes (0 to disable, default: %d)"), DEFAULT_BLOCK_READ_CACHE) + "\n";
     strUsage += "  -checkblocks=<n>       " + _("How many blocks to check at startup (default: 288, 0 = all)") + "\n";
     strUsage += "  -checklevel=<n>        " + _("How thorough the block verification of -checkblocks is (0-4, default: 3)") + "\n";
     strUsage += "  -conf=<file>           " + _("Specify configuration file (default: ") + IniCfg().GetCoinName() + ".conf)" + "\n";
@@ -215,8 +227,15 @@ string HelpMessage() {
     strUsage += "  -datadir=<dir>         " + _("Specify data directory") + "\n";
     strUsage += "  -dbcache=<n>           " + strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), MIN_DB_CACHE, MAX_DB_CACHE, DEFAULT_DB_CACHE) + "\n";
     strUsage += "  -loadblock=<file>      " + _("Imports blocks from external blk000??.dat file") + " " + _("on startup") + "\n";
+    strUsage += "  -maxforkcache=<n>      " + strprintf(_("Keep the chain state deltas of the forked chains under <n> megabytes, evicting the least recently used (default: %d)"), DEFAULT_MAX_FORK_CACHE_SIZE) + "\n";
+    strUsage += "  -maxmempool=<n>        " + strprintf(_("Keep the serialized transactions in the memory pool under <n> megabytes, evicting the lowest fees per kB (default: %d)"), DEFAULT_MAX_MEMPOOL_SIZE) + "\n";
+    strUsage += "  -par=<n>               " + strprintf(_("Set the number of signature verification threads (up to %d, 0 = auto, <0 = leave that many cores free, default: 0)"), MAX_SIGCHECK_THREADS) + "\n";
+    strUsage += "  -parexec               " + _("Execute independent transactions of a block in parallel on the -par threads (default: 1)") + "\n";
     strUsage += "  -pid=<file>            " + _("Specify pid file (default: coin.pid)") + "\n";
+    strUsage += "  -prefetchblocks=<n>    " + strprintf(_("Read and check <n> blocks ahead of the block being connected when catching up (0 to disable, default: %d)"), DEFAULT_PREFETCH_BLOCKS) + "\n";
     strUsage += "  -reindex               " + _("Rebuild block chain index from current blk000??.dat files") + " " + _("on startup") + "\n";
+    strUsage += "  -singledb              " + _("Store the chain state in one database, committing each flush atomically; migrates an existing chain state (default: 0)") + "\n";
+    strUsage += "  -txadmissionthreads=<n> " + strprintf(_("Set the number of threads verifying the transactions from peers outside the chain state lock (0 = verify them in the message handler, default: %d)"), DEFAULT_TX_ADMISSION_THREADS) + "\n";
     strUsage += "  -txindex               " + _("Maintain a full transaction index (default: 0)") + "\n";
     strUsage += "  -logfailures           " + _("Log failures into level db in detail (default: 0)") + "\n";
     strUsage += "  -genreceipt               " + _("Whether generate receipt(default: 0)") + "\n";
@@ -226,6 +245,7 @@ string HelpMessage() {
     strUsage += "  -banscore=<n>          " + _("Threshold for disconnecting misbehaving peers (default: 100)") + "\n";
     strUsage += "  -bantime=<n>           " + _("Number of seconds to keep misbehaving peers from reconnecting (default: 86400)") + "\n";
     strUsage += "  -bind=<addr>           " + _("Bind to given address and always listen on it. Use [host]:port notation for IPv6") + "\n";
+    strUsage += "  -compactblocks         " + strprintf(_("Relay the new blocks as compact blocks to the peers which ask for them, and ask for them (default: %u)"), DEFAULT_COMPACT_BLOCKS) + "\n";
     strUsage += "  -connect=<ip>          " + _("Connect only to the specified node(s)") + "\n";
     strUsage += "  -discover              " + _("Discover own IP address (default: 1 when listening and no -externalip)") + "\n";
     strUsage += "  -dns                   " + _("Allow DNS lookups for -addnode, -seednode and -connect") + " " + _("(default: 1)") + "\n";
@@ -236,6 +256,7 @@ string HelpMessage() {
     strUsage += "  -maxconnections=<n>    " + _("Maintain at most <n> connections to peers (default: 125)") + "\n";
     strUsage += "  -maxreceivebuffer=<n>  " + _("Maximum per-connection receive buffer, <n>*1000 bytes (default: 5000)") + "\n";
     strUsage += "  -maxsendbuffer=<n>     " + _("Maximum per-connection send buffer, <n>*1000 bytes (default: 1000)") + "\n";
+    strUsage += "  -msghandlerthreads=<n> " + strprintf(_("Set the number of threads processing the peer messages, each peer is handled by one of them (1 to %d, default: %d)"), MAX_MESSAGE_HANDLER_THREADS, DEFAULT_MESSAGE_HANDLER_THREADS) + "\n";
     strUsage += "  -onion=<ip:port>       " + _("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: -proxy)") + "\n";
     strUsage += "  -onlynet=<net>         " + _("Only connect to nodes in network <net> (IPv4, IPv6 or Tor)") + "\n";
     strUsage += "  -port=<port>           " + _("Listen for connections on <port> (default: 8333 or testnet: 18333)") + "\n";
@@ -243,6 +264,7 @@ string HelpMessage() {
     strUsage += "  -ipserver=<server>     " + _("IP Reporting Service") + "\n";
     strUsage += "  -seednode=<ip>         " + _("Connect to a node to retrieve peer addresses, and disconnect") + "\n";
     strUsage += "  -socks=<n>             " + _("Select SOCKS version for -proxy (4 or 5, default: 5)") + "\n";
+    strUsage += "  -socketevents=<mode>   " + strprintf(_("Wait for the peer sockets with <mode>, epoll or select (default: %s)"), DEFAULT_SOCKET_EVENTS) + "\n";
     strUsage += "  -timeout=<n>           " + _("Specify connection timeout in milliseconds (default: 5000)") + "\n";
 #ifdef USE_UPNP
 #if USE_UPNP
@@ -285,7 +307,7 @@ string HelpMessage() {
     strUsage += "  -logtimestamps         " + _("Prepend debug output with timestamp (default: 1)") + "\n";
     if (SysCfg().GetBoolArg("-help-debug", false)) {
         strUsage += "  -limitfreerelay=<n>    " + _("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default:15)") + "\n";
-        strUsage += "  -maxsigcachesize=<n>   " + _("Limit size of signature cache to <n> entries (default: 50000)") + "\n";
+        strUsage += "  -maxsigcachesize=<n>   " + strprintf(_("Limit size of signature cache to <n> megabytes, not entries (0 to %d, default: %d)"), MAX_MAX_SIG_CACHE_SIZE, DEFAULT_MAX_SIG_CACHE_SIZE) + "\n";
     }
     strUsage += "  -logprinttoconsole     " + _("Send trace/debug info to console instead of debug.log file") + "\n";
     if (SysCfg().GetBoolArg("-help-debug", false)) {
@@ -493,10 +515,16 @@ bool AppInit(boost::thread_group &threadGroup) {
             LogPrint(BCLog::INFO, "AppInit : parameter interaction: -salvagewallet=1 -> setting -rescan=1\n");
     }
 
+    string strSocketEventsError;
+    if (!InitSocketEvents(SysCfg().GetArg("-socketevents", DEFAULT_SOCKET_EVENTS), strSocketEventsError))
+        return InitError(strSocketEventsError);
+
     // Make sure enough file descriptors are available
     int32_t nBind   = max((int32_t)SysCfg().IsArgCount("-bind"), 1);
     nMaxConnections = SysCfg().GetArg("-maxconnections", 125);
-    nMaxConnections = max(min(nMaxConnections, (int32_t)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
+    // only select() is limited to the sockets below FD_SETSIZE
+    if (nSocketEventsMode == SOCKETEVENTS_SELECT)
+        nMaxConnections = max(min(nMaxConnections, (int32_t)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
     int32_t nFD     = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
@@ -505,7 +533,31 @@ bool AppInit(boost::thread_group &threadGroup) {
         nMaxConnections = nFD - MIN_CORE_FILEDESCRIPTORS;
 
     SysCfg().SetBenchMark(SysCfg().GetBoolArg("-benchmark", false));
+
+    // -par=0 means autodetect, but nSigCheckThreads==0 means no concurrency
+    nSigCheckThreads = SysCfg().GetArg("-par", 0);
+    if (nSigCheckThreads <= 0)
+        nSigCheckThreads += boost::thread::hardware_concurrency();
+    if (nSigCheckThreads <= 1)
+        nSigCheckThreads = 0;
+    else if (nSigCheckThreads > MAX_SIGCHECK_THREADS)
+        nSigCheckThreads = MAX_SIGCHECK_THREADS;
+    fParallelTxExecute = SysCfg().GetBoolArg("-parexec", true);
+
+    int64_t nBlockReadCache = SysCfg().GetArg("-blockreadcache", DEFAULT_BLOCK_READ_CACHE);
+    blockReadCache.SetMaxSize(std::max<int64_t>(nBlockReadCache, 0) << 20);
+    int64_t nSigCacheSize = SysCfg().GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE);
+    if (nSigCacheSize > MAX_MAX_SIG_CACHE_SIZE) {
+        LogPrint(BCLog::INFO, "AppInit : -maxsigcachesize=%d is in megabytes (was entries), limited to %d\n",
+                 nSigCacheSize, MAX_MAX_SIG_CACHE_SIZE);
+        nSigCacheSize = MAX_MAX_SIG_CACHE_SIZE;
+    }
+    signatureCache.Setup(std::max<int64_t>(nSigCacheSize, 0) << 20);
     mempool.SetSanityCheck(SysCfg().GetBoolArg("-checkmempool", RegTest()));
+    int64_t nMaxMempool = SysCfg().GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE);
+    mempool.SetMaxSize(std::max<int64_t>(nMaxMempool, 0) << 20);
+    int64_t nMaxForkCache = SysCfg().GetArg("-maxforkcache", DEFAULT_MAX_FORK_CACHE_SIZE);
+    forkCache.SetMaxSize(std::max<int64_t>(nMaxForkCache, 0) << 20);
 
     setvbuf(stdout, nullptr, _IOLBF, 0);
 
@@ -546,6 +598,7 @@ bool AppInit(boost::thread_group &threadGroup) {
     string leveldb_version = strprintf("%d.%d", leveldb::kMajorVersion, leveldb::kMinorVersion);
     LogPrint(BCLog::INFO, "Using Level DB version %s\n", leveldb_version);
     LogPrint(BCLog::INFO, "Using Berkeley DB version %s\n", DB_VERSION_STRING);
+    LogPrint(BCLog::INFO, "Using the '%s' SHA256 implementation\n", SHA256AutoDetect());
 
 #ifdef USE_UPNP
     LogPrint(BCLog::INFO, "Using miniupnpc version %s,API version %d\n", MINIUPNPC_VERSION, MINIUPNPC_API_VERSION);
@@ -553,7 +606,33 @@ bool AppInit(boost::thread_group &threadGroup) {
     LogPrint(BCLog::INFO, "Startup time: %s\n", DateTimeStrFormat("%Y-%m-%d %H:%M:%S", GetTime()));
     LogPrint(BCLog::INFO, "Default data directory %s\n", GetDefaultDataDir().string());
     LogPrint(BCLog::INFO, "Using data directory %s\n", strDataDir);
-    LogPrint(BCLog::INFO, "Using at most %i connections (%i file descriptors available)\n", nMaxConnections, nFD);
+    LogPrint(BCLog::INFO, "Using at most %i connections (%i file descriptors available), waiting with %s\n",
+             nMaxConnections, nFD, nSocketEventsMode == SOCKETEVENTS_EPOLL ? "epoll" : "select");
+
+    if (nSigCheckThreads) {
+        LogPrint(BCLog::INFO, "Using %u threads for signature verification\n", nSigCheckThreads);
+        for (int32_t i = 0; i < nSigCheckThreads - 1; i++)
+            threadGroup.create_thread(&ThreadSignatureCheck);
+
+        if (fParallelTxExecute) {
+            for (int32_t i = 0; i < nSigCheckThreads - 1; i++)
+                threadGroup.create_thread(&ThreadTxExecute);
+        }
+    }
+
+    int32_t nTxAdmissionThreads = SysCfg().GetArg("-txadmissionthreads", DEFAULT_TX_ADMISSION_THREADS);
+    if (nTxAdmissionThreads > 0) {
+        LogPrint(BCLog::INFO, "Using %d threads for tx admission\n", nTxAdmissionThreads);
+        for (int32_t i = 0; i < nTxAdmissionThreads; i++)
+            threadGroup.create_thread(&ThreadTxAdmission);
+    }
+
+    int32_t nPrefetchBlocks = SysCfg().GetArg("-prefetchblocks", DEFAULT_PREFETCH_BLOCKS);
+    blockPrefetcher.SetWindow(std::max<int32_t>(nPrefetchBlocks, 0));
+    if (nPrefetchBlocks > 0) {
+        for (int32_t i = 0; i < BLOCK_PREFETCH_THREADS; i++)
+            threadGroup.create_thread(&ThreadBlockPrefetch);
+    }
 
     RegisterNodeSignals(GetNodeSignals());
 
@@ -675,6 +754,13 @@ bool AppInit(boost::thread_group &threadGroup) {
         filesystem::create_directories(blocksDir);
     }
 
+    if (SysCfg().GetBoolArg("-singledb", false)) {
+        if (!SysCfg().IsReindex() && !CCacheDBManager::MigrateToSingleDb(blocksDir))
+            return InitError(_("Failed to migrate the chain state into the single database"));
+    } else if (CCacheDBManager::IsSingleDbLayout(blocksDir)) {
+        return InitError(_("The chain state is stored in the single database, restart with -singledb"));
+    }
+
     try {
         pWalletMain = CWallet::GetInstance();
         RegisterWallet(pWalletMain);
@@ -759,6 +845,9 @@ bool AppInit(boost::thread_group &threadGroup) {
 
     LogPrint(BCLog::INFO, "Build %lu block indexes into memory (%lldms)\n", mapBlockIndex.size(), GetTimeMillis() - nStart);
 
+    // "0" is parsed as the null hash, which verifies all signatures
+    SetAssumeValid(uint256S(SysCfg().GetArg("-assumevalid", SysCfg().GetDefaultAssumeValid().GetHex())));
+
     if (SysCfg().GetBoolArg("-printblockindex", false) || SysCfg().GetBoolArg("-printblocktree", false)) {
         PrintBlockTree();
         return false;
@@ -789,22 +878,34 @@ bool AppInit(boost::thread_group &threadGroup) {
     if (!ActivateBestChain(state))
         return InitError("Failed to connect best block");
 
+    // Load the transaction memory cache from its snapshot, and read the blocks not in the snapshot (or
+    // not in the active chain any more) from disk.
     nStart                   = GetTimeMillis();
     CBlockIndex *pBlockIndex = chainActive.Tip();
     int32_t nCacheHeight     = SysCfg().GetTxCacheHeight();
     int32_t nCount           = 0;
+    int32_t nSnapshotCount   = 0;
+    boost::filesystem::path pathTxCache = GetDataDir() / "txcache.dat";
+    if (boost::filesystem::exists(pathTxCache) && !pCdMan->pTxCache->ReadSnapshot(pathTxCache, chainActive.Height()))
+        pCdMan->pTxCache->Clear();
+
     CBlock block;
     while (pBlockIndex && nCacheHeight-- > 0) {
-        if (!ReadBlockFromDisk(pBlockIndex, block))
-            return InitError("Failed to read block from disk");
+        if (pCdMan->pTxCache->HaveBlockTx(pBlockIndex->height, pBlockIndex->GetBlockHash())) {
+            ++nSnapshotCount;
+        } else {
+            if (!ReadBlockFromDisk(pBlockIndex, block))
+                return InitError("Failed to read block from disk");
 
-        if (!pCdMan->pTxCache->AddBlockTx(block))
-            return InitError("Failed to add block to transaction memory cache");
+            if (!pCdMan->pTxCache->AddBlockTx(block))
+                return InitError("Failed to add block to transaction memory cache");
+        }
 
         pBlockIndex = pBlockIndex->pprev;
         ++nCount;
     }
-    LogPrint(BCLog::INFO, "Added the latest %d blocks to transaction memory cache (%dms)\n", nCount, GetTimeMillis() - nStart);
+    LogPrint(BCLog::INFO, "Added the latest %d blocks to transaction memory cache, %d from snapshot (%dms)\n", nCount,
+             nSnapshotCount, GetTimeMillis() - nStart);
 
     nStart       = GetTimeMillis();
     pBlockIndex  = chainActive.Tip();
@@ -837,6 +938,11 @@ bool AppInit(boost::thread_group &threadGroup) {
         }
 
     }
+
+    fAsyncFlush = SysCfg().GetBoolArg("-asyncflush", true);
+    if (fAsyncFlush)
+        threadGroup.create_thread(&ThreadFlushChainState);
+
     threadGroup.create_thread(boost::bind(&ThreadImport, vImportFiles));
 
 
@@ -9,6 +9,7 @@
 #include "logging.h"
 #include "entities/id.h"
 #include "p2p/addrman.h"
+#include "p2p/compactblock.h"
 #include "alert.h"
 #include "config/chainparams.h"
 #include "config/configuration.h"
@@ -26,11 +27,16 @@
 #include "p2p/processmessage.hpp"
 #include "p2p/sendmessage.hpp"
 #include "chain/blockdelegates.h"
+#include "chain/tipcontext.h"
+#include "chain/blockprefetch.h"
 #include "persistence/blockundo.h"
 #include "tx/txserializer.h"
+#include "checkqueue.h"
 
 #include <sstream>
 #include <algorithm>
+#include <atomic>
+#include <limits>
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
@@ -56,8 +62,11 @@ CTxMemPool mempool;
 map<uint256, CBlockIndex *> mapBlockIndex;
 int32_t nSyncTipHeight = 0;
 string publicIp;
-map<uint256/* blockhash */, std::shared_ptr<CCacheWrapper>> mapForkCache;
+CForkCache forkCache(DEFAULT_MAX_FORK_CACHE_SIZE << 20);
 CSignatureCache signatureCache;
+int32_t nSigCheckThreads = 0;
+bool fParallelTxExecute = true;
+bool fAsyncFlush = false;
 CChain chainActive;
 CChain chainMostWork;
 bool mining;        // could change from time to time due to vote change
@@ -219,8 +228,8 @@ void UnregisterNodeSignals(CNodeSignals &nodeSignals) {
     nodeSignals.FinalizeNode.disconnect(&FinalizeNode);
 }
 
+// reads no chain state, so it is also called by the tx admission threads without cs_main
 bool IsStandardTx(CBaseTx *pBaseTx, string &reason) {
-    AssertLockHeld(cs_main);
     if (pBaseTx->nVersion > CBaseTx::CURRENT_VERSION || pBaseTx->nVersion < 1) {
         reason = "version";
         return false;
@@ -239,20 +248,95 @@ bool IsStandardTx(CBaseTx *pBaseTx, string &reason) {
     return true;
 }
 
-bool VerifySignature(const uint256 &sigHash, const std::vector<uint8_t> &signature, const CPubKey &pubKey) {
-    if (signatureCache.Get(sigHash, signature, pubKey))
+static CCheckQueue<CSignatureCheck> sigCheckQueue(128);
+
+void ThreadSignatureCheck() {
+    RenameThread("coin-sigcheck");
+    sigCheckQueue.Thread();
+}
+
+void StopSignatureCheckThreads() { sigCheckQueue.Quit(); }
+
+/** A transaction executed speculatively on a private child view of the block cache */
+class CTxSpeculativeExec {
+public:
+    std::shared_ptr<CBaseTx> pTx;
+    CTxExecuteContext context;
+    CCacheWrapper cw;
+    CValidationState state;
+    CDBReadTracker readTracker;
+    CTxUndo txUndo;
+    bool fExecuted;
+
+    CTxSpeculativeExec(const std::shared_ptr<CBaseTx> &pTxIn, const CTxExecuteContext &contextIn,
+                       CCacheWrapper &blockCw, std::mutex &baseMutex)
+        : pTx(pTxIn), context(contextIn), cw(&blockCw), readTracker(baseMutex), txUndo(pTxIn->GetHash()),
+          fExecuted(false) {
+        context.pCw    = &cw;
+        context.pState = &state;
+        cw.SetDbOpLogMap(&txUndo.dbOpLogMap);
+        cw.SetReadTracker(&readTracker);
+    }
+
+    void Execute() {
+        try {
+            fExecuted = pTx->ExecuteTx(context);
+        } catch (std::exception &e) {
+            // it will be executed again on the block cache, which reports the error
+            fExecuted = false;
+        }
+    }
+};
+
+/** Work item of txExecuteQueue, it never fails the queue, the result is kept in the CTxSpeculativeExec */
+class CTxExecuteCheck {
+private:
+    CTxSpeculativeExec *pExec;
+
+public:
+    CTxExecuteCheck() : pExec(nullptr) {}
+    CTxExecuteCheck(CTxSpeculativeExec *pExecIn) : pExec(pExecIn) {}
+
+    bool operator()() {
+        pExec->Execute();
+        return true;
+    }
+
+    void swap(CTxExecuteCheck &check) { std::swap(pExec, check.pExec); }
+};
+
+static CCheckQueue<CTxExecuteCheck> txExecuteQueue(1);
+
+void ThreadTxExecute() {
+    RenameThread("coin-txexec");
+    txExecuteQueue.Thread();
+}
+
+void StopTxExecuteThreads() { txExecuteQueue.Quit(); }
+
+void ThreadFlushChainState() {
+    RenameThread("coin-flush");
+    pCdMan->flushQueue.Thread();
+}
+
+bool VerifySignature(const uint256 &sigHash, const std::vector<uint8_t> &signature, const CPubKey &pubKey,
+                     bool fBlockCheck) {
+    if (signatureCache.Get(sigHash, signature, pubKey, fBlockCheck))
         return true;
 
     if (!pubKey.Verify(sigHash, signature))
         return false;
 
-    signatureCache.Set(sigHash, signature, pubKey);
+    if (!fBlockCheck)
+        signatureCache.Set(sigHash, signature, pubKey);
+
     return true;
 }
 
 bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBaseTx,
-                        bool fLimitFree, bool fRejectInsaneFee) {
+                        bool fLimitFree, bool fRejectInsaneFee, const CSerializedTxRef &pSerializedTx) {
     AssertLockHeld(cs_main);
+    int64_t nStart = GetTimeMicros();
 
     // is it already in the memory pool?
     uint256 hash = pBaseTx->GetHash();
@@ -274,16 +358,15 @@ bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBas
 
     auto spCW = std::make_shared<CCacheWrapper>(mempool.cw.get());
 
-    CBlockIndex *pTip =  chainActive.Tip();
-    uint32_t fuelRate  = GetElementForBurn(pTip);
-    uint32_t blockTime = pTip->GetBlockTime();
-    uint32_t prevBlockTime = pTip->pprev != nullptr ? pTip->pprev->GetBlockTime() : pTip->GetBlockTime();
-
-    CTxExecuteContext context(chainActive.Height(), 0, fuelRate, blockTime, prevBlockTime, spCW.get(), &state);
+    auto pTipContext = GetTipContext();
+    CTxExecuteContext context(pTipContext->height, 0, pTipContext->fuelRate, pTipContext->blockTime,
+                              pTipContext->prevBlockTime, spCW.get(), &state);
     if (!pBaseTx->CheckTx(context))
         return ERRORMSG("AcceptToMemoryPool() : CheckTx failed, txid: %s", hash.GetHex());
 
-    CTxMemPoolEntry entry(pBaseTx, GetTime(), chainActive.Height());
+    int64_t nTimeCheck = GetTimeMicros();
+    CTxMemPoolEntry entry(pBaseTx, GetTime(), chainActive.Height(), pSerializedTx);
+    entry.SetValidated();
     auto nFees = std::get<1>(entry.GetFees());
     auto nSize = entry.GetTxSize();
     // Continuously rate-limit free transactions
@@ -312,7 +395,27 @@ bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBas
     if (fRejectInsaneFee && nFees > SysCfg().GetMaxFee())
         return ERRORMSG("AcceptToMemoryPool() : txid: %s pay insane fees, %d > %d", hash.GetHex(), nFees, SysCfg().GetMaxFee());
 
-    return pool.AddUnchecked(hash, entry, state);
+    bool fAccepted = pool.AddUnchecked(hash, entry, state);
+
+    if (SysCfg().IsBenchmark()) {
+        // aggregated over every 1000 txs which pass CheckTx, cs_main guards the counters
+        static uint32_t nBenchTxs;
+        static int64_t nBenchCheck, nBenchTotal;
+        int64_t nNow = GetTimeMicros();
+        nBenchTxs++;
+        nBenchCheck += nTimeCheck - nStart;
+        nBenchTotal += nNow - nStart;
+        if (nBenchTxs == 1000) {
+            LogPrint(BCLog::INFO, "- Accept to mempool: %u txs, %.3fms/tx (check %.3fms/tx, add %.3fms/tx)\n",
+                     nBenchTxs, 0.001 * nBenchTotal / nBenchTxs, 0.001 * nBenchCheck / nBenchTxs,
+                     0.001 * (nBenchTotal - nBenchCheck) / nBenchTxs);
+            nBenchTxs   = 0;
+            nBenchCheck = 0;
+            nBenchTotal = 0;
+        }
+    }
+
+    return fAccepted;
 }
 
 int32_t CMerkleTx::GetDepthInMainChainINTERNAL(CBlockIndex *&pindexRet) const {
@@ -1009,7 +1112,59 @@ static bool ComputeVoteStakingInterestAndRevokeVotes(const int32_t currHeight, c
     return true;
 }
 
-bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool fJustCheck) {
+bool IsSpeculativeTxType(const TxType txType) {
+    switch (txType) {
+        case BCOIN_TRANSFER_TX:
+        case UCOIN_TRANSFER_TX:
+        case DEX_LIMIT_BUY_ORDER_TX:
+        case DEX_LIMIT_SELL_ORDER_TX:
+        case DEX_MARKET_BUY_ORDER_TX:
+        case DEX_MARKET_SELL_ORDER_TX:
+        case DEX_CANCEL_ORDER_TX:
+        case DEX_ORDER_TX:
+        case DEX_OPERATOR_ORDER_TX:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Execute the run of speculative txs starting at beginIndex in parallel, each one on its own child view of cw,
+ * and return the end of the run. Nothing is written to cw here, ConnectBlock() commits the results in block
+ * order and executes a tx again on cw if it has read any key written by an earlier tx of the run.
+ */
+static int32_t ExecuteTxsSpeculatively(CBlock &block, int32_t beginIndex, CCacheWrapper &cw, CBlockIndex *pIndex,
+                                       std::mutex &baseMutex, vector<std::unique_ptr<CTxSpeculativeExec>> &vExecs) {
+    int32_t endIndex = beginIndex;
+    while (endIndex < (int32_t)block.vptx.size() && IsSpeculativeTxType(block.vptx[endIndex]->nTxType))
+        ++endIndex;
+
+    if (endIndex - beginIndex < 2)
+        return endIndex;
+
+    uint32_t fuelRate      = block.GetFuelRate();
+    uint32_t prevBlockTime = pIndex->pprev != nullptr ? pIndex->pprev->GetBlockTime() : pIndex->GetBlockTime();
+    vector<CTxExecuteCheck> vChecks;
+    vChecks.reserve(endIndex - beginIndex);
+    for (int32_t index = beginIndex; index < endIndex; ++index) {
+        std::shared_ptr<CBaseTx> &pBaseTx = block.vptx[index];
+        pBaseTx->nFuelRate = fuelRate;
+
+        CTxExecuteContext context(pIndex->height, index, fuelRate, pIndex->nTime, prevBlockTime, nullptr, nullptr);
+        vExecs[index].reset(new CTxSpeculativeExec(pBaseTx, context, cw, baseMutex));
+        vChecks.push_back(CTxExecuteCheck(vExecs[index].get()));
+    }
+
+    CCheckQueueControl<CTxExecuteCheck> control(&txExecuteQueue);
+    control.Add(vChecks);
+    control.Wait();
+
+    return endIndex;
+}
+
+bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool fJustCheck,
+                  CDBReadTracker::KeyMap *pWriteKeys) {
     AssertLockHeld(cs_main);
 
     bool isGensisBlock = block.GetHeight() == 0 && block.GetHash() == SysCfg().GetGenesisBlockHash();
@@ -1079,6 +1234,17 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
         uint32_t fuelRate     = block.GetFuelRate();
         uint64_t totalRunStep = 0;
 
+        // Runs of independent txs are executed in parallel on child views of cw first, then committed to cw in
+        // block order. A tx which has read a key written by an earlier tx of its run is executed again on cw,
+        // so that cw and blockUndo end up exactly as if all txs were executed one by one.
+        bool fSpeculate = fParallelTxExecute && nSigCheckThreads > 0;
+        std::mutex baseMutex;
+        vector<std::unique_ptr<CTxSpeculativeExec>> vExecs(block.vptx.size());
+        CDBReadTracker::KeyMap runWriteKeys;
+        int32_t runEndIndex  = 0;
+        uint32_t nCommitted  = 0;
+        uint32_t nReexecuted = 0;
+
         for (int32_t index = 1; index < (int32_t)block.vptx.size(); ++index) {
             std::shared_ptr<CBaseTx> &pBaseTx = block.vptx[index];
             if (cw.txCache.HaveTx((pBaseTx->GetHash())))
@@ -1089,16 +1255,35 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
                 return state.DoS(100, ERRORMSG("ConnectBlock() : txid=%s beyond the scope of valid height",
                                  pBaseTx->GetHash().GetHex()), REJECT_INVALID, "tx-invalid-height");
 
+            if (fSpeculate && index >= runEndIndex) {
+                runEndIndex = ExecuteTxsSpeculatively(block, index, cw, pIndex, baseMutex, vExecs);
+                runWriteKeys.clear();
+            }
+
             pBaseTx->nFuelRate = fuelRate;
-            CTxUndoOpLogger opLogger(cw, pBaseTx->GetHash(), blockUndo);
+            std::unique_ptr<CTxSpeculativeExec> pExec(std::move(vExecs[index]));
+            if (pExec && pExec->fExecuted && !pExec->readTracker.IsConflict(runWriteKeys)) {
+                pExec->cw.FlushDbCaches();
+                CDBReadTracker::AddWriteKeys(pExec->txUndo.dbOpLogMap, runWriteKeys);
+                blockUndo.vtxundo.push_back(pExec->txUndo);
+                ++nCommitted;
+            } else {
+                if (pExec)
+                    ++nReexecuted;
+
+                CTxUndoOpLogger opLogger(cw, pBaseTx->GetHash(), blockUndo);
+
+                uint32_t prevBlockTime = pIndex->pprev != nullptr ? pIndex->pprev->GetBlockTime() : pIndex->GetBlockTime();
+                CTxExecuteContext context(pIndex->height, index, fuelRate, pIndex->nTime, prevBlockTime, &cw, &state);
+                if (!pBaseTx->ExecuteTx(context)) {
+                    pCdMan->pLogCache->SetExecuteFail(pIndex->height, pBaseTx->GetHash(), state.GetRejectCode(),
+                                                      state.GetRejectReason());
+                    return state.DoS(100, ERRORMSG("ConnectBlock() : txid=%s execute failed, in detail: %s",
+                                     pBaseTx->GetHash().GetHex(), pBaseTx->ToString(cw.accountCache)), REJECT_INVALID, "tx-execute-failed");
+                }
 
-            uint32_t prevBlockTime = pIndex->pprev != nullptr ? pIndex->pprev->GetBlockTime() : pIndex->GetBlockTime();
-            CTxExecuteContext context(pIndex->height, index, fuelRate, pIndex->nTime, prevBlockTime, &cw, &state);
-            if (!pBaseTx->ExecuteTx(context)) {
-                pCdMan->pLogCache->SetExecuteFail(pIndex->height, pBaseTx->GetHash(), state.GetRejectCode(),
-                                                  state.GetRejectReason());
-                return state.DoS(100, ERRORMSG("ConnectBlock() : txid=%s execute failed, in detail: %s",
-                                 pBaseTx->GetHash().GetHex(), pBaseTx->ToString(cw.accountCache)), REJECT_INVALID, "tx-execute-failed");
+                if (index < runEndIndex)
+                    CDBReadTracker::AddWriteKeys(opLogger.tx_undo.dbOpLogMap, runWriteKeys);
             }
 
             vPos.push_back(make_pair(pBaseTx->GetHash(), pos));
@@ -1122,6 +1307,10 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
             LogPrint(BCLog::DEBUG, "total fuel fee:%d, tx fuel fee:%d runStep:%d fuelRate:%d txid:%s\n", totalFuel,
                      fuel, pBaseTx->nRunStep, fuelRate, pBaseTx->GetHash().GetHex());
         }
+
+        if (SysCfg().IsBenchmark() && fSpeculate)
+            LogPrint(BCLog::INFO, "- Execute transactions in parallel: %u committed, %u executed again\n",
+                     nCommitted, nReexecuted);
     }
 
     // Verify total fuel
@@ -1248,27 +1437,11 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
             return state.Abort(_("ConnectBlock() : failed to write block index"));
     }
 
+    // Adding the block evicts the block nTxCacheHeight back from the transaction memory cache.
     if (!cw.txCache.AddBlockTx(block)) {
         return state.Abort(_("ConnectBlock() : failed add block into transaction memory cache"));
     }
 
-    if (pIndex->height > SysCfg().GetTxCacheHeight()) {
-        CBlockIndex *pDeleteBlockIndex = pIndex;
-        int32_t nCacheHeight           = SysCfg().GetTxCacheHeight();
-        while (pDeleteBlockIndex && nCacheHeight-- > 0) {
-            pDeleteBlockIndex = pDeleteBlockIndex->pprev;
-        }
-
-        CBlock deleteBlock;
-        if (!ReadBlockFromDisk(pDeleteBlockIndex, deleteBlock)) {
-            return state.Abort(_("ConnectBlock() : failed to read block"));
-        }
-
-        if (!cw.txCache.RemoveBlockTx(deleteBlock)) {
-            return state.Abort(_("ConnectBlock() : failed delete block from transaction memory cache"));
-        }
-    }
-
     // Attention: should NOT to call AddBlock() for price point memory cache, as everything
     // is ready when executing transactions.
 
@@ -1293,6 +1466,11 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
     // Set best block to current account cache.
     cw.blockCache.SetBestBlock(pIndex->GetBlockHash());
 
+    if (pWriteKeys != nullptr) {
+        for (auto &txUndo : blockUndo.vtxundo)
+            CDBReadTracker::AddWriteKeys(txUndo.dbOpLogMap, *pWriteKeys);
+    }
+
     return true;
 }
 
@@ -1324,16 +1502,65 @@ bool static WriteChainState(CValidationState &state) {
 
         FlushBlockFile();
         // pCdMan->pBlockCache->Sync();
-        pCdMan->Flush();
-        mapForkCache.clear();
+        if (fAsyncFlush)
+            pCdMan->FlushAsync();
+        else
+            pCdMan->Flush();
+        forkCache.Clear();
         nLastWrite = GetTimeMicros();
     }
     return true;
 }
 
+/**
+ * -assumevalid: the tx signatures of the blocks up to this block were verified by the release, so they are not
+ * verified again in the initial block download. The other checks of the blocks, the tx execution included, run as
+ * usual. Only the signatures of the blocks known to be ancestors of the assumevalid block are skipped, which
+ * takes the assumevalid block to be in mapBlockIndex, e.g. received ahead as an orphan or loaded on -reindex.
+ */
+static uint256 hashAssumeValid;
+static std::atomic<bool> fAssumeValidReached(false);  //!< the assumevalid block is in chainActive
+static std::atomic<bool> fAssumeValidSkipped(false);  //!< the signatures of some block were not verified
+
+static void UpdateAssumeValid() {
+    AssertLockHeld(cs_main);
+    if (hashAssumeValid.IsNull() || fAssumeValidReached)
+        return;
+
+    auto it = mapBlockIndex.find(hashAssumeValid);
+    if (it != mapBlockIndex.end() && chainActive.Contains(it->second)) {
+        fAssumeValidReached = true;
+        LogPrint(BCLog::INFO, "UpdateAssumeValid, reached the assumevalid block [%d]: %s, verify all signatures from now on\n",
+                 it->second->height, hashAssumeValid.GetHex());
+    }
+}
+
+void SetAssumeValid(const uint256 &hash) {
+    LOCK(cs_main);
+    hashAssumeValid     = hash;
+    fAssumeValidReached = false;
+    if (hash.IsNull())
+        LogPrint(BCLog::INFO, "SetAssumeValid, verify the signatures of all blocks\n");
+    else
+        LogPrint(BCLog::INFO, "SetAssumeValid, assume the signatures valid up to block %s\n", hash.GetHex());
+
+    UpdateAssumeValid();
+}
+
+bool IsSignatureAssumedValid(const CBlockIndex *pIndex) {
+    AssertLockHeld(cs_main);
+    if (hashAssumeValid.IsNull() || fAssumeValidReached || pIndex == nullptr)
+        return false;
+
+    // without the index of the assumevalid block, whether the block is its ancestor is unknown
+    auto it = mapBlockIndex.find(hashAssumeValid);
+    return it != mapBlockIndex.end() && it->second->GetAncestor(pIndex->height) == pIndex;
+}
+
 // Update chainActive and related internal data structures.
 void static UpdateTip(CBlockIndex *pIndexNew, const CBlock &block) {
     chainActive.SetTip(pIndexNew);
+    UpdateAssumeValid();
 
     SyncTransaction(uint256(), nullptr, &block);
 
@@ -1401,6 +1628,8 @@ bool static DisconnectTip(CValidationState &state) {
         return false;
     // Update chainActive and related variables.
     UpdateTip(pIndexDelete->pprev, block);
+    // The undo log does not tell which keys are written back, all mempool txs are executed on the next rescan.
+    mempool.SetFullRescan();
     // Resurrect mempool transactions from the disconnected block.
     for (const auto &pTx : block.vptx) {
         list<std::shared_ptr<CBaseTx> > removed;
@@ -1421,17 +1650,19 @@ bool static DisconnectTip(CValidationState &state) {
 bool static ConnectTip(CValidationState &state, CBlockIndex *pIndexNew) {
     assert(pIndexNew->pprev == chainActive.Tip());
     // Read block from disk.
+    int64_t nReadStart = GetTimeMicros();
     CBlock block;
     if (!ReadBlockFromDisk(pIndexNew, block))
         return state.Abort(strprintf("Failed to read block hash: %s", pIndexNew->GetBlockHash().GetHex()));
 
     // Apply the block automatically to the chain state.
     int64_t nStart = GetTimeMicros();
+    CDBReadTracker::KeyMap blockWriteKeys;
     {
         CInv inv(MSG_BLOCK, pIndexNew->GetBlockHash());
 
         auto spCW = std::make_shared<CCacheWrapper>(pCdMan);
-        if (!ConnectBlock(block, *spCW, pIndexNew, state)) {
+        if (!ConnectBlock(block, *spCW, pIndexNew, state, false, &blockWriteKeys)) {
             if (state.IsInvalid()) {
                 InvalidBlockFound(pIndexNew, state);
             }
@@ -1447,8 +1678,12 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pIndexNew) {
         spCW->Flush();
     }
 
-    if (SysCfg().IsBenchmark())
-        LogPrint(BCLog::INFO, "- Connect: %.2fms\n", (GetTimeMicros() - nStart) * 0.001);
+    if (SysCfg().IsBenchmark()) {
+        CBlockReadCache::CStats cacheStats = blockReadCache.GetStats();
+        LogPrint(BCLog::INFO, "- Connect: %.2fms (read %.2fms), block reads: %llu cached, %llu from disk\n",
+                 (GetTimeMicros() - nStart) * 0.001, (nStart - nReadStart) * 0.001, cacheStats.nHits,
+                 cacheStats.nMisses);
+    }
 
     // Write the chain state to disk, if necessary.
     if (!WriteChainState(state))
@@ -1457,9 +1692,8 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pIndexNew) {
     // Update chainActive & related variables.
     UpdateTip(pIndexNew, block);
 
-    for (auto &pTxItem : block.vptx) {
-        mempool.memPoolTxs.erase(pTxItem->GetHash());
-    }
+    // The mempool txs which have read the keys written by the block are executed again on the next rescan.
+    mempool.RemoveForBlock(block, blockWriteKeys);
     return true;
 }
 
@@ -1593,6 +1827,7 @@ bool ActivateBestChain(CValidationState &state, CBlockIndex* pNewIndex) {
         // Connect new blocks.
         while (!chainActive.Contains(chainMostWork.Tip())) {
             CBlockIndex *pIndexConnect = chainMostWork[chainActive.Height() + 1];
+            blockPrefetcher.Prefetch(chainMostWork, chainActive.Height(), *pCdMan->pAccountCache);
             if (!ConnectTip(state, pIndexConnect)) {
                 if (state.IsInvalid()) {
                     // The block violates a consensus rule.
@@ -1748,10 +1983,13 @@ bool ProcessForkedChain(const CBlock &block, CBlockIndex *pPreBlockIndex, CValid
     vector<CBlock> vPreBlocks;
     std::shared_ptr<CCacheWrapper> spCW = nullptr;
 
+    // the fork views derived from an older tip are stale
+    forkCache.SetTip(chainActive.Tip()->GetBlockHash());
+
     // If the block's previous block is not the active chain's tip, find the forked point.
     while (!chainActive.Contains(pPreBlockIndex)) {
         if (!forkChainTipFound) {
-            if (mapForkCache.count(pPreBlockIndex->GetBlockHash())) {
+            if (forkCache.Exists(pPreBlockIndex->GetBlockHash())) {
                 forkChainTipBlockHash = pPreBlockIndex->GetBlockHash();
                 forkChainTipFound     = true;
                 LogPrint(BCLog::INFO, "ProcessForkedChain() : fork chain's best block [%d]: %s\n",
@@ -1785,15 +2023,16 @@ bool ProcessForkedChain(const CBlock &block, CBlockIndex *pPreBlockIndex, CValid
                 block.GetHash().GetHex(), block.GetHeight()));
 
     if (forkChainTipFound) {
-        spCW = mapForkCache[forkChainTipBlockHash];
-    } else if (mapForkCache.count(pPreBlockIndex->GetBlockHash())) {
+        spCW = forkCache.Get(forkChainTipBlockHash);
+    } else if (forkCache.Exists(pPreBlockIndex->GetBlockHash())) {
         forkChainTipBlockHash = pPreBlockIndex->GetBlockHash();
-        spCW                  = mapForkCache[forkChainTipBlockHash];
+        spCW                  = forkCache.Get(forkChainTipBlockHash);
         forkChainTipFound     = true;
         LogPrint(BCLog::INFO, "ProcessForkedChain() : found [%d]: %s in cache\n",
             pPreBlockIndex->height, forkChainTipBlockHash.GetHex());
     } else {
-        spCW                     = CCacheWrapper::NewCopyFrom(pCdMan);
+        // only the delta of the rollback is held by the view, the rest is read through to pCdMan
+        spCW                     = std::make_shared<CCacheWrapper>(pCdMan);
         int64_t beginTime        = GetTimeMillis();
         CBlockIndex *pBlockIndex = chainActive.Tip();
 
@@ -1814,7 +2053,7 @@ bool ProcessForkedChain(const CBlock &block, CBlockIndex *pPreBlockIndex, CValid
             pBlockIndex = pBlockIndex->pprev;
         }  // Rollback the active chain to the forked point.
 
-        mapForkCache[pPreBlockIndex->GetBlockHash()] = spCW;
+        forkCache.Add(pPreBlockIndex->GetBlockHash(), spCW);
         forkChainTipBlockHash = pPreBlockIndex->GetBlockHash();
         forkChainTipFound     = true;
         LogPrint(BCLog::INFO, "ProcessForkedChain() : add [%d]: %s to cache\n", pPreBlockIndex->height,
@@ -1870,10 +2109,10 @@ bool ProcessForkedChain(const CBlock &block, CBlockIndex *pPreBlockIndex, CValid
 
         vector<CBlock>::iterator iterBlock = vPreBlocks.begin();
         if (forkChainTipFound) {
-            mapForkCache.erase(forkChainTipBlockHash);
+            forkCache.Erase(forkChainTipBlockHash);
         }
 
-        mapForkCache[iterBlock->GetHash()] = spCW;
+        forkCache.Add(iterBlock->GetHash(), spCW);
     }
 
     VoteDelegate curDelegate;
@@ -1884,22 +2123,90 @@ bool ProcessForkedChain(const CBlock &block, CBlockIndex *pPreBlockIndex, CValid
     return true;
 }
 
-bool CheckBlock(const CBlock &block, CValidationState &state, CCacheWrapper &cw, bool fCheckTx, bool fCheckMerkleRoot) {
-    if (block.vptx.empty() || block.vptx.size() > MAX_BLOCK_SIZE ||
-        ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION) > MAX_BLOCK_SIZE)
-        return state.DoS(100, ERRORMSG("CheckBlock() : size limits failed"), REJECT_INVALID, "bad-blk-length");
-
-    if ((block.GetHeight() != 0 || block.GetHash() != SysCfg().GetGenesisBlockHash()) &&
-        block.GetVersion() != CBlockHeader::CURRENT_VERSION) {
-        return state.Invalid(ERRORMSG("CheckBlock() : block version error"), REJECT_INVALID, "block-version-error");
+bool CheckBlockHeader(const CBlockHeader &header, CValidationState &state) {
+    if ((header.GetHeight() != 0 || header.GetHash() != SysCfg().GetGenesisBlockHash()) &&
+        header.GetVersion() != CBlockHeader::CURRENT_VERSION) {
+        return state.Invalid(ERRORMSG("CheckBlockHeader() : block version error"), REJECT_INVALID,
+                             "block-version-error");
     }
 
     // Check timestamp `block interval' + 2 seconds limits
-    if (block.GetBlockTime() > GetAdjustedTime() + ::GetBlockInterval(block.GetHeight()) + 2) {
-        return state.Invalid(ERRORMSG("CheckBlock() : block timestamp too far in the future"), REJECT_INVALID,
+    if (header.GetBlockTime() > GetAdjustedTime() + ::GetBlockInterval(header.GetHeight()) + 2) {
+        return state.Invalid(ERRORMSG("CheckBlockHeader() : block timestamp too far in the future"), REJECT_INVALID,
                              "time-too-new");
     }
 
+    // Check nonce
+    static uint64_t maxNonce = SysCfg().GetBlockMaxNonce();
+    if (header.GetNonce() > maxNonce) {
+        return state.Invalid(ERRORMSG("CheckBlockHeader() : Nonce is larger than maxNonce"), REJECT_INVALID,
+                             "Nonce-too-large");
+    }
+
+    return true;
+}
+
+bool ContextualCheckBlockHeader(const CBlockHeader &header, CValidationState &state) {
+    AssertLockHeld(cs_main);
+
+    auto it = mapBlockIndex.find(header.GetPrevBlockHash());
+    if (it == mapBlockIndex.end())
+        return ERRORMSG("ContextualCheckBlockHeader() : prev block %s not found", header.GetPrevBlockHash().GetHex());
+
+    CBlockIndex *pPrevIndex = it->second;
+    if (header.GetHeight() != (uint32_t)pPrevIndex->height + 1)
+        return state.DoS(100, ERRORMSG("ContextualCheckBlockHeader() : height given in block mismatches with its actual height"),
+                         REJECT_INVALID, "incorrect-height");
+
+    if (header.GetBlockTime() - pPrevIndex->GetBlockTime() < GetBlockInterval(header.GetHeight()))
+        return state.Invalid(ERRORMSG("ContextualCheckBlockHeader() : the new block came in too early"), REJECT_INVALID,
+                             "time-too-early");
+
+    if (header.GetFuelRate() != (pPrevIndex == chainActive.Tip() ? GetTipContext()->fuelRate
+                                                                 : GetElementForBurn(pPrevIndex)))
+        return state.DoS(100, ERRORMSG("ContextualCheckBlockHeader() : block fuel rate unmatched"), REJECT_INVALID,
+                         "fuel-rate-unmatched");
+
+    // The delegates are known on top of the tip only, the block of a fork is checked by ProcessForkedChain().
+    if (pPrevIndex != chainActive.Tip())
+        return true;
+
+    VoteDelegateVector delegates;
+    if (!pCdMan->pDelegateCache->GetActiveDelegates(delegates))
+        return ERRORMSG("ContextualCheckBlockHeader() : failed to get the active delegates");
+
+    VoteDelegate delegate;
+    ShuffleDelegates(header.GetHeight(), header.GetTime(), delegates);
+    GetCurrentDelegate(header.GetTime(), header.GetHeight(), delegates, delegate);
+
+    CAccount account;
+    if (!pCdMan->pAccountCache->GetAccount(delegate.regid, account))
+        return ERRORMSG("ContextualCheckBlockHeader() : failed to get current delegate's account, regId=%s",
+                        delegate.regid.ToString());
+
+    // the block is signed by the delegate of its slot, see VerifyRewardTx()
+    uint256 blockHash                     = header.GetHash();
+    const vector<uint8_t> &blockSignature = header.GetSignature();
+    if (blockSignature.size() == 0 || blockSignature.size() > MAX_SIGNATURE_SIZE)
+        return state.DoS(100, ERRORMSG("ContextualCheckBlockHeader() : invalid block signature size, hash=%s",
+                         blockHash.ToString()), REJECT_INVALID, "bad-blk-sig-size");
+
+    if (!VerifySignature(blockHash, blockSignature, account.owner_pubkey, true) &&
+        !VerifySignature(blockHash, blockSignature, account.miner_pubkey, true))
+        return state.DoS(100, ERRORMSG("ContextualCheckBlockHeader() : block %s is not signed by delegate %s",
+                         blockHash.ToString(), delegate.regid.ToString()), REJECT_INVALID, "bad-blk-signature");
+
+    return true;
+}
+
+bool CheckBlock(const CBlock &block, CValidationState &state, CCacheWrapper &cw, bool fCheckTx, bool fCheckMerkleRoot) {
+    if (block.vptx.empty() || block.vptx.size() > MAX_BLOCK_SIZE ||
+        ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION) > MAX_BLOCK_SIZE)
+        return state.DoS(100, ERRORMSG("CheckBlock() : size limits failed"), REJECT_INVALID, "bad-blk-length");
+
+    if (!CheckBlockHeader(block, state))
+        return false;
+
     // First transaction must be reward transaction, the rest must not be
     if (block.vptx.empty() || !block.vptx[0]->IsBlockRewardTx())
         return state.DoS(100, ERRORMSG("CheckBlock() : first tx is not coinbase"), REJECT_INVALID, "bad-cb-missing");
@@ -1909,6 +2216,20 @@ bool CheckBlock(const CBlock &block, CValidationState &state, CCacheWrapper &cw,
     // recalculated many times during this block's validation.
     block.BuildMerkleTree();
 
+    // Signature verifications of all txs are collected while running CheckTx() and then
+    // verified in parallel by the signature check threads, see -par. Without the threads, the signatures
+    // of each tx are verified right after its CheckTx().
+    bool fParallelSigCheck = fCheckTx && nSigCheckThreads > 0;
+    CCheckQueueControl<CSignatureCheck> control(fParallelSigCheck ? &sigCheckQueue : nullptr);
+    vector<CSignatureCheck> vSigChecks;
+
+    // The signatures are still collected, so that CheckTx() runs the same, and then dropped, see -assumevalid.
+    auto itIndex       = mapBlockIndex.find(block.GetHash());
+    bool fSkipSigCheck = fCheckTx && itIndex != mapBlockIndex.end() && IsSignatureAssumedValid(itIndex->second);
+    if (fSkipSigCheck && !fAssumeValidSkipped.exchange(true))
+        LogPrint(BCLog::INFO, "CheckBlock() : skip verifying the tx signatures from block [%d] on, up to the assumevalid block %s\n",
+                 block.GetHeight(), hashAssumeValid.GetHex());
+
     // Check for duplicate txids. This is caught by ConnectInputs(),
     // but catching it earlier avoids a potential DoS attack:
     set<uint256> uniqueTx;
@@ -1918,9 +2239,26 @@ bool CheckBlock(const CBlock &block, CValidationState &state, CCacheWrapper &cw,
 
         uint32_t prevBlockTime = block.GetTime(); // the prev block maybe unkown when checking block
         CTxExecuteContext context(block.GetHeight(), i + 1, block.GetFuelRate(), block.GetTime(), prevBlockTime, &cw, &state);
+        if (fCheckTx)
+            context.pSigChecks = &vSigChecks;
+
         if (fCheckTx && !block.vptx[i]->CheckTx(context))
             return ERRORMSG("CheckBlock() : CheckTx failed, txid: %s", block.vptx[i]->GetHash().GetHex());
 
+        if (fSkipSigCheck) {
+            vSigChecks.clear();
+        } else if (fParallelSigCheck && !vSigChecks.empty()) {
+            control.Add(vSigChecks);
+            vSigChecks.clear();
+        } else if (!vSigChecks.empty()) {
+            for (const auto &check : vSigChecks) {
+                if (!check())
+                    return state.DoS(100, ERRORMSG("CheckBlock() : tx signature verification failed, txid: %s",
+                                     block.vptx[i]->GetHash().GetHex()), REJECT_INVALID, "bad-tx-signature");
+            }
+            vSigChecks.clear();
+        }
+
         if (block.GetHeight() != 0 || block.GetHash() != SysCfg().GetGenesisBlockHash()) {
             if (0 != i && block.vptx[i]->IsBlockRewardTx())
                 return state.DoS(100, ERRORMSG("CheckBlock() : more than one block reward tx"), REJECT_INVALID,
@@ -1948,10 +2286,15 @@ bool CheckBlock(const CBlock &block, CValidationState &state, CCacheWrapper &cw,
                         block.GetHeight(), block.GetMerkleRootHash().ToString(), block.vMerkleTree.back().ToString()),
                         REJECT_INVALID, "bad-merkle-root", true);
 
-    // Check nonce
-    static uint64_t maxNonce = SysCfg().GetBlockMaxNonce();
-    if (block.GetNonce() > maxNonce) {
-        return state.Invalid(ERRORMSG("CheckBlock() : Nonce is larger than maxNonce"), REJECT_INVALID, "Nonce-too-large");
+    if (fParallelSigCheck) {
+        int64_t nStart = GetTimeMicros();
+        if (!control.Wait())
+            return state.DoS(100, ERRORMSG("CheckBlock() : tx signature verification failed, height: %u",
+                             block.GetHeight()), REJECT_INVALID, "bad-tx-signature");
+
+        if (SysCfg().IsBenchmark())
+            LogPrint(BCLog::INFO, "- Verify signatures of %u transactions (%d threads): %.2fms\n",
+                     (uint32_t)block.vptx.size(), nSigCheckThreads, 0.001 * (GetTimeMicros() - nStart));
     }
 
     return true;
@@ -1970,7 +2313,9 @@ bool AcceptBlock(CBlock &block, CValidationState &state, CDiskBlockPos *dbp, boo
 
     assert(block.GetHeight() == 0 || mapBlockIndex.count(block.GetPrevBlockHash()));
 
-    if (block.GetHeight() != 0 && block.GetFuelRate() != GetElementForBurn(mapBlockIndex[block.GetPrevBlockHash()]))
+    CBlockIndex *pPrevIndex = block.GetHeight() != 0 ? mapBlockIndex[block.GetPrevBlockHash()] : nullptr;
+    if (block.GetHeight() != 0 && block.GetFuelRate() != (pPrevIndex == chainActive.Tip() ? GetTipContext()->fuelRate
+                                                                                         : GetElementForBurn(pPrevIndex)))
         return state.DoS(100, ERRORMSG("AcceptBlock() : block fuel rate unmatched"), REJECT_INVALID,
                          "fuel-rate-unmatched");
 
@@ -2026,6 +2371,9 @@ bool AcceptBlock(CBlock &block, CValidationState &state, CDiskBlockPos *dbp, boo
         if (dbp == nullptr && !WriteBlockToDisk(block, blockPos))
             return state.Abort(_("Failed to write block"));
 
+        // connecting the block reads it again
+        blockReadCache.Add(block, nBlockSize);
+
         if (!AddToBlockIndex(block, state, blockPos))
             return ERRORMSG("AcceptBlock() : AddToBlockIndex failed");
 
@@ -2036,16 +2384,31 @@ bool AcceptBlock(CBlock &block, CValidationState &state, CDiskBlockPos *dbp, boo
     // Relay inventory, but don't relay old inventory during initial block download
     CBlockIndex* pTip = chainActive.Tip() ;
     if (pTip->GetBlockHash() == blockHash) {
+        // the peers which asked for compact blocks get the block at once, they rebuild it from their mempools
+        std::unique_ptr<CBlockHeaderAndShortTxIDs> pCmpctBlock;
+        if (SysCfg().GetBoolArg("-compactblocks", DEFAULT_COMPACT_BLOCKS))
+            pCmpctBlock.reset(new CBlockHeaderAndShortTxIDs(block, GetRand(std::numeric_limits<uint64_t>::max())));
         {
+            CInv inv(MSG_BLOCK, blockHash);
             LOCK(cs_vNodes);
             for (auto pNode : vNodes) {
+                bool fCompact = pCmpctBlock && pNode->fSendCompactBlocks;
                 //p2p_xiaoyu_20191116
                 if (mining) {
-                    pNode->PushMessage(NetMsgType::BLOCK, block);
+                    if (fCompact)
+                        pNode->PushMessage(NetMsgType::CMPCTBLOCK, *pCmpctBlock);
+                    else
+                        pNode->PushMessage(NetMsgType::BLOCK, block);
                     continue;
                 }
-                if (chainActive.Height() > (pNode->nStartingHeight != -1 ? pNode->nStartingHeight - 2000 : 0))
-                    pNode->PushInventory(CInv(MSG_BLOCK, blockHash));
+                if (chainActive.Height() > (pNode->nStartingHeight != -1 ? pNode->nStartingHeight - 2000 : 0)) {
+                    if (fCompact && !pNode->IsInventoryKnown(inv)) {
+                        pNode->PushMessage(NetMsgType::CMPCTBLOCK, *pCmpctBlock);
+                        pNode->AddInventoryKnown(inv);
+                    } else {
+                        pNode->PushInventory(inv);
+                    }
+                }
             }
         }
 
@@ -43,11 +43,19 @@ extern CCriticalSection cs_main;
 /** The currently-connected chain of blocks. */
 extern CChain chainActive;
 extern CSignatureCache signatureCache;
+/** Number of signature checking threads, 0 for verifying signatures inline */
+extern int32_t nSigCheckThreads;
+/** Whether ConnectBlock() executes runs of independent txs in parallel */
+extern bool fParallelTxExecute;
+/** Whether the chainstate is written to disk by the flush thread, off cs_main */
+extern bool fAsyncFlush;
 
 extern CTxMemPool mempool;
 extern map<uint256, CBlockIndex *> mapBlockIndex;
 extern uint64_t nLastBlockTx;
 extern uint64_t nLastBlockSize;
+/** Micro seconds spent packing the txs of the last mined block, including the packing ahead of its slot */
+extern int64_t nLastBlockPackTime;
 extern const string strMessageMagic;
 extern bool ReadBlockFromDisk(const CBlockIndex *pIndex, CBlock &block) ;
 
@@ -96,8 +104,16 @@ bool CheckDiskSpace(uint64_t nAdditionalBytes = 0);
 /** Verify consistency of the block and coin databases */
 bool VerifyDB(int32_t nCheckLevel, int32_t nCheckDepth);
 
-/** Run an instance of the script checking thread */
-void ThreadScriptCheck();
+/** Run an instance of the signature checking thread */
+void ThreadSignatureCheck();
+/** Stop all signature checking threads once the queued work is done */
+void StopSignatureCheckThreads();
+/** Run an instance of the speculative tx execution thread */
+void ThreadTxExecute();
+/** Stop all speculative tx execution threads once the queued work is done */
+void StopTxExecuteThreads();
+/** Run the thread committing the async chainstate flushes */
+void ThreadFlushChainState();
 
 /** Format a string that describes several potential problems detected by the core */
 string GetWarnings(string strFor);
@@ -113,11 +129,15 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats);
 /** Increase a node's misbehavior score. */
 void Misbehaving(NodeId nodeid, int32_t howmuch);
 
-bool VerifySignature(const uint256 &sigHash, const std::vector<uint8_t> &signature, const CPubKey &pubKey);
+/** Verify a signature through the signature cache. A block check takes the signature out of the cache, as
+ *  it will not be checked again, and does not cache it. */
+bool VerifySignature(const uint256 &sigHash, const std::vector<uint8_t> &signature, const CPubKey &pubKey,
+                     bool fBlockCheck = false);
 
-/** (try to) add transaction to memory pool **/
+/** (try to) add transaction to memory pool, with its serialization if already known **/
 bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBaseTx,
-                        bool fLimitFree, bool fRejectInsaneFee = false);
+                        bool fLimitFree, bool fRejectInsaneFee = false,
+                        const CSerializedTxRef &pSerializedTx = nullptr);
 
 struct CNodeStateStats {
     int32_t nMisbehavior;
@@ -192,6 +212,7 @@ public:
 /** The currently best known chain of headers (some of which may be invalid). */
 extern CChain chainMostWork;
 extern CCacheDBManager *pCdMan;
+extern CForkCache forkCache;
 extern int32_t nSyncTipHeight;
 extern std::tuple<bool, boost::thread *> RunCoin(int32_t argc, char *argv[]);
 extern string publicIp;
@@ -216,18 +237,35 @@ protected:
  *  will be true if no problems were found. Otherwise, the return value will be false in case
  *  of problems. Note that in any case, coins may be modified. */
 bool DisconnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool *pfClean = nullptr);
-// Apply the effects of this block (with given index) on the UTXO set represented by coins
-bool ConnectBlock   (CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool fJustCheck = false);
+// Apply the effects of this block (with given index) on the UTXO set represented by coins, the keys written by
+// the block are added to pWriteKeys if given
+bool ConnectBlock   (CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool fJustCheck = false,
+                     CDBReadTracker::KeyMap *pWriteKeys = nullptr);
+
+/** Txs which only touch the account, receipt and dex order state, they can be executed speculatively */
+bool IsSpeculativeTxType(const TxType txType);
 
 // Add this block to the block index, and if necessary, switch the active block chain to this
 bool AddToBlockIndex(CBlock &block, CValidationState &state, const CDiskBlockPos &pos);
 
+// Context-independent validity checks of the block header: version, timestamp and nonce
+bool CheckBlockHeader(const CBlockHeader &header, CValidationState &state);
+// Validity checks of the block header against its prev block: height, timestamp, fuel rate and, on top of the
+// tip, the signature of the delegate of its slot. Returns false with the state valid when the header can not be
+// checked, e.g. its prev block is unknown. Requires cs_main.
+bool ContextualCheckBlockHeader(const CBlockHeader &header, CValidationState &state);
+
 // Context-independent validity checks
 bool CheckBlock(const CBlock &block, CValidationState &state, CCacheWrapper &cw,
                 bool fCheckTx = true, bool fCheckMerkleRoot = true);
 
 bool ProcessForkedChain(const CBlock &block, CValidationState &state);
 
+// Set the block of -assumevalid, the null hash to verify the signatures of all blocks
+void SetAssumeValid(const uint256 &hash);
+// Whether the tx signatures of the block are not to be verified, see -assumevalid. Requires cs_main.
+bool IsSignatureAssumedValid(const CBlockIndex *pIndex);
+
 // Store block on disk
 // if dbp is provided, the file is known to already reside on disk
 bool AcceptBlock(CBlock &block, CValidationState &state, CDiskBlockPos *dbp = nullptr, bool mining = false);
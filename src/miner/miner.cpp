@@ -6,6 +6,7 @@
 #include "miner.h"
 
 #include "pbftcontext.h"
+#include "chain/tipcontext.h"
 #include "init.h"
 #include "main.h"
 #include "net.h"
@@ -26,8 +27,9 @@ extern CPBFTContext pbftContext ;
 extern void SetMinerStatus(bool bStatus);
 
 
-uint64_t nLastBlockTx   = 0;
-uint64_t nLastBlockSize = 0;
+uint64_t nLastBlockTx       = 0;
+uint64_t nLastBlockSize     = 0;
+int64_t nLastBlockPackTime  = 0;
 
 MinedBlockInfo miningBlockInfo;
 boost::circular_buffer<MinedBlockInfo> minedBlocks(MAX_MINED_BLOCK_COUNT);
@@ -82,28 +84,322 @@ uint32_t GetElementForBurn(CBlockIndex *pIndex) {
     return newFuelRate;
 }
 
-// Sort transactions by priority and fee to decide priority orders to process transactions.
-void GetPriorityTx(int32_t height, set<TxPriority> &txPriorities, const int32_t nFuelRate) {
-    static TokenSymbol feeSymbol;
-    static uint64_t fee    = 0;
-    static uint32_t txSize = 0;
-    static double feePerKb = 0;
-    static double priority = 0;
-
-    for (map<uint256, CTxMemPoolEntry>::iterator mi = mempool.memPoolTxs.begin(); mi != mempool.memPoolTxs.end(); ++mi) {
-        CBaseTx *pBaseTx = mi->second.GetTransaction().get();
-        if (!pBaseTx->IsBlockRewardTx() && !pCdMan->pTxCache->HaveTx(pBaseTx->GetHash())) {
-            feeSymbol = std::get<0>(mi->second.GetFees());
-            fee       = std::get<1>(mi->second.GetFees());
-            txSize    = mi->second.GetTxSize();
-            feePerKb  = double(fee - pBaseTx->GetFuel(height, nFuelRate)) / txSize * 1000.0;
-            priority  = mi->second.GetPriority();
-
-            txPriorities.emplace(TxPriority(priority, feePerKb, mi->second.GetTransaction()));
+/**
+ * Iterates the mempool txs in mining order, which is kept by the priority index of the mempool, so nothing is
+ * sorted here. The price median tx, if given, comes after the txs of a higher priority. The caller must hold
+ * mempool.cs while iterating.
+ */
+class CMiningTxCursor {
+public:
+    CMiningTxCursor(const std::shared_ptr<CBaseTx> &pPriceMedianTxIn = nullptr)
+        : it(mempool.MiningOrderBegin()), end(mempool.MiningOrderEnd()), pPriceMedianTx(pPriceMedianTxIn) {}
+
+    // return nullptr at the end
+    std::shared_ptr<CBaseTx> Next() {
+        while (it != end) {
+            if (pPriceMedianTx && it->first.priorityClass < PRICE_MEDIAN_TRANSACTION_PRIORITY)
+                break;
+
+            pEntry = &it->second->second;
+            ++it;
+            if (!pEntry->GetTransaction()->IsBlockRewardTx())
+                return pEntry->GetTransaction();
         }
+
+        // the price median tx is returned once
+        pEntry = nullptr;
+        std::shared_ptr<CBaseTx> pRet;
+        pRet.swap(pPriceMedianTx);
+        return pRet;
     }
+
+    // the mempool entry of the tx returned by Next(), nullptr for the price median tx
+    const CTxMemPoolEntry *GetEntry() const { return pEntry; }
+
+private:
+    CTxMemPool::MiningOrderIter it;
+    CTxMemPool::MiningOrderIter end;
+    std::shared_ptr<CBaseTx> pPriceMedianTx;
+    const CTxMemPoolEntry *pEntry = nullptr;
+};
+
+// The signatures of a mempool tx have been verified when it entered the mempool, they are not verified again
+// when the tx is packed, unless a fork has been activated since.
+static bool IsSignatureVerified(const CTxMemPoolEntry *pEntry, int32_t height) {
+    return pEntry != nullptr && pEntry->IsValidated() &&
+           GetFeatureForkVersion(pEntry->GetHeight()) == GetFeatureForkVersion(height);
+}
+
+// The run steps measured on the mempool view predict whether the tx fits in the block before it is executed.
+static bool ExceedRunStepLimit(const CTxMemPoolEntry *pEntry, uint64_t totalRunStep) {
+    return pEntry != nullptr && totalRunStep + pEntry->GetRunStep() >= MAX_BLOCK_RUN_STEP;
 }
 
+// the longest time an update of the block template holds cs_main
+static const int64_t BLOCK_TEMPLATE_UPDATE_MS = 50;
+
+/**
+ * A candidate block kept executed on its own view while the miner waits for its slot, so that producing the
+ * block in the slot only takes the block reward tx and the final checks. The first updates pack the mempool txs
+ * in mining order with the block price median tx after the price feed txs, as CreateNewBlockStableCoinRelease()
+ * does, the later ones append the txs which have entered the mempool since. The candidate starts over when the
+ * tip or the block time changes. Only the miner thread uses it.
+ */
+class CBlockTemplateBuilder {
+public:
+    // pack more mempool txs into the candidate block for the given tip and block time, until deadlineMs
+    void Update(CBlockIndex *pPrevIndex, int64_t blockTime, int64_t deadlineMs) {
+        LOCK2(cs_main, mempool.cs);
+        if (chainActive.Tip() != pPrevIndex)
+            return;
+
+        if (!pBlock || prevBlockHash != pPrevIndex->GetBlockHash() || (int64_t)pBlock->GetTime() != blockTime) {
+            if (!Reset(pPrevIndex, blockTime))
+                return;
+        }
+
+        int64_t packStart = GetTimeMicros();
+        PackMempoolTxs(deadlineMs);
+        nPackTime += GetTimeMicros() - packStart;
+    }
+
+    // Move the candidate block out, if it was built on pPrevIndex for blockTime. The caller must hold cs_main.
+    bool Take(CBlockIndex *pPrevIndex, int64_t blockTime, std::unique_ptr<CBlock> &pBlockOut) {
+        AssertLockHeld(cs_main);
+        if (!pBlock || chainActive.Tip() != pPrevIndex || prevBlockHash != pPrevIndex->GetBlockHash() ||
+            (int64_t)pBlock->GetTime() != blockTime)
+            return false;
+
+        // the initial pass has not reached the price median tx, the txs packed so far are of a higher priority
+        uint32_t packedTxCount = pBlock->vptx.size() - 1;
+        if (!fPriceMedianPacked) {
+            int64_t packStart = GetTimeMicros();
+            bool packed       = PackPriceMedianTx(std::make_shared<CBlockPriceMedianTx>(height));
+            nPackTime += GetTimeMicros() - packStart;
+            if (!packed) {
+                Clear();
+                return false;
+            }
+        }
+
+        ((CUCoinBlockRewardTx *)pBlock->vptx[0].get())->reward_fees = rewards;
+
+        pBlock->SetPrevBlockHash(prevBlockHash);
+        pBlock->SetNonce(0);
+        pBlock->SetHeight(height);
+        pBlock->SetFuel(totalFuel);
+        pBlock->SetFuelRate(fuelRate);
+
+        nLastBlockTx       = pBlock->vptx.size();
+        nLastBlockSize     = totalBlockSize;
+        nLastBlockPackTime = nPackTime;
+
+        LogPrint(BCLog::INFO, "%s() : height=%d, tx=%d, totalBlockSize=%llu, packed_ahead=%u, pack_time_ms=%.2f\n",
+                 __func__, height, pBlock->vptx.size(), totalBlockSize, packedTxCount, nPackTime * 0.001);
+
+        pBlockOut = std::move(pBlock);
+        Clear();
+        return true;
+    }
+
+private:
+    void PackMempoolTxs(int64_t deadlineMs) {
+        if (!fInitialPassDone) {
+            // The pass starts over from the top of the mining order when it was cut off by the deadline. Once the
+            // price median tx is packed, the price feed txs which have entered the mempool since are left to the
+            // next block, as in the sequence pass below. The deadline is checked after each tx packed, so that
+            // every update makes progress.
+            CMiningTxCursor txCursor(fPriceMedianPacked ? nullptr : std::make_shared<CBlockPriceMedianTx>(height));
+            while (std::shared_ptr<CBaseTx> pTx = txCursor.Next()) {
+                const CTxMemPoolEntry *pEntry = txCursor.GetEntry();
+                if (pTx->IsPriceMedianTx()) {
+                    if (!PackPriceMedianTx(pTx)) {
+                        Clear();
+                        return;
+                    }
+                } else if (fPriceMedianPacked && pEntry->GetPriority() >= PRICE_MEDIAN_TRANSACTION_PRIORITY) {
+                    continue;
+                } else if (fBlockFull || !setTriedTxids.insert(pTx->GetHash()).second) {
+                    continue;
+                } else {
+                    PackTx(pTx, pEntry);
+                }
+
+                if (GetTimeMillis() > deadlineMs)
+                    return;
+            }
+            fInitialPassDone = true;
+        }
+
+        for (auto it = mempool.SequenceUpperBound(nLastSequence); it != mempool.SequenceEnd(); ++it) {
+            if (GetTimeMillis() > deadlineMs)
+                return;
+
+            nLastSequence = it->first;
+            const CTxMemPoolEntry &entry = it->second->second;
+            // the txs of a higher priority than the price median tx, i.e. the price feed txs, are left to the
+            // next block, they would come after the price median tx here
+            if (entry.GetPriority() >= PRICE_MEDIAN_TRANSACTION_PRIORITY)
+                continue;
+
+            if (!fBlockFull && setTriedTxids.insert(entry.GetTransaction()->GetHash()).second)
+                PackTx(entry.GetTransaction(), &entry);
+        }
+    }
+
+    // the median prices are computed on the view after the price feed txs packed before the price median tx
+    bool PackPriceMedianTx(const std::shared_ptr<CBaseTx> &pTx) {
+        PriceMap medianPrices;
+        if (!spCW->ppCache.CalcBlockMedianPrices(*spCW, height, medianPrices))
+            return ERRORMSG("%s(), calculate block median prices error", __func__);
+
+        ((CBlockPriceMedianTx *)pTx.get())->SetMedianPrices(medianPrices);
+        fPriceMedianPacked = PackTx(pTx, nullptr);
+        if (!fPriceMedianPacked)
+            LogPrint(BCLog::MINER, "%s() : failed to pack the price median tx into the block template, height=%d\n",
+                     __func__, height);
+
+        return fPriceMedianPacked;
+    }
+
+    bool Reset(CBlockIndex *pPrevIndex, int64_t blockTime) {
+        Clear();
+
+        height = pPrevIndex->height + 1;
+        // the stable coin genesis block and the blocks before the stable coin release are created at once
+        if (height == (int32_t)SysCfg().GetStableCoinGenesisHeight() || GetFeatureForkVersion(height) == MAJOR_VER_R1)
+            return false;
+
+        prevBlockHash = pPrevIndex->GetBlockHash();
+        prevBlockTime = pPrevIndex->GetBlockTime();
+        fuelRate      = pPrevIndex == chainActive.Tip() ? GetTipContext()->fuelRate : GetElementForBurn(pPrevIndex);
+        spCW          = std::make_shared<CCacheWrapper>(pCdMan);
+        nLastSequence = mempool.GetLastSequence();
+
+        pBlock.reset(new CBlock());
+        pBlock->SetTime(blockTime);
+        pBlock->vptx.push_back(std::make_shared<CUCoinBlockRewardTx>());
+
+        // Largest block you're willing to create:
+        nBlockMaxSize = SysCfg().GetArg("-blockmaxsize", DEFAULT_BLOCK_MAX_SIZE);
+        // Limit to between 1K and MAX_BLOCK_SIZE-1K for sanity:
+        nBlockMaxSize = std::max<uint32_t>(1000, std::min<uint32_t>((MAX_BLOCK_SIZE - 1000), nBlockMaxSize));
+
+        totalBlockSize = ::GetSerializeSize(*pBlock, SER_NETWORK, PROTOCOL_VERSION);
+        return true;
+    }
+
+    void Clear() {
+        pBlock.reset();
+        spCW.reset();
+        setTriedTxids.clear();
+        fInitialPassDone   = false;
+        fPriceMedianPacked = false;
+        fBlockFull         = false;
+        nPackTime          = 0;
+        totalBlockSize   = 0;
+        totalRunStep     = 0;
+        totalFuel        = 0;
+        rewards          = {{SYMB::WICC, 0}, {SYMB::WUSD, 0}};
+    }
+
+    // execute the tx on the view of the candidate block and append it, the same way as
+    // CreateNewBlockStableCoinRelease() does
+    bool PackTx(const std::shared_ptr<CBaseTx> &pTx, const CTxMemPoolEntry *pEntry) {
+        CBaseTx *pBaseTx = pTx.get();
+
+        if (ExceedRunStepLimit(pEntry, totalRunStep)) {
+            LogPrint(BCLog::MINER, "%s() : predicted to exceed max block run steps, txid: %s\n", __func__,
+                     pBaseTx->GetHash().GetHex());
+            return false;
+        }
+
+        uint32_t txSize = pBaseTx->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
+        if (totalBlockSize + txSize >= nBlockMaxSize) {
+            LogPrint(BCLog::MINER, "%s() : exceed max block size, txid: %s\n", __func__, pBaseTx->GetHash().GetHex());
+            if (nBlockMaxSize - totalBlockSize < MIN_PACKED_TX_SIZE)
+                fBlockFull = true;
+            return false;
+        }
+
+        auto spTxCW = std::make_shared<CCacheWrapper>(spCW.get());
+        try {
+            CValidationState state;
+            pBaseTx->nFuelRate = fuelRate;
+
+            CTxExecuteContext context(height, pBlock->vptx.size(), fuelRate, pBlock->GetTime(), prevBlockTime,
+                                      spTxCW.get(), &state, transaction_status_type::mining);
+            vector<CSignatureCheck> vSigChecks;  // dropped, the signatures are verified already
+            if (IsSignatureVerified(pEntry, height))
+                context.pSigChecks = &vSigChecks;
+            if (!pBaseTx->CheckTx(context) || !pBaseTx->ExecuteTx(context)) {
+                LogPrint(BCLog::MINER, "%s() : failed to pack transaction: %s\n", __func__,
+                         pBaseTx->ToString(spTxCW->accountCache));
+
+                pCdMan->pLogCache->SetExecuteFail(height, pBaseTx->GetHash(), state.GetRejectCode(),
+                                                  state.GetRejectReason());
+                return false;
+            }
+
+            // Run step limits
+            if (totalRunStep + pBaseTx->nRunStep >= MAX_BLOCK_RUN_STEP) {
+                LogPrint(BCLog::MINER, "%s() : exceed max block run steps, txid: %s\n", __func__,
+                         pBaseTx->GetHash().GetHex());
+                return false;
+            }
+        } catch (std::exception &e) {
+            LogPrint(BCLog::ERROR, "%s() : unexpected exception: %s\n", __func__, e.what());
+            return false;
+        }
+
+        spTxCW->Flush();
+
+        auto fuel        = pBaseTx->GetFuel(height, fuelRate);
+        auto fees_symbol = std::get<0>(pBaseTx->GetFees());
+        auto fees        = std::get<1>(pBaseTx->GetFees());
+        assert(fees_symbol == SYMB::WICC || fees_symbol == SYMB::WUSD);
+
+        totalBlockSize += txSize;
+        totalRunStep += pBaseTx->nRunStep;
+        totalFuel += fuel;
+        assert(fees >= fuel);
+        rewards[fees_symbol] += (fees - fuel);
+
+        pBlock->vptx.push_back(pTx);
+        return true;
+    }
+
+    // the smallest tx, stop packing when the room left is less than it
+    static const uint32_t MIN_PACKED_TX_SIZE = 100;
+
+    std::unique_ptr<CBlock> pBlock;
+    std::shared_ptr<CCacheWrapper> spCW;  // the view after the packed txs
+    uint256 prevBlockHash;
+    int64_t prevBlockTime = 0;
+    int32_t height        = 0;
+    uint32_t fuelRate     = 0;
+    uint32_t nBlockMaxSize = 0;
+    uint64_t nLastSequence = 0;          // the last mempool sequence visited
+    set<uint256> setTriedTxids;          // packed, or failed to be packed
+    bool fInitialPassDone   = false;
+    bool fPriceMedianPacked = false;
+    bool fBlockFull         = false;
+    int64_t nPackTime       = 0;         // in micro seconds
+    uint64_t totalBlockSize = 0;
+    uint64_t totalRunStep   = 0;
+    uint64_t totalFuel      = 0;
+    map<TokenSymbol, uint64_t> rewards;
+};
+
+static CBlockTemplateBuilder blockTemplateBuilder;
+
+void UpdateBlockTemplate(CBlockIndex *pPrevIndex, int64_t blockTime, int64_t deadlineMs) {
+    blockTemplateBuilder.Update(pPrevIndex, blockTime, deadlineMs);
+}
+
+bool TakeBlockTemplate(CBlockIndex *pPrevIndex, int64_t blockTime, std::unique_ptr<CBlock> &pBlock) {
+    return blockTemplateBuilder.Take(pPrevIndex, blockTime, pBlock);
+}
 
 bool GetCurrentDelegate(const int64_t currentTime, const int32_t currHeight, const VoteDelegateVector &delegates,
                                VoteDelegate &delegate) {
@@ -305,23 +601,28 @@ static bool CreateNewBlockPreStableCoinRelease(CCacheWrapper &cwIn, std::unique_
         uint32_t blockTime      = pBlock->GetTime();
         int32_t height          = pIndexPrev->height + 1;
         int32_t index           = 0; // block reward tx
-        uint32_t fuelRate       = GetElementForBurn(pIndexPrev);
+        uint32_t fuelRate       = GetTipContext()->fuelRate;
         uint64_t totalBlockSize = ::GetSerializeSize(*pBlock, SER_NETWORK, PROTOCOL_VERSION);
         uint64_t totalRunStep   = 0;
         uint64_t totalFees      = 0;
         uint64_t totalFuel      = 0;
         uint64_t reward         = 0;
 
-        // Calculate && sort transactions from memory pool.
-        set<TxPriority> txPriorities;
-        GetPriorityTx(height, txPriorities, fuelRate);
-
         LogPrint(BCLog::MINER, "CreateNewBlockPreStableCoinRelease() : got %lu transaction(s) sorted by priority rules\n",
-                 txPriorities.size());
+                 mempool.memPoolTxs.size());
 
         // Collect transactions into the block.
-        for (auto itor = txPriorities.rbegin(); itor != txPriorities.rend(); ++itor) {
-            CBaseTx *pBaseTx = itor->baseTx.get();
+        int64_t packStart = GetTimeMicros();
+        CMiningTxCursor txCursor;
+        while (std::shared_ptr<CBaseTx> pTx = txCursor.Next()) {
+            CBaseTx *pBaseTx = pTx.get();
+            const CTxMemPoolEntry *pEntry = txCursor.GetEntry();
+
+            if (ExceedRunStepLimit(pEntry, totalRunStep)) {
+                LogPrint(BCLog::MINER, "CreateNewBlockPreStableCoinRelease() : predicted to exceed max block run steps, txid: %s\n",
+                         pBaseTx->GetHash().GetHex());
+                continue;
+            }
 
             uint32_t txSize = pBaseTx->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
             if (totalBlockSize + txSize >= nBlockMaxSize) {
@@ -337,6 +638,9 @@ static bool CreateNewBlockPreStableCoinRelease(CCacheWrapper &cwIn, std::unique_
                 pBaseTx->nFuelRate = fuelRate;
                 uint32_t prevBlockTime = pIndexPrev->GetBlockTime();
                 CTxExecuteContext context(height, index + 1, fuelRate, blockTime, prevBlockTime, spCW.get(), &state, transaction_status_type::mining);
+                vector<CSignatureCheck> vSigChecks;  // dropped, the signatures are verified already
+                if (IsSignatureVerified(pEntry, height))
+                    context.pSigChecks = &vSigChecks;
                 if (!pBaseTx->CheckTx(context) || !pBaseTx->ExecuteTx(context)) {
                     LogPrint(BCLog::MINER, "CreateNewBlockPreStableCoinRelease() : failed to pack transaction, txid: %s\n",
                             pBaseTx->GetHash().GetHex());
@@ -373,7 +677,7 @@ static bool CreateNewBlockPreStableCoinRelease(CCacheWrapper &cwIn, std::unique_
 
             ++index;
 
-            pBlock->vptx.push_back(itor->baseTx);
+            pBlock->vptx.push_back(pTx);
 
             LogPrint(BCLog::DEBUG, "miner total fuel fee:%d, tx fuel fee:%d, fuel:%d, fuelRate:%d, txid:%s\n", totalFuel,
                      pBaseTx->GetFuel(height, fuelRate), pBaseTx->nRunStep, fuelRate, pBaseTx->GetHash().GetHex());
@@ -381,6 +685,7 @@ static bool CreateNewBlockPreStableCoinRelease(CCacheWrapper &cwIn, std::unique_
 
         nLastBlockTx                   = index + 1;
         nLastBlockSize                 = totalBlockSize;
+        nLastBlockPackTime             = GetTimeMicros() - packStart;
 
         ((CBlockRewardTx *)pBlock->vptx[0].get())->reward_fees = reward;
 
@@ -391,8 +696,8 @@ static bool CreateNewBlockPreStableCoinRelease(CCacheWrapper &cwIn, std::unique_
         pBlock->SetFuel(totalFuel);
         pBlock->SetFuelRate(fuelRate);
 
-        LogPrint(BCLog::INFO, "CreateNewBlockPreStableCoinRelease() : height=%d, tx=%d, totalBlockSize=%llu\n", height, index + 1,
-                 totalBlockSize);
+        LogPrint(BCLog::INFO, "CreateNewBlockPreStableCoinRelease() : height=%d, tx=%d, totalBlockSize=%llu, pack_time_ms=%.2f\n",
+                 height, index + 1, totalBlockSize, nLastBlockPackTime * 0.001);
     }
 
     return true;
@@ -410,7 +715,7 @@ static bool CreateStableCoinGenesisBlock(std::unique_ptr<CBlock> &pBlock) {
     // Fill in header
     CBlockIndex *pIndexPrev = chainActive.Tip();
     int32_t height          = pIndexPrev->height + 1;
-    uint32_t fuelRate       = GetElementForBurn(pIndexPrev);
+    uint32_t fuelRate       = GetTipContext()->fuelRate;
 
     pBlock->SetPrevBlockHash(pIndexPrev->GetBlockHash());
     pBlock->SetNonce(0);
@@ -421,7 +726,7 @@ static bool CreateStableCoinGenesisBlock(std::unique_ptr<CBlock> &pBlock) {
     return true;
 }
 
-static bool CreateNewBlockStableCoinRelease(int64_t startMiningMs, CCacheWrapper &cwIn, std::unique_ptr<CBlock> &pBlock) {
+bool CreateNewBlockStableCoinRelease(int64_t startMiningMs, CCacheWrapper &cwIn, std::unique_ptr<CBlock> &pBlock) {
     pBlock->vptx.push_back(std::make_shared<CUCoinBlockRewardTx>());
 
     // Largest block you're willing to create:
@@ -437,25 +742,20 @@ static bool CreateNewBlockStableCoinRelease(int64_t startMiningMs, CCacheWrapper
         uint32_t blockTime                 = pBlock->GetTime();
         int32_t height                     = pIndexPrev->height + 1;
         int32_t index                      = 0; // 0: block reward tx
-        uint32_t fuelRate                  = GetElementForBurn(pIndexPrev);
+        uint32_t fuelRate                  = GetTipContext()->fuelRate;
         uint64_t totalBlockSize            = ::GetSerializeSize(*pBlock, SER_NETWORK, PROTOCOL_VERSION);
         uint64_t totalRunStep              = 0;
         uint64_t totalFees                 = 0;
         uint64_t totalFuel                 = 0;
         map<TokenSymbol, uint64_t> rewards = {{SYMB::WICC, 0}, {SYMB::WUSD, 0}};
 
-        // Calculate && sort transactions from memory pool.
-        set<TxPriority> txPriorities;
-        GetPriorityTx(height, txPriorities, fuelRate);
-
-        // Push block price median transaction into queue.
-        txPriorities.emplace(TxPriority(PRICE_MEDIAN_TRANSACTION_PRIORITY, 0, std::make_shared<CBlockPriceMedianTx>(height)));
-
         LogPrint(BCLog::MINER, "CreateNewBlockStableCoinRelease() : got %lu transaction(s) sorted by priority rules\n",
-                 txPriorities.size());
+                 mempool.memPoolTxs.size() + 1);
 
-        // Collect transactions into the block.
-        for (auto itor = txPriorities.rbegin(); itor != txPriorities.rend(); ++itor) {
+        // Collect transactions into the block, the block price median transaction included.
+        int64_t packStart = GetTimeMicros();
+        CMiningTxCursor txCursor(std::make_shared<CBlockPriceMedianTx>(height));
+        while (std::shared_ptr<CBaseTx> pTx = txCursor.Next()) {
 
             if (!CheckPackBlockTime(startMiningMs, height)) {
                 LogPrint(BCLog::MINER, "%s() : no time left to pack more tx, ignore! height=%d, start_ms=%lld, tx_count=%u\n",
@@ -463,7 +763,14 @@ static bool CreateNewBlockStableCoinRelease(int64_t startMiningMs, CCacheWrapper
                 break;
             }
 
-            CBaseTx *pBaseTx = itor->baseTx.get();
+            CBaseTx *pBaseTx = pTx.get();
+            const CTxMemPoolEntry *pEntry = txCursor.GetEntry();
+
+            if (ExceedRunStepLimit(pEntry, totalRunStep)) {
+                LogPrint(BCLog::MINER, "CreateNewBlockStableCoinRelease() : predicted to exceed max block run steps, txid: %s\n",
+                         pBaseTx->GetHash().GetHex());
+                continue;
+            }
 
             uint32_t txSize = pBaseTx->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
             if (totalBlockSize + txSize >= nBlockMaxSize) {
@@ -481,7 +788,7 @@ static bool CreateNewBlockStableCoinRelease(int64_t startMiningMs, CCacheWrapper
 
                 // Special case for price median tx,
                 if (pBaseTx->IsPriceMedianTx()) {
-                    CBlockPriceMedianTx *pPriceMedianTx = (CBlockPriceMedianTx *)itor->baseTx.get();
+                    CBlockPriceMedianTx *pPriceMedianTx = (CBlockPriceMedianTx *)pBaseTx;
 
                     PriceMap medianPrices;
                     if (!spCW->ppCache.CalcBlockMedianPrices(*spCW, height, medianPrices))
@@ -495,6 +802,9 @@ static bool CreateNewBlockStableCoinRelease(int64_t startMiningMs, CCacheWrapper
 
                 uint32_t prevBlockTime = pIndexPrev->GetBlockTime();
                 CTxExecuteContext context(height, index + 1, fuelRate, blockTime, prevBlockTime, spCW.get(), &state, transaction_status_type::mining);
+                vector<CSignatureCheck> vSigChecks;  // dropped, the signatures are verified already
+                if (IsSignatureVerified(pEntry, height))
+                    context.pSigChecks = &vSigChecks;
                 if (!pBaseTx->CheckTx(context) || !pBaseTx->ExecuteTx(context)) {
                     LogPrint(BCLog::MINER, "CreateNewBlockStableCoinRelease() : failed to pack transaction: %s\n",
                              pBaseTx->ToString(spCW->accountCache));
@@ -532,7 +842,7 @@ static bool CreateNewBlockStableCoinRelease(int64_t startMiningMs, CCacheWrapper
 
             ++index;
 
-            pBlock->vptx.push_back(itor->baseTx);
+            pBlock->vptx.push_back(pTx);
 
             LogPrint(BCLog::DEBUG, "miner total fuel fee:%d, tx fuel fee:%d, fuel:%d, fuelRate:%d, txid:%s\n", totalFuel,
                      pBaseTx->GetFuel(height, fuelRate), pBaseTx->nRunStep, fuelRate, pBaseTx->GetHash().GetHex());
@@ -541,6 +851,7 @@ static bool CreateNewBlockStableCoinRelease(int64_t startMiningMs, CCacheWrapper
 
         nLastBlockTx                   = index + 1;
         nLastBlockSize                 = totalBlockSize;
+        nLastBlockPackTime             = GetTimeMicros() - packStart;
 
         ((CUCoinBlockRewardTx *)pBlock->vptx[0].get())->reward_fees = rewards;
 
@@ -551,8 +862,8 @@ static bool CreateNewBlockStableCoinRelease(int64_t startMiningMs, CCacheWrapper
         pBlock->SetFuel(totalFuel);
         pBlock->SetFuelRate(fuelRate);
 
-        LogPrint(BCLog::INFO, "CreateNewBlockStableCoinRelease() : height=%d, tx=%d, totalBlockSize=%llu\n", height, index + 1,
-                 totalBlockSize);
+        LogPrint(BCLog::INFO, "CreateNewBlockStableCoinRelease() : height=%d, tx=%d, totalBlockSize=%llu, pack_time_ms=%.2f\n",
+                 height, index + 1, totalBlockSize, nLastBlockPackTime * 0.001);
     }
 
     return true;
@@ -662,6 +973,8 @@ static bool ProduceBlock(int64_t startMiningMs, CBlockIndex *pPrevIndex, Miner &
             success = CreateStableCoinGenesisBlock(pBlock);  // stable coin genesis
         } else if (GetFeatureForkVersion(blockHeight) == MAJOR_VER_R1) {
             success = CreateNewBlockPreStableCoinRelease(*spCW, pBlock); // pre-stable coin release
+        } else if (TakeBlockTemplate(pPrevIndex, pBlock->GetTime(), pBlock)) {
+            success = true;  // packed ahead of the slot
         } else {
             success = CreateNewBlockStableCoinRelease(startMiningMs, *spCW, pBlock);    // stable coin release
         }
@@ -741,6 +1054,9 @@ void static ThreadProduceBlocks(CWallet *pWallet, int32_t targetHeight) {
     targetHeight += GetCurrHeight();
     bool needSleep = false;
     int64_t nextSlotTime = 0;
+    CBlockIndex *pTemplateIndex = nullptr;
+    int64_t templateSlotTime    = 0;
+    bool isTemplateMiner        = false;
 
     try {
         SetMinerStatus(true);
@@ -782,6 +1098,17 @@ void static ThreadProduceBlocks(CWallet *pWallet, int32_t targetHeight) {
             int64_t curMiningTime = MillisToSecond(startMiningMs);
             int64_t curSlotTime = std::max(nextSlotTime, pIndexPrev->GetBlockTime() + GetBlockInterval(blockHeight));
             if (curMiningTime < curSlotTime) {
+                // pack the block ahead while waiting for the slot, if it is ours
+                if (pTemplateIndex != pIndexPrev || templateSlotTime != curSlotTime) {
+                    Miner slotMiner;
+                    pTemplateIndex   = pIndexPrev;
+                    templateSlotTime = curSlotTime;
+                    isTemplateMiner  = GetMiner(curSlotTime * 1000, blockHeight, slotMiner);
+                }
+                if (isTemplateMiner)
+                    UpdateBlockTemplate(pIndexPrev, curSlotTime,
+                        std::min(GetTimeMillis() + BLOCK_TEMPLATE_UPDATE_MS, curSlotTime * 1000));
+
                 needSleep = true;
                 continue;
             }
@@ -39,27 +39,6 @@ struct Miner {
     CKey key;
 };
 
-struct TxPriority {
-    double priority;
-    double feePerKb;
-    std::shared_ptr<CBaseTx> baseTx;
-
-    TxPriority(const double priorityIn, const double feePerKbIn, const std::shared_ptr<CBaseTx> &baseTxIn)
-        : priority(priorityIn), feePerKb(feePerKbIn), baseTx(baseTxIn) {}
-
-    bool operator<(const TxPriority &other) const {
-        if (fabs(this->priority - other.priority) <= 1000) {
-            if (fabs(this->feePerKb < other.feePerKb) <= 1e-8) {
-                return this->baseTx->GetHash() < other.baseTx->GetHash();
-            } else {
-                return this->feePerKb < other.feePerKb;
-            }
-        } else {
-            return this->priority < other.priority;
-        }
-    }
-};
-
 // mined block info
 class MinedBlockInfo {
 public:
@@ -90,11 +69,18 @@ bool VerifyRewardTx(const CBlock *pBlock, CCacheWrapper &cwIn, bool bNeedRunTx,
 /** Check mined block */
 bool CheckWork(CBlock *pBlock);
 
+/** Create a new block on the active tip from the mempool txs */
+bool CreateNewBlockStableCoinRelease(int64_t startMiningMs, CCacheWrapper &cwIn, std::unique_ptr<CBlock> &pBlock);
+
+/** Pack more mempool txs into the block template on pPrevIndex for blockTime, until deadlineMs */
+void UpdateBlockTemplate(CBlockIndex *pPrevIndex, int64_t blockTime, int64_t deadlineMs);
+
+/** Move out the block template built on pPrevIndex for blockTime, false if there is none. Requires cs_main. */
+bool TakeBlockTemplate(CBlockIndex *pPrevIndex, int64_t blockTime, std::unique_ptr<CBlock> &pBlock);
+
 /** Get burn element */
 uint32_t GetElementForBurn(CBlockIndex *pIndex);
 
-void GetPriorityTx(vector<TxPriority> &vecPriority, int32_t nFuelRate);
-
 void ShuffleDelegates(const int32_t nCurHeight, const int64_t blockTime,VoteDelegateVector &delegates);
 
 bool GetCurrentDelegate(const int64_t currentTime, const int32_t currHeight,
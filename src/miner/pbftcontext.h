@@ -45,21 +45,24 @@ public:
 public:
 
     bool IsBroadcastedBlock(uint256 blockHash) {
+        LOCK(cs_pbftmessage);
         return broadcastedBlockHashSet.count(blockHash) > 0;
     }
 
     bool SaveBroadcastedBlock(uint256 blockHash) {
+        LOCK(cs_pbftmessage);
         broadcastedBlockHashSet.insert(blockHash) ;
         return true ;
     }
     bool IsKnown(const MsgType msg) {
+        LOCK(cs_pbftmessage);
         return messageKnown.count(msg) != 0 ;
     }
 
+    // return false if the message was known already
     bool AddMessageKnown(const MsgType msg) {
             LOCK(cs_pbftmessage);
-            messageKnown.insert(msg) ;
-            return true;
+            return messageKnown.insert(msg).second;
     }
 
     int  SaveMessageByBlock(const uint256 blockHash,const MsgType& msg) {
@@ -80,6 +83,7 @@ public:
     }
 
     bool GetMessagesByBlockHash(const uint256 hash, set<MsgType>& msgs) {
+            LOCK(cs_pbftmessage);
             auto it = blockMessagesMap.find(hash) ;
             if(it == blockMessagesMap.end())
                 return false;
@@ -91,6 +95,8 @@ public:
 
 class CPBFTContext {
 
+private:
+    CCriticalSection cs_minerlist;
 
 public:
 
@@ -141,6 +141,8 @@ bool CPBFTMan::UpdateLocalFinBlock(const CBlockIndex* pIndex){
 
 bool CPBFTMan::UpdateLocalFinBlock(const CBlockConfirmMessage& msg){
 
+    // called from the message handler threads, chainActive must not change meanwhile
+    LOCK(cs_main);
     CBlockIndex* fi = GetLocalFinIndex();
 
     if(fi == nullptr ||(uint32_t)fi->height >= msg.height)
@@ -215,6 +217,8 @@ int64_t  CPBFTMan::GetLocalFinLastUpdate() const {
 
 bool CPBFTMan::UpdateGlobalFinBlock(const CBlockFinalityMessage& msg){
 
+    // called from the message handler threads, chainActive must not change meanwhile
+    LOCK(cs_main);
     CBlockIndex* fi = GetGlobalFinIndex();
 
     if(fi == nullptr ||(uint32_t)fi->height >= msg.height)
@@ -396,25 +400,26 @@ bool CheckPBFTMessage(const int32_t msgType ,const CPBFTMessage& msg){
 
     //check height
 
-    CBlockIndex* localFinBlock = pbftMan.GetLocalFinIndex() ;
-    if(msg.height - chainActive.Height()>500 || (localFinBlock && msg.height < (uint32_t)localFinBlock->height) ) {
-        return ERRORMSG("checkPBftMessage():: messagesHeight is out range");
-    }
-
     //check message type ;
     if(msg.msgType != msgType )
         return ERRORMSG("checkPbftMessage(), msgType is illegal") ;
 
-    //if block received,check whether on chainActive
-    CBlockIndex* pIndex = chainActive[msg.height] ;
-    if(pIndex != nullptr &&pIndex->GetBlockHash() != msg.blockHash){
-        return ERRORMSG("checkPbftMessage(): block not on chainActive") ;
-    }
-
-    //check signature
     CAccount account ;
     {
+        // the messages are handled in several threads, chainActive changes under cs_main only
         LOCK(cs_main) ;
+        CBlockIndex* localFinBlock = pbftMan.GetLocalFinIndex() ;
+        if(msg.height - chainActive.Height()>500 || (localFinBlock && msg.height < (uint32_t)localFinBlock->height) ) {
+            return ERRORMSG("checkPBftMessage():: messagesHeight is out range");
+        }
+
+        //if block received,check whether on chainActive
+        CBlockIndex* pIndex = chainActive[msg.height] ;
+        if(pIndex != nullptr &&pIndex->GetBlockHash() != msg.blockHash){
+            return ERRORMSG("checkPbftMessage(): block not on chainActive") ;
+        }
+
+        //check signature
         if(!pCdMan->pAccountCache->GetAccount(msg.miner, account)) {
             return ERRORMSG("checkPBftMessage() : the signature creator is not found!");
         }
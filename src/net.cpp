@@ -39,6 +39,7 @@
 #include <thread>
 
 #include <boost/filesystem.hpp>
+#include <boost/function.hpp>
 
 // Dump addresses to peers.dat every 15 minutes (900s)
 #define DUMP_ADDRESSES_INTERVAL 900
@@ -78,7 +79,7 @@ CNodeSignals& GetNodeSignals() { return g_node_signals; }
 
 vector<CNode*> vNodes;
 CCriticalSection cs_vNodes;
-map<CInv, CDataStream> mapRelay;
+map<CInv, CSerializedTxRef> mapRelay;
 deque<pair<int64_t, CInv> > vRelayExpiration;
 CCriticalSection cs_mapRelay;
 
@@ -423,6 +424,51 @@ CNode* FindNode(const CService& addr) {
     return nullptr;
 }
 
+SocketEventsMode nSocketEventsMode = SOCKETEVENTS_SELECT;
+static CSocketEvents socketEvents;
+static vector<CNode*> vNodesToRegister;  // requires cs_vNodes, the new nodes to register with epoll
+static CCriticalSection cs_vSendRequests;
+static vector<NodeId> vSendRequests;     // the nodes with messages queued but not written to the socket
+
+bool InitSocketEvents(const string& strMode, string& strError) {
+    if (strMode == "select") {
+        nSocketEventsMode = SOCKETEVENTS_SELECT;
+        return true;
+    }
+
+    if (strMode != "epoll") {
+        strError = strprintf("unknown -socketevents mode: %s", strMode);
+        return false;
+    }
+
+    if (!socketEvents.Init(strError))
+        return false;
+
+    nSocketEventsMode = SOCKETEVENTS_EPOLL;
+    return true;
+}
+
+void WakeSocketHandler(NodeId id) {
+    // select() polls the send queues by itself
+    if (nSocketEventsMode != SOCKETEVENTS_EPOLL)
+        return;
+
+    {
+        LOCK(cs_vSendRequests);
+        vSendRequests.push_back(id);
+    }
+    socketEvents.Wake();
+}
+
+// requires cs_vNodes
+static void AddNode(CNode* pNode) {
+    vNodes.push_back(pNode);
+    if (nSocketEventsMode == SOCKETEVENTS_EPOLL) {
+        vNodesToRegister.push_back(pNode);
+        socketEvents.Wake();
+    }
+}
+
 CNode* ConnectNode(CAddress addrConnect, const char* pszDest) {
     if (pszDest == nullptr) {
         if (IsLocal(addrConnect))
@@ -465,7 +511,7 @@ CNode* ConnectNode(CAddress addrConnect, const char* pszDest) {
 
         {
             LOCK(cs_vNodes);
-            vNodes.push_back(pNode);
+            AddNode(pNode);
         }
 
         pNode->nTimeConnected = GetTime();
@@ -478,66 +524,200 @@ CNode* ConnectNode(CAddress addrConnect, const char* pszDest) {
 
 static list<CNode*> vNodesDisconnected;
 
-void ThreadSocketHandler() {
-    uint32_t nPrevNodeCount = 0;
-    while (true) {
-        //
-        // Disconnect nodes
-        //
-        {
-            LOCK(cs_vNodes);
-            // Disconnect unused nodes
-            vector<CNode*> vNodesCopy = vNodes;
-            for (auto pNode : vNodesCopy) {
-                if (pNode->fDisconnect || (pNode->GetRefCount() <= 0 && pNode->vRecvMsg.empty() &&
-                                           pNode->nSendSize == 0 && pNode->ssSend.empty())) {
-                    // remove from vNodes
-                    vNodes.erase(remove(vNodes.begin(), vNodes.end(), pNode), vNodes.end());
-
-                    // release outbound grant (if any)
-                    pNode->grantOutbound.Release();
-
-                    // close socket and cleanup
-                    pNode->CloseSocketDisconnect();
-                    pNode->Cleanup();
-
-                    // hold in disconnected pool until all refs are released
-                    if (pNode->fNetworkNode || pNode->fInbound)
-                        pNode->Release();
-                    vNodesDisconnected.push_back(pNode);
-                }
+static void DisconnectNodes(vector<NodeId>* pRemoved = nullptr) {
+    static uint32_t nPrevNodeCount = 0;
+    {
+        LOCK(cs_vNodes);
+        // Disconnect unused nodes
+        vector<CNode*> vNodesCopy = vNodes;
+        for (auto pNode : vNodesCopy) {
+            if (pNode->fDisconnect || (pNode->GetRefCount() <= 0 && pNode->vRecvMsg.empty() &&
+                                       pNode->nSendSize == 0 && pNode->ssSend.empty())) {
+                // remove from vNodes
+                vNodes.erase(remove(vNodes.begin(), vNodes.end(), pNode), vNodes.end());
+                vNodesToRegister.erase(remove(vNodesToRegister.begin(), vNodesToRegister.end(), pNode),
+                                       vNodesToRegister.end());
+                if (pRemoved != nullptr)
+                    pRemoved->push_back(pNode->GetId());
+
+                // release outbound grant (if any)
+                pNode->grantOutbound.Release();
+
+                // close socket and cleanup
+                pNode->CloseSocketDisconnect();
+                pNode->Cleanup();
+
+                // hold in disconnected pool until all refs are released
+                if (pNode->fNetworkNode || pNode->fInbound)
+                    pNode->Release();
+                vNodesDisconnected.push_back(pNode);
             }
         }
-        {
-            // Delete disconnected nodes
-            list<CNode*> vNodesDisconnectedCopy = vNodesDisconnected;
-            for (auto pNode : vNodesDisconnectedCopy) {
-                // wait until threads are done using it
-                if (pNode->GetRefCount() <= 0) {
-                    bool fDelete = false;
-                    {
-                        TRY_LOCK(pNode->cs_vSend, lockSend);
-                        if (lockSend) {
-                            TRY_LOCK(pNode->cs_vRecvMsg, lockRecv);
-                            if (lockRecv) {
-                                TRY_LOCK(pNode->cs_inventory, lockInv);
-                                if (lockInv)
-                                    fDelete = true;
-                            }
+    }
+    {
+        // Delete disconnected nodes
+        list<CNode*> vNodesDisconnectedCopy = vNodesDisconnected;
+        for (auto pNode : vNodesDisconnectedCopy) {
+            // wait until threads are done using it
+            if (pNode->GetRefCount() <= 0) {
+                bool fDelete = false;
+                {
+                    TRY_LOCK(pNode->cs_vSend, lockSend);
+                    if (lockSend) {
+                        TRY_LOCK(pNode->cs_vRecvMsg, lockRecv);
+                        if (lockRecv) {
+                            TRY_LOCK(pNode->cs_inventory, lockInv);
+                            if (lockInv)
+                                fDelete = true;
                         }
                     }
-                    if (fDelete) {
-                        vNodesDisconnected.remove(pNode);
-                        delete pNode;
-                    }
+                }
+                if (fDelete) {
+                    vNodesDisconnected.remove(pNode);
+                    delete pNode;
                 }
             }
         }
-        if (vNodes.size() != nPrevNodeCount) {
-            nPrevNodeCount = vNodes.size();
+    }
+    if (vNodes.size() != nPrevNodeCount) {
+        nPrevNodeCount = vNodes.size();
+
+        LogPrint(BCLog::INFO, "Connections number changed, %d -> %d\n", nPrevNodeCount, vNodes.size());
+    }
+}
+
+// Accept a connection of the listening socket, return false if there is none
+static bool AcceptConnection(SOCKET hListenSocket) {
+    struct sockaddr_storage sockaddr;
+    socklen_t len  = sizeof(sockaddr);
+    SOCKET hSocket = accept(hListenSocket, (struct sockaddr*)&sockaddr, &len);
+    CAddress addr;
+    int32_t nInbound = 0;
 
-            LogPrint(BCLog::INFO, "Connections number changed, %d -> %d\n", nPrevNodeCount, vNodes.size());
+    if (hSocket != INVALID_SOCKET)
+        if (!addr.SetSockAddr((const struct sockaddr*)&sockaddr))
+            LogPrint(BCLog::INFO, "Warning: Unknown socket family\n");
+
+    {
+        LOCK(cs_vNodes);
+        for (auto pNode : vNodes)
+            if (pNode->fInbound)
+                nInbound++;
+    }
+
+    if (hSocket == INVALID_SOCKET) {
+        int32_t nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK)
+            LogPrint(BCLog::INFO, "socket[%s] error accept failed: %s\n", addr.ToString(), NetworkErrorString(nErr));
+        return false;
+    } else if (nInbound >= nMaxConnections - MAX_OUTBOUND_CONNECTIONS) {
+        closesocket(hSocket);
+    } else if (CNode::IsBanned(addr)) {
+        LogPrint(BCLog::INFO, "connection from %s dropped (banned)\n", addr.ToString());
+        closesocket(hSocket);
+    } else {
+        LogPrint(BCLog::NET, "accepted connection %s\n", addr.ToString());
+        CNode* pNode = new CNode(hSocket, addr, "", true);
+        pNode->AddRef();
+        {
+            LOCK(cs_vNodes);
+            AddNode(pNode);
+        }
+    }
+    return true;
+}
+
+// requires cs_vRecvMsg. If there is no (complete) message in the receive buffer, or there is space left in the
+// buffer, receive more data, otherwise the message handler thread processes the messages first.
+static bool CanReceive(CNode* pNode) {
+    return pNode->vRecvMsg.empty() || !pNode->vRecvMsg.front().complete() ||
+           pNode->GetTotalRecvSize() <= ReceiveFloodSize();
+}
+
+// requires cs_vRecvMsg. Receive once from the socket, return false if nothing was received, fWouldBlock tells
+// whether the socket has no more data for now.
+static bool ReceiveSocketData(CNode* pNode, bool& fWouldBlock) {
+    fWouldBlock = false;
+    // typical socket buffer is 8K-64K
+    char pchBuf[0x10000];
+    int32_t nBytes = recv(pNode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+    if (nBytes > 0) {
+        if (!pNode->ReceiveMsgBytes(pchBuf, nBytes))
+            pNode->CloseSocketDisconnect();
+        pNode->nLastRecv = GetTime();
+        pNode->nRecvBytes += nBytes;
+        pNode->RecordBytesRecv(nBytes);
+        return true;
+    } else if (nBytes == 0) {
+        // socket closed gracefully
+        if (!pNode->fDisconnect)
+            LogPrint(BCLog::NET, "socket[%s] closed\n", pNode->addr.ToString());
+        pNode->CloseSocketDisconnect();
+    } else if (nBytes < 0) {
+        // error
+        int32_t nErr = WSAGetLastError();
+        if (nErr == WSAEWOULDBLOCK) {
+            fWouldBlock = true;
+        } else if (nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS) {
+            if (!pNode->fDisconnect)
+                LogPrint(BCLog::INFO, "socket[%s] recv error %s\n", pNode->addr.ToString(), NetworkErrorString(nErr));
+            pNode->CloseSocketDisconnect();
+        }
+    }
+    return false;
+}
+
+static void InactivityCheck(CNode* pNode) {
+    if (pNode->sendQueues.empty())
+        pNode->nLastSendEmpty = GetTime();
+    // p2p_xiaoyu_20191126
+    // if (GetTime() - pNode->nTimeConnected > 60) {
+    //     if (pNode->nLastRecv == 0 || pNode->nLastSend == 0) {
+    //         LogPrint(BCLog::NET, "socket no message in first 60 seconds, %d %d\n", pNode->nLastRecv != 0,
+    //                  pNode->nLastSend != 0);
+    //         pNode->fDisconnect = true;
+    //     } else if (GetTime() - pNode->nLastSend > 90 * 60 && GetTime() - pNode->nLastSendEmpty > 90 * 60) {
+    //         LogPrint(BCLog::INFO, "socket not sending\n");
+    //         pNode->fDisconnect = true;
+    //     } else if (GetTime() - pNode->nLastRecv > 90 * 60) {
+    //         LogPrint(BCLog::INFO, "socket inactivity timeout\n");
+    //         pNode->fDisconnect = true;
+    //     }
+    // }
+    int64_t nTime = GetSystemTimeInSeconds();
+    if (nTime - pNode->nTimeConnected > DEFAULT_PEER_CONNECT_TIMEOUT)
+    {
+        if (pNode->nLastRecv == 0 || pNode->nLastSend == 0)
+        {
+            LogPrint(BCLog::NET, "socket no message in first %i seconds, %d %d from %d\n", DEFAULT_PEER_CONNECT_TIMEOUT, pNode->nLastRecv != 0, pNode->nLastSend != 0, pNode->GetId());
+            pNode->fDisconnect = true;
+        }
+        else if (nTime - pNode->nLastSend > TIMEOUT_INTERVAL)
+        {
+            LogPrint(BCLog::NET, "socket sending timeout: %is\n", nTime - pNode->nLastSend);
+            pNode->fDisconnect = true;
+        }
+        else if (nTime - pNode->nLastRecv > TIMEOUT_INTERVAL)
+        {
+            LogPrint(BCLog::NET, "socket receive timeout: %is\n", nTime - pNode->nLastRecv);
+            pNode->fDisconnect = true;
+        }
+        else if (pNode->nPingNonceSent && pNode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
+        {
+            LogPrint(BCLog::NET, "ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pNode->nPingUsecStart));
+            pNode->fDisconnect = true;
+        }
+        else if (!pNode->fSuccessfullyConnected)
+        {
+            LogPrint(BCLog::NET, "version handshake timeout from %d\n", pNode->GetId());
+            pNode->fDisconnect = true;
         }
+    }
+}
+
+static void ThreadSocketHandlerSelect() {
+    while (true) {
+        DisconnectNodes();
 
         //
         // Find which sockets have data to receive
@@ -588,15 +768,14 @@ void ThreadSocketHandler() {
                 // * We process a message in the buffer (message handler thread).
                 {
                     TRY_LOCK(pNode->cs_vSend, lockSend);
-                    if (lockSend && !pNode->vSendMsg.empty()) {
+                    if (lockSend && !pNode->sendQueues.empty()) {
                         FD_SET(pNode->hSocket, &fdsetSend);
                         continue;
                     }
                 }
                 {
                     TRY_LOCK(pNode->cs_vRecvMsg, lockRecv);
-                    if (lockRecv && (pNode->vRecvMsg.empty() || !pNode->vRecvMsg.front().complete() ||
-                                     pNode->GetTotalRecvSize() <= ReceiveFloodSize()))
+                    if (lockRecv && CanReceive(pNode))
                         FD_SET(pNode->hSocket, &fdsetRecv);
                 }
             }
@@ -621,43 +800,8 @@ void ThreadSocketHandler() {
         // Accept new connections
         //
         for (auto hListenSocket : vhListenSocket)
-            if (hListenSocket != INVALID_SOCKET && FD_ISSET(hListenSocket, &fdsetRecv)) {
-                struct sockaddr_storage sockaddr;
-                socklen_t len  = sizeof(sockaddr);
-                SOCKET hSocket = accept(hListenSocket, (struct sockaddr*)&sockaddr, &len);
-                CAddress addr;
-                int32_t nInbound = 0;
-
-                if (hSocket != INVALID_SOCKET)
-                    if (!addr.SetSockAddr((const struct sockaddr*)&sockaddr))
-                        LogPrint(BCLog::INFO, "Warning: Unknown socket family\n");
-
-                {
-                    LOCK(cs_vNodes);
-                    for (auto pNode : vNodes)
-                        if (pNode->fInbound)
-                            nInbound++;
-                }
-
-                if (hSocket == INVALID_SOCKET) {
-                    int32_t nErr = WSAGetLastError();
-                    if (nErr != WSAEWOULDBLOCK)
-                        LogPrint(BCLog::INFO, "socket[%s] error accept failed: %s\n", addr.ToString(), NetworkErrorString(nErr));
-                } else if (nInbound >= nMaxConnections - MAX_OUTBOUND_CONNECTIONS) {
-                    closesocket(hSocket);
-                } else if (CNode::IsBanned(addr)) {
-                    LogPrint(BCLog::INFO, "connection from %s dropped (banned)\n", addr.ToString());
-                    closesocket(hSocket);
-                } else {
-                    LogPrint(BCLog::NET, "accepted connection %s\n", addr.ToString());
-                    CNode* pNode = new CNode(hSocket, addr, "", true);
-                    pNode->AddRef();
-                    {
-                        LOCK(cs_vNodes);
-                        vNodes.push_back(pNode);
-                    }
-                }
-            }
+            if (hListenSocket != INVALID_SOCKET && FD_ISSET(hListenSocket, &fdsetRecv))
+                AcceptConnection(hListenSocket);
 
         //
         // Service each socket
@@ -680,32 +824,8 @@ void ThreadSocketHandler() {
             if (FD_ISSET(pNode->hSocket, &fdsetRecv) || FD_ISSET(pNode->hSocket, &fdsetError)) {
                 TRY_LOCK(pNode->cs_vRecvMsg, lockRecv);
                 if (lockRecv) {
-                    {
-                        // typical socket buffer is 8K-64K
-                        char pchBuf[0x10000];
-                        int32_t nBytes = recv(pNode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
-                        if (nBytes > 0) {
-                            if (!pNode->ReceiveMsgBytes(pchBuf, nBytes))
-                                pNode->CloseSocketDisconnect();
-                            pNode->nLastRecv = GetTime();
-                            pNode->nRecvBytes += nBytes;
-                            pNode->RecordBytesRecv(nBytes);
-                        } else if (nBytes == 0) {
-                            // socket closed gracefully
-                            if (!pNode->fDisconnect)
-                                LogPrint(BCLog::NET, "socket[%s] closed\n", pNode->addr.ToString());
-                            pNode->CloseSocketDisconnect();
-                        } else if (nBytes < 0) {
-                            // error
-                            int32_t nErr = WSAGetLastError();
-                            if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR &&
-                                nErr != WSAEINPROGRESS) {
-                                if (!pNode->fDisconnect)
-                                    LogPrint(BCLog::INFO, "socket[%s] recv error %s\n", pNode->addr.ToString(), NetworkErrorString(nErr));
-                                pNode->CloseSocketDisconnect();
-                            }
-                        }
-                    }
+                    bool fWouldBlock;
+                    ReceiveSocketData(pNode, fWouldBlock);
                 }
             }
 
@@ -723,63 +843,202 @@ void ThreadSocketHandler() {
             //
             // Inactivity checking
             //
-            if (pNode->vSendMsg.empty())
-                pNode->nLastSendEmpty = GetTime();
-            // p2p_xiaoyu_20191126
-            // if (GetTime() - pNode->nTimeConnected > 60) {
-            //     if (pNode->nLastRecv == 0 || pNode->nLastSend == 0) {
-            //         LogPrint(BCLog::NET, "socket no message in first 60 seconds, %d %d\n", pNode->nLastRecv != 0,
-            //                  pNode->nLastSend != 0);
-            //         pNode->fDisconnect = true;
-            //     } else if (GetTime() - pNode->nLastSend > 90 * 60 && GetTime() - pNode->nLastSendEmpty > 90 * 60) {
-            //         LogPrint(BCLog::INFO, "socket not sending\n");
-            //         pNode->fDisconnect = true;
-            //     } else if (GetTime() - pNode->nLastRecv > 90 * 60) {
-            //         LogPrint(BCLog::INFO, "socket inactivity timeout\n");
-            //         pNode->fDisconnect = true;
-            //     }
-            // }
-            int64_t nTime = GetSystemTimeInSeconds();
-            if (nTime - pNode->nTimeConnected > DEFAULT_PEER_CONNECT_TIMEOUT)
-            {
-                if (pNode->nLastRecv == 0 || pNode->nLastSend == 0)
-                {
-                    LogPrint(BCLog::NET, "socket no message in first %i seconds, %d %d from %d\n", DEFAULT_PEER_CONNECT_TIMEOUT, pNode->nLastRecv != 0, pNode->nLastSend != 0, pNode->GetId());
-                    pNode->fDisconnect = true;
-                }
-                else if (nTime - pNode->nLastSend > TIMEOUT_INTERVAL)
-                {
-                    LogPrint(BCLog::NET, "socket sending timeout: %is\n", nTime - pNode->nLastSend);
-                    pNode->fDisconnect = true;
-                }
-                else if (nTime - pNode->nLastRecv > TIMEOUT_INTERVAL )
-                {
-                    LogPrint(BCLog::NET, "socket receive timeout: %is\n", nTime - pNode->nLastRecv);
-                    pNode->fDisconnect = true;
-                }
-                else if (pNode->nPingNonceSent && pNode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
-                {
-                    LogPrint(BCLog::NET, "ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pNode->nPingUsecStart));
-                    pNode->fDisconnect = true;
-                }
-                else if (!pNode->fSuccessfullyConnected)
-                {
-                    LogPrint(BCLog::NET, "version handshake timeout from %d\n", pNode->GetId());
-                    pNode->fDisconnect = true;
+            InactivityCheck(pNode);
+        }
+
+        {
+            LOCK(cs_vNodes);
+            for (auto pNode : vNodesCopy)
+                pNode->Release();
+        }
+    }
+}
+
+/**
+ * The sockets are registered with epoll once and served by their events only: a node is read until its socket
+ * would block and written until the send buffer of the socket is full, then it waits for the next edge. A node
+ * whose reads are held back by the receive buffer or whose locks are busy stays pending and is retried after a
+ * short wait. The nodes are disconnected and checked for inactivity once a second, so a pass costs O(events)
+ * rather than O(peers).
+ */
+static void ThreadSocketHandlerEpoll() {
+    // the node ids are non-negative int32_t
+    static const uint64_t LISTEN_TAG       = (uint64_t)1 << 63;
+    static const int32_t MAX_RECV_PER_PASS = 4;     // receive calls of a node per pass, for fairness
+    static const int32_t PENDING_WAIT      = 50;    // in milliseconds
+    static const int32_t CHECK_INTERVAL    = 1000;  // in milliseconds
+
+    for (size_t i = 0; i < vhListenSocket.size(); i++) {
+        if (vhListenSocket[i] != INVALID_SOCKET)
+            socketEvents.Add(vhListenSocket[i], LISTEN_TAG | i, false);
+    }
+
+    map<NodeId, CNode*> mapNodes;  // the registered nodes, until they are removed from vNodes
+    set<NodeId> setRecvPending;    // readable, not read until the socket would block
+    set<NodeId> setSendPending;    // writable or requested, not written for the send lock was busy
+    vector<CSocketEvents::CEvent> events;
+    vector<NodeId> vRemoved;
+    int64_t nLastCheck = 0;
+    int32_t nTimeout   = 0;
+    while (true) {
+        if (!socketEvents.Wait(nTimeout, events)) {
+            LogPrint(BCLog::INFO, "socket epoll_wait error %s\n", NetworkErrorString(WSAGetLastError()));
+            MilliSleep(PENDING_WAIT);
+        }
+        boost::this_thread::interruption_point();
+
+        for (const auto& event : events) {
+            if (event.nTag & LISTEN_TAG) {
+                // accept all pending connections, the listening socket reports no more edges until then
+                while (AcceptConnection(vhListenSocket[event.nTag & ~LISTEN_TAG])) {}
+                continue;
+            }
+
+            if (event.fRecv || event.fError)
+                setRecvPending.insert((NodeId)event.nTag);
+            if (event.fSend)
+                setSendPending.insert((NodeId)event.nTag);
+        }
+
+        vector<NodeId> vRequests;
+        {
+            LOCK(cs_vSendRequests);
+            vRequests.swap(vSendRequests);
+        }
+        setSendPending.insert(vRequests.begin(), vRequests.end());
+
+        // a socket which is ready already reports its events right after it is registered
+        vector<CNode*> vNewNodes;
+        {
+            LOCK(cs_vNodes);
+            vNewNodes.swap(vNodesToRegister);
+        }
+        for (auto pNode : vNewNodes) {
+            if (pNode->hSocket == INVALID_SOCKET)
+                continue;
+
+            if (socketEvents.Add(pNode->hSocket, pNode->GetId()))
+                mapNodes[pNode->GetId()] = pNode;
+            else
+                pNode->CloseSocketDisconnect();
+        }
+
+        //
+        // Service the sockets with events
+        //
+        set<NodeId> setReady(setRecvPending);
+        setReady.insert(setSendPending.begin(), setSendPending.end());
+        vector<CNode*> vNodesReady;
+        {
+            LOCK(cs_vNodes);
+            for (NodeId id : setReady) {
+                auto it = mapNodes.find(id);
+                if (it != mapNodes.end()) {
+                    it->second->AddRef();
+                    vNodesReady.push_back(it->second);
+                } else {
+                    // not registered yet or removed already
+                    setRecvPending.erase(id);
+                    setSendPending.erase(id);
                 }
             }
+        }
+
+        bool fMoreData = false;
+        for (auto pNode : vNodesReady) {
+            boost::this_thread::interruption_point();
+
+            NodeId id = pNode->GetId();
+            if (pNode->hSocket == INVALID_SOCKET) {
+                setRecvPending.erase(id);
+                setSendPending.erase(id);
+                continue;
+            }
 
+            if (setRecvPending.count(id)) {
+                TRY_LOCK(pNode->cs_vRecvMsg, lockRecv);
+                if (lockRecv) {
+                    bool fWouldBlock = false;
+                    for (int32_t i = 0; i < MAX_RECV_PER_PASS && CanReceive(pNode); i++) {
+                        if (!ReceiveSocketData(pNode, fWouldBlock))
+                            break;
+                    }
+
+                    if (fWouldBlock || pNode->hSocket == INVALID_SOCKET)
+                        setRecvPending.erase(id);
+                    else if (CanReceive(pNode))
+                        fMoreData = true;
+                }
+            }
 
+            if (setSendPending.count(id) && pNode->hSocket != INVALID_SOCKET) {
+                TRY_LOCK(pNode->cs_vSend, lockSend);
+                if (lockSend) {
+                    // either all is sent, or the socket would block until the next edge
+                    if (!pNode->sendQueues.empty())
+                        pNode->SocketSendData();
+                    setSendPending.erase(id);
+                }
+            }
         }
 
         {
             LOCK(cs_vNodes);
-            for (auto pNode : vNodesCopy)
+            for (auto pNode : vNodesReady)
                 pNode->Release();
         }
+
+        //
+        // Disconnect the nodes and check their inactivity
+        //
+        int64_t nNow = GetTimeMillis();
+        if (nNow - nLastCheck >= CHECK_INTERVAL) {
+            nLastCheck = nNow;
+
+            vRemoved.clear();
+            DisconnectNodes(&vRemoved);
+            for (NodeId id : vRemoved) {
+                mapNodes.erase(id);
+                setRecvPending.erase(id);
+                setSendPending.erase(id);
+            }
+
+            vector<CNode*> vNodesCopy;
+            {
+                LOCK(cs_vNodes);
+                vNodesCopy = vNodes;
+                for (auto pNode : vNodesCopy)
+                    pNode->AddRef();
+            }
+            for (auto pNode : vNodesCopy) {
+                InactivityCheck(pNode);
+                // in case a write stopped before the socket would block
+                if (!pNode->sendQueues.empty())
+                    setSendPending.insert(pNode->GetId());
+            }
+            {
+                LOCK(cs_vNodes);
+                for (auto pNode : vNodesCopy)
+                    pNode->Release();
+            }
+        }
+
+        if (fMoreData)
+            nTimeout = 0;
+        else if (!setRecvPending.empty() || !setSendPending.empty())
+            nTimeout = PENDING_WAIT;
+        else
+            nTimeout = max<int64_t>(0, nLastCheck + CHECK_INTERVAL - GetTimeMillis());
     }
 }
 
+void ThreadSocketHandler() {
+    if (nSocketEventsMode == SOCKETEVENTS_EPOLL)
+        ThreadSocketHandlerEpoll();
+    else
+        ThreadSocketHandlerSelect();
+}
+
 #ifdef USE_UPNP
 void ThreadMapPort() {
     string port               = strprintf("%u", GetListenPort());
@@ -1171,7 +1430,12 @@ void static StartSync(const vector<CNode*>& vNodes) {
     }
 }
 
-void ThreadMessageHandler() {
+/**
+ * The peers are shared out to the message handler workers by their id, so the messages of a peer are processed in
+ * order by one worker, while a slow request of a peer, e.g. getdata or mempool, only holds up the peers of its
+ * worker. The handlers needing the chain state still serialize on cs_main, the others run in parallel.
+ */
+static void ThreadMessageHandler(int32_t nWorker, int32_t nWorkers) {
     SetThreadPriority(THREAD_PRIORITY_BELOW_NORMAL);
     while (true) {
         bool fHaveSyncNode = false;
@@ -1187,10 +1451,11 @@ void ThreadMessageHandler() {
             }
         }
 
-        if (!fHaveSyncNode)
+        // the first worker picks the sync node among all the peers
+        if (nWorker == 0 && !fHaveSyncNode)
             StartSync(vNodesCopy);
 
-        // Poll the connected nodes for messages
+        // Poll the connected nodes for messages, the trickle node is picked among all the peers to keep its rate
         CNode* pnodeTrickle = nullptr;
         if (!vNodesCopy.empty())
             pnodeTrickle = vNodesCopy[GetRand(vNodesCopy.size())];
@@ -1198,7 +1463,7 @@ void ThreadMessageHandler() {
         bool fSleep = true;
 
         for (auto pNode : vNodesCopy) {
-            if (pNode->fDisconnect)
+            if (pNode->fDisconnect || pNode->GetId() % nWorkers != nWorker)
                 continue;
 
             // Receive messages
@@ -1208,7 +1473,7 @@ void ThreadMessageHandler() {
                     if (!GetNodeSignals().ProcessMessages(pNode))
                         pNode->CloseSocketDisconnect();
 
-                    if (pNode->nSendSize < SendBufferSize()) {
+                    if (!pNode->IsSendBufferFull()) {
                         if (!pNode->vRecvGetData.empty() ||
                             (!pNode->vRecvMsg.empty() && pNode->vRecvMsg[0].complete())) {
                             fSleep = false;
@@ -1417,7 +1682,12 @@ void StartNode(boost::thread_group& threadGroup) {
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "opencon", &ThreadOpenConnections));
 
     // Process messages
-    threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "msghand", &ThreadMessageHandler));
+    int32_t nWorkers = SysCfg().GetArg("-msghandlerthreads", DEFAULT_MESSAGE_HANDLER_THREADS);
+    nWorkers         = max(min(nWorkers, MAX_MESSAGE_HANDLER_THREADS), 1);
+    LogPrint(BCLog::INFO, "Using %d threads for message handling\n", nWorkers);
+    for (int32_t i = 0; i < nWorkers; i++)
+        threadGroup.create_thread(boost::bind(&TraceThread<boost::function<void()> >, "msghand",
+                                              boost::function<void()>(boost::bind(&ThreadMessageHandler, i, nWorkers))));
 
     // Dump network addresses
     threadGroup.create_thread(boost::bind(&LoopForever<void (*)()>, "dumpaddr", &DumpAddresses, DUMP_ADDRESSES_INTERVAL * 1000));
@@ -1473,14 +1743,10 @@ public:
 instance_of_cnetcleanup;
 
 void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash) {
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    ss.reserve(1000);
-    auto pTx = pBaseTx->GetNewInstance();
-    ss << pTx;
-    RelayTransaction(pBaseTx, hash, ss);
+    RelayTransaction(pBaseTx, hash, MakeSerializedTx(*pBaseTx));
 }
 
-void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash, const CDataStream& ss) {
+void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash, const CSerializedTxRef& pSerializedTx) {
     CInv inv(MSG_TX, hash);
     {
         LOCK(cs_mapRelay);
@@ -1490,8 +1756,8 @@ void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash, const CDataStream&
             vRelayExpiration.pop_front();
         }
 
-        // Save original serialized message so newer versions are preserved
-        mapRelay.insert(make_pair(inv, ss));
+        // Save original serialized message so newer versions are preserved, the peers are sent the same buffer
+        mapRelay.insert(make_pair(inv, pSerializedTx));
         vRelayExpiration.push_back(make_pair(GetTime() + 15 * 60, inv));
     }
     LOCK(cs_vNodes);
@@ -11,6 +11,8 @@
 #include "crypto/hash.h"
 #include "sync.h"
 #include "netbase.h"
+#include "p2p/socketevents.h"
+#include "tx/serializedtx.h"
 
 
 #include <stdint.h>
@@ -38,6 +40,23 @@ static const int TIMEOUT_INTERVAL = 20 * 60;
 /** -peertimeout default */
 static const int64_t DEFAULT_PEER_CONNECT_TIMEOUT = 60;
 
+/** -msghandlerthreads default, each peer is handled by one of the threads */
+static const int32_t DEFAULT_MESSAGE_HANDLER_THREADS = 4;
+static const int32_t MAX_MESSAGE_HANDLER_THREADS     = 16;
+
+/** How the socket handler waits for the sockets */
+enum SocketEventsMode {
+    SOCKETEVENTS_SELECT,
+    SOCKETEVENTS_EPOLL,
+};
+
+/** -socketevents default */
+#ifdef USE_EPOLL
+static const char* const DEFAULT_SOCKET_EVENTS = "epoll";
+#else
+static const char* const DEFAULT_SOCKET_EVENTS = "select";
+#endif
+
 inline uint32_t ReceiveFloodSize() { return 1000 * SysCfg().GetArg("-maxreceivebuffer", 5 * 1000); }
 void AddOneShot(string strDest);
 bool RecvLine(SOCKET hSocket, string& strLine);
@@ -49,6 +68,7 @@ CNode* ConnectNode(CAddress addrConnect, const char* strDest = nullptr);
 void MapPort(bool fUseUPnP);
 uint16_t GetListenPort();
 bool BindListenPort(const CService& bindAddr, string& strError = REF(string()));
+bool InitSocketEvents(const string& strMode, string& strError);
 void StartNode(boost::thread_group& threadGroup);
 bool StopNode();
 
@@ -78,9 +98,10 @@ extern bool fDiscover;
 extern uint64_t nLocalHostNonce;
 extern CAddrMan addrman;
 extern int32_t nMaxConnections;
+extern SocketEventsMode nSocketEventsMode;
 extern vector<CNode*> vNodes;
 extern CCriticalSection cs_vNodes;
-extern map<CInv, CDataStream> mapRelay;
+extern map<CInv, CSerializedTxRef> mapRelay;
 extern deque<pair<int64_t, CInv> > vRelayExpiration;
 extern CCriticalSection cs_mapRelay;
 extern vector<string> vAddedNodes;
@@ -88,7 +109,7 @@ extern CCriticalSection cs_vAddedNodes;
 extern map<CNetAddr, LocalServiceInfo> mapLocalHost;
 
 void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash);
-void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash, const CDataStream& ss);
+void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash, const CSerializedTxRef& pSerializedTx);
 
 /** Access to the (IP) address database (peers.dat) */
 class CAddrDB {
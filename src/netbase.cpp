@@ -12,6 +12,9 @@
 
 #ifndef WIN32
 #include <fcntl.h>
+#ifndef WIN32
+#include <poll.h>
+#endif
 #endif
 
 #include <boost/algorithm/string/case_conv.hpp>  // for to_lower()
@@ -341,6 +344,7 @@ bool static ConnectSocketDirectly(const CService& addrConnect, SOCKET& hSocketRe
         // WSAEINVAL is here because some legacy version of winsock uses it
         if (WSAGetLastError() == WSAEINPROGRESS || WSAGetLastError() == WSAEWOULDBLOCK ||
             WSAGetLastError() == WSAEINVAL) {
+#ifdef WIN32
             struct timeval timeout;
             timeout.tv_sec  = nTimeout / 1000;
             timeout.tv_usec = (nTimeout % 1000) * 1000;
@@ -349,13 +353,21 @@ bool static ConnectSocketDirectly(const CService& addrConnect, SOCKET& hSocketRe
             FD_ZERO(&fdset);
             FD_SET(hSocket, &fdset);
             int nRet = select(hSocket + 1, nullptr, &fdset, nullptr, &timeout);
+#else
+            // the socket may be beyond FD_SETSIZE, with the peers served by epoll, see -socketevents
+            struct pollfd pollFd;
+            pollFd.fd      = hSocket;
+            pollFd.events  = POLLOUT;
+            pollFd.revents = 0;
+            int nRet = poll(&pollFd, 1, nTimeout);
+#endif
             if (nRet == 0) {
                 LogPrint(BCLog::NET, "connection to %s timeout\n", addrConnect.ToString());
                 closesocket(hSocket);
                 return false;
             }
             if (nRet == SOCKET_ERROR) {
-                LogPrint(BCLog::NET, "select() for %s failed: %s\n", addrConnect.ToString(),
+                LogPrint(BCLog::NET, "waiting for the connection to %s failed: %s\n", addrConnect.ToString(),
                          NetworkErrorString(WSAGetLastError()));
                 closesocket(hSocket);
                 return false;
@@ -373,7 +385,7 @@ bool static ConnectSocketDirectly(const CService& addrConnect, SOCKET& hSocketRe
                 return false;
             }
             if (nRet != 0) {
-                LogPrint(BCLog::NET, "connect() to %s failed after select(): %s\n", addrConnect.ToString(),
+                LogPrint(BCLog::NET, "connect() to %s failed after waiting: %s\n", addrConnect.ToString(),
                          NetworkErrorString(nRet));
                 closesocket(hSocket);
                 return false;
@@ -11,9 +11,11 @@
 #include "commons/util/util.h"
 #include "main.h"
 #include "net.h"
+#include "p2p/compactblock.h"
 #include "miner/pbftcontext.h"
 #include "miner/pbftmanager.h"
 #include "tx/einvalidtxtype.h"
+#include "tx/txadmission.h"
 
 #include <string>
 #include <tuple>
@@ -91,7 +93,7 @@ inline void ProcessGetData(CNode *pFrom) {
 
     while (it != pFrom->vRecvGetData.end()) {
         // Don't bother if send buffer is too full to respond anyway
-        if (pFrom->nSendSize >= SendBufferSize()) {
+        if (pFrom->IsSendBufferFull()) {
             LogPrint(BCLog::NET, "send buffer size: %d full for peer: %s\n", pFrom->nSendSize, pFrom->addr.ToString());
             break;
         }
@@ -117,7 +119,9 @@ inline void ProcessGetData(CNode *pFrom) {
                     if (inv.type == MSG_BLOCK) {
                         LogPrint(BCLog::NET, "send block[%u]: %s to peer %s\n", block.GetHeight(), block.GetHash().GetHex(),
                                  pFrom->addr.ToString());
-                        pFrom->PushMessage(NetMsgType::BLOCK, block);
+                        // the old blocks of a syncing peer do not hold up the new blocks and the txs, the blocks
+                        // asked for with them go the same way, or the later ones would arrive first as orphans
+                        pFrom->PushMessage(pFrom->fBulkGetData ? SEND_BULK : SEND_BLOCK, NetMsgType::BLOCK, block);
                     }
                     else  // MSG_FILTERED_BLOCK)
                     {
@@ -152,25 +156,22 @@ inline void ProcessGetData(CNode *pFrom) {
                     }
                 }
             } else if (inv.IsKnownType()) {
-                // Send stream from relay memory
-                bool pushed = false;
+                // Send the serialized tx from relay memory or the mempool, its buffer is shared, not copied
+                CSerializedTxRef pSerializedTx;
                 {
                     LOCK(cs_mapRelay);
-                    map<CInv, CDataStream>::iterator mi = mapRelay.find(inv);
-                    if (mi != mapRelay.end()) {
-                        pFrom->PushMessage(inv.GetCommand(), (*mi).second);
-                        pushed = true;
-                    }
+                    map<CInv, CSerializedTxRef>::iterator mi = mapRelay.find(inv);
+                    if (mi != mapRelay.end())
+                        pSerializedTx = mi->second;
                 }
-                if (!pushed && inv.type == MSG_TX) {
-                    std::shared_ptr<CBaseTx> pBaseTx = mempool.Lookup(inv.hash);
-                    if (pBaseTx.get() && !pBaseTx->IsBlockRewardTx() && !pBaseTx->IsPriceMedianTx()) {
-                        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-                        ss.reserve(1000);
-                        ss << pBaseTx;
-                        pFrom->PushMessage(NetMsgType::TX, ss);
-                        pushed = true;
-                    }
+                // the block reward and price median txs never enter the mempool
+                if (!pSerializedTx && inv.type == MSG_TX)
+                    pSerializedTx = mempool.LookupSerialized(inv.hash);
+
+                bool pushed = false;
+                if (pSerializedTx) {
+                    pFrom->PushSerializedTx(pSerializedTx);
+                    pushed = true;
                 }
                 if (!pushed) {
                     vNotFound.push_back(inv);
@@ -186,6 +187,8 @@ inline void ProcessGetData(CNode *pFrom) {
     }
 
     pFrom->vRecvGetData.erase(pFrom->vRecvGetData.begin(), it);
+    if (pFrom->vRecvGetData.empty())
+        pFrom->fBulkGetData = false;
 
     if (!vNotFound.empty()) {
         // Let the peer know that we didn't find what it asked for, so it doesn't
@@ -320,6 +323,10 @@ inline int32_t ProcessVersionMessage(CNode *pFrom, string strCommand, CDataStrea
     pFrom->PushMessage(NetMsgType::VERACK);
     pFrom->ssSend.SetVersion(min(pFrom->nVersion, PROTOCOL_VERSION));
 
+    // Ask for the new blocks as compact blocks, the peers which do not know the message ignore it
+    if (SysCfg().GetBoolArg("-compactblocks", DEFAULT_COMPACT_BLOCKS))
+        pFrom->PushMessage(NetMsgType::SENDCMPCT, true, COMPACT_BLOCKS_VERSION);
+
     if (!pFrom->fInbound) {
         // Advertise our address
         if (!fNoListen && !IsInitialBlockDownload()) {
@@ -444,8 +451,7 @@ inline bool ProcessAddrMessage(CNode *pFrom, CDataStream &vRecv) {
                 LOCK(cs_vNodes);
                 // Use deterministic randomness to send to the same nodes for 24 hours
                 // at a time so the setAddrKnowns of the chosen nodes prevent repeats
-                static uint256 hashSalt;
-                if (hashSalt.IsNull()) hashSalt = GetRandHash();
+                static const uint256 hashSalt = GetRandHash();
                 uint64_t hashAddr = addr.GetHash();
                 uint256 hashRand  = ArithToUint256(UintToArith256(hashSalt) ^ (hashAddr << 32) ^
                                                   ((GetTime() + hashAddr) / (24 * 60 * 60)));
@@ -480,6 +486,8 @@ inline bool ProcessAddrMessage(CNode *pFrom, CDataStream &vRecv) {
 }
 
 inline bool ProcessTxMessage(CNode *pFrom, string strCommand, CDataStream &vRecv) {
+    // the bytes of the tx are kept as received, for the mempool and the relay to the other peers
+    CSerializeData txData(vRecv.begin(), vRecv.end());
     std::shared_ptr<CBaseTx> pBaseTx;
     try {
         vRecv >> pBaseTx;
@@ -487,44 +495,30 @@ inline bool ProcessTxMessage(CNode *pFrom, string strCommand, CDataStream &vRecv
         // TODO: record the misebehaving or ban the peer node.
         return ERRORMSG("Unknown transaction type from peer %s, ignore! %s", pFrom->addr.ToString(), e.what());
     }
+    // trailing bytes are not part of the tx
+    txData.resize(txData.size() - vRecv.size());
 
     if (pBaseTx->IsBlockRewardTx() || pBaseTx->IsCoinRewardTx() || pBaseTx->IsPriceMedianTx()) {
         return ERRORMSG("Forbidden transaction from network from peer %s, raw: %s", pFrom->addr.ToString(),
-                        HexStr(vRecv.begin(), vRecv.end()));
+                        HexStr(txData.begin(), txData.end()));
     }
 
     CInv inv(MSG_TX, pBaseTx->GetHash());
     pFrom->AddInventoryKnown(inv);
+    CSerializedTxRef pSerializedTx = MakeSerializedTx(*pBaseTx, std::move(txData));
 
     if(IsInitialBlockDownload()){
-        RelayTransaction(pBaseTx.get(), inv.hash);
+        RelayTransaction(pBaseTx.get(), inv.hash, pSerializedTx);
         return true ;
     }
 
-
+    // the admission threads verify the tx outside cs_main, the tx is dropped when they are too busy
+    if (txAdmissionQueue.Push(pFrom, strCommand, pBaseTx, pSerializedTx))
+        return true;
 
     LOCK(cs_main);
     CValidationState state;
-    if (AcceptToMemoryPool(mempool, state, pBaseTx.get(), true)) {
-        RelayTransaction(pBaseTx.get(), inv.hash);
-        mapAlreadyAskedFor.erase(inv);
-
-        LogPrint(BCLog::INFO, "AcceptToMemoryPool: %s %s : accepted %s (poolsz %u)\n", pFrom->addr.ToString(),
-                 pFrom->cleanSubVer, pBaseTx->GetHash().ToString(), mempool.memPoolTxs.size());
-    }
-
-    int32_t nDoS = 0;
-    if (state.IsInvalid(nDoS)) {
-        LogPrint(BCLog::INFO, "%s [%d] from %s %s was not accepted into the memory pool: %s\n",
-                pBaseTx->GetHash().ToString(), pBaseTx->valid_height,
-                pFrom->addr.ToString(), pFrom->cleanSubVer, state.GetRejectReason());
-
-        pFrom->PushMessage(NetMsgType::REJECT, strCommand, state.GetRejectCode(), state.GetRejectReason(), inv.hash);
-        // if (nDoS > 0) {
-        //     LogPrint(BCLog::INFO, "Misebehaving, add to tx hash %s mempool error, Misbehavior add %d",
-        //     pBaseTx->GetHash().GetHex(), nDoS); Misbehaving(pFrom->GetId(), nDoS);
-        // }
-    }
+    AdmitTxFromPeer(pFrom, strCommand, pBaseTx.get(), pSerializedTx, state);
 
     return true;
 }
@@ -699,20 +693,26 @@ inline bool ProcessGetDataMessage(CNode *pFrom, CDataStream &vRecv) {
     if ((vInv.size() > 0) || (vInv.size() == 1))
         LogPrint(BCLog::NET, "received getdata for: %s from peer %s\n", vInv[0].ToString(), pFrom->addr.ToString());
 
+    {
+        // the class of the blocks is decided by the lowest block asked for, not block by block
+        LOCK(cs_main);
+        for (const auto &inv : vInv) {
+            if (pFrom->fBulkGetData)
+                break;
+            if (inv.type != MSG_BLOCK)
+                continue;
+            auto mi = mapBlockIndex.find(inv.hash);
+            if (mi != mapBlockIndex.end() && mi->second->height < chainActive.Height() - BULK_BLOCK_DEPTH)
+                pFrom->fBulkGetData = true;
+        }
+    }
     pFrom->vRecvGetData.insert(pFrom->vRecvGetData.end(), vInv.begin(), vInv.end());
     ProcessGetData(pFrom);
 
     return true;
 }
 
-inline void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv) {
-    CBlock block;
-    vRecv >> block;
-
-    LogPrint(BCLog::NET, "recv block! time_ms=%lld, hash=%s, peer=%s\n", GetTimeMillis(),
-        block.GetHash().ToString(), pFrom->addr.ToString());
-    // block.Print();
-
+inline void ProcessReceivedBlock(CNode *pFrom, CBlock &block) {
     CInv inv(MSG_BLOCK, block.GetHash());
     pFrom->AddInventoryKnown(inv);
 
@@ -737,6 +737,205 @@ inline void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv) {
 
 }
 
+inline void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv) {
+    CBlock block;
+    vRecv >> block;
+
+    LogPrint(BCLog::NET, "recv block! time_ms=%lld, hash=%s, peer=%s\n", GetTimeMillis(),
+        block.GetHash().ToString(), pFrom->addr.ToString());
+    // block.Print();
+
+    ProcessReceivedBlock(pFrom, block);
+}
+
+// The compact block could not be rebuilt, download it in full from the peer.
+inline void RequestFullBlock(CNode *pFrom, const uint256 &blockHash) {
+    pFrom->nCmpctBlocksFailed++;
+
+    LOCK(cs_main);
+    AddBlockToQueue(blockHash, pFrom->GetId());
+}
+
+inline void ProcessSendCmpctMessage(CNode *pFrom, CDataStream &vRecv) {
+    bool fAnnounce    = false;
+    uint64_t nVersion = 0;
+    vRecv >> fAnnounce >> nVersion;
+
+    // the later versions are not known yet, the peer keeps getting the full blocks then
+    if (nVersion == COMPACT_BLOCKS_VERSION)
+        pFrom->fSendCompactBlocks = fAnnounce;
+}
+
+inline void ProcessCmpctBlockMessage(CNode *pFrom, CDataStream &vRecv) {
+    CBlockHeaderAndShortTxIDs cmpctBlock;
+    vRecv >> cmpctBlock;
+
+    uint256 blockHash = cmpctBlock.header.GetHash();
+    LogPrint(BCLog::NET, "recv cmpctblock! time_ms=%lld, hash=%s, txs=%u, prefilled=%u, size=%u, peer=%s\n",
+        GetTimeMillis(), blockHash.ToString(), cmpctBlock.BlockTxCount(), cmpctBlock.prefilledTxs.size(),
+        vRecv.size(), pFrom->addr.ToString());
+
+    pFrom->nCmpctBlocksRecv++;
+    pFrom->AddInventoryKnown(CInv(MSG_BLOCK, blockHash));
+
+    // the header is checked before the mempool is scanned for the txs of the block
+    bool fHeaderChecked;
+    CValidationState state;
+    {
+        LOCK(cs_main);
+        if (mapBlockIndex.count(blockHash) || mapOrphanBlocks.count(blockHash))
+            return;
+
+        fHeaderChecked =
+            CheckBlockHeader(cmpctBlock.header, state) && ContextualCheckBlockHeader(cmpctBlock.header, state);
+    }
+
+    int32_t nDoS = 0;
+    if (state.IsInvalid(nDoS)) {
+        Misbehaving(pFrom->GetId(), nDoS);
+        LogPrint(BCLog::INFO, "invalid cmpctblock header %s from peer %s: %s\n", blockHash.ToString(),
+                 pFrom->addr.ToString(), state.GetRejectReason());
+        return;
+    }
+    if (!fHeaderChecked) {
+        // e.g. the prev block is unknown, the full block is kept as an orphan until its ancestors are downloaded
+        LogPrint(BCLog::NET, "cmpctblock %s header can not be checked, download the full block\n", blockHash.ToString());
+        RequestFullBlock(pFrom, blockHash);
+        return;
+    }
+
+    auto pPartialBlock = std::make_shared<CPartiallyDownloadedBlock>();
+    CompactBlockReadStatus status = pPartialBlock->InitData(cmpctBlock);
+    if (status == READ_STATUS_INVALID) {
+        Misbehaving(pFrom->GetId(), 100);
+        LogPrint(BCLog::INFO, "invalid cmpctblock %s from peer %s\n", blockHash.ToString(), pFrom->addr.ToString());
+        return;
+    }
+    if (status == READ_STATUS_FAILED) {
+        LogPrint(BCLog::NET, "cmpctblock %s has colliding short txids, download the full block\n", blockHash.ToString());
+        RequestFullBlock(pFrom, blockHash);
+        return;
+    }
+
+    pPartialBlock->AddCandidates(mempool);
+    vector<uint32_t> vMissingIndexes = pPartialBlock->GetMissingIndexes();
+    LogPrint(BCLog::NET, "rebuild cmpctblock! time_ms=%lld, hash=%s, prefilled=%u, mempool=%u, missing=%u, peer=%s\n",
+        GetTimeMillis(), blockHash.ToString(), pPartialBlock->GetPrefilledCount(), pPartialBlock->GetMempoolCount(),
+        vMissingIndexes.size(), pFrom->addr.ToString());
+
+    if (vMissingIndexes.empty()) {
+        CBlock block;
+        status = pPartialBlock->FillBlock(block, {});
+        if (status != READ_STATUS_OK) {
+            RequestFullBlock(pFrom, blockHash);
+            return;
+        }
+
+        ProcessReceivedBlock(pFrom, block);
+        return;
+    }
+
+    {
+        LOCK(cs_mapNodeState);
+        CNodeState *state = State(pFrom->GetId());
+        if (state == nullptr)
+            return;
+
+        if (state->mapPartialBlocks.size() >= MAX_PARTIAL_BLOCKS_PER_PEER)
+            state->mapPartialBlocks.erase(state->mapPartialBlocks.begin());
+        state->mapPartialBlocks[blockHash] = pPartialBlock;
+    }
+
+    pFrom->nCmpctBlocksRoundTrip++;
+
+    CBlockTxnRequest request;
+    request.blockHash = blockHash;
+    request.indexes   = vMissingIndexes;
+    pFrom->PushMessage(NetMsgType::GETBLOCKTXN, request);
+}
+
+inline void ProcessGetBlockTxnMessage(CNode *pFrom, CDataStream &vRecv) {
+    CBlockTxnRequest request;
+    vRecv >> request;
+
+    CBlock block;
+    {
+        LOCK(cs_main);
+        auto it = mapBlockIndex.find(request.blockHash);
+        if (it == mapBlockIndex.end()) {
+            LogPrint(BCLog::NET, "getblocktxn for unknown block %s from peer %s\n", request.blockHash.ToString(),
+                     pFrom->addr.ToString());
+            return;
+        }
+
+        if (!ReadBlockFromDisk(it->second, block))
+            return;
+
+        // a peer which asks for the txs of an old block is behind, it gets the full block
+        if (chainActive.Height() - it->second->height >= MAX_BLOCKTXN_DEPTH) {
+            pFrom->PushMessage(NetMsgType::BLOCK, block);
+            return;
+        }
+    }
+
+    CBlockTxn blockTxn;
+    blockTxn.blockHash = request.blockHash;
+    blockTxn.vptx.reserve(request.indexes.size());
+    for (uint32_t index : request.indexes) {
+        if (index >= block.vptx.size()) {
+            Misbehaving(pFrom->GetId(), 100);
+            LogPrint(BCLog::INFO, "getblocktxn with out of range index %u from peer %s\n", index,
+                     pFrom->addr.ToString());
+            return;
+        }
+        blockTxn.vptx.push_back(block.vptx[index]);
+    }
+
+    pFrom->PushMessage(NetMsgType::BLOCKTXN, blockTxn);
+}
+
+inline void ProcessBlockTxnMessage(CNode *pFrom, CDataStream &vRecv) {
+    CBlockTxn blockTxn;
+    vRecv >> blockTxn;
+
+    std::shared_ptr<CPartiallyDownloadedBlock> pPartialBlock;
+    {
+        LOCK(cs_mapNodeState);
+        CNodeState *state = State(pFrom->GetId());
+        if (state != nullptr) {
+            auto it = state->mapPartialBlocks.find(blockTxn.blockHash);
+            if (it != state->mapPartialBlocks.end()) {
+                pPartialBlock = it->second;
+                state->mapPartialBlocks.erase(it);
+            }
+        }
+    }
+
+    if (!pPartialBlock) {
+        LogPrint(BCLog::NET, "unrequested blocktxn for block %s from peer %s\n", blockTxn.blockHash.ToString(),
+                 pFrom->addr.ToString());
+        return;
+    }
+
+    CBlock block;
+    CompactBlockReadStatus status = pPartialBlock->FillBlock(block, blockTxn.vptx);
+    if (status == READ_STATUS_INVALID) {
+        Misbehaving(pFrom->GetId(), 100);
+        LogPrint(BCLog::INFO, "invalid blocktxn for block %s from peer %s\n", blockTxn.blockHash.ToString(),
+                 pFrom->addr.ToString());
+        return;
+    }
+    if (status == READ_STATUS_FAILED) {
+        RequestFullBlock(pFrom, blockTxn.blockHash);
+        return;
+    }
+
+    LogPrint(BCLog::NET, "recv blocktxn! time_ms=%lld, hash=%s, txs=%u, peer=%s\n", GetTimeMillis(),
+        blockTxn.blockHash.ToString(), blockTxn.vptx.size(), pFrom->addr.ToString());
+
+    ProcessReceivedBlock(pFrom, block);
+}
+
 inline void ProcessMempoolMessage(CNode *pFrom, CDataStream &vRecv) {
     LOCK2(cs_main, pFrom->cs_filter);
 
@@ -766,6 +965,8 @@ inline void ProcessAlertMessage(CNode *pFrom, CDataStream &vRecv) {
     vRecv >> alert;
 
     uint256 alertHash = alert.GetHash();
+    // the handlers of the other peers relay the alerts to this peer as well
+    LOCK(cs_mapAlerts);
     if (pFrom->setKnown.count(alertHash) == 0) {
         if (alert.ProcessAlert()) {
             // Relay
@@ -824,9 +1025,15 @@ inline void ProcessFilterAddMessage(CNode *pFrom, CDataStream &vRecv) {
     }
 }
 
+// the time of the tip, read under cs_main as the tip moves while the other handler threads run
+inline int64_t GetTipBlockTime() {
+    LOCK(cs_main);
+    return chainActive.Tip()->GetBlockTime();
+}
+
 bool ProcessBlockConfirmMessage(CNode *pFrom, CDataStream &vRecv) {
 
-    if(SysCfg().IsReindex()|| GetTime()-chainActive.Tip()->GetBlockTime()>600){
+    if(SysCfg().IsReindex()|| GetTime()-GetTipBlockTime()>600){
         LogPrint(BCLog::NET, "local tip's height is too low,drop the confirm message ") ;
         return false ;
     }
@@ -850,7 +1057,9 @@ bool ProcessBlockConfirmMessage(CNode *pFrom, CDataStream &vRecv) {
         return false ;
     }
 
-    msgMan.AddMessageKnown(message);
+    // the same message from another peer may have been checked meanwhile
+    if(!msgMan.AddMessageKnown(message))
+        return false ;
     int messageCount = msgMan.SaveMessageByBlock(message.blockHash, message);
 
     bool updateFinalitySuccess = false ;
@@ -872,7 +1081,7 @@ bool ProcessBlockConfirmMessage(CNode *pFrom, CDataStream &vRecv) {
 bool ProcessBlockFinalityMessage(CNode *pFrom, CDataStream &vRecv) {
 
 
-    if(SysCfg().IsReindex()|| GetTime()-chainActive.Tip()->GetBlockTime()>600)
+    if(SysCfg().IsReindex()|| GetTime()-GetTipBlockTime()>600)
         return false ;
 
     CPBFTMessageMan<CBlockFinalityMessage>& msgMan = pbftContext.finalityMessageMan ;
@@ -894,7 +1103,9 @@ bool ProcessBlockFinalityMessage(CNode *pFrom, CDataStream &vRecv) {
         return false ;
     }
 
-    msgMan.AddMessageKnown(message);
+    // the same message from another peer may have been checked meanwhile
+    if(!msgMan.AddMessageKnown(message))
+        return false ;
     int messageCount = msgMan.SaveMessageByBlock(message.blockHash, message);
     if(messageCount>= FINALITY_BLOCK_CONFIRM_MINER_COUNT){
         pbftMan.UpdateGlobalFinBlock(message) ;
@@ -0,0 +1,154 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "compactblock.h"
+
+#include "crypto/hash.h"
+#include "crypto/siphash.h"
+#include "tx/txmempool.h"
+#include "tx/txserializer.h"
+
+static const uint64_t SHORT_TXID_MASK = 0xffffffffffffULL;
+
+// the txs which are never relayed alone, so a peer has them only from the block
+static bool IsPrefilledTx(const std::shared_ptr<CBaseTx> &pTx) {
+    return pTx->IsBlockRewardTx() || pTx->IsCoinRewardTx() || pTx->IsPriceMedianTx();
+}
+
+CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock &block, uint64_t nonceIn)
+    : header(block.GetBlockHeader()), nonce(nonceIn) {
+    shortTxIds.reserve(block.vptx.size());
+    for (uint32_t i = 0; i < block.vptx.size(); i++) {
+        const std::shared_ptr<CBaseTx> &pTx = block.vptx[i];
+        if (IsPrefilledTx(pTx))
+            prefilledTxs.emplace_back(i, pTx);
+        else
+            shortTxIds.emplace_back(GetShortTxId(pTx->GetHash()));
+    }
+}
+
+void CBlockHeaderAndShortTxIDs::FillShortTxIdKeys() const {
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << header << nonce;
+    uint256 hash = ss.GetHash();
+    shortTxIdK0  = hash.GetUint64(0);
+    shortTxIdK1  = hash.GetUint64(1);
+    fKeysSet     = true;
+}
+
+uint64_t CBlockHeaderAndShortTxIDs::GetShortTxId(const uint256 &txid) const {
+    if (!fKeysSet)
+        FillShortTxIdKeys();
+
+    return SipHashUint256(shortTxIdK0, shortTxIdK1, txid) & SHORT_TXID_MASK;
+}
+
+CompactBlockReadStatus CPartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs &cmpctBlockIn) {
+    if (cmpctBlockIn.header.GetHash().IsNull() || cmpctBlockIn.BlockTxCount() == 0 ||
+        cmpctBlockIn.BlockTxCount() > MAX_BLOCK_SIZE / 10)
+        return READ_STATUS_INVALID;
+
+    cmpctBlock   = cmpctBlockIn;
+    header       = cmpctBlock.header;
+    nPrefilled   = 0;
+    nFromMempool = 0;
+    vptx.assign(cmpctBlock.BlockTxCount(), nullptr);
+    vCollided.assign(vptx.size(), false);
+    mapShortTxIdIndexes.clear();
+
+    for (const auto &prefilled : cmpctBlock.prefilledTxs) {
+        if (!prefilled.pTx || prefilled.index >= vptx.size() || vptx[prefilled.index])
+            return READ_STATUS_INVALID;
+
+        vptx[prefilled.index] = prefilled.pTx;
+        nPrefilled++;
+    }
+
+    // the short txids take the slots left by the prefilled txs, in order
+    uint32_t index = 0;
+    for (const auto &shortTxId : cmpctBlock.shortTxIds) {
+        while (vptx[index])
+            index++;
+
+        // two txs of the block with one short txid, the block can only be rebuilt in full
+        if (!mapShortTxIdIndexes.emplace(shortTxId.id, index).second)
+            return READ_STATUS_FAILED;
+
+        index++;
+    }
+
+    return READ_STATUS_OK;
+}
+
+void CPartiallyDownloadedBlock::AddCandidate(const uint256 &txid, const std::shared_ptr<CBaseTx> &pTx) {
+    auto it = mapShortTxIdIndexes.find(cmpctBlock.GetShortTxId(txid));
+    if (it == mapShortTxIdIndexes.end())
+        return;
+
+    uint32_t index = it->second;
+    if (vCollided[index])
+        return;
+
+    if (vptx[index]) {
+        if (vptx[index]->GetHash() != txid) {
+            vptx[index].reset();
+            vCollided[index] = true;
+            nFromMempool--;
+        }
+        return;
+    }
+
+    vptx[index] = pTx;
+    nFromMempool++;
+}
+
+void CPartiallyDownloadedBlock::AddCandidates(CTxMemPool &pool) {
+    LOCK(pool.cs);
+    for (const auto &item : pool.memPoolTxs) {
+        if (nFromMempool == mapShortTxIdIndexes.size())
+            break;
+
+        AddCandidate(item.first, item.second.GetTransaction());
+    }
+}
+
+bool CPartiallyDownloadedBlock::IsTxAvailable(size_t index) const {
+    assert(index < vptx.size());
+    return vptx[index] != nullptr;
+}
+
+vector<uint32_t> CPartiallyDownloadedBlock::GetMissingIndexes() const {
+    vector<uint32_t> indexes;
+    for (uint32_t i = 0; i < vptx.size(); i++) {
+        if (!vptx[i])
+            indexes.push_back(i);
+    }
+    return indexes;
+}
+
+CompactBlockReadStatus CPartiallyDownloadedBlock::FillBlock(CBlock &block,
+                                                            const vector<std::shared_ptr<CBaseTx> > &vMissingTxs) const {
+    block = CBlock(header);
+    block.vptx.reserve(vptx.size());
+
+    size_t nMissing = 0;
+    for (const auto &pTx : vptx) {
+        if (pTx) {
+            block.vptx.push_back(pTx);
+        } else {
+            if (nMissing >= vMissingTxs.size() || !vMissingTxs[nMissing])
+                return READ_STATUS_INVALID;
+
+            block.vptx.push_back(vMissingTxs[nMissing++]);
+        }
+    }
+    if (nMissing != vMissingTxs.size())
+        return READ_STATUS_INVALID;
+
+    // a mempool tx taken by a colliding short txid makes another block than the header commits to
+    if (block.BuildMerkleTree() != header.GetMerkleRootHash())
+        return READ_STATUS_FAILED;
+
+    return READ_STATUS_OK;
+}
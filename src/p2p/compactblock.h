@@ -0,0 +1,160 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef P2P_COMPACTBLOCK_H
+#define P2P_COMPACTBLOCK_H
+
+#include "commons/serialize.h"
+#include "commons/uint256.h"
+#include "persistence/block.h"
+
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+class CBaseTx;
+class CTxMemPool;
+
+/** The version of the compact blocks announced in the "sendcmpct" message */
+static const uint64_t COMPACT_BLOCKS_VERSION = 1;
+/** Whether the new blocks are relayed to the peers as compact blocks by default */
+static const bool DEFAULT_COMPACT_BLOCKS = true;
+/** The deepest block whose missing txs are served to a "getblocktxn", the full block is sent beyond it */
+static const int32_t MAX_BLOCKTXN_DEPTH = 10;
+/** The most compact blocks a peer may have waiting for their missing txs */
+static const size_t MAX_PARTIAL_BLOCKS_PER_PEER = 3;
+
+/** A 6-byte short txid, the low 48 bits of the SipHash of the txid keyed by the block */
+class CShortTxId {
+public:
+    uint64_t id;
+
+    CShortTxId() : id(0) {}
+    explicit CShortTxId(uint64_t idIn) : id(idIn) {}
+
+    IMPLEMENT_SERIALIZE(
+        uint32_t lsb = id & 0xffffffff;
+        uint16_t msb = (id >> 32) & 0xffff;
+        READWRITE(lsb);
+        READWRITE(msb);
+        if (fRead)
+            const_cast<CShortTxId *>(this)->id = ((uint64_t)msb << 32) | lsb;
+    )
+};
+
+/** A tx sent in full within a compact block, at its index in the block */
+class CPrefilledTx {
+public:
+    uint32_t index;
+    std::shared_ptr<CBaseTx> pTx;
+
+    CPrefilledTx() : index(0) {}
+    CPrefilledTx(uint32_t indexIn, const std::shared_ptr<CBaseTx> &pTxIn) : index(indexIn), pTx(pTxIn) {}
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(VARINT(index));
+        READWRITE(pTx);
+    )
+};
+
+/**
+ * The "cmpctblock" message: the header of a block, the short txids of the txs which the peer likely has in its
+ * mempool and, in full, the txs which never enter a mempool, i.e. the block reward, coin reward and price median
+ * txs. The short txids are salted by a random nonce, so that colliding txids can not be made up ahead.
+ */
+class CBlockHeaderAndShortTxIDs {
+public:
+    CBlockHeader header;
+    uint64_t nonce;
+    vector<CShortTxId> shortTxIds;
+    vector<CPrefilledTx> prefilledTxs;
+
+    CBlockHeaderAndShortTxIDs() : nonce(0) {}
+    CBlockHeaderAndShortTxIDs(const CBlock &block, uint64_t nonceIn);
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(header);
+        READWRITE(nonce);
+        READWRITE(shortTxIds);
+        READWRITE(prefilledTxs);
+        if (fRead)
+            const_cast<CBlockHeaderAndShortTxIDs *>(this)->fKeysSet = false;
+    )
+
+    size_t BlockTxCount() const { return shortTxIds.size() + prefilledTxs.size(); }
+    uint64_t GetShortTxId(const uint256 &txid) const;
+
+private:
+    void FillShortTxIdKeys() const;
+
+    // the SipHash keys of the short txids, from the hash of the header and the nonce
+    mutable uint64_t shortTxIdK0 = 0;
+    mutable uint64_t shortTxIdK1 = 0;
+    mutable bool fKeysSet        = false;
+};
+
+/** The "getblocktxn" message: the indexes of the txs of a compact block which the peer did not have */
+class CBlockTxnRequest {
+public:
+    uint256 blockHash;
+    vector<uint32_t> indexes;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(blockHash);
+        READWRITE(indexes);
+    )
+};
+
+/** The "blocktxn" message: the txs asked for by a "getblocktxn", in the order of their indexes */
+class CBlockTxn {
+public:
+    uint256 blockHash;
+    vector<std::shared_ptr<CBaseTx> > vptx;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(blockHash);
+        READWRITE(vptx);
+    )
+};
+
+enum CompactBlockReadStatus {
+    READ_STATUS_OK,
+    READ_STATUS_INVALID,  // the peer sent a malformed message
+    READ_STATUS_FAILED,   // the block could not be rebuilt, e.g. the short txids collide, the full block is needed
+};
+
+/**
+ * A block rebuilt from a compact block: the prefilled txs are placed at once, the others are looked up by their
+ * short txids in the mempool, and the remaining ones are filled in from the "blocktxn" answer. A short txid which
+ * matches two candidate txs is left missing, so that the peer sends the right one.
+ */
+class CPartiallyDownloadedBlock {
+public:
+    CBlockHeader header;
+
+    CompactBlockReadStatus InitData(const CBlockHeaderAndShortTxIDs &cmpctBlock);
+    // fill the slot of the tx if its short txid is one of the block's
+    void AddCandidate(const uint256 &txid, const std::shared_ptr<CBaseTx> &pTx);
+    void AddCandidates(CTxMemPool &pool);
+
+    bool IsTxAvailable(size_t index) const;
+    vector<uint32_t> GetMissingIndexes() const;
+    size_t GetPrefilledCount() const { return nPrefilled; }
+    size_t GetMempoolCount() const { return nFromMempool; }
+    // the missing txs are given in the order of GetMissingIndexes(), the merkle root of the block is checked
+    CompactBlockReadStatus FillBlock(CBlock &block, const vector<std::shared_ptr<CBaseTx> > &vMissingTxs) const;
+
+private:
+    CBlockHeaderAndShortTxIDs cmpctBlock;
+    vector<std::shared_ptr<CBaseTx> > vptx;
+    map<uint64_t, uint32_t> mapShortTxIdIndexes;  // short txid -> index in the block
+    vector<bool> vCollided;                        // slots which more than one candidate matched
+    size_t nPrefilled   = 0;
+    size_t nFromMempool = 0;
+};
+
+#endif  // P2P_COMPACTBLOCK_H
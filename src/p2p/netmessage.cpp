@@ -5,6 +5,10 @@
 
 #include "netmessage.h"
 
+#include <string.h>
+#include <algorithm>
+#include <limits>
+
 int32_t CNetMessage::readHeader(const char* pch, uint32_t nBytes) {
     // copy data to temporary parsing buffer
     uint32_t nRemaining = 24 - nHdrPos;
@@ -44,3 +48,115 @@ int32_t CNetMessage::readData(const char* pch, uint32_t nBytes) {
 
     return nCopy;
 }
+
+const char* const SEND_CLASS_NAMES[SEND_CLASS_MAX] = {"consensus", "block", "tx", "bulk"};
+
+SendClass GetSendClass(const char* pszCommand) {
+    static const char* const consensusCommands[] = {NetMsgType::CONFIRMBLOCK, NetMsgType::FINALITYBLOCK};
+    static const char* const blockCommands[]     = {
+        NetMsgType::BLOCK,      NetMsgType::CMPCTBLOCK, NetMsgType::GETBLOCKTXN, NetMsgType::BLOCKTXN,
+        NetMsgType::VERSION,    NetMsgType::VERACK,     NetMsgType::SENDCMPCT,   NetMsgType::PING,
+        NetMsgType::PONG,       NetMsgType::REJECT,     NetMsgType::GETDATA,     NetMsgType::GETBLOCKS,
+        NetMsgType::GETHEADERS, NetMsgType::MEMPOOL,    NetMsgType::FILTERLOAD,  NetMsgType::FILTERADD,
+        NetMsgType::FILTERCLEAR};
+
+    for (const char* pszConsensus : consensusCommands) {
+        if (strcmp(pszCommand, pszConsensus) == 0)
+            return SEND_CONSENSUS;
+    }
+    if (strcmp(pszCommand, NetMsgType::TX) == 0)
+        return SEND_TX;
+    for (const char* pszBlock : blockCommands) {
+        if (strcmp(pszCommand, pszBlock) == 0)
+            return SEND_BLOCK;
+    }
+    return SEND_BULK;
+}
+
+bool CSendQueues::empty() const {
+    for (const auto& queue : queues) {
+        if (!queue.empty())
+            return false;
+    }
+    return true;
+}
+
+size_t CSendQueues::GetQueuedBytes(SendClass sendClass) const {
+    LOCK(cs_stats);
+    return stats[sendClass].nQueuedBytes;
+}
+
+void CSendQueues::Push(SendClass sendClass, CSendMessage&& msg, int64_t nNow) {
+    msg.nQueuedTime = nNow;
+    {
+        LOCK(cs_stats);
+        stats[sendClass].nQueuedMsgs++;
+        stats[sendClass].nQueuedBytes += msg.size();
+    }
+    queues[sendClass].push_back(std::move(msg));
+}
+
+const CSendMessage* CSendQueues::Front(bool fPartlySent) {
+    if (fPartlySent) {
+        assert(nFrontClass >= 0 && !queues[nFrontClass].empty());
+        return &queues[nFrontClass].front();
+    }
+
+    nFrontClass = -1;
+    if (!queues[SEND_CONSENSUS].empty()) {
+        nFrontClass = SEND_CONSENSUS;
+        return &queues[SEND_CONSENSUS].front();
+    }
+
+    // the first class in priority which has the deficit for its next message, else start as many new rounds
+    // as the class nearest to it needs
+    while (true) {
+        uint64_t nRounds = std::numeric_limits<uint64_t>::max();
+        for (int32_t i = SEND_CONSENSUS + 1; i < SEND_CLASS_MAX; i++) {
+            if (queues[i].empty())
+                continue;
+
+            uint64_t nSize = queues[i].front().size();
+            if (deficits[i] >= nSize) {
+                nFrontClass = i;
+                return &queues[i].front();
+            }
+            nRounds = std::min(nRounds, (nSize - deficits[i] + SEND_CLASS_QUANTUM[i] - 1) / SEND_CLASS_QUANTUM[i]);
+        }
+        if (nRounds == std::numeric_limits<uint64_t>::max())
+            return nullptr;
+
+        for (int32_t i = SEND_CONSENSUS + 1; i < SEND_CLASS_MAX; i++) {
+            if (!queues[i].empty())
+                deficits[i] += nRounds * SEND_CLASS_QUANTUM[i];
+        }
+    }
+}
+
+void CSendQueues::PopFront(int64_t nNow) {
+    assert(nFrontClass >= 0 && !queues[nFrontClass].empty());
+    deque<CSendMessage>& queue = queues[nFrontClass];
+    const CSendMessage& msg    = queue.front();
+    size_t nSize               = msg.size();
+    int64_t nWait              = nNow - msg.nQueuedTime;
+    {
+        LOCK(cs_stats);
+        CSendClassStats& classStats = stats[nFrontClass];
+        classStats.nQueuedMsgs--;
+        classStats.nQueuedBytes -= nSize;
+        classStats.nSentMsgs++;
+        classStats.nSentBytes += nSize;
+        classStats.nTotalWaitUsec += nWait;
+        classStats.nMaxWaitUsec = std::max(classStats.nMaxWaitUsec, nWait);
+    }
+    queue.pop_front();
+
+    if (nFrontClass != SEND_CONSENSUS)
+        deficits[nFrontClass] = queue.empty() ? 0 : deficits[nFrontClass] - nSize;
+    nFrontClass = -1;
+}
+
+void CSendQueues::GetStats(vector<CSendClassStats>& statsOut) const {
+    LOCK(cs_stats);
+    statsOut.assign(stats, stats + SEND_CLASS_MAX);
+}
@@ -8,6 +8,11 @@
 
 #include "commons/serialize.h"
 #include "p2p/protocol.h"
+#include "sync.h"
+#include "tx/serializedtx.h"
+
+#include <deque>
+#include <vector>
 
 class CNetMessage {
 public:
@@ -42,6 +47,74 @@ public:
     int32_t readData(const char* pch, uint32_t nBytes);
 };
 
+/** The classes of the send queues of a peer, in the order they are served */
+enum SendClass {
+    SEND_CONSENSUS = 0,  // the PBFT block confirm and finality messages, never held back
+    SEND_BLOCK,          // the new blocks, compact blocks and their txs, the handshake and the requests
+    SEND_TX,             // the relayed txs
+    SEND_BULK,           // inv, addr, the old blocks asked for by a syncing peer and the rest
+    SEND_CLASS_MAX
+};
+
+extern const char* const SEND_CLASS_NAMES[SEND_CLASS_MAX];
+/** The bytes a class may send in a round of the scheduler while the lower classes wait, the consensus class is
+ *  served before all of them and has no quantum */
+static const uint32_t SEND_CLASS_QUANTUM[SEND_CLASS_MAX] = {0, 64 * 1024, 16 * 1024, 8 * 1024};
+/** The blocks deeper below the tip are sent as bulk traffic, they are asked for by a syncing peer */
+static const int32_t BULK_BLOCK_DEPTH = 10;
+
+/** The send class of the message of the command */
+SendClass GetSendClass(const char* pszCommand);
+
+/** A message queued to be sent: the whole message, or its header only when its payload is a shared serialized tx */
+class CSendMessage {
+public:
+    CSerializeData data;
+    CSerializedTxRef pPayload;
+    int64_t nQueuedTime = 0;  // in micro seconds
+
+    size_t size() const { return data.size() + (pPayload ? pPayload->size() : 0); }
+};
+
+class CSendClassStats {
+public:
+    uint64_t nQueuedMsgs   = 0;
+    uint64_t nQueuedBytes  = 0;
+    uint64_t nSentMsgs     = 0;
+    uint64_t nSentBytes    = 0;
+    int64_t nTotalWaitUsec = 0;  // from being queued until the last byte was handed to the socket
+    int64_t nMaxWaitUsec   = 0;
+};
+
+/**
+ * The send queues of a peer, one for each send class. The consensus messages are sent before all others, the
+ * other classes share the link by deficit round robin in the order of their priority: in each round a class may
+ * send up to its quantum of bytes before the lower classes get their turn, so that the blocks overtake the txs and
+ * the bulk inventory without starving them. A message which is partly sent is finished first.
+ */
+class CSendQueues {
+public:
+    bool empty() const;
+    size_t GetQueuedBytes(SendClass sendClass) const;
+
+    void Push(SendClass sendClass, CSendMessage&& msg, int64_t nNow);
+    // the message to send next, nullptr if none, fPartlySent keeps the message which is partly sent
+    const CSendMessage* Front(bool fPartlySent);
+    // the message returned by Front() has been sent in full
+    void PopFront(int64_t nNow);
+
+    void GetStats(vector<CSendClassStats>& stats) const;
+
+private:
+    deque<CSendMessage> queues[SEND_CLASS_MAX];
+    uint64_t deficits[SEND_CLASS_MAX] = {};
+    int32_t nFrontClass               = -1;
+
+    // the stats are read by getpeerinfo, which can not take cs_vSend as it holds cs_vNodes
+    mutable CCriticalSection cs_stats;
+    CSendClassStats stats[SEND_CLASS_MAX];
+};
+
 
 
 #endif //WAYKICHAIN_NETMESSAGE_H
@@ -8,6 +8,11 @@
 #include "netmessage.h"
 #include <openssl/rand.h>
 
+#ifndef WIN32
+#include <netinet/tcp.h>
+#include <sys/uio.h>
+#endif
+
 uint64_t CNode::nTotalBytesRecv = 0;
 uint64_t CNode::nTotalBytesSent = 0;
 CCriticalSection CNode::cs_totalBytesRecv;
@@ -36,28 +41,61 @@ CNodeState *State(NodeId pNode) {
     return &it->second;
 }
 
+void SetSocketSendLowat(SOCKET hSocket) {
+#ifdef TCP_NOTSENT_LOWAT
+    int32_t nLowat = SOCKET_SEND_LOWAT;
+    if (setsockopt(hSocket, IPPROTO_TCP, TCP_NOTSENT_LOWAT, (void*)&nLowat, sizeof(nLowat)) == SOCKET_ERROR)
+        LogPrint(BCLog::NET, "setsockopt TCP_NOTSENT_LOWAT failed, error %s\n", NetworkErrorString(WSAGetLastError()));
+#endif
+}
+
+// send the rest of the message from the offset, its header and its shared payload in one call
+static int32_t SendMessageData(SOCKET hSocket, const CSendMessage& msg, size_t nOffset) {
+    const CSerializeData& data = msg.data;
+    if (!msg.pPayload)
+        return send(hSocket, &data[nOffset], data.size() - nOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+
+    const CSerializeData& payload = msg.pPayload->GetData();
+    if (nOffset >= data.size()) {
+        nOffset -= data.size();
+        return send(hSocket, &payload[nOffset], payload.size() - nOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+    }
+#ifdef WIN32
+    return send(hSocket, &data[nOffset], data.size() - nOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+    struct iovec iov[2];
+    iov[0].iov_base = (void*)&data[nOffset];
+    iov[0].iov_len  = data.size() - nOffset;
+    iov[1].iov_base = (void*)&payload[0];
+    iov[1].iov_len  = payload.size();
+
+    struct msghdr msgHdr;
+    memset(&msgHdr, 0, sizeof(msgHdr));
+    msgHdr.msg_iov    = iov;
+    msgHdr.msg_iovlen = 2;
+    return sendmsg(hSocket, &msgHdr, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
+}
+
 // requires LOCK(cs_vSend)
 void CNode::SocketSendData() {
-    deque<CSerializeData>::iterator it = vSendMsg.begin();
-
-    while (it != vSendMsg.end()) {
-        const CSerializeData& data = *it;
-        assert(data.size() > nSendOffset);
-        int32_t nBytes = send(hSocket, &data[nSendOffset], data.size() - nSendOffset,
-                              MSG_NOSIGNAL | MSG_DONTWAIT);
+    const CSendMessage* pMsg;
+    while ((pMsg = sendQueues.Front(nSendOffset > 0)) != nullptr) {
+        size_t nSize = pMsg->size();
+        assert(nSize > nSendOffset);
+        int32_t nBytes = SendMessageData(hSocket, *pMsg, nSendOffset);
         if (nBytes > 0) {
             nLastSend = GetTime();
             nSendBytes += nBytes;
             nSendOffset += nBytes;
             RecordBytesSent(nBytes);
-            if (nSendOffset == data.size()) {
+            if (nSendOffset == nSize) {
                 nSendOffset = 0;
-                nSendSize -= data.size();
-                it++;
-            } else {
-                // could not send full message; stop sending more
-                break;
+                sendQueues.PopFront(GetTimeMicros());
+                nSendSize -= nSize;
             }
+            // else retry the rest until the socket would block, the edge-triggered socket events report
+            // it writable again only after that
         } else {
             if (nBytes < 0) {
                 // error
@@ -72,11 +110,10 @@ void CNode::SocketSendData() {
         }
     }
 
-    if (it == vSendMsg.end()) {
+    if (sendQueues.empty()) {
         assert(nSendOffset == 0);
         assert(nSendSize == 0);
     }
-    vSendMsg.erase(vSendMsg.begin(), it);
 }
 
 
@@ -185,6 +222,28 @@ bool CNode::Ban(const CNetAddr& addr) {
     return true;
 }
 
+const int64_t CCommandTimeStats::BUCKET_LIMITS[BUCKETS - 1] = {100, 1000, 10000, 100000, 1000000};
+const char* const CCommandTimeStats::BUCKET_NAMES[BUCKETS] = {"<100us", "<1ms", "<10ms", "<100ms", "<1s", ">=1s"};
+
+void CCommandTimeStats::Add(int64_t nUsec) {
+    int32_t nBucket = 0;
+    while (nBucket < BUCKETS - 1 && nUsec >= BUCKET_LIMITS[nBucket])
+        nBucket++;
+
+    nCount++;
+    nTotalUsec += nUsec;
+    nMaxUsec = max(nMaxUsec, nUsec);
+    vBuckets[nBucket]++;
+}
+
+void CNode::RecordCommandTime(const string& strCommand, int64_t nUsec) {
+    // the peer chooses the command, the unknown ones share an entry so that the map stays bounded
+    static const set<string> setCommands(getAllNetMessageTypes().begin(), getAllNetMessageTypes().end());
+
+    LOCK(cs_commandTimes);
+    mapCommandTimes[setCommands.count(strCommand) ? strCommand : "*other*"].Add(nUsec);
+}
+
 #undef X
 #define X(name) stats.name = name
 void CNode::copyStats(CNodeStats& stats) {
@@ -200,6 +259,11 @@ void CNode::copyStats(CNodeStats& stats) {
     X(nStartingHeight);
     X(nSendBytes);
     X(nRecvBytes);
+    X(fSendCompactBlocks);
+    X(nCmpctBlocksRecv);
+    X(nCmpctBlocksRoundTrip);
+    X(nCmpctBlocksFailed);
+    sendQueues.GetStats(stats.vSendClassStats);
     stats.fSyncNode = (this == pnodeSync);
 
     // It is common for nodes with good ping times to suddenly become lagged,
@@ -220,6 +284,9 @@ void CNode::copyStats(CNodeStats& stats) {
 
     // Leave string empty if addrLocal invalid (not filled in yet)
     stats.addrLocal = addrLocal.IsValid() ? addrLocal.ToString() : "";
+
+    LOCK(cs_commandTimes);
+    stats.mapCommandTimes = mapCommandTimes;
 }
 #undef X
 
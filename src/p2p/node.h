@@ -21,6 +21,7 @@
 class CNode ;
 struct CNodeSignals;
 struct CNodeState ;
+class CPartiallyDownloadedBlock;
 
 typedef int32_t NodeId;
 extern CCriticalSection cs_nLastNodeId;
@@ -31,6 +32,13 @@ extern CCriticalSection cs_mapLocalHost;
 extern map<NodeId, CNodeState> mapNodeState;
 extern CCriticalSection cs_mapNodeState;
 extern CNodeSignals& GetNodeSignals();
+/** Have the socket handler write the queued messages of the node */
+void WakeSocketHandler(NodeId id);
+/** Bound the bytes which the kernel holds unsent for the socket, so that the send queues order the rest by class */
+void SetSocketSendLowat(SOCKET hSocket);
+
+/** The unsent bytes of a socket in the kernel, a consensus message waits at most for them to leave the host */
+static const int32_t SOCKET_SEND_LOWAT = 128 * 1024;
 
 /** The maximum number of entries in an 'inv' protocol message */
 static const uint32_t MAX_INV_SZ = 50000;
@@ -62,6 +70,23 @@ inline uint32_t SendBufferSize() { return 1000 * SysCfg().GetArg("-maxsendbuffer
 CAddress GetLocalAddress(const CNetAddr* paddrPeer = nullptr);
 bool GetLocal(CService& addr, const CNetAddr* paddrPeer = nullptr);
 
+/** The processing times of the messages of a command, counted in buckets by their duration */
+class CCommandTimeStats {
+public:
+    static const int32_t BUCKETS = 6;
+    static const int64_t BUCKET_LIMITS[BUCKETS - 1];  // in microseconds, the last bucket is unbounded
+    static const char* const BUCKET_NAMES[BUCKETS];
+
+    uint64_t nCount;
+    int64_t nTotalUsec;
+    int64_t nMaxUsec;
+    uint64_t vBuckets[BUCKETS];
+
+    CCommandTimeStats() : nCount(0), nTotalUsec(0), nMaxUsec(0), vBuckets() {}
+
+    void Add(int64_t nUsec);
+};
+
 class CNodeStats {
 public:
     NodeId nodeid;
@@ -80,6 +105,12 @@ public:
     double dPingTime;
     double dPingWait;
     string addrLocal;
+    map<string, CCommandTimeStats> mapCommandTimes;
+    bool fSendCompactBlocks;
+    uint64_t nCmpctBlocksRecv;
+    uint64_t nCmpctBlocksRoundTrip;
+    uint64_t nCmpctBlocksFailed;
+    vector<CSendClassStats> vSendClassStats;
 };
 
 struct CBlockReject {
@@ -115,6 +146,8 @@ struct CNodeState {
     int32_t nBlocksToDownload;        // blocks number to be downloaded
     int64_t nLastBlockReceive;        // the latest receiving blocks time
     int64_t nLastBlockProcess;        // the latest processing blocks time
+    // compact blocks waiting for the "blocktxn" of their missing txs
+    map<uint256, std::shared_ptr<CPartiallyDownloadedBlock>> mapPartialBlocks;
 
     CNodeState() {
         nMisbehavior      = 0;
@@ -136,13 +169,15 @@ public:
     uint64_t nServices;
     SOCKET hSocket;
     CDataStream ssSend;
-    size_t nSendSize;    // total size of all vSendMsg entries
-    size_t nSendOffset;  // offset inside the first vSendMsg already sent
+    size_t nSendSize;    // total size of all queued messages
+    size_t nSendOffset;  // offset inside the front message already sent, its header and payload in a row
     uint64_t nSendBytes;
-    deque<CSerializeData> vSendMsg;
+    CSendQueues sendQueues;
+    SendClass nSendClass;  // of the message in ssSend
     CCriticalSection cs_vSend;
 
     deque<CInv> vRecvGetData;  // strCommand == "getdata 保存的inv
+    bool fBulkGetData;         // the blocks asked for in vRecvGetData reach below the bulk depth, all go as bulk
     deque<CNetMessage> vRecvMsg;
     CCriticalSection cs_vRecvMsg;
     uint64_t nRecvBytes;
@@ -195,10 +230,11 @@ public:
     bool fStartSync;
 
     // flood relay
+    CCriticalSection cs_vAddrToSend;  // the other peers' handlers push addresses too
     vector<CAddress> vAddrToSend;
     mruset<CAddress> setAddrKnown;
     bool fGetAddr;
-    set<uint256> setKnown;  // alertHash
+    set<uint256> setKnown;  // alertHash, protected by cs_mapAlerts
 
     // inventory based relay
     mruset<CInv> setInventoryKnown;  //存放已收到的inv
@@ -215,6 +251,17 @@ public:
     mruset<CBlockFinalityMessage> setBlockFinalityMsgKnown ;
     CCriticalSection cs_blockFinality ;
 
+    // compact block relay: whether the peer asked for the new blocks as "cmpctblock", and how the received compact
+    // blocks were rebuilt, at once from the mempool, after a "getblocktxn" round trip or not at all
+    bool fSendCompactBlocks;
+    uint64_t nCmpctBlocksRecv;
+    uint64_t nCmpctBlocksRoundTrip;
+    uint64_t nCmpctBlocksFailed;
+
+    // the processing times of the received messages, by command
+    CCriticalSection cs_commandTimes;
+    map<string, CCommandTimeStats> mapCommandTimes;
+
     // Ping time measurement
     uint64_t nPingNonceSent;
     int64_t nPingUsecStart;
@@ -245,6 +292,8 @@ public:
         nRefCount                = 0;
         nSendSize                = 0;
         nSendOffset              = 0;
+        nSendClass               = SEND_BULK;
+        fBulkGetData             = false;
         hashContinue             = uint256();
         pIndexLastGetBlocksBegin = 0;
         hashLastGetBlocksEnd     = uint256();
@@ -252,6 +301,10 @@ public:
         fStartSync               = false;
         fGetAddr                 = false;
         fRelayTxes               = false;
+        fSendCompactBlocks       = false;
+        nCmpctBlocksRecv         = 0;
+        nCmpctBlocksRoundTrip    = 0;
+        nCmpctBlocksFailed       = 0;
         setInventoryKnown.max_size(SendBufferSize() / 1000);
         setBlockConfirmMsgKnown.max_size(200);
         pFilter        = new CBloomFilter();
@@ -265,6 +318,9 @@ public:
             id = nLastNodeId++;
         }
 
+        if (hSocket != INVALID_SOCKET)
+            SetSocketSendLowat(hSocket);
+
         // Be shy and don't send version until we hear
         if (hSocket != INVALID_SOCKET && !fInbound)
             PushVersion();
@@ -318,6 +374,12 @@ public:
     // requires LOCK(cs_vRecvMsg)
     bool ReceiveMsgBytes(const char* pch, uint32_t nBytes);
 
+    // whether to stop answering the peer, the queued consensus messages do not count, nor are they held back
+    bool IsSendBufferFull() const {
+        size_t nConsensusSize = sendQueues.GetQueuedBytes(SEND_CONSENSUS);
+        return nSendSize > nConsensusSize && nSendSize - nConsensusSize >= SendBufferSize();
+    }
+
     // requires LOCK(cs_vRecvMsg)
     void SetRecvVersion(int32_t nVersionIn) {
         nRecvVersion = nVersionIn;
@@ -332,12 +394,22 @@ public:
 
     void Release() { nRefCount--; }
 
-    void AddAddressKnown(const CAddress& addr) { setAddrKnown.insert(addr); }
+    void AddAddressKnown(const CAddress& addr) {
+        LOCK(cs_vAddrToSend);
+        setAddrKnown.insert(addr);
+    }
 
-    void AddBlockConfirmMessageKnown(const CBlockConfirmMessage msg){ setBlockConfirmMsgKnown.insert(msg); }
-    void AddBlockFinalityMessageKnown(const CBlockFinalityMessage msg){ setBlockFinalityMsgKnown.insert(msg); }
+    void AddBlockConfirmMessageKnown(const CBlockConfirmMessage msg) {
+        LOCK(cs_blockConfirm);
+        setBlockConfirmMsgKnown.insert(msg);
+    }
+    void AddBlockFinalityMessageKnown(const CBlockFinalityMessage msg) {
+        LOCK(cs_blockFinality);
+        setBlockFinalityMsgKnown.insert(msg);
+    }
 
     void PushAddress(const CAddress& addr) {
+        LOCK(cs_vAddrToSend);
         // Known checking here is only to save space from duplicates.
         // SendMessages will filter it again for knowns that were added
         // after addresses were pushed.
@@ -357,6 +429,11 @@ public:
         }
     }
 
+    bool IsInventoryKnown(const CInv& inv) {
+        LOCK(cs_inventory);
+        return setInventoryKnown.count(inv) > 0;
+    }
+
     void PushInventory(const CInv& inv, bool forced = false) {
         {
             LOCK(cs_inventory);
@@ -421,9 +498,14 @@ public:
 
     // TODO: Document the postcondition of this function.  Is cs_vSend locked?
     void BeginMessage(const char* pszCommand) EXCLUSIVE_LOCK_FUNCTION(cs_vSend) {
+            BeginMessage(pszCommand, GetSendClass(pszCommand));
+    }
+
+    void BeginMessage(const char* pszCommand, SendClass sendClass) EXCLUSIVE_LOCK_FUNCTION(cs_vSend) {
             ENTER_CRITICAL_SECTION(cs_vSend);
             assert(ssSend.size() == 0);
             ssSend << CMessageHeader(pszCommand, 0);
+            nSendClass = sendClass;
             LogPrint(BCLog::NET, "sending: %s\n", pszCommand);
     }
 
@@ -437,7 +519,8 @@ public:
     }
 
     // TODO: Document the precondition of this function.  Is cs_vSend locked?
-    void EndMessage() UNLOCK_FUNCTION(cs_vSend) {
+    // A shared payload is queued after the message by reference, it is neither copied nor hashed again.
+    void EndMessage(const CSerializedTxRef& pPayload = nullptr) UNLOCK_FUNCTION(cs_vSend) {
             // The -*messagestest options are intentionally not documented in the help message,
             // since they are only used during development to debug the networking code and are
             // not intended for end-users.
@@ -446,7 +529,7 @@ public:
                 AbortMessage();
                 return;
             }
-            if (SysCfg().IsArgCount("-fuzzmessagestest"))
+            if (SysCfg().IsArgCount("-fuzzmessagestest") && !pPayload)
             Fuzz(SysCfg().GetArg("-fuzzmessagestest", 10));
 
             if (ssSend.size() == 0)
@@ -454,29 +537,55 @@ public:
 
             // Set the size
             uint32_t nSize = ssSend.size() - CMessageHeader::HEADER_SIZE;
+            if (pPayload) {
+                assert(nSize == 0);
+                nSize = pPayload->size();
+            }
             memcpy((char*)&ssSend[CMessageHeader::MESSAGE_SIZE_OFFSET], &nSize, sizeof(nSize));
 
             // Set the checksum
-            uint256 hash           = Hash(ssSend.begin() + CMessageHeader::HEADER_SIZE, ssSend.end());
             uint32_t nChecksum = 0;
-            memcpy(&nChecksum, &hash, sizeof(nChecksum));
+            if (pPayload) {
+                nChecksum = pPayload->GetChecksum();
+            } else {
+                uint256 hash = Hash(ssSend.begin() + CMessageHeader::HEADER_SIZE, ssSend.end());
+                memcpy(&nChecksum, &hash, sizeof(nChecksum));
+            }
             assert(ssSend.size() >= CMessageHeader::CHECKSUM_OFFSET + sizeof(nChecksum));
             memcpy((char*)&ssSend[CMessageHeader::CHECKSUM_OFFSET], &nChecksum, sizeof(nChecksum));
 
             LogPrint(BCLog::NET, "(%d bytes)\n", nSize);
 
-            deque<CSerializeData>::iterator it = vSendMsg.insert(vSendMsg.end(), CSerializeData());
-            ssSend.GetAndClear(*it);
-            nSendSize += (*it).size();
+            CSendMessage msg;
+            ssSend.GetAndClear(msg.data);
+            msg.pPayload = pPayload;
+            nSendSize += msg.size();
+            bool fQueueEmpty = sendQueues.empty();
+            sendQueues.Push(nSendClass, std::move(msg), GetTimeMicros());
 
-            // If write queue empty, attempt "optimistic write"
-            if (it == vSendMsg.begin()) SocketSendData();
+            // If write queue empty, attempt "optimistic write", a consensus message tries to overtake the queue
+            if (fQueueEmpty || nSendClass == SEND_CONSENSUS) SocketSendData();
+            bool fPending = !sendQueues.empty();
 
             LEAVE_CRITICAL_SECTION(cs_vSend);
+
+            if (fPending)
+                WakeSocketHandler(id);
     }
 
     void PushVersion();
 
+    // send the "tx" message of a serialized tx, whose buffer the send queue shares
+    void PushSerializedTx(const CSerializedTxRef& pSerializedTx) {
+        try {
+            BeginMessage(NetMsgType::TX);
+            EndMessage(pSerializedTx);
+        } catch (...) {
+            AbortMessage();
+            throw;
+        }
+    }
+
     void PushMessage(const char* pszCommand) {
         try {
             BeginMessage(pszCommand);
@@ -487,6 +596,19 @@ public:
         }
     }
 
+    // send the message in the given class instead of the one of its command
+    template <typename T1>
+    void PushMessage(SendClass sendClass, const char* pszCommand, const T1& a1) {
+        try {
+            BeginMessage(pszCommand, sendClass);
+            ssSend << a1;
+            EndMessage();
+        } catch (...) {
+            AbortMessage();
+            throw;
+        }
+    }
+
     template <typename T1>
     void PushMessage(const char* pszCommand, const T1& a1) {
         try {
@@ -624,6 +746,7 @@ public:
     static bool IsBanned(CNetAddr ip);
     static bool Ban(const CNetAddr& ip);
     void copyStats(CNodeStats& stats);
+    void RecordCommandTime(const string& strCommand, int64_t nUsec);
 
     // Network stats
     static void RecordBytesRecv(uint64_t bytes);
@@ -72,7 +72,28 @@ bool static ProcessMessage(CNode *pFrom, string strCommand, CDataStream &vRecv)
         ProcessBlockMessage(pFrom, vRecv);
     }
 
+    else if (strCommand == NetMsgType::SENDCMPCT) {
+        ProcessSendCmpctMessage(pFrom, vRecv);
+    }
+
+    else if (strCommand == NetMsgType::CMPCTBLOCK &&
+            !SysCfg().IsImporting() && !SysCfg().IsReindex())  // Ignore blocks received while importing
+    {
+        ProcessCmpctBlockMessage(pFrom, vRecv);
+    }
+
+    else if (strCommand == NetMsgType::GETBLOCKTXN) {
+        ProcessGetBlockTxnMessage(pFrom, vRecv);
+    }
+
+    else if (strCommand == NetMsgType::BLOCKTXN &&
+            !SysCfg().IsImporting() && !SysCfg().IsReindex())
+    {
+        ProcessBlockTxnMessage(pFrom, vRecv);
+    }
+
     else if (strCommand == NetMsgType::GETADDR) {
+        LOCK(pFrom->cs_vAddrToSend);
         pFrom->vAddrToSend.clear();
         vector<CAddress> vAddr = addrman.GetAddr();
         for (const auto &addr : vAddr)
@@ -175,7 +196,7 @@ bool ProcessMessages(CNode *pFrom) {
     deque<CNetMessage>::iterator it = pFrom->vRecvMsg.begin();
     while (!pFrom->fDisconnect && it != pFrom->vRecvMsg.end()) {
         // Don't bother if send buffer is too full to respond anyway
-        if (pFrom->nSendSize >= SendBufferSize()) {
+        if (pFrom->IsSendBufferFull()) {
             LogPrint(BCLog::NET, "send buffer size: %d full for peer: %s\n", pFrom->nSendSize, pFrom->addr.ToString());
             break;
         }
@@ -226,6 +247,7 @@ bool ProcessMessages(CNode *pFrom) {
 
         // Process message
         bool fRet = false;
+        int64_t nStart = GetTimeMicros();
         try {
             fRet = ProcessMessage(pFrom, strCommand, vRecv);
             boost::this_thread::interruption_point();
@@ -248,6 +270,7 @@ bool ProcessMessages(CNode *pFrom) {
         } catch (...) {
             PrintExceptionContinue(nullptr, "ProcessMessages()");
         }
+        pFrom->RecordCommandTime(strCommand, GetTimeMicros() - nStart);
 
         if (!fRet)
             LogPrint(BCLog::INFO, "ProcessMessage(%s, %u bytes) FAILED\n", strCommand, nMessageSize);
@@ -17,6 +17,7 @@
 
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 /** Message header.
  * (4) message start.
@@ -233,13 +234,13 @@ extern const char *SENDCMPCT;
  */
 extern const char *CMPCTBLOCK;
 /**
- * Contains a BlockTransactionsRequest
+ * Contains a CBlockTxnRequest
  * Peer should respond with "blocktxn" message.
  * @since protocol version 70014 as described by BIP 152
  */
 extern const char *GETBLOCKTXN;
 /**
- * Contains a BlockTransactions.
+ * Contains a CBlockTxn.
  * Sent in response to a "getblocktxn" message.
  * @since protocol version 70014 as described by BIP 152
  */
@@ -255,6 +256,9 @@ extern const char *CONFIRMBLOCK ;
 extern const char *FINALITYBLOCK ;
 };
 
+/* Get a vector of all valid message types (see above) */
+const std::vector<std::string> &getAllNetMessageTypes();
+
 enum PBFTMsgType {
 
     CONFIRM_BLOCK =1 ,
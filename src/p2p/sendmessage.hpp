@@ -41,7 +41,7 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
             pingSend = true;
         }
         
-        //if (pTo->nLastSend && GetTime() - pTo->nLastSend > 30 * 60 && pTo->vSendMsg.empty()) {
+        //if (pTo->nLastSend && GetTime() - pTo->nLastSend > 30 * 60 && pTo->sendQueues.empty()) {
         if (pTo->nPingNonceSent == 0 && pTo->nPingUsecStart + PING_INTERVAL * 1000000 < GetTimeMicros()) {
             // Ping automatically sent as a keepalive
             pingSend = true;
@@ -80,8 +80,10 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
                     LOCK(cs_vNodes);
                     for (auto pNode : vNodes) {
                         // Periodically clear setAddrKnown to allow refresh broadcasts
-                        if (nLastRebroadcast)
+                        if (nLastRebroadcast) {
+                            LOCK(pNode->cs_vAddrToSend);
                             pNode->setAddrKnown.clear();
+                        }
 
                         // Rebroadcast our address
                         if (!fNoListen) {
@@ -98,6 +100,7 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
             // Message: addr
             //
             if (fSendTrickle) {
+                LOCK(pTo->cs_vAddrToSend);
                 vector<CAddress> vAddr;
                 vAddr.reserve(pTo->vAddrToSend.size());
                 for (const auto &addr : pTo->vAddrToSend) {
@@ -174,9 +177,7 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
                 // trickle out tx inv to protect privacy
                 if (inv.type == MSG_TX && !fSendTrickle) {
                     // 1/4 of tx invs blast to all immediately
-                    static uint256 hashSalt;
-                    if (hashSalt.IsNull())
-                        hashSalt = GetRandHash();
+                    static const uint256 hashSalt = GetRandHash();
                     uint256 hashRand  = ArithToUint256(UintToArith256(inv.hash) ^ UintToArith256(hashSalt));
                     hashRand          = Hash(BEGIN(hashRand), END(hashRand));
                     bool fTrickleWait = ((UintToArith256(hashRand) & 3) != 0);
@@ -0,0 +1,112 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "socketevents.h"
+
+#include "commons/util/util.h"
+#include "netbase.h"
+
+#include <assert.h>
+
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+static const uint64_t WAKE_TAG  = ~(uint64_t)0;
+static const int32_t MAX_EVENTS = 1024;
+
+CSocketEvents::CSocketEvents() : hEpoll(-1), hWake(-1) {}
+
+CSocketEvents::~CSocketEvents() {
+#ifdef USE_EPOLL
+    if (hWake >= 0)
+        close(hWake);
+    if (hEpoll >= 0)
+        close(hEpoll);
+#endif
+}
+
+bool CSocketEvents::Init(string &strError) {
+#ifdef USE_EPOLL
+    hEpoll = epoll_create1(EPOLL_CLOEXEC);
+    if (hEpoll < 0) {
+        strError = strprintf("epoll_create1 failed: %s", NetworkErrorString(errno));
+        return false;
+    }
+
+    hWake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (hWake < 0) {
+        strError = strprintf("eventfd failed: %s", NetworkErrorString(errno));
+        return false;
+    }
+
+    struct epoll_event event;
+    event.events   = EPOLLIN | EPOLLET;
+    event.data.u64 = WAKE_TAG;
+    if (epoll_ctl(hEpoll, EPOLL_CTL_ADD, hWake, &event) != 0) {
+        strError = strprintf("epoll_ctl of the eventfd failed: %s", NetworkErrorString(errno));
+        return false;
+    }
+
+    return true;
+#else
+    strError = "epoll is not supported on this system";
+    return false;
+#endif
+}
+
+bool CSocketEvents::Add(SOCKET hSocket, uint64_t nTag, bool fSend) {
+    assert(nTag != WAKE_TAG);
+#ifdef USE_EPOLL
+    struct epoll_event event;
+    event.events   = EPOLLIN | EPOLLRDHUP | EPOLLET | (fSend ? EPOLLOUT : 0);
+    event.data.u64 = nTag;
+    if (epoll_ctl(hEpoll, EPOLL_CTL_ADD, hSocket, &event) != 0) {
+        LogPrint(BCLog::INFO, "CSocketEvents::Add, epoll_ctl failed: %s\n", NetworkErrorString(errno));
+        return false;
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+void CSocketEvents::Wake() {
+#ifdef USE_EPOLL
+    uint64_t nOne = 1;
+    // the counter only overflows when nobody waits, then a wake-up is pending anyway
+    if (write(hWake, &nOne, sizeof(nOne)) < 0 && errno != EAGAIN)
+        LogPrint(BCLog::INFO, "CSocketEvents::Wake, write to eventfd failed: %s\n", NetworkErrorString(errno));
+#endif
+}
+
+bool CSocketEvents::Wait(int32_t nTimeout, vector<CEvent> &events) {
+    events.clear();
+#ifdef USE_EPOLL
+    struct epoll_event epollEvents[MAX_EVENTS];
+    int32_t nEvents = epoll_wait(hEpoll, epollEvents, MAX_EVENTS, nTimeout);
+    if (nEvents < 0)
+        return errno == EINTR;
+
+    for (int32_t i = 0; i < nEvents; i++) {
+        const struct epoll_event &event = epollEvents[i];
+        if (event.data.u64 == WAKE_TAG) {
+            uint64_t nCount;
+            if (read(hWake, &nCount, sizeof(nCount)) < 0 && errno != EAGAIN)
+                LogPrint(BCLog::INFO, "CSocketEvents::Wait, read from eventfd failed: %s\n", NetworkErrorString(errno));
+            continue;
+        }
+
+        events.push_back(CEvent{event.data.u64, (event.events & EPOLLIN) != 0, (event.events & EPOLLOUT) != 0,
+                                (event.events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) != 0});
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
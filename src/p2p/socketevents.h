@@ -0,0 +1,58 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef P2P_SOCKETEVENTS_H
+#define P2P_SOCKETEVENTS_H
+
+#if defined(HAVE_CONFIG_H)
+#include "config/coin-config.h"
+#endif
+
+#include "commons/compat/compat.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_SYS_EVENTFD_H)
+#define USE_EPOLL 1
+#endif
+
+using namespace std;
+
+/**
+ * The readiness of the sockets from epoll, in edge-triggered mode: an event is reported once when a socket turns
+ * readable or writable, so the caller reads or writes until the call would block, or remembers that it did not.
+ * The sockets are registered once, a closed socket leaves the set by itself. Wake() interrupts Wait() from any
+ * thread, through an eventfd. On the systems without epoll, Init() fails and the caller keeps select().
+ */
+class CSocketEvents {
+public:
+    struct CEvent {
+        uint64_t nTag;  //!< given to Add()
+        bool fRecv;
+        bool fSend;
+        bool fError;    //!< error or hang-up, reading tells which
+    };
+
+    CSocketEvents();
+    ~CSocketEvents();
+
+    bool Init(string &strError);
+    bool Add(SOCKET hSocket, uint64_t nTag, bool fSend = true);
+    void Wake();
+
+    // Wait for the events up to nTimeout milliseconds, return false on error. The wake-ups end the wait and are
+    // not returned.
+    bool Wait(int32_t nTimeout, vector<CEvent> &events);
+
+private:
+    CSocketEvents(const CSocketEvents &);
+    void operator=(const CSocketEvents &);
+
+    int32_t hEpoll;
+    int32_t hWake;
+};
+
+#endif  // P2P_SOCKETEVENTS_H
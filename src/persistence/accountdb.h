@@ -102,6 +102,12 @@ public:
         nickId2KeyIdCache.SetDbOpLogMap(pDbOpLogMapIn);
     }
 
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn) {
+        accountCache.SetReadTracker(pReadTrackerIn);
+        regId2KeyIdCache.SetReadTracker(pReadTrackerIn);
+        nickId2KeyIdCache.SetReadTracker(pReadTrackerIn);
+    }
+
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         regId2KeyIdCache.RegisterUndoFunc(undoDataFuncMap);
         nickId2KeyIdCache.RegisterUndoFunc(undoDataFuncMap);
@@ -111,11 +117,11 @@ private:
 /*  CCompositeKVCache     prefixType            key              value           variable           */
 /*  -------------------- --------------------   --------------  -------------   --------------------- */
     // <prefix$RegID -> KeyID>
-    CCompositeKVCache< dbk::REGID_KEYID,          CRegIDKey,       CKeyID >         regId2KeyIdCache;
+    CHashKVCache< dbk::REGID_KEYID,          CRegIDKey,       CKeyID >         regId2KeyIdCache;
     // <prefix$NickID -> KeyID>
     CCompositeKVCache< dbk::NICKID_KEYID,         CVarIntValue<uint64_t>,      std::pair<CVarIntValue<uint32_t>,CKeyID>>   nickId2KeyIdCache;
     // <prefix$KeyID -> Account>
-    CCompositeKVCache< dbk::KEYID_ACCOUNT,        CKeyID,       CAccount>        accountCache;
+    CHashKVCache< dbk::KEYID_ACCOUNT,        CKeyID,       CAccount>        accountCache;
 
 };
 
@@ -75,6 +75,11 @@ public:
         assetTradingPairCache.SetDbOpLogMap(pDbOpLogMapIn);
     }
 
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn) {
+        assetCache.SetReadTracker(pReadTrackerIn);
+        assetTradingPairCache.SetReadTracker(pReadTrackerIn);
+    }
+
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         assetCache.RegisterUndoFunc(undoDataFuncMap);
         assetTradingPairCache.RegisterUndoFunc(undoDataFuncMap);
@@ -26,16 +26,19 @@ uint256 CBlockHeader::ComputeSignatureHash() const {
 
 uint256 CBlock::BuildMerkleTree() const {
     vMerkleTree.clear();
+    vMerkleTree.reserve(vptx.size() * 2 + 16);
     for (const auto& ptx : vptx) {
         vMerkleTree.push_back(ptx->GetHash());
     }
-    int32_t j = 0;
-    for (int32_t nSize = vptx.size(); nSize > 1; nSize = (nSize + 1) / 2) {
-        for (int32_t i = 0; i < nSize; i += 2) {
-            int32_t i2 = min(i + 1, nSize - 1);
-            vMerkleTree.push_back(Hash(BEGIN(vMerkleTree[j + i]), END(vMerkleTree[j + i]),
-                                       BEGIN(vMerkleTree[j + i2]), END(vMerkleTree[j + i2])));
-        }
+    // The pairs of each level are hashed in one batch, the last hash of an odd level is paired with itself.
+    size_t j = 0;
+    for (size_t nSize = vptx.size(); nSize > 1; nSize = (nSize + 1) / 2) {
+        size_t nNext = vMerkleTree.size();
+        vMerkleTree.resize(nNext + (nSize + 1) / 2);
+        HashPairs(&vMerkleTree[nNext], &vMerkleTree[j], nSize / 2);
+        if (nSize & 1)
+            vMerkleTree.back() = HashPair(vMerkleTree[j + nSize - 1], vMerkleTree[j + nSize - 1]);
+
         j += nSize;
     }
     return (vMerkleTree.empty() ? uint256() : vMerkleTree.back());
@@ -60,9 +63,9 @@ uint256 CBlock::CheckMerkleBranch(uint256 hash, const vector<uint256>& vMerkleBr
         return uint256();
     for (const auto& otherside : vMerkleBranch) {
         if (index & 1)
-            hash = Hash(BEGIN(otherside), END(otherside), BEGIN(hash), END(hash));
+            hash = HashPair(otherside, hash);
         else
-            hash = Hash(BEGIN(hash), END(hash), BEGIN(otherside), END(otherside));
+            hash = HashPair(hash, otherside);
         index >>= 1;
     }
     return hash;
@@ -176,15 +179,108 @@ bool ReadBlockFromDisk(const CDiskBlockPos &pos, CBlock &block) {
 }
 
 bool ReadBlockFromDisk(const CBlockIndex *pIndex, CBlock &block) {
+    if (blockReadCache.Get(pIndex->GetBlockHash(), block))
+        return true;
+
     if (!ReadBlockFromDisk(pIndex->GetBlockPos(), block))
         return false;
 
     if (block.GetHash() != pIndex->GetBlockHash())
         return ERRORMSG("ReadBlockFromDisk(CBlock&, CBlockIndex*) : GetHash() doesn't match");
 
+    blockReadCache.Add(block, ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION));
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// class CBlockReadCache
+
+CBlockReadCache blockReadCache(DEFAULT_BLOCK_READ_CACHE << 20);
+
+void CBlockReadCache::SetMaxSize(size_t nMaxSizeIn) {
+    LOCK(cs_cache);
+    nMaxSize = nMaxSizeIn;
+    Shrink();
+}
+
+bool CBlockReadCache::Get(const uint256 &hash, CBlock &block) {
+    std::shared_ptr<const CBlock> spBlock;
+    {
+        LOCK(cs_cache);
+        auto it = mapEntries.find(hash);
+        if (it == mapEntries.end()) {
+            nMisses++;
+            return false;
+        }
+
+        nHits++;
+        entries.splice(entries.begin(), entries, it->second);
+        spBlock = it->second->spBlock;
+    }
+
+    CopyBlock(*spBlock, block);
+    return true;
+}
+
+bool CBlockReadCache::Peek(const uint256 &hash, CBlock &block) const {
+    std::shared_ptr<const CBlock> spBlock;
+    {
+        LOCK(cs_cache);
+        auto it = mapEntries.find(hash);
+        if (it == mapEntries.end())
+            return false;
+
+        spBlock = it->second->spBlock;
+    }
+
+    CopyBlock(*spBlock, block);
     return true;
 }
 
+void CBlockReadCache::Add(const CBlock &block, size_t nBlockSize) {
+    if (nBlockSize > nMaxSize)
+        return;
+
+    auto spBlock = std::make_shared<CBlock>(block);
+    for (auto &pTx : spBlock->vptx)
+        pTx = pTx->GetNewInstance();
+
+    uint256 hash = block.GetHash();
+    LOCK(cs_cache);
+    if (mapEntries.count(hash))
+        return;
+
+    entries.push_front({hash, spBlock, nBlockSize});
+    mapEntries.emplace(hash, entries.begin());
+    nSize += nBlockSize;
+    Shrink();
+}
+
+CBlockReadCache::CStats CBlockReadCache::GetStats() const {
+    LOCK(cs_cache);
+    CStats stats;
+    stats.nHits    = nHits;
+    stats.nMisses  = nMisses;
+    stats.nBlocks  = entries.size();
+    stats.nSize    = nSize;
+    stats.nMaxSize = nMaxSize;
+    return stats;
+}
+
+void CBlockReadCache::CopyBlock(const CBlock &from, CBlock &to) {
+    to = from;
+    for (auto &pTx : to.vptx)
+        pTx = pTx->GetNewInstance();
+}
+
+void CBlockReadCache::Shrink() {
+    while (nSize > nMaxSize && !entries.empty()) {
+        nSize -= entries.back().nBlockSize;
+        mapEntries.erase(entries.back().hash);
+        entries.pop_back();
+    }
+}
+
 bool ReadBaseTxFromDisk(const CTxCord txCord, std::shared_ptr<CBaseTx> &pTx) {
     auto pBlock = std::make_shared<CBlock>();
     const CBlockIndex* pBlockIndex = chainActive[ txCord.GetHeight() ];
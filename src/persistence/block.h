@@ -21,6 +21,8 @@
 
 
 #include <stdint.h>
+#include <list>
+#include <map>
 #include <memory>
 
 class CBlockDBCache;
@@ -465,6 +467,58 @@ struct CBlockLocator {
     bool IsNull() { return vHave.empty(); }
 };
 
+/**
+ * LRU cache of the decoded recent blocks, used by ReadBlockFromDisk(const CBlockIndex*, CBlock&). The
+ * recent blocks are read again by ConnectBlock() (the maturity block, the blocks evicted from the tx
+ * and price point caches), ConnectTip() and DisconnectTip(). AcceptBlock() adds the new blocks, so
+ * connecting them does not read the disk. Bounded by the serialized size of the blocks.
+ */
+class CBlockReadCache {
+public:
+    struct CStats {
+        uint64_t nHits    = 0;
+        uint64_t nMisses  = 0;  // the reads which went to the disk
+        uint32_t nBlocks  = 0;
+        size_t nSize      = 0;
+        size_t nMaxSize   = 0;
+    };
+
+    explicit CBlockReadCache(size_t nMaxSizeIn) : nMaxSize(nMaxSizeIn) {}
+
+    void SetMaxSize(size_t nMaxSizeIn);
+
+    // copy the cached block, the txs are copied as well, so the caller may modify them
+    bool Get(const uint256 &hash, CBlock &block);
+
+    // same as Get(), but leaves the LRU order and the hit stats untouched, for the block prefetcher
+    bool Peek(const uint256 &hash, CBlock &block) const;
+
+    void Add(const CBlock &block, size_t nBlockSize);
+
+    CStats GetStats() const;
+
+private:
+    struct CEntry {
+        uint256 hash;
+        std::shared_ptr<const CBlock> spBlock;
+        size_t nBlockSize;
+    };
+    typedef std::list<CEntry> EntryList;  // the most recently used first
+
+    void Shrink();
+    static void CopyBlock(const CBlock &from, CBlock &to);
+
+    mutable CCriticalSection cs_cache;
+    EntryList entries;
+    std::map<uint256, EntryList::iterator> mapEntries;
+    size_t nSize = 0;
+    size_t nMaxSize;
+    uint64_t nHits   = 0;
+    uint64_t nMisses = 0;
+};
+
+extern CBlockReadCache blockReadCache;
+
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(CBlock &block, CDiskBlockPos &pos);
 bool ReadBlockFromDisk(const CDiskBlockPos &pos, CBlock &block);
@@ -95,6 +95,13 @@ CCacheWrapper& CCacheWrapper::operator=(CCacheWrapper& other) {
 }
 
 void CCacheWrapper::Flush() {
+    FlushDbCaches();
+
+    txCache.Flush();
+    ppCache.Flush();
+}
+
+void CCacheWrapper::FlushDbCaches() {
     sysParamCache.Flush();
     blockCache.Flush();
     accountCache.Flush();
@@ -106,9 +113,6 @@ void CCacheWrapper::Flush() {
     dexCache.Flush();
     txReceiptCache.Flush();
     txUtxoCache.Flush();
-
-    txCache.Flush();
-    ppCache.Flush();
     sysGovernCache.Flush();
 }
 
@@ -127,6 +131,21 @@ void CCacheWrapper::SetDbOpLogMap(CDBOpLogMap *pDbOpLogMap) {
     sysGovernCache.SetDbOpLogMap(pDbOpLogMap) ;
 }
 
+void CCacheWrapper::SetReadTracker(CDBReadTracker *pReadTracker) {
+    sysParamCache.SetReadTracker(pReadTracker);
+    blockCache.SetReadTracker(pReadTracker);
+    accountCache.SetReadTracker(pReadTracker);
+    assetCache.SetReadTracker(pReadTracker);
+    contractCache.SetReadTracker(pReadTracker);
+    delegateCache.SetReadTracker(pReadTracker);
+    cdpCache.SetReadTracker(pReadTracker);
+    closedCdpCache.SetReadTracker(pReadTracker);
+    dexCache.SetReadTracker(pReadTracker);
+    txReceiptCache.SetReadTracker(pReadTracker);
+    txUtxoCache.SetReadTracker(pReadTracker);
+    sysGovernCache.SetReadTracker(pReadTracker);
+}
+
 UndoDataFuncMap CCacheWrapper::GetUndoDataFuncMap() {
     UndoDataFuncMap undoDataFuncMap;
     sysParamCache.RegisterUndoFunc(undoDataFuncMap);
@@ -144,50 +163,149 @@ UndoDataFuncMap CCacheWrapper::GetUndoDataFuncMap() {
     return undoDataFuncMap;
 }
 
+uint32_t CCacheWrapper::GetCacheSize() const {
+    return sysParamCache.GetCacheSize() +
+        blockCache.GetCacheSize() +
+        accountCache.GetCacheSize() +
+        assetCache.GetCacheSize() +
+        contractCache.GetCacheSize() +
+        delegateCache.GetCacheSize() +
+        cdpCache.GetCacheSize() +
+        closedCdpCache.GetCacheSize() +
+        dexCache.GetCacheSize() +
+        txReceiptCache.GetCacheSize() +
+        txUtxoCache.GetCacheSize() +
+        sysGovernCache.GetCacheSize();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// class CForkCache
+
+void CForkCache::SetTip(const uint256 &tipHashIn) {
+    if (tipHash == tipHashIn)
+        return;
+
+    if (!mapViews.empty())
+        LogPrint(BCLog::INFO, "CForkCache::SetTip, drop %u fork views of the old tip %s\n", mapViews.size(),
+                 tipHash.GetHex());
+
+    Clear();
+    tipHash = tipHashIn;
+}
+
+std::shared_ptr<CCacheWrapper> CForkCache::Get(const uint256 &blockHash) {
+    auto it = mapViews.find(blockHash);
+    if (it == mapViews.end())
+        return nullptr;
+
+    it->second.nLastUsed = ++nUseCount;
+    return it->second.spCW;
+}
+
+void CForkCache::Add(const uint256 &blockHash, const std::shared_ptr<CCacheWrapper> &spCW) {
+    Erase(blockHash);
+
+    CEntry &entry   = mapViews[blockHash];
+    entry.spCW      = spCW;
+    entry.nSize     = spCW->GetCacheSize();
+    entry.nLastUsed = ++nUseCount;
+    nSize += entry.nSize;
+
+    Shrink(blockHash);
+}
+
+void CForkCache::Erase(const uint256 &blockHash) {
+    auto it = mapViews.find(blockHash);
+    if (it == mapViews.end())
+        return;
+
+    nSize -= it->second.nSize;
+    mapViews.erase(it);
+}
+
+void CForkCache::Clear() {
+    mapViews.clear();
+    nSize = 0;
+}
+
+CForkCache::CStats CForkCache::GetStats() const {
+    CStats stats;
+    stats.nViews   = mapViews.size();
+    stats.nSize    = nSize;
+    stats.nMaxSize = nMaxSize;
+    stats.nEvicted = nEvicted;
+    return stats;
+}
+
+void CForkCache::Shrink(const uint256 &keepHash) {
+    while (nSize > nMaxSize && mapViews.size() > 1) {
+        auto itOldest = mapViews.end();
+        for (auto it = mapViews.begin(); it != mapViews.end(); ++it) {
+            if (it->first != keepHash && (itOldest == mapViews.end() || it->second.nLastUsed < itOldest->second.nLastUsed))
+                itOldest = it;
+        }
+
+        LogPrint(BCLog::INFO, "CForkCache::Shrink, evict the fork view of %s, size: %u\n", itOldest->first.GetHex(),
+                 itOldest->second.nSize);
+        nSize -= itOldest->second.nSize;
+        mapViews.erase(itOldest);
+        nEvicted++;
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // class CCacheDBManager
 
 CCacheDBManager::CCacheDBManager(bool fReIndex, bool fMemory) {
     const boost::filesystem::path& dbDir = GetDataDir() / "blocks";
-    pSysParamDb     = new CDBAccess(dbDir, DBNameType::SYSPARAM, false, fReIndex);
+    std::shared_ptr<CDBStorage> spSingleStorage;
+    if (SysCfg().GetBoolArg("-singledb", false))
+        spSingleStorage = std::make_shared<CDBStorage>(dbDir / kSingleDbName, GetSingleDbCacheSize(), false, fReIndex);
+
+    auto NewDbAccess = [&](DBNameType dbNameType) {
+        return spSingleStorage ? new CDBAccess(dbNameType, spSingleStorage)
+                               : new CDBAccess(dbDir, dbNameType, false, fReIndex);
+    };
+
+    pSysParamDb     = NewDbAccess(DBNameType::SYSPARAM);
     pSysParamCache  = new CSysParamDBCache(pSysParamDb);
 
-    pAccountDb      = new CDBAccess(dbDir, DBNameType::ACCOUNT, false, fReIndex);
+    pAccountDb      = NewDbAccess(DBNameType::ACCOUNT);
     pAccountCache   = new CAccountDBCache(pAccountDb);
 
-    pAssetDb        = new CDBAccess(dbDir, DBNameType::ASSET, false, fReIndex);
+    pAssetDb        = NewDbAccess(DBNameType::ASSET);
     pAssetCache     = new CAssetDBCache(pAssetDb);
 
-    pContractDb     = new CDBAccess(dbDir, DBNameType::CONTRACT, false, fReIndex);
+    pContractDb     = NewDbAccess(DBNameType::CONTRACT);
     pContractCache  = new CContractDBCache(pContractDb);
 
-    pDelegateDb     = new CDBAccess(dbDir, DBNameType::DELEGATE, false, fReIndex);
+    pDelegateDb     = NewDbAccess(DBNameType::DELEGATE);
     pDelegateCache  = new CDelegateDBCache(pDelegateDb);
 
-    pCdpDb          = new CDBAccess(dbDir, DBNameType::CDP, false, fReIndex);
+    pCdpDb          = NewDbAccess(DBNameType::CDP);
     pCdpCache       = new CCdpDBCache(pCdpDb);
 
-    pClosedCdpDb    = new CDBAccess(dbDir, DBNameType::CLOSEDCDP, false, fReIndex);
+    pClosedCdpDb    = NewDbAccess(DBNameType::CLOSEDCDP);
     pClosedCdpCache = new CClosedCdpDBCache(pClosedCdpDb);
 
-    pDexDb          = new CDBAccess(dbDir, DBNameType::DEX, false, fReIndex);
+    pDexDb          = NewDbAccess(DBNameType::DEX);
     pDexCache       = new CDexDBCache(pDexDb);
 
     pBlockIndexDb   = new CBlockIndexDB(false, fReIndex);
 
-    pBlockDb        = new CDBAccess(dbDir, DBNameType::BLOCK, false, fReIndex);
+    pBlockDb        = NewDbAccess(DBNameType::BLOCK);
     pBlockCache     = new CBlockDBCache(pBlockDb);
 
-    pLogDb          = new CDBAccess(dbDir, DBNameType::LOG, false, fReIndex);
+    pLogDb          = NewDbAccess(DBNameType::LOG);
     pLogCache       = new CLogDBCache(pLogDb);
 
-    pReceiptDb      = new CDBAccess(dbDir, DBNameType::RECEIPT, false, fReIndex);
+    pReceiptDb      = NewDbAccess(DBNameType::RECEIPT);
     pReceiptCache   = new CTxReceiptDBCache(pReceiptDb);
 
-    pUtxoDb         = new CDBAccess(dbDir, DBNameType::UTXO, false, fReIndex);
+    pUtxoDb         = NewDbAccess(DBNameType::UTXO);
     pUtxoCache      = new CTxUTXODBCache(pUtxoDb);
 
-    pSysGovernDb    = new CDBAccess(dbDir, DBNameType::SYSGOVERN, false, fReIndex);
+    pSysGovernDb    = NewDbAccess(DBNameType::SYSGOVERN);
     pSysGovernCache = new CSysGovernDBCache(pSysGovernDb);
 
     // memory-only cache
@@ -231,6 +349,42 @@ CCacheDBManager::~CCacheDBManager() {
 }
 
 bool CCacheDBManager::Flush() {
+    FreezeCaches();
+    for (auto pStorage : GetStorages())
+        pStorage->CommitPendingBatches();
+
+    return true;
+}
+
+bool CCacheDBManager::FlushAsync() {
+    // nobody would commit the batches
+    if (!flushQueue.WaitForSpace(MAX_PENDING_FLUSHES))
+        return Flush();
+
+    int64_t nBeginTime = GetTimeMicros();
+    vector<CDBStorage *> frozenStorages = FreezeCaches();
+    if (!frozenStorages.empty())
+        flushQueue.Push(frozenStorages, GetTimeMicros() - nBeginTime);
+
+    return true;
+}
+
+vector<CDBStorage *> CCacheDBManager::FreezeCaches() {
+    vector<CDBStorage *> storages = GetStorages();
+    for (auto pStorage : storages)
+        pStorage->BeginBatch();
+
+    FlushCaches();
+
+    vector<CDBStorage *> frozenStorages;
+    for (auto pStorage : storages) {
+        if (pStorage->FreezeBatch())
+            frozenStorages.push_back(pStorage);
+    }
+    return frozenStorages;
+}
+
+void CCacheDBManager::FlushCaches() {
     if (pSysParamCache) pSysParamCache->Flush();
 
     if (pAccountCache) pAccountCache->Flush();
@@ -264,6 +418,156 @@ bool CCacheDBManager::Flush() {
     //     pTxCache->Flush();
     // if (pPpCache)
     //     pPpCache->Flush();
+}
+
+vector<CDBStorage *> CCacheDBManager::GetStorages() const {
+    vector<CDBAccess *> dbs = {pSysParamDb, pAccountDb, pAssetDb,     pContractDb, pDelegateDb,
+                               pCdpDb,      pClosedCdpDb, pDexDb,     pBlockDb,    pLogDb,
+                               pReceiptDb,  pSysGovernDb, pUtxoDb};
+    vector<CDBStorage *> storages;
+    for (auto pDb : dbs) {
+        CDBStorage *pStorage = &pDb->GetStorage();
+        if (std::find(storages.begin(), storages.end(), pStorage) == storages.end())
+            storages.push_back(pStorage);
+    }
+    return storages;
+}
+
+bool CCacheDBManager::IsSingleDbLayout(const boost::filesystem::path &dbDir) {
+    return boost::filesystem::exists(dbDir / kSingleDbName);
+}
+
+// entries per write batch when migrating to the single db
+static const uint32_t MIGRATE_BATCH_SIZE = 10000;
+
+bool CCacheDBManager::MigrateToSingleDb(const boost::filesystem::path &dbDir) {
+    namespace fs = boost::filesystem;
+
+    vector<DBNameType> oldDbs;
+    for (int32_t i = 0; i < DBNameType::DB_NAME_COUNT; i++) {
+        if (fs::exists(dbDir / GetDbName((DBNameType)i)))
+            oldDbs.push_back((DBNameType)i);
+    }
+
+    if (!IsSingleDbLayout(dbDir) && !oldDbs.empty()) {
+        // copy into a temp db first, so an interrupted migration leaves no half single db behind
+        const fs::path tempPath = dbDir / (kSingleDbName + ".migrating");
+        LogPrint(BCLog::INFO, "Migrating the chain state dbs into the single db %s\n",
+                 (dbDir / kSingleDbName).string());
+        try {
+            {
+                CLevelDBWrapper singleDb(tempPath, GetSingleDbCacheSize(), false, true);
+                for (auto dbNameType : oldDbs) {
+                    CLevelDBWrapper db(dbDir / GetDbName(dbNameType), DBCacheSize[dbNameType], false, false);
+                    std::unique_ptr<leveldb::Iterator> pCursor(db.NewIterator());
+                    CLevelDBBatch batch;
+                    uint32_t nBatchCount = 0;
+                    uint64_t nCount      = 0;
+                    for (pCursor->SeekToFirst(); pCursor->Valid(); pCursor->Next()) {
+                        batch.WriteRaw(pCursor->key().ToString(), pCursor->value().ToString());
+                        nCount++;
+                        if (++nBatchCount == MIGRATE_BATCH_SIZE) {
+                            singleDb.WriteBatch(batch);
+                            batch.Clear();
+                            nBatchCount = 0;
+                        }
+                    }
+                    ThrowError(pCursor->status());
+
+                    singleDb.WriteBatch(batch);
+                    LogPrint(BCLog::INFO, "Migrated %llu entries of the db %s\n", nCount, GetDbName(dbNameType));
+                }
+                singleDb.Sync();
+            }
+            fs::rename(tempPath, dbDir / kSingleDbName);
+        } catch (std::exception &e) {
+            return ERRORMSG("%s : failed to migrate the chain state dbs - %s", __func__, e.what());
+        }
+    }
+
+    // the dbs of the old layout are never read again
+    for (auto dbNameType : oldDbs) {
+        LogPrint(BCLog::INFO, "Removing the migrated db %s\n", GetDbName(dbNameType));
+        fs::remove_all(dbDir / GetDbName(dbNameType));
+    }
 
     return true;
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// class CDBFlushQueue
+
+bool CDBFlushQueue::WaitForSpace(uint32_t nMaxSize) {
+    boost::unique_lock<boost::mutex> lock(mutex);
+    if (!fStopped && jobs.size() >= nMaxSize) {
+        int64_t nBeginTime = GetTimeMicros();
+        while (!fStopped && jobs.size() >= nMaxSize)
+            condFlusher.wait(lock);
+
+        stats.nStallTime += GetTimeMicros() - nBeginTime;
+    }
+    return !fStopped;
+}
+
+void CDBFlushQueue::Push(const vector<CDBStorage *> &storages, int64_t nFreezeTime) {
+    boost::unique_lock<boost::mutex> lock(mutex);
+    jobs.push_back({storages, GetTimeMicros()});
+    stats.nLastFreezeTime = nFreezeTime;
+    condWriter.notify_one();
+}
+
+void CDBFlushQueue::Thread() {
+    try {
+        while (CommitNextJob()) {}
+    } catch (boost::thread_interrupted &) {
+        // the pending batches are committed by CCacheDBManager::Flush() at shutdown
+        Stop();
+        throw;
+    }
+
+    Stop();
+}
+
+bool CDBFlushQueue::CommitNextJob() {
+    CFlushJob job;
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        while (jobs.empty())
+            condWriter.wait(lock);
+
+        job = jobs.front();
+    }
+
+    try {
+        for (auto pStorage : job.storages)
+            pStorage->CommitPendingBatches();
+    } catch (std::exception &e) {
+        // the batches stay pending, so the chainstate seen by the node is still intact
+        AbortNode(strprintf("Failed to commit the chainstate flush: %s", e.what()));
+        return false;
+    }
+
+    boost::unique_lock<boost::mutex> lock(mutex);
+    jobs.pop_front();
+
+    int64_t nWriteTime = GetTimeMicros() - job.nFrozenTime;
+    stats.nFlushes++;
+    stats.nLastWriteTime = nWriteTime;
+    stats.nMaxWriteTime  = std::max(stats.nMaxWriteTime, nWriteTime);
+    stats.nTotalWriteTime += nWriteTime;
+    condFlusher.notify_all();
+    return true;
+}
+
+void CDBFlushQueue::Stop() {
+    boost::unique_lock<boost::mutex> lock(mutex);
+    fStopped = true;
+    condFlusher.notify_all();
+}
+
+CDBFlushStats CDBFlushQueue::GetStats() const {
+    boost::unique_lock<boost::mutex> lock(mutex);
+    CDBFlushStats ret     = stats;
+    ret.nPendingFlushes   = jobs.size();
+    return ret;
+}
@@ -22,6 +22,11 @@
 #include "sysgoverndb.h"
 #include "logdb.h"
 
+#include <deque>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
 class CCacheDBManager;
 
 class CCacheWrapper {
@@ -54,16 +59,120 @@ public:
     void CopyFrom(CCacheDBManager* pCdMan);
 
     void Flush();
+    // flush the db caches only, leave txCache and ppCache untouched
+    void FlushDbCaches();
 
     UndoDataFuncMap GetUndoDataFuncMap();
 
     void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMap);
+    // track the reads through to the base view, see CDBReadTracker
+    void SetReadTracker(CDBReadTracker *pReadTracker);
+
+    // serialized size of the entries held by the db caches, txCache and ppCache are not counted
+    uint32_t GetCacheSize() const;
 private:
     CCacheWrapper(const CCacheWrapper&) = delete;
     CCacheWrapper& operator=(const CCacheWrapper&) = delete;
 
 };
 
+/**
+ * The chain state views of the forked chains, keyed by the best block hash of each view. A view is a
+ * CCacheWrapper over the caches of pCdMan holding only the delta of the fork, i.e. the undo of the
+ * active chain blocks after the fork point and the forked chain blocks, so it is only valid as long as
+ * the active chain tip it was derived from. The views of another tip are dropped, and the least recently
+ * used views are evicted once the deltas exceed the max size. Guarded by cs_main.
+ */
+class CForkCache {
+public:
+    struct CStats {
+        uint32_t nViews  = 0;
+        size_t nSize     = 0;
+        size_t nMaxSize  = 0;
+        uint64_t nEvicted = 0;  // evicted for the max size
+    };
+
+    explicit CForkCache(size_t nMaxSizeIn) : nMaxSize(nMaxSizeIn) {}
+
+    void SetMaxSize(size_t nMaxSizeIn) { nMaxSize = nMaxSizeIn; }
+
+    // drop the views which were not derived from the given active chain tip
+    void SetTip(const uint256 &tipHash);
+
+    bool Exists(const uint256 &blockHash) const { return mapViews.count(blockHash) > 0; }
+
+    std::shared_ptr<CCacheWrapper> Get(const uint256 &blockHash);
+
+    // add or update the view, the view just added is never evicted
+    void Add(const uint256 &blockHash, const std::shared_ptr<CCacheWrapper> &spCW);
+
+    void Erase(const uint256 &blockHash);
+
+    void Clear();
+
+    CStats GetStats() const;
+
+private:
+    struct CEntry {
+        std::shared_ptr<CCacheWrapper> spCW;
+        size_t nSize;
+        uint64_t nLastUsed;
+    };
+
+    void Shrink(const uint256 &keepHash);
+
+    std::map<uint256, CEntry> mapViews;
+    uint256 tipHash;  // the active chain tip all views are derived from
+    size_t nSize       = 0;
+    size_t nMaxSize;
+    uint64_t nUseCount = 0;
+    uint64_t nEvicted  = 0;
+};
+
+struct CDBFlushStats {
+    uint32_t nPendingFlushes = 0;  // frozen, not committed yet
+    uint64_t nFlushes        = 0;  // committed by the flush thread
+    int64_t nLastFreezeTime  = 0;  // microseconds holding the caller's locks to freeze the last flush
+    int64_t nLastWriteTime   = 0;  // microseconds from freezing to committing the last flush
+    int64_t nMaxWriteTime    = 0;
+    int64_t nTotalWriteTime  = 0;
+    int64_t nStallTime       = 0;  // microseconds the flushes waited for MAX_PENDING_FLUSHES
+};
+
+/**
+ * The chainstate flushes handed over to the flush thread, which commits the frozen batches of each flush
+ * to the dbs in flush order. See CCacheDBManager::FlushAsync().
+ */
+class CDBFlushQueue {
+private:
+    struct CFlushJob {
+        vector<CDBStorage *> storages;  // the storages having a frozen batch, in flush order
+        int64_t nFrozenTime;
+    };
+
+    mutable boost::mutex mutex;
+    boost::condition_variable condWriter;   // signaled when a flush is queued
+    boost::condition_variable condFlusher;  // signaled when a flush is committed
+    std::deque<CFlushJob> jobs;
+    CDBFlushStats stats;
+    bool fStopped = false;  // the flush thread has ended
+
+    // return false if the flush thread must end
+    bool CommitNextJob();
+    void Stop();
+
+public:
+    // block until less than nMaxSize flushes are pending, return false if the flush thread has ended
+    bool WaitForSpace(uint32_t nMaxSize);
+
+    void Push(const vector<CDBStorage *> &storages, int64_t nFreezeTime);
+
+    // the flush thread, ends when interrupted
+    void Thread();
+
+    CDBFlushStats GetStats() const;
+};
+
 class CCacheDBManager {
 public:
     CDBAccess           *pSysParamDb;
@@ -111,12 +220,32 @@ public:
     CTxMemCache         *pTxCache;
     CPricePointMemCache *pPpCache;
 
+    CDBFlushQueue       flushQueue;
+
 public:
     CCacheDBManager(bool fReIndex, bool fMemory);
 
     ~CCacheDBManager();
 
+    // write the caches to the dbs, after the pending async flushes, with one write batch per storage
     bool Flush();
+    /**
+     * Freeze the caches into one batch per db and hand them to the flush thread, the reads of the dbs see
+     * the batches until they are committed. Waits if MAX_PENDING_FLUSHES flushes are pending.
+     */
+    bool FlushAsync();
+
+    // whether the chainstate dbs are in the single db layout (-singledb)
+    static bool IsSingleDbLayout(const boost::filesystem::path &dbDir);
+    // copy the dbs of the multi-db layout into the single db, then remove them
+    static bool MigrateToSingleDb(const boost::filesystem::path &dbDir);
+
+private:
+    // freeze the caches into one batch per storage, return the storages which have a new batch
+    vector<CDBStorage *> FreezeCaches();
+    void FlushCaches();
+    // the storages of the dbs, in flush order
+    vector<CDBStorage *> GetStorages() const;
 };  // CCacheDBManager
 
 #endif //PERSIST_CACHEWRAPPER_H
\ No newline at end of file
@@ -165,6 +165,14 @@ void CCdpDBCache::SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) {
     cdpRatioSortedCache.SetDbOpLogMap(pDbOpLogMapIn);
 }
 
+void CCdpDBCache::SetReadTracker(CDBReadTracker *pReadTrackerIn) {
+    cdpGlobalDataCache.SetReadTracker(pReadTrackerIn);
+    cdpCache.SetReadTracker(pReadTrackerIn);
+    userCdpCache.SetReadTracker(pReadTrackerIn);
+    cdpCoinPairsCache.SetReadTracker(pReadTrackerIn);
+    cdpRatioSortedCache.SetReadTracker(pReadTrackerIn);
+}
+
 uint32_t CCdpDBCache::GetCacheSize() const {
     return cdpGlobalDataCache.GetCacheSize() + cdpCache.GetCacheSize() + userCdpCache.GetCacheSize() +
             cdpCoinPairsCache.GetCacheSize() + cdpRatioSortedCache.GetCacheSize();
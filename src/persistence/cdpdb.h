@@ -54,6 +54,8 @@ public:
     void SetBaseViewPtr(CCdpDBCache *pBaseIn);
     void SetDbOpLogMap(CDBOpLogMap * pDbOpLogMapIn);
 
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn);
+
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         cdpGlobalDataCache.RegisterUndoFunc(undoDataFuncMap);
         cdpCache.RegisterUndoFunc(undoDataFuncMap);
@@ -79,7 +81,7 @@ private:
     // cdpCoinPair -> total staked assets
     CCompositeKVCache<  dbk::CDP_GLOBAL_DATA, CCdpCoinPair,   CCdpGlobalData>    cdpGlobalDataCache;
     // cdp{$cdpid} -> CUserCDP
-    CCompositeKVCache<  dbk::CDP,       uint256,                    CUserCDP>           cdpCache;
+    CHashKVCache<  dbk::CDP,       uint256,                    CUserCDP>           cdpCache;
     // ucdp${CRegID}{$cdpCoinPair} -> set<cdpid>
     CCompositeKVCache<  dbk::USER_CDP, pair<CRegIDKey, CCdpCoinPair>, optional<uint256>> userCdpCache;
     // [prefix]${cdpCoinPair} -> ${cdpCoinPairStatus}
@@ -139,6 +141,11 @@ public:
         closedTxCdpCache.SetDbOpLogMap(pDbOpLogMapIn);
     }
 
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn) {
+        closedCdpTxCache.SetReadTracker(pReadTrackerIn);
+        closedTxCdpCache.SetReadTracker(pReadTrackerIn);
+    }
+
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         closedCdpTxCache.RegisterUndoFunc(undoDataFuncMap);
         closedTxCdpCache.RegisterUndoFunc(undoDataFuncMap);
@@ -149,9 +156,9 @@ private:
     /*  CCompositeKVCache     prefixType     key               value             variable  */
     /*  ----------------   --------------   ------------   --------------    ----- --------*/
     // ccdp${closed_cdpid} -> <closedCdpTxId, closeType>
-    CCompositeKVCache< dbk::CLOSED_CDP_TX, uint256, std::pair<uint256, uint8_t> > closedCdpTxCache;
+    CHashKVCache< dbk::CLOSED_CDP_TX, uint256, std::pair<uint256, uint8_t> > closedCdpTxCache;
     // ctx${$closed_cdp_txid} -> <closedCdpId, closeType> (no-force-liquidation)
-    CCompositeKVCache< dbk::CLOSED_TX_CDP, uint256, std::pair<uint256, uint8_t> > closedTxCdpCache;
+    CHashKVCache< dbk::CLOSED_TX_CDP, uint256, std::pair<uint256, uint8_t> > closedTxCdpCache;
 };
 
 #endif  // PERSIST_CDPDB_H
@@ -112,6 +112,13 @@ public:
         contractTracesCache.SetDbOpLogMap(pDbOpLogMapIn);
     }
 
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn) {
+        contractCache.SetReadTracker(pReadTrackerIn);
+        contractDataCache.SetReadTracker(pReadTrackerIn);
+        contractAccountCache.SetReadTracker(pReadTrackerIn);
+        contractTracesCache.SetReadTracker(pReadTrackerIn);
+    }
+
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         contractCache.RegisterUndoFunc(undoDataFuncMap);
         contractDataCache.RegisterUndoFunc(undoDataFuncMap);
@@ -134,7 +141,7 @@ private:
     // pair<contractRegId, accountKey> -> appUserAccount
     CCompositeKVCache< dbk::CONTRACT_ACCOUNT,     pair<CRegIDKey, string>,     CAppUserAccount >      contractAccountCache;
     // txid -> contract_traces
-    CCompositeKVCache< dbk::CONTRACT_TRACES,     uint256,                  string >      contractTracesCache;
+    CHashKVCache< dbk::CONTRACT_TRACES,     uint256,                  string >      contractTracesCache;
 };
 
 #endif  // PERSIST_CONTRACTDB_H
\ No newline at end of file
@@ -8,8 +8,11 @@
 
 #include "commons/uint256.h"
 #include "dbconf.h"
+#include "flathashmap.h"
 #include "leveldbwrapper.h"
 
+#include <deque>
+#include <mutex>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -211,23 +214,197 @@ namespace db_util {
 typedef void(UndoDataFunc)(const CDbOpLogs &pDbOpLogs);
 typedef std::map<dbk::PrefixType, std::function<UndoDataFunc>> UndoDataFuncMap;
 
+/**
+ * A leveldb with the writes which are not committed yet, see BeginBatch(). The CDBAccess of every db
+ * have their own storage, or all share one storage in the single db mode (-singledb), where a flush
+ * commits every cache in one write batch.
+ */
+class CDBStorage {
+public:
+    CDBStorage(const boost::filesystem::path &path, size_t nCacheSize, bool fMemory, bool fWipe) :
+        db(path, nCacheSize, fMemory, fWipe) {}
+
+    template<typename ValueType>
+    bool Read(const string &key, ValueType &value) const {
+        std::optional<string> pendingValue;
+        if (FindPendingData(key, pendingValue))
+            return pendingValue && ParseValue(*pendingValue, value);
+
+        return db.Read(key, value);
+    }
+
+    bool Exists(const string &key) const {
+        std::optional<string> pendingValue;
+        if (FindPendingData(key, pendingValue))
+            return pendingValue.has_value();
+
+        return db.Exists(key);
+    }
+
+    // write the serialized values, or erase the keys of nullopt
+    void Write(const CDBWriteMap &writes) {
+        {
+            std::lock_guard<std::mutex> lock(cs_pending);
+            if (spCollectingBatch) {
+                for (const auto &item : writes)
+                    (*spCollectingBatch)[item.first] = item.second;
+                return;
+            }
+        }
+
+        // the frozen batches must reach the db before the newer writes
+        CommitPendingBatches();
+
+        WriteToDb(writes);
+    }
+
+    int64_t GetDbCount() const { return db.GetDbCount(); }
+
+    // the iterator sees the writes which are not committed yet too
+    std::shared_ptr<leveldb::Iterator> NewIterator() {
+        vector<std::shared_ptr<const CDBWriteMap>> batches;
+        {
+            std::lock_guard<std::mutex> lock(cs_pending);
+            batches.assign(pendingBatches.begin(), pendingBatches.end());
+            if (spCollectingBatch && !spCollectingBatch->empty())
+                batches.push_back(std::make_shared<const CDBWriteMap>(*spCollectingBatch));
+        }
+
+        if (batches.empty())
+            return std::shared_ptr<leveldb::Iterator>(db.NewIterator());
+
+        return std::make_shared<CDBOverlayIterator>(db.NewIterator(), batches);
+    }
+
+    /**
+     * Collect the writes into a batch instead of writing them to the db, until FreezeBatch() is called.
+     * The collected writes are visible to the reads.
+     */
+    void BeginBatch() {
+        std::lock_guard<std::mutex> lock(cs_pending);
+        assert(!spCollectingBatch);
+        spCollectingBatch = std::make_shared<CDBWriteMap>();
+    }
+
+    /**
+     * Freeze the collected writes into an immutable batch, which stays visible to the reads until
+     * CommitPendingBatches() has written it to the db. Return false if nothing was written.
+     */
+    bool FreezeBatch() {
+        std::lock_guard<std::mutex> lock(cs_pending);
+        assert(spCollectingBatch);
+        bool fWritten = !spCollectingBatch->empty();
+        if (fWritten)
+            pendingBatches.push_back(spCollectingBatch);
+
+        spCollectingBatch = nullptr;
+        return fWritten;
+    }
+
+    // Write the frozen batches to the db in the order they were frozen. Can be called from any thread.
+    void CommitPendingBatches() {
+        std::lock_guard<std::mutex> commitLock(cs_commit);
+        while (true) {
+            std::shared_ptr<const CDBWriteMap> spBatch;
+            {
+                std::lock_guard<std::mutex> lock(cs_pending);
+                if (pendingBatches.empty())
+                    return;
+
+                spBatch = pendingBatches.front();
+            }
+
+            WriteToDb(*spBatch);
+
+            // drop the batch only after it has been written, so the reads never miss it
+            std::lock_guard<std::mutex> lock(cs_pending);
+            pendingBatches.pop_front();
+        }
+    }
+
+    size_t GetPendingBatchCount() const {
+        std::lock_guard<std::mutex> lock(cs_pending);
+        return pendingBatches.size();
+    }
+
+private:
+    void WriteToDb(const CDBWriteMap &writes) {
+        CLevelDBBatch batch;
+        for (const auto &item : writes) {
+            if (item.second) {
+                batch.WriteRaw(item.first, *item.second);
+            } else {
+                batch.Erase(item.first);
+            }
+        }
+        db.WriteBatch(batch, true);
+    }
+
+    // find the key in the writes which are not committed yet, from the latest to the earliest
+    bool FindPendingData(const string &key, std::optional<string> &value) const {
+        std::lock_guard<std::mutex> lock(cs_pending);
+        if (spCollectingBatch) {
+            auto it = spCollectingBatch->find(key);
+            if (it != spCollectingBatch->end()) {
+                value = it->second;
+                return true;
+            }
+        }
+
+        for (auto batchIt = pendingBatches.rbegin(); batchIt != pendingBatches.rend(); batchIt++) {
+            auto it = (*batchIt)->find(key);
+            if (it != (*batchIt)->end()) {
+                value = it->second;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template<typename ValueType>
+    static bool ParseValue(const string &strValue, ValueType &value) {
+        try {
+            CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
+            ssValue >> value;
+        } catch(std::exception &e) {
+            return false;
+        }
+        return true;
+    }
+
+private:
+    mutable CLevelDBWrapper db;
+
+    mutable std::mutex cs_pending;                                  // protects the two batch members below
+    std::shared_ptr<CDBWriteMap> spCollectingBatch;                 // see BeginBatch()
+    std::deque<std::shared_ptr<const CDBWriteMap>> pendingBatches;  // frozen, not committed yet
+    std::mutex cs_commit;                                           // serializes CommitPendingBatches()
+};
+
 class CDBAccess {
 public:
     CDBAccess(const boost::filesystem::path& dir, DBNameType dbNameTypeIn, bool fMemory, bool fWipe) :
               dbNameType(dbNameTypeIn),
-              db( dir / ::GetDbName(dbNameTypeIn), DBCacheSize[dbNameTypeIn], fMemory, fWipe ) {}
+              spStorage(std::make_shared<CDBStorage>(dir / ::GetDbName(dbNameTypeIn), DBCacheSize[dbNameTypeIn],
+                                                     fMemory, fWipe)) {}
 
-    int64_t GetDbCount() const { return db.GetDbCount(); }
+    // for the single db mode
+    CDBAccess(DBNameType dbNameTypeIn, const std::shared_ptr<CDBStorage> &spStorageIn) :
+              dbNameType(dbNameTypeIn), spStorage(spStorageIn) {
+        assert(spStorage);
+    }
+
+    int64_t GetDbCount() const { return spStorage->GetDbCount(); }
     template<typename KeyType, typename ValueType>
     bool GetData(const dbk::PrefixType prefixType, const KeyType &key, ValueType &value) const {
         string keyStr = dbk::GenDbKey(prefixType, key);
-        return db.Read(keyStr, value);
+        return spStorage->Read(keyStr, value);
     }
 
     template<typename ValueType>
     bool GetData(const dbk::PrefixType prefixType, ValueType &value) const {
         const string prefix = dbk::GetKeyPrefix(prefixType);
-        return db.Read(prefix, value);
+        return spStorage->Read(prefix, value);
     }
 
     template <typename KeyType>
@@ -394,55 +571,64 @@ public:
     template<typename KeyType, typename ValueType>
     bool HaveData(const dbk::PrefixType prefixType, const KeyType &key) const {
         string keyStr = dbk::GenDbKey(prefixType, key);
-        return db.Exists(keyStr);
+        return spStorage->Exists(keyStr);
     }
 
-    template<typename KeyType, typename ValueType>
-    void BatchWrite(const dbk::PrefixType prefixType, const map<KeyType, ValueType> &mapData) {
-        CLevelDBBatch batch;
-        for (auto item : mapData) {
-            string key = dbk::GenDbKey(prefixType, item.first);
-            if (db_util::IsEmpty(item.second)) {
-                batch.Erase(key);
-            } else {
-                batch.Write(key, item.second);
-            }
+    template<typename KeyType, typename ValueType, typename MapType>
+    void BatchWrite(const dbk::PrefixType prefixType, const MapType &mapData) {
+        CDBWriteMap writes;
+        for (const auto &item : mapData) {
+            auto &value = writes[dbk::GenDbKey(prefixType, item.first)];
+            if (!db_util::IsEmpty(item.second))
+                value = SerializeValue(item.second);
         }
-        db.WriteBatch(batch, true);
+        spStorage->Write(writes);
     }
 
     template<typename ValueType>
     void BatchWrite(const dbk::PrefixType prefixType, ValueType &value) {
-        CLevelDBBatch batch;
-        const string prefix = dbk::GetKeyPrefix(prefixType);
+        CDBWriteMap writes;
+        auto &writeValue = writes[dbk::GetKeyPrefix(prefixType)];
+        if (!db_util::IsEmpty(value))
+            writeValue = SerializeValue(value);
 
-        if (db_util::IsEmpty(value)) {
-            batch.Erase(prefix);
-        } else {
-            batch.Write(prefix, value);
-        }
-        db.WriteBatch(batch, true);
+        spStorage->Write(writes);
     }
 
     DBNameType GetDbNameType() const { return dbNameType; }
 
-    std::shared_ptr<leveldb::Iterator> NewIterator() {
-        return std::shared_ptr<leveldb::Iterator>(db.NewIterator());
+    std::shared_ptr<leveldb::Iterator> NewIterator() { return spStorage->NewIterator(); }
+
+    CDBStorage &GetStorage() { return *spStorage; }
+
+private:
+    template<typename ValueType>
+    static string SerializeValue(const ValueType &value) {
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        ssValue << value;
+        return ssValue.str();
     }
+
 private:
     DBNameType dbNameType;
-    mutable CLevelDBWrapper db; // // TODO: remove the mutable declare
+    std::shared_ptr<CDBStorage> spStorage;
 };
 
-template<int32_t PREFIX_TYPE_VALUE, typename __KeyType, typename __ValueType>
+/**
+ * Key-value cache of one db prefix. The entries are stored in __MapType, which must be ordered (std::map)
+ * for the caches that use GetTopNElements(), the GetAllElements() with an end key, or a db iterator.
+ * Point-lookup-only caches can use CFlatHashMap instead, see CHashKVCache.
+ */
+template<int32_t PREFIX_TYPE_VALUE, typename __KeyType, typename __ValueType,
+         typename __MapType = std::map<__KeyType, __ValueType>>
 class CCompositeKVCache {
 public:
     static const dbk::PrefixType PREFIX_TYPE = (dbk::PrefixType)PREFIX_TYPE_VALUE;
 public:
     typedef __KeyType   KeyType;
     typedef __ValueType ValueType;
-    typedef typename std::map<KeyType, ValueType> Map;
-    typedef typename std::map<KeyType, ValueType>::iterator Iterator;
+    typedef __MapType   Map;
+    typedef typename Map::iterator Iterator;
 
 public:
     /**
@@ -471,10 +657,23 @@ public:
         pDbOpLogMap = pDbOpLogMapIn;
     }
 
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn) {
+        pReadTracker = pReadTrackerIn;
+    }
+
     bool IsCalcSize() const { return is_calc_size; }
 
     uint32_t GetCacheSize() const {
-        return size;
+        if (is_calc_size)
+            return size;
+
+        // the caches over a base cache hold small deltas and do not track their size, compute it on demand
+        uint32_t sz = 0;
+        for (const auto &item : mapData)
+            sz += CalcDataSize(item.first) + CalcDataSize(item.second);
+        for (const auto &item : mapReadData)
+            sz += CalcDataSize(item.first) + CalcDataSize(item.second);
+        return sz;
     }
 
     bool GetTopNElements(const uint32_t maxNum, set<KeyType> &keys) {
@@ -523,9 +722,9 @@ public:
         if (db_util::IsEmpty(key)) {
             return false;
         }
-        auto it = GetDataIt(key);
-        if (it != mapData.end() && !db_util::IsEmpty(it->second)) {
-            value = it->second;
+        auto pValue = FindData(key);
+        if (pValue != nullptr && !db_util::IsEmpty(*pValue)) {
+            value = *pValue;
             return true;
         }
         return false;
@@ -535,7 +734,7 @@ public:
         if (db_util::IsEmpty(key)) {
             return false;
         }
-        auto it = GetDataIt(key);
+        auto it = GetDataItForWrite(key);
         if (it == mapData.end()) {
             auto pEmptyValue = db_util::MakeEmptyValue<ValueType>();
             AddOpLog(key, *pEmptyValue, &value);
@@ -552,15 +751,15 @@ public:
         if (db_util::IsEmpty(key)) {
             return false;
         }
-        auto it = GetDataIt(key);
-        return it != mapData.end() && !db_util::IsEmpty(it->second);
+        auto pValue = FindData(key);
+        return pValue != nullptr && !db_util::IsEmpty(*pValue);
     }
 
     bool EraseData(const KeyType &key) {
         if (db_util::IsEmpty(key)) {
             return false;
         }
-        Iterator it = GetDataIt(key);
+        Iterator it = GetDataItForWrite(key);
         if (it != mapData.end() && !db_util::IsEmpty(it->second)) {
             DecDataSize(it->second);
             AddOpLog(key, it->second, nullptr);
@@ -572,15 +771,18 @@ public:
 
     void Clear() {
         mapData.clear();
+        mapReadData.clear();
         size = 0;
     }
 
+    // only the written data is flushed, the read data is dropped
     void Flush() {
         assert(pBase != nullptr || pDbAccess != nullptr);
         if (pBase != nullptr) {
             assert(pDbAccess == nullptr);
             for (auto it : mapData) {
                 pBase->mapData[it.first] = it.second;
+                pBase->EraseReadData(it.first);
             }
         } else if (pDbAccess != nullptr) {
             assert(pBase == nullptr);
@@ -600,6 +802,7 @@ public:
             it->second = value;
         } else {
             AddDataToMap(key, value);
+            EraseReadData(key);
         }
     }
 
@@ -623,23 +826,60 @@ public:
         return pRet;
     }
 
-    CCompositeKVCache<PREFIX_TYPE, KeyType, ValueType>* GetBasePtr() { return pBase; }
+    CCompositeKVCache* GetBasePtr() { return pBase; }
 
-    map<KeyType, ValueType>& GetMapData() { return mapData; };
+    Map& GetMapData() { return mapData; };
 private:
-    Iterator GetDataIt(const KeyType &key) const {
+    // Find the value of key in this cache or its bases. The value found in a base cache is returned by
+    // reference instead of being copied into this cache, only the values read from db are kept in mapReadData.
+    const ValueType* FindData(const KeyType &key) const {
+        auto it = mapData.find(key);
+        if (it != mapData.end())
+            return &it->second;
+
+        auto readIt = mapReadData.find(key);
+        if (readIt != mapReadData.end())
+            return &readIt->second;
+
+        if (pBase != nullptr) {
+            if (pReadTracker == nullptr)
+                return pBase->FindData(key);
+
+            // the base is shared with other readers, keep a private copy which is made under the base lock
+            auto baseLock = TrackBaseRead(key);
+            auto pBaseValue = pBase->FindData(key);
+            if (pBaseValue != nullptr)
+                return &AddReadData(key, *pBaseValue)->second;
+        } else if (pDbAccess != nullptr) {
+            // TODO: need to save the empty value to mapReadData for search performance?
+            auto pDbValue = db_util::MakeEmptyValue<ValueType>();
+            if (pDbAccess->GetData(PREFIX_TYPE, key, *pDbValue)) {
+                return &AddReadData(key, *pDbValue)->second;
+            }
+        }
+
+        return nullptr;
+    }
+
+    // Get the entry of key in mapData to be modified, the current value is copied into mapData first.
+    Iterator GetDataItForWrite(const KeyType &key) {
         Iterator it = mapData.find(key);
-        if (it != mapData.end()) {
+        if (it != mapData.end())
             return it;
-        } else if (pBase != nullptr) {
-            // find key-value at base cache
-            auto baseIt = pBase->GetDataIt(key);
-            if (baseIt != pBase->mapData.end()) {
-                // the found key-value add to current mapData
-                return AddDataToMap(key, baseIt->second);
-            }
-        } else if (pDbAccess != NULL) {
-            // TODO: need to save the empty value to mapData for search performance?
+
+        auto readIt = mapReadData.find(key);
+        if (readIt != mapReadData.end()) {
+            it = AddDataToMap(key, readIt->second);
+            EraseReadData(key);
+            return it;
+        }
+
+        if (pBase != nullptr) {
+            auto baseLock = TrackBaseRead(key);
+            auto pBaseValue = pBase->FindData(key);
+            if (pBaseValue != nullptr)
+                return AddDataToMap(key, *pBaseValue);
+        } else if (pDbAccess != nullptr) {
             auto pDbValue = db_util::MakeEmptyValue<ValueType>();
             if (pDbAccess->GetData(PREFIX_TYPE, key, *pDbValue)) {
                 return AddDataToMap(key, *pDbValue);
@@ -649,7 +889,23 @@ private:
         return mapData.end();
     }
 
-    inline Iterator AddDataToMap(const KeyType &keyIn, const ValueType &valueIn) const {
+    inline Iterator AddReadData(const KeyType &keyIn, const ValueType &valueIn) const {
+        auto newRet = mapReadData.emplace(keyIn, valueIn);
+        if (!newRet.second)
+            throw runtime_error(strprintf("%s :  %s, alloc new cache item failed", __FUNCTION__, __LINE__));
+        IncDataSize(keyIn, valueIn);
+        return newRet.first;
+    }
+
+    inline void EraseReadData(const KeyType &keyIn) {
+        auto it = mapReadData.find(keyIn);
+        if (it != mapReadData.end()) {
+            DecDataSize(it->first, it->second);
+            mapReadData.erase(it);
+        }
+    }
+
+    inline Iterator AddDataToMap(const KeyType &keyIn, const ValueType &valueIn) {
         auto newRet = mapData.emplace(keyIn, valueIn);
         if (!newRet.second)
             throw runtime_error(strprintf("%s :  %s, alloc new cache item failed", __FUNCTION__, __LINE__));
@@ -669,6 +925,13 @@ private:
             size += CalcDataSize(valueIn);
     }
 
+    inline void DecDataSize(const KeyType &keyIn, const ValueType &valueIn) const {
+        if (is_calc_size) {
+            uint32_t sz = CalcDataSize(keyIn) + CalcDataSize(valueIn);
+            size = size > sz ? size - sz : 0;
+        }
+    }
+
     inline void DecDataSize(const ValueType &valueIn) const {
         if (is_calc_size) {
             uint32_t sz = CalcDataSize(valueIn);
@@ -710,6 +973,7 @@ private:
         }
 
         if (pBase != nullptr) {
+            auto baseLock = TrackBaseRead();
             return pBase->GetTopNElements(maxNum, expiredKeys, keys);
         } else if (pDbAccess != nullptr) {
             return pDbAccess->GetTopNElements(maxNum, PREFIX_TYPE, expiredKeys, keys);
@@ -733,6 +997,7 @@ private:
         }
 
         if (pBase != nullptr) {
+            auto baseLock = TrackBaseRead();
             return pBase->GetAllElements(endKey, mapDataOut, expiredKeys);
         } else if (pDbAccess != nullptr) {
             return pDbAccess->GetAllElements(PREFIX_TYPE, endKey, mapDataOut, expiredKeys);
@@ -757,6 +1022,7 @@ private:
         }
 
         if (pBase != nullptr) {
+            auto baseLock = TrackBaseRead();
             return pBase->GetAllElements(expiredKeys, elements);
         } else if (pDbAccess != nullptr) {
             return pDbAccess->GetAllElements(PREFIX_TYPE, expiredKeys, elements);
@@ -765,6 +1031,18 @@ private:
         return true;
     }
 
+    inline std::unique_lock<std::mutex> TrackBaseRead(const KeyType &key) const {
+        if (pReadTracker == nullptr)
+            return std::unique_lock<std::mutex>();
+        return pReadTracker->AddKey(PREFIX_TYPE, key);
+    }
+
+    inline std::unique_lock<std::mutex> TrackBaseRead() const {
+        if (pReadTracker == nullptr)
+            return std::unique_lock<std::mutex>();
+        return pReadTracker->AddPrefix(PREFIX_TYPE);
+    }
+
     inline void AddOpLog(const KeyType &key, const ValueType& oldValue, const ValueType *pNewValue) {
         if (pDbOpLogMap != nullptr) {
             CDbOpLog dbOpLog;
@@ -777,18 +1055,33 @@ private:
                 dbOpLog.Set(key, oldValue);
             #endif
             pDbOpLogMap->AddOpLog(PREFIX_TYPE, dbOpLog);
+
+            CDBOpLogMap *pRedoLogMap = pDbOpLogMap->GetRedoLogMap();
+            if (pRedoLogMap != nullptr) {
+                CDbOpLog redoLog;
+                if (pNewValue != nullptr)
+                    redoLog.Set(key, *pNewValue);
+                else
+                    redoLog.Set(key, *db_util::MakeEmptyValue<ValueType>());
+                pRedoLogMap->AddOpLog(PREFIX_TYPE, redoLog);
+            }
         }
 
     }
 private:
-    mutable CCompositeKVCache<PREFIX_TYPE, KeyType, ValueType> *pBase = nullptr;
+    mutable CCompositeKVCache *pBase = nullptr;
     CDBAccess *pDbAccess = nullptr;
-    mutable map<KeyType, ValueType> mapData;
+    Map mapData;              // the written data
+    mutable Map mapReadData;  // the data read from db, or from a tracked base
     CDBOpLogMap *pDbOpLogMap = nullptr;
+    CDBReadTracker *pReadTracker = nullptr;
     bool is_calc_size = false;
     mutable uint32_t size = 0;
 };
 
+/** Key-value cache stored in a CFlatHashMap, for the db prefixes which never need ordered scans */
+template<int32_t PREFIX_TYPE_VALUE, typename KeyType, typename ValueType>
+using CHashKVCache = CCompositeKVCache<PREFIX_TYPE_VALUE, KeyType, ValueType, CFlatHashMap<KeyType, ValueType>>;
 
 template<int32_t PREFIX_TYPE_VALUE, typename __ValueType>
 class CSimpleKVCache {
@@ -824,7 +1117,13 @@ public:
         } else {
             ptrData = make_shared<ValueType>(*other.ptrData);
         }
+        if (other.ptrReadData == nullptr) {
+            ptrReadData = nullptr;
+        } else {
+            ptrReadData = make_shared<ValueType>(*other.ptrReadData);
+        }
         pDbOpLogMap = other.pDbOpLogMap;
+        pReadTracker = other.pReadTracker;
         return *this;
     }
 
@@ -838,12 +1137,17 @@ public:
         pDbOpLogMap = pDbOpLogMapIn;
     }
 
-    uint32_t GetCacheSize() const {
-        if (!ptrData) {
-            return 0;
-        }
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn) {
+        pReadTracker = pReadTrackerIn;
+    }
 
-        return ::GetSerializeSize(*ptrData, SER_DISK, CLIENT_VERSION);
+    uint32_t GetCacheSize() const {
+        uint32_t sz = 0;
+        if (ptrData)
+            sz += ::GetSerializeSize(*ptrData, SER_DISK, CLIENT_VERSION);
+        if (ptrReadData)
+            sz += ::GetSerializeSize(*ptrReadData, SER_DISK, CLIENT_VERSION);
+        return sz;
     }
 
     bool GetData(ValueType &value) const {
@@ -857,9 +1161,10 @@ public:
 
     bool SetData(const ValueType &value) {
         if (!ptrData) {
-            ptrData = db_util::MakeEmptyValue<ValueType>();
+            auto ptr = GetDataPtr();
+            ptrData = ptr ? std::make_shared<ValueType>(*ptr) : db_util::MakeEmptyValue<ValueType>();
         }
-        AddOpLog(*ptrData);
+        AddOpLog(*ptrData, &value);
         *ptrData = value;
         return true;
     }
@@ -872,16 +1177,19 @@ public:
     bool EraseData() {
         auto ptr = GetDataPtr();
         if (ptr && !db_util::IsEmpty(*ptr)) {
-            AddOpLog(*ptr);
-            db_util::SetEmpty(*ptr);
+            AddOpLog(*ptr, nullptr);
+            // ptr may be owned by the base cache, never modify it
+            ptrData = db_util::MakeEmptyValue<ValueType>();
         }
         return true;
     }
 
     void Clear() {
-        ptrData = nullptr;
+        ptrData     = nullptr;
+        ptrReadData = nullptr;
     }
 
+    // only the written data is flushed, the read data is dropped
     void Flush() {
         assert(pBase != nullptr || pDbAccess != nullptr);
         if (ptrData) {
@@ -892,8 +1200,8 @@ public:
                 assert(pBase == nullptr);
                 pDbAccess->BatchWrite(PREFIX_TYPE, *ptrData);
             }
-            ptrData = nullptr;
         }
+        Clear();
     }
 
     void UndoData(const CDbOpLog &dbOpLog) {
@@ -915,41 +1223,61 @@ public:
 
     dbk::PrefixType GetPrefixType() const { return PREFIX_TYPE; }
 private:
+    // Get the value of this cache or its bases. The value of a base cache is shared instead of being copied,
+    // only the value read from db, or from a tracked base, is kept in ptrReadData.
     std::shared_ptr<ValueType> GetDataPtr() const {
-
         if (ptrData) {
             return ptrData;
-        } else if (pBase != nullptr){
+        } else if (ptrReadData) {
+            return ptrReadData;
+        } else if (pBase != nullptr) {
+            if (pReadTracker == nullptr)
+                return pBase->GetDataPtr();
+
+            // the base is shared with other readers, keep a private copy which is made under the base lock
+            auto baseLock = pReadTracker->AddValue(PREFIX_TYPE);
             auto ptr = pBase->GetDataPtr();
             if (ptr) {
-                ptrData = std::make_shared<ValueType>(*ptr);
-                return ptrData;
+                ptrReadData = std::make_shared<ValueType>(*ptr);
+                return ptrReadData;
             }
         } else if (pDbAccess != NULL) {
             auto ptrDbData = db_util::MakeEmptyValue<ValueType>();
 
             if (pDbAccess->GetData(PREFIX_TYPE, *ptrDbData)) {
                 assert(!db_util::IsEmpty(*ptrDbData));
-                ptrData = ptrDbData;
-                return ptrData;
+                ptrReadData = ptrDbData;
+                return ptrReadData;
             }
         }
         return nullptr;
     }
 
-    inline void AddOpLog(const ValueType &oldValue) {
+    inline void AddOpLog(const ValueType &oldValue, const ValueType *pNewValue) {
         if (pDbOpLogMap != nullptr) {
             CDbOpLog dbOpLog;
             dbOpLog.Set(oldValue);
             pDbOpLogMap->AddOpLog(PREFIX_TYPE, dbOpLog);
+
+            CDBOpLogMap *pRedoLogMap = pDbOpLogMap->GetRedoLogMap();
+            if (pRedoLogMap != nullptr) {
+                CDbOpLog redoLog;
+                if (pNewValue != nullptr)
+                    redoLog.Set(*pNewValue);
+                else
+                    redoLog.Set(*db_util::MakeEmptyValue<ValueType>());
+                pRedoLogMap->AddOpLog(PREFIX_TYPE, redoLog);
+            }
         }
 
     }
 private:
     mutable CSimpleKVCache<PREFIX_TYPE, ValueType> *pBase;
     CDBAccess *pDbAccess;
-    mutable std::shared_ptr<ValueType> ptrData = nullptr;
+    std::shared_ptr<ValueType> ptrData         = nullptr;  // the written data
+    mutable std::shared_ptr<ValueType> ptrReadData = nullptr;  // the data read from db, or from a tracked base
     CDBOpLogMap *pDbOpLogMap                   = nullptr;
+    CDBReadTracker *pReadTracker               = nullptr;
 };
 
 #endif  // PERSIST_DB_ACCESS_H
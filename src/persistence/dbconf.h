@@ -58,6 +58,16 @@ inline const std::string& GetDbName(DBNameType dbNameType) {
     return kDbNames[dbNameType];
 }
 
+// the db holding all of the above dbs in the single db mode (-singledb), the prefixes keep them apart
+static const std::string kSingleDbName = "chainstate";
+
+inline size_t GetSingleDbCacheSize() {
+    size_t cacheSize = 0;
+    for (int32_t i = 0; i < DBNameType::DB_NAME_COUNT; i++)
+        cacheSize += DBCacheSize[i];
+    return cacheSize;
+}
+
 namespace dbk {
 
 
@@ -78,6 +78,14 @@ public:
         active_delegates_cache.SetDbOpLogMap(pDbOpLogMapIn);
     }
 
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn) {
+        voteRegIdCache.SetReadTracker(pReadTrackerIn);
+        regId2VoteCache.SetReadTracker(pReadTrackerIn);
+        last_vote_height_cache.SetReadTracker(pReadTrackerIn);
+        pending_delegates_cache.SetReadTracker(pReadTrackerIn);
+        active_delegates_cache.SetReadTracker(pReadTrackerIn);
+    }
+
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         voteRegIdCache.RegisterUndoFunc(undoDataFuncMap);
         regId2VoteCache.RegisterUndoFunc(undoDataFuncMap);
@@ -152,6 +152,15 @@ public:
         operator_trade_pair_cache.SetDbOpLogMap(pDbOpLogMapIn);
     }
 
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn) {
+        activeOrderCache.SetReadTracker(pReadTrackerIn);
+        blockOrdersCache.SetReadTracker(pReadTrackerIn);
+        operator_detail_cache.SetReadTracker(pReadTrackerIn);
+        operator_owner_map_cache.SetReadTracker(pReadTrackerIn);
+        operator_last_id_cache.SetReadTracker(pReadTrackerIn);
+        operator_trade_pair_cache.SetReadTracker(pReadTrackerIn);
+    }
+
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         activeOrderCache.RegisterUndoFunc(undoDataFuncMap);
         blockOrdersCache.RegisterUndoFunc(undoDataFuncMap);
@@ -179,7 +188,7 @@ private:
 /*  ----------------   -----------------------------  ---------------------------  ------------------   ------------------------ */
     /////////// DexDB
     // order tx id -> active order
-    CCompositeKVCache< dbk::DEX_ACTIVE_ORDER,          uint256,                     dex::CDEXOrderDetail >     activeOrderCache;
+    CHashKVCache< dbk::DEX_ACTIVE_ORDER,          uint256,                     dex::CDEXOrderDetail >     activeOrderCache;
     DEXBlockOrdersCache    blockOrdersCache;
     CCompositeKVCache< dbk::DEX_OPERATOR_DETAIL,       std::optional<CVarIntValue<DexID>> , DexOperatorDetail >   operator_detail_cache;
     CCompositeKVCache< dbk::DEX_OPERATOR_OWNER_MAP,    CRegIDKey,               std::optional<CVarIntValue<DexID>>> operator_owner_map_cache;
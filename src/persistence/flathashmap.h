@@ -0,0 +1,211 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PERSIST_FLATHASHMAP_H
+#define PERSIST_FLATHASHMAP_H
+
+#include "commons/serialize.h"
+#include "commons/util/util.h"
+#include "config/version.h"
+#include "crypto/siphash.h"
+
+#include <stdint.h>
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+/**
+ * Hashes a db key by its disk serialization, so any key type of the db caches can be hashed without
+ * providing a std::hash specialization. The SipHash key is random per process.
+ */
+class CDbKeyHasher {
+public:
+    class CKeyHashWriter {
+    private:
+        CSipHasher hasher;
+
+    public:
+        int32_t nType;
+        int32_t nVersion;
+
+        CKeyHashWriter(uint64_t k0, uint64_t k1) : hasher(k0, k1), nType(SER_DISK), nVersion(CLIENT_VERSION) {}
+
+        CKeyHashWriter &write(const char *pch, size_t size) {
+            hasher.Write((const uint8_t *)pch, size);
+            return (*this);
+        }
+
+        template <typename T>
+        CKeyHashWriter &operator<<(const T &obj) {
+            ::Serialize(*this, obj, nType, nVersion);
+            return (*this);
+        }
+
+        uint64_t GetHash() const { return hasher.Finalize(); }
+    };
+
+    template <typename K>
+    uint64_t operator()(const K &key) const {
+        static const uint64_t k0 = GetRand(std::numeric_limits<uint64_t>::max());
+        static const uint64_t k1 = GetRand(std::numeric_limits<uint64_t>::max());
+        CKeyHashWriter hashWriter(k0, k1);
+        hashWriter << key;
+        return hashWriter.GetHash();
+    }
+};
+
+/**
+ * A hash map for the db caches which do not need ordered scans. The entries are stored densely in one
+ * vector, in insertion order, and found through an open-addressing (linear probing) index of entry
+ * positions, so the map costs two allocations instead of one heap node per entry, and a lookup does not
+ * chase pointers. Erasing moves the last entry into the hole. Like std::vector, any insertion or erasure
+ * may invalidate iterators and references.
+ */
+template <typename K, typename V, typename Hash = CDbKeyHasher>
+class CFlatHashMap {
+public:
+    typedef K key_type;
+    typedef V mapped_type;
+    typedef std::pair<K, V> value_type;
+    typedef typename std::vector<value_type>::iterator iterator;
+    typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+private:
+    static constexpr uint32_t SLOT_EMPTY   = 0xFFFFFFFF;
+    static constexpr uint32_t SLOT_DELETED = 0xFFFFFFFE;
+    static constexpr uint32_t MIN_SLOTS    = 16;
+
+    struct CSlot {
+        uint32_t index; //!< position of the entry, or SLOT_EMPTY/SLOT_DELETED
+        uint32_t hash;  //!< low bits of the key hash, kept for rehashing
+    };
+
+    std::vector<value_type> entries;
+    std::vector<CSlot> slots;
+    uint32_t nDeleted = 0;
+    Hash hasher;
+
+public:
+    iterator begin() { return entries.begin(); }
+    iterator end() { return entries.end(); }
+    const_iterator begin() const { return entries.begin(); }
+    const_iterator end() const { return entries.end(); }
+
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+
+    iterator find(const K &key) {
+        uint32_t slot = FindSlot(key, (uint32_t)hasher(key));
+        return slot == SLOT_EMPTY ? entries.end() : entries.begin() + slots[slot].index;
+    }
+
+    const_iterator find(const K &key) const {
+        uint32_t slot = FindSlot(key, (uint32_t)hasher(key));
+        return slot == SLOT_EMPTY ? entries.end() : entries.begin() + slots[slot].index;
+    }
+
+    size_t count(const K &key) const { return find(key) != end() ? 1 : 0; }
+
+    std::pair<iterator, bool> emplace(const K &key, const V &value) {
+        uint32_t hash = (uint32_t)hasher(key);
+        uint32_t slot = FindSlot(key, hash);
+        if (slot != SLOT_EMPTY)
+            return std::make_pair(entries.begin() + slots[slot].index, false);
+
+        if ((entries.size() + nDeleted + 1) * 4 > slots.size() * 3)
+            Rehash(std::max<size_t>(MIN_SLOTS, (entries.size() + 1) * 2));
+
+        entries.emplace_back(key, value);
+        InsertSlot((uint32_t)(entries.size() - 1), hash);
+        return std::make_pair(entries.end() - 1, true);
+    }
+
+    V &operator[](const K &key) { return emplace(key, V()).first->second; }
+
+    // return the iterator of the entry moved into the erased position
+    iterator erase(iterator pos) {
+        uint32_t index = pos - entries.begin();
+        uint32_t last  = entries.size() - 1;
+
+        uint32_t slot = FindSlot(pos->first, (uint32_t)hasher(pos->first));
+        slots[slot].index = SLOT_DELETED;
+        ++nDeleted;
+
+        if (index != last) {
+            uint32_t lastSlot = FindSlot(entries[last].first, (uint32_t)hasher(entries[last].first));
+            slots[lastSlot].index = index;
+            entries[index] = std::move(entries[last]);
+        }
+        entries.pop_back();
+
+        return entries.begin() + index;
+    }
+
+    size_t erase(const K &key) {
+        auto it = find(key);
+        if (it == end())
+            return 0;
+
+        erase(it);
+        return 1;
+    }
+
+    // release the memory at once
+    void clear() {
+        std::vector<value_type>().swap(entries);
+        std::vector<CSlot>().swap(slots);
+        nDeleted = 0;
+    }
+
+private:
+    // return the slot of key, or SLOT_EMPTY if not found
+    uint32_t FindSlot(const K &key, uint32_t hash) const {
+        if (slots.empty())
+            return SLOT_EMPTY;
+
+        uint32_t mask = slots.size() - 1;
+        for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+            const CSlot &slot = slots[i];
+            if (slot.index == SLOT_EMPTY)
+                return SLOT_EMPTY;
+
+            if (slot.index != SLOT_DELETED && slot.hash == hash && entries[slot.index].first == key)
+                return i;
+        }
+    }
+
+    void InsertSlot(uint32_t index, uint32_t hash) {
+        uint32_t mask = slots.size() - 1;
+        for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+            CSlot &slot = slots[i];
+            if (slot.index == SLOT_EMPTY || slot.index == SLOT_DELETED) {
+                if (slot.index == SLOT_DELETED)
+                    --nDeleted;
+
+                slot.index = index;
+                slot.hash  = hash;
+                return;
+            }
+        }
+    }
+
+    void Rehash(size_t minSlots) {
+        size_t newSize = MIN_SLOTS;
+        while (newSize < minSlots)
+            newSize <<= 1;
+
+        std::vector<CSlot> oldSlots;
+        oldSlots.swap(slots);
+        slots.assign(newSize, CSlot{SLOT_EMPTY, 0});
+        nDeleted = 0;
+
+        for (const auto &slot : oldSlots) {
+            if (slot.index != SLOT_EMPTY && slot.index != SLOT_DELETED)
+                InsertSlot(slot.index, slot.hash);
+        }
+    }
+};
+
+#endif  // PERSIST_FLATHASHMAP_H
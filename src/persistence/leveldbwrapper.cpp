@@ -117,3 +117,112 @@ int64_t CLevelDBWrapper::GetDbCount() {
 
     return ret;
 }
+
+CDBOverlayIterator::CDBOverlayIterator(leveldb::Iterator *pDbItIn,
+                                       const vector<std::shared_ptr<const CDBWriteMap>> &batchesIn)
+    : pDbIt(pDbItIn), batches(batchesIn), fValid(false), fNotSupported(false) {
+    for (const auto &spBatch : batches)
+        positions.push_back(spBatch->end());
+}
+
+CDBOverlayIterator::~CDBOverlayIterator() {
+    delete pDbIt;
+    pDbIt = nullptr;
+}
+
+void CDBOverlayIterator::SeekToFirst() {
+    pDbIt->SeekToFirst();
+    for (size_t i = 0; i < batches.size(); i++)
+        positions[i] = batches[i]->begin();
+
+    FindNextValid();
+}
+
+void CDBOverlayIterator::SeekToLast() {
+    fValid        = false;
+    fNotSupported = true;
+}
+
+void CDBOverlayIterator::Seek(const leveldb::Slice &target) {
+    pDbIt->Seek(target);
+    const string targetKey = target.ToString();
+    for (size_t i = 0; i < batches.size(); i++)
+        positions[i] = batches[i]->lower_bound(targetKey);
+
+    FindNextValid();
+}
+
+void CDBOverlayIterator::Next() {
+    assert(fValid);
+    SkipCurrentKey();
+    FindNextValid();
+}
+
+void CDBOverlayIterator::Prev() {
+    fValid        = false;
+    fNotSupported = true;
+}
+
+leveldb::Status CDBOverlayIterator::status() const {
+    if (fNotSupported)
+        return leveldb::Status::NotSupported("CDBOverlayIterator only supports forward iteration");
+
+    return pDbIt->status();
+}
+
+void CDBOverlayIterator::FindNextValid() {
+    while (true) {
+        // the smallest key of all sources, std::string compares bytewise like the leveldb comparator
+        bool fFound = false;
+        if (pDbIt->Valid()) {
+            curKey = pDbIt->key().ToString();
+            fFound = true;
+        }
+
+        for (size_t i = 0; i < batches.size(); i++) {
+            if (positions[i] != batches[i]->end() && (!fFound || positions[i]->first < curKey)) {
+                curKey = positions[i]->first;
+                fFound = true;
+            }
+        }
+
+        if (!fFound) {
+            fValid = false;
+            return;
+        }
+
+        // the latest batch which has the key overwrites the db
+        int32_t latest = -1;
+        for (int32_t i = batches.size() - 1; i >= 0; i--) {
+            if (positions[i] != batches[i]->end() && positions[i]->first == curKey) {
+                latest = i;
+                break;
+            }
+        }
+
+        if (latest < 0) {
+            curValue = pDbIt->value();
+            fValid   = true;
+            return;
+        }
+
+        if (positions[latest]->second) {
+            curValue = leveldb::Slice(*positions[latest]->second);
+            fValid   = true;
+            return;
+        }
+
+        // the key is erased, skip it
+        SkipCurrentKey();
+    }
+}
+
+void CDBOverlayIterator::SkipCurrentKey() {
+    if (pDbIt->Valid() && pDbIt->key() == leveldb::Slice(curKey))
+        pDbIt->Next();
+
+    for (size_t i = 0; i < batches.size(); i++) {
+        if (positions[i] != batches[i]->end() && positions[i]->first == curKey)
+            ++positions[i];
+    }
+}
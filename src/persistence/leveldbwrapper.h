@@ -16,6 +16,9 @@
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
+#include <mutex>
+#include <optional>
+
 using namespace json_spirit;
 
 class CDbOpLog {
@@ -87,6 +90,7 @@ typedef vector<CDbOpLog> CDbOpLogs;
 class CDBOpLogMap {
 public:
     map<string, CDbOpLogs>& GetMap() { return mapDbOpLogs; }
+    const map<string, CDbOpLogs>& GetMap() const { return mapDbOpLogs; }
 
     const CDbOpLogs* GetDbOpLogsPtr(dbk::PrefixType prefixType) const {
         assert(prefixType != dbk::EMPTY);
@@ -106,6 +110,29 @@ public:
 
     void Clear() { mapDbOpLogs.clear(); }
 
+    // Besides the old values, the caches log the new value of every write into the redo log map if it is set,
+    // so that the writes can be replayed on another view through the undo functions of its caches.
+    void SetRedoLogMap(CDBOpLogMap *pRedoLogMapIn) { pRedoLogMap = pRedoLogMapIn; }
+    CDBOpLogMap* GetRedoLogMap() const { return pRedoLogMap; }
+
+    // keep only the last log of each key, for a redo log whose logs are applied in any order
+    void KeepLastLogs() {
+        for (auto &item : mapDbOpLogs) {
+            map<string, const CDbOpLog*> lastLogs;
+            for (const auto &dbOpLog : item.second)
+                lastLogs[dbOpLog.GetKey()] = &dbOpLog;
+
+            if (lastLogs.size() == item.second.size())
+                continue;
+
+            CDbOpLogs dbOpLogs;
+            dbOpLogs.reserve(lastLogs.size());
+            for (const auto &lastLog : lastLogs)
+                dbOpLogs.push_back(*lastLog.second);
+            item.second.swap(dbOpLogs);
+        }
+    }
+
     std::string ToString() const;
 public:
     IMPLEMENT_SERIALIZE(
@@ -113,6 +140,75 @@ public:
 	)
 private:
     mutable map<string, CDbOpLogs> mapDbOpLogs; // dbName -> dbOpLogs
+    CDBOpLogMap *pRedoLogMap = nullptr;         // not serialized
+};
+
+/**
+ * Records which keys a child cache reads through to its base cache, so that a transaction executed
+ * speculatively on a private child view can be checked against the writes of the transactions that
+ * precede it in the block. Keys are serialized the same way as in CDbOpLog, so they are directly
+ * comparable with the undo op logs. All trackers sharing one base view must share one base mutex,
+ * which serializes the reads (and the read-through caching) of the base view.
+ */
+class CDBReadTracker {
+public:
+    typedef map<string, set<string>> KeyMap; // prefix -> serialized keys
+
+    CDBReadTracker(std::mutex &baseMutexIn): baseMutex(baseMutexIn) {}
+
+    // for key-value cache, lock the base view and record the key
+    template<typename K>
+    std::unique_lock<std::mutex> AddKey(dbk::PrefixType prefixType, const K &key) {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey << key;
+        std::unique_lock<std::mutex> lock(baseMutex);
+        mapReadKeys[dbk::GetKeyPrefix(prefixType)].insert(ssKey.str());
+        return lock;
+    }
+
+    // for single value cache, the key of its op log is empty
+    std::unique_lock<std::mutex> AddValue(dbk::PrefixType prefixType) {
+        std::unique_lock<std::mutex> lock(baseMutex);
+        mapReadKeys[dbk::GetKeyPrefix(prefixType)].insert(string());
+        return lock;
+    }
+
+    // for iterating the elements of a cache, any write of the prefix is a conflict
+    std::unique_lock<std::mutex> AddPrefix(dbk::PrefixType prefixType) {
+        std::unique_lock<std::mutex> lock(baseMutex);
+        setReadPrefixes.insert(dbk::GetKeyPrefix(prefixType));
+        return lock;
+    }
+
+    bool IsConflict(const KeyMap &writeKeys) const {
+        for (const auto &item : writeKeys) {
+            if (setReadPrefixes.count(item.first))
+                return true;
+
+            auto it = mapReadKeys.find(item.first);
+            if (it == mapReadKeys.end())
+                continue;
+
+            for (const auto &key : item.second) {
+                if (it->second.count(key))
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    static void AddWriteKeys(CDBOpLogMap &dbOpLogMap, KeyMap &writeKeys) {
+        for (const auto &item : dbOpLogMap.GetMap()) {
+            auto &keys = writeKeys[item.first];
+            for (const auto &dbOpLog : item.second)
+                keys.insert(dbOpLog.GetKey());
+        }
+    }
+
+private:
+    std::mutex &baseMutex;
+    KeyMap mapReadKeys;
+    set<string> setReadPrefixes;
 };
 
 class leveldb_error : public runtime_error
@@ -141,12 +237,59 @@ public:
         batch.Put(slKey, slValue);
     }
 
+    // write the value which has been serialized already
+    void WriteRaw(const std::string &key, const std::string &value) {
+        batch.Put(key, value);
+    }
+
     void Erase(const std::string &key) {
         batch.Delete(key);
     }
 
+    void Clear() {
+        batch.Clear();
+    }
+
  };
 
+/**
+ * The writes of a db which are not committed yet: db key -> serialized value, or nullopt if the key is
+ * erased. See CDBAccess::FreezeBatch().
+ */
+typedef std::map<std::string, std::optional<std::string>> CDBWriteMap;
+
+/**
+ * Iterates a db as if the given write batches were committed to it. The batches are in commit order,
+ * the later ones overwrite the earlier ones. Only forward iteration is supported.
+ */
+class CDBOverlayIterator : public leveldb::Iterator {
+public:
+    CDBOverlayIterator(leveldb::Iterator *pDbItIn, const vector<std::shared_ptr<const CDBWriteMap>> &batchesIn);
+    ~CDBOverlayIterator();
+
+    bool Valid() const { return fValid; }
+    void SeekToFirst();
+    void SeekToLast();
+    void Seek(const leveldb::Slice &target);
+    void Next();
+    void Prev();
+    leveldb::Slice key() const { return curKey; }
+    leveldb::Slice value() const { return curValue; }
+    leveldb::Status status() const;
+
+private:
+    void FindNextValid();
+    void SkipCurrentKey();
+
+    leveldb::Iterator *pDbIt;
+    vector<std::shared_ptr<const CDBWriteMap>> batches;
+    vector<CDBWriteMap::const_iterator> positions;  // one for each batch
+    bool fValid;
+    bool fNotSupported;
+    std::string curKey;
+    leveldb::Slice curValue;
+};
+
 class CLevelDBWrapper {
 private:
     // custom environment this database is using (may be NULL in case of default environment)
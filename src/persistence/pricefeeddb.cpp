@@ -9,6 +9,113 @@
 #include "main.h"
 #include "tx/pricefeedtx.h"
 
+#include <algorithm>
+
+void CMedianPriceWindow::Add(const uint64_t price) {
+    if (lo.empty() || price <= *lo.rbegin())
+        lo.insert(price);
+    else
+        hi.insert(price);
+
+    Rebalance();
+}
+
+void CMedianPriceWindow::Remove(const uint64_t price) {
+    if (!lo.empty() && price <= *lo.rbegin()) {
+        auto it = lo.find(price);
+        if (it != lo.end())
+            lo.erase(it);
+    } else {
+        auto it = hi.find(price);
+        if (it != hi.end())
+            hi.erase(it);
+    }
+
+    Rebalance();
+}
+
+void CMedianPriceWindow::Rebalance() {
+    while (lo.size() > hi.size() + 1) {
+        auto it = std::prev(lo.end());
+        hi.insert(*it);
+        lo.erase(it);
+    }
+
+    while (hi.size() > lo.size()) {
+        lo.insert(*hi.begin());
+        hi.erase(hi.begin());
+    }
+}
+
+uint64_t CMedianPriceWindow::GetMedian() const {
+    if (lo.empty())
+        return 0;
+
+    return lo.size() > hi.size() ? *lo.rbegin() : (*lo.rbegin() + *hi.begin()) / 2;
+}
+
+bool CMedianPriceWindow::GetMedian(const vector<uint64_t> &removed, const vector<uint64_t> &added,
+                                   uint64_t &median) const {
+    if (removed.empty() && added.empty()) {
+        median = GetMedian();
+        return true;
+    }
+
+    if (Size() == 0 || removed.size() > Size())
+        return false;
+
+    size_t count = Size() - removed.size() + added.size();
+    if (count == 0) {
+        median = 0;
+        return true;
+    }
+
+    // Collect the prices around the median, the median of the changed window can move by one position
+    // at most for each change.
+    size_t span = 2 * (removed.size() + added.size()) + 2;
+    vector<uint64_t> segment;
+    segment.reserve(2 * span + 1 + added.size());
+    for (auto it = lo.rbegin(); it != lo.rend() && segment.size() < span; ++it)
+        segment.push_back(*it);
+
+    size_t below = lo.size() - segment.size();
+    std::reverse(segment.begin(), segment.end());
+    size_t loCount = segment.size();
+    for (auto it = hi.begin(); it != hi.end() && segment.size() < loCount + span + 1; ++it)
+        segment.push_back(*it);
+
+    const uint64_t lowPrice  = segment.front();
+    const uint64_t highPrice = segment.back();
+    for (const auto price : removed) {
+        if (price < lowPrice) {
+            if (below == 0)
+                return false;
+            --below;
+        } else if (price <= highPrice) {
+            auto it = std::lower_bound(segment.begin(), segment.end(), price);
+            if (it == segment.end() || *it != price)
+                return false;
+            segment.erase(it);
+        }
+    }
+
+    for (const auto price : added) {
+        if (price < lowPrice)
+            ++below;
+        else if (price <= highPrice)
+            segment.insert(std::upper_bound(segment.begin(), segment.end(), price), price);
+    }
+
+    // same as ComputeMedianNumber(): the middle one, or the average of the middle two
+    size_t index = (count - 1) / 2;
+    size_t last  = count % 2 == 0 ? index + 1 : index;
+    if (index < below || last >= below + segment.size())
+        return false;
+
+    median = count % 2 == 0 ? (segment[index - below] + segment[last - below]) / 2 : segment[index - below];
+    return true;
+}
+
 void CConsecutiveBlockPrice::AddUserPrice(const int32_t blockHeight, const CRegID &regId, const uint64_t price) {
     mapBlockUserPrices[blockHeight][regId] = price;
 }
@@ -38,6 +145,8 @@ bool CPricePointMemCache::AddPrice(const int32_t blockHeight, const CRegID &regI
 
         CConsecutiveBlockPrice &cbp = mapCoinPricePointCache[pp.GetCoinPricePair()];
         cbp.AddUserPrice(blockHeight, regId, pp.GetPrice());
+        if (pBase == nullptr)
+            AddWindowPrice(pp.GetCoinPricePair(), pp.GetPrice());
         LogPrint(BCLog::PRICEFEED,
                  "CPricePointMemCache::AddPrice, add block user price, "
                  "height: %d, redId: %s, pricePoint: %s\n",
@@ -49,9 +158,19 @@ bool CPricePointMemCache::AddPrice(const int32_t blockHeight, const CRegID &regI
 
 bool CPricePointMemCache::ExistBlockUserPrice(const int32_t blockHeight, const CRegID &regId,
                                               const CoinPricePair &coinPricePair) {
-    if (mapCoinPricePointCache.count(coinPricePair) &&
-        mapCoinPricePointCache[coinPricePair].ExistBlockUserPrice(blockHeight, regId))
-        return true;
+    auto it = mapCoinPricePointCache.find(coinPricePair);
+    if (it != mapCoinPricePointCache.end()) {
+        auto itBlock = it->second.mapBlockUserPrices.find(blockHeight);
+        if (itBlock != it->second.mapBlockUserPrices.end()) {
+            if (itBlock->second.count(regId))
+                return true;
+
+            // an empty entry marks the block prices of the base cache deleted, e.g. by a block disconnected
+            // in a fork view, so the block connected at the same height must not look up the base
+            if (itBlock->second.empty())
+                return false;
+        }
+    }
 
     if (pBase)
         return pBase->ExistBlockUserPrice(blockHeight, regId, coinPricePair);
@@ -82,6 +201,20 @@ bool CPricePointMemCache::AddPriceByBlock(const CBlock &block) {
 }
 
 bool CPricePointMemCache::DeleteBlockPricePoint(const int32_t blockHeight) {
+    if (pBase == nullptr) {
+        // Nothing to mark for the base cache, erase the block prices at once.
+        for (auto &item : mapCoinPricePointCache) {
+            auto &mapBlockUserPrices = item.second.mapBlockUserPrices;
+            auto it                  = mapBlockUserPrices.find(blockHeight);
+            if (it != mapBlockUserPrices.end()) {
+                RemoveWindowPrices(item.first, it->second);
+                mapBlockUserPrices.erase(it);
+            }
+        }
+
+        return true;
+    }
+
     if (mapCoinPricePointCache.empty()) {
         // TODO: multi stable coin
         mapCoinPricePointCache[CoinPricePair(SYMB::WICC, SYMB::USD)].DeleteUserPrice(blockHeight);
@@ -102,14 +235,22 @@ void CPricePointMemCache::BatchWrite(const CoinPricePointMap &mapCoinPricePointC
         // map<int32_t /* block height */, map<CRegID, uint64_t /* price */>>
         const auto &mapBlockUserPrices = item.second.mapBlockUserPrices;
         for (const auto &userPrice : mapBlockUserPrices) {
+            auto &blockUserPrices = mapCoinPricePointCache[item.first /* CoinPricePair */].mapBlockUserPrices;
             if (userPrice.second.empty()) {
-                mapCoinPricePointCache[item.first /* CoinPricePair */].mapBlockUserPrices.erase(userPrice.first /* height */);
+                auto it = blockUserPrices.find(userPrice.first /* height */);
+                if (it != blockUserPrices.end()) {
+                    if (pBase == nullptr)
+                        RemoveWindowPrices(item.first, it->second);
+
+                    blockUserPrices.erase(it);
+                }
             } else {
                 // map<CRegID, uint64_t /* price */>;
+                auto &userPrices = blockUserPrices[userPrice.first /* height */];
                 for (const auto &priceItem : userPrice.second) {
-                    mapCoinPricePointCache[item.first /* CoinPricePair */]
-                        .mapBlockUserPrices[userPrice.first /* height */]
-                        .emplace(priceItem.first /* CRegID */, priceItem.second /* price */);
+                    bool inserted = userPrices.emplace(priceItem.first /* CRegID */, priceItem.second /* price */).second;
+                    if (inserted && pBase == nullptr)
+                        AddWindowPrice(item.first, priceItem.second);
                 }
             }
         }
@@ -127,6 +268,65 @@ void CPricePointMemCache::Flush() {
     mapCoinPricePointCache.clear();
 }
 
+void CPricePointMemCache::AddWindowPrice(const CoinPricePair &coinPricePair, const uint64_t price) {
+    mapMedianPriceWindow[coinPricePair].Add(price);
+}
+
+void CPricePointMemCache::RemoveWindowPrices(const CoinPricePair &coinPricePair,
+                                             const map<CRegID, uint64_t> &userPrices) {
+    auto it = mapMedianPriceWindow.find(coinPricePair);
+    if (it == mapMedianPriceWindow.end())
+        return;
+
+    for (const auto &userPrice : userPrices)
+        it->second.Remove(userPrice.second);
+}
+
+bool CPricePointMemCache::GetWindowMedianPrice(const int32_t blockHeight, const uint64_t slideWindow,
+                                               const CoinPricePair &coinPricePair, uint64_t &medianPrice) {
+    // 1. the block prices of the views above the bottom cache, the upper view wins.
+    map<int32_t, const map<CRegID, uint64_t> *> upperUserPrices;
+    CPricePointMemCache *pBottom = this;
+    for (; pBottom->pBase != nullptr; pBottom = pBottom->pBase) {
+        auto iter = pBottom->mapCoinPricePointCache.find(coinPricePair);
+        if (iter == pBottom->mapCoinPricePointCache.end())
+            continue;
+
+        for (const auto &item : iter->second.mapBlockUserPrices)
+            upperUserPrices.emplace(item.first, &item.second);
+    }
+
+    auto windowIter = pBottom->mapMedianPriceWindow.find(coinPricePair);
+    if (windowIter == pBottom->mapMedianPriceWindow.end())
+        return false;
+
+    // 2. the prices of the bottom cache out of the sliding window, or overridden by the upper views, are
+    // removed, and the prices of the upper views in the sliding window are added.
+    int32_t beginBlockHeight = std::max<int32_t>((blockHeight - slideWindow), 0);
+    vector<uint64_t> removed;
+    vector<uint64_t> added;
+    auto bottomIter = pBottom->mapCoinPricePointCache.find(coinPricePair);
+    if (bottomIter != pBottom->mapCoinPricePointCache.end()) {
+        for (const auto &item : bottomIter->second.mapBlockUserPrices) {
+            if (item.first > beginBlockHeight && item.first <= blockHeight && !upperUserPrices.count(item.first))
+                continue;
+
+            for (const auto &userPrice : item.second)
+                removed.push_back(userPrice.second);
+        }
+    }
+
+    for (const auto &item : upperUserPrices) {
+        if (item.first <= beginBlockHeight || item.first > blockHeight)
+            continue;
+
+        for (const auto &userPrice : *item.second)
+            added.push_back(userPrice.second);
+    }
+
+    return windowIter->second.GetMedian(removed, added, medianPrice);
+}
+
 bool CPricePointMemCache::GetBlockUserPrices(const CoinPricePair &coinPricePair, set<int32_t> &expired,
                                              BlockUserPriceMap &blockUserPrices) {
     const auto &iter = mapCoinPricePointCache.find(coinPricePair);
@@ -164,6 +364,14 @@ bool CPricePointMemCache::GetBlockUserPrices(const CoinPricePair &coinPricePair,
 
 uint64_t CPricePointMemCache::ComputeBlockMedianPrice(const int32_t blockHeight, const uint64_t slideWindow,
                                                       const CoinPricePair &coinPricePair) {
+    uint64_t medianPrice = 0;
+    if (GetWindowMedianPrice(blockHeight, slideWindow, coinPricePair, medianPrice)) {
+        LogPrint(BCLog::PRICEFEED,
+                 "CPricePointMemCache::ComputeBlockMedianPrice, blockHeight: %d, median number of window: %llu\n",
+                 blockHeight, medianPrice);
+        return medianPrice;
+    }
+
     // 1. merge block user prices with base cache.
     BlockUserPriceMap blockUserPrices;
     if (!GetBlockUserPrices(coinPricePair, blockUserPrices) || blockUserPrices.empty()) {
@@ -15,6 +15,7 @@
 #include "tx/tx.h"
 
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -37,6 +38,33 @@ public:
     BlockUserPriceMap mapBlockUserPrices;
 };
 
+/**
+ * All the prices of one coin pair in a price point cache without base cache, kept split at the median
+ * (lo holds the lower half plus the median of an odd count, hi the upper half), so adding or removing a
+ * price costs O(log n) and the median of the window costs O(1).
+ */
+class CMedianPriceWindow {
+public:
+    void Add(const uint64_t price);
+    void Remove(const uint64_t price);
+
+    size_t Size() const { return lo.size() + hi.size(); }
+    uint64_t GetMedian() const;
+
+    /**
+     * Get the median of the window with the removed prices (which must be in the window) taken out and the
+     * added prices put in, without changing the window. Only the prices around the median are visited,
+     * return false if the median of the changed window is out of them.
+     */
+    bool GetMedian(const vector<uint64_t> &removed, const vector<uint64_t> &added, uint64_t &median) const;
+
+private:
+    void Rebalance();
+
+    multiset<uint64_t> lo;
+    multiset<uint64_t> hi;
+};
+
 class CPricePointMemCache {
 public:
     CPricePointMemCache() : pBase(nullptr) {}
@@ -63,6 +91,11 @@ private:
 
     void BatchWrite(const CoinPricePointMap &mapCoinPricePointCacheIn);
 
+    void AddWindowPrice(const CoinPricePair &coinPricePair, const uint64_t price);
+    void RemoveWindowPrices(const CoinPricePair &coinPricePair, const map<CRegID, uint64_t> &userPrices);
+    bool GetWindowMedianPrice(const int32_t blockHeight, const uint64_t slideWindow,
+                              const CoinPricePair &coinPricePair, uint64_t &medianPrice);
+
     bool GetBlockUserPrices(const CoinPricePair &coinPricePair, set<int32_t> &expired, BlockUserPriceMap &blockUserPrices);
     bool GetBlockUserPrices(const CoinPricePair &coinPricePair, BlockUserPriceMap &blockUserPrices);
 
@@ -70,10 +103,13 @@ private:
                                      const CoinPricePair &coinPricePair);
     uint64_t ComputeBlockMedianPrice(const int32_t blockHeight, const uint64_t slideWindow,
                                      const BlockUserPriceMap &blockUserPrices);
+
+public:
     static uint64_t ComputeMedianNumber(vector<uint64_t> &numbers);
 
 private:
     CoinPricePointMap mapCoinPricePointCache;  // coinPriceType -> consecutiveBlockPrice
+    map<CoinPricePair, CMedianPriceWindow> mapMedianPriceWindow;  // maintained without base cache only
     CPricePointMemCache *pBase;
     PriceMap latest_median_prices;
 };
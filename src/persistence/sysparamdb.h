@@ -100,6 +100,13 @@ public:
         cdpInterestParamChangesCache.SetDbOpLogMap(pDbOpLogMapIn);
     }
 
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn) {
+        sysParamCache.SetReadTracker(pReadTrackerIn);
+        minerFeeCache.SetReadTracker(pReadTrackerIn);
+        cdpParamCache.SetReadTracker(pReadTrackerIn);
+        cdpInterestParamChangesCache.SetReadTracker(pReadTrackerIn);
+    }
+
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         sysParamCache.RegisterUndoFunc(undoDataFuncMap);
         minerFeeCache.RegisterUndoFunc(undoDataFuncMap);
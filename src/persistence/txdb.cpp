@@ -14,53 +14,210 @@
 
 #include <algorithm>
 
+#include <boost/filesystem.hpp>
+
+CTxCacheBucket &CTxMemCache::GetSlot(int32_t height) {
+    if (buckets.empty())
+        buckets.resize(std::max<int32_t>(1, SysCfg().GetTxCacheHeight()));
+
+    return buckets[height % buckets.size()];
+}
+
+void CTxMemCache::EraseBucketTxids(const CTxCacheBucket &bucket) {
+    for (const auto &txid : bucket.txids) {
+        auto it = txHeights.find(txid);
+        if (it != txHeights.end() && it->second == bucket.height)
+            txHeights.erase(it);
+    }
+}
+
+void CTxMemCache::WriteBucket(const CTxCacheBucket &bucket) {
+    CTxCacheBucket &slot = GetSlot(bucket.height);
+    if (bucket.fErased) {
+        if (pBase == nullptr) {
+            if (slot.height != bucket.height)
+                return;
+        } else if (!slot.IsEmpty() && !slot.fErased && slot.height != bucket.height) {
+            // the base bucket of the erased height has been replaced already
+            return;
+        }
+    }
+
+    EraseBucketTxids(slot);
+    slot = bucket;
+    if (slot.fErased && pBase == nullptr) {
+        slot = CTxCacheBucket();
+        return;
+    }
+
+    for (const auto &txid : slot.txids)
+        txHeights[txid] = slot.height;
+}
+
 bool CTxMemCache::AddBlockTx(const CBlock &block) {
+    CTxCacheBucket bucket;
+    bucket.height    = block.GetHeight();
+    bucket.blockHash = block.GetHash();
+    bucket.txids.reserve(block.vptx.size());
     for (auto &ptx : block.vptx) {
-        txids.insert(ptx->GetHash());
+        bucket.txids.push_back(ptx->GetHash());
     }
+
+    WriteBucket(bucket);
     return true;
 }
 
 bool CTxMemCache::RemoveBlockTx(const CBlock &block) {
-    for (auto &ptx : block.vptx) {
-        txids.erase(ptx->GetHash());
-    }
+    CTxCacheBucket bucket;
+    bucket.height    = block.GetHeight();
+    bucket.blockHash = block.GetHash();
+    bucket.fErased   = true;
+
+    WriteBucket(bucket);
     return true;
 }
 
-bool CTxMemCache::HaveTx(const uint256 &txid) {
-    bool found = txids.count(txid) > 0;
-    if (found)
-        return true;
-    else if (pBase == nullptr) {
+bool CTxMemCache::HaveBlockTx(int32_t height, const uint256 &blockHash) const {
+    if (buckets.empty())
         return false;
-    } else
-        return pBase->HaveTx(txid);
+
+    const CTxCacheBucket &slot = buckets[height % buckets.size()];
+    return !slot.fErased && slot.height == height && slot.blockHash == blockHash;
 }
 
-void CTxMemCache::BatchWrite(const UnorderedHashSet &txidsIn) {
-    txids.clear();
+bool CTxMemCache::IsHidden(int32_t height) const {
+    if (buckets.empty())
+        return false;
+
+    const CTxCacheBucket &slot = buckets[height % buckets.size()];
+    if (slot.IsEmpty())
+        return false;
 
-    for (const auto &txid : txidsIn) {
-        txids.insert(txid);
+    return slot.fErased ? slot.height == height : true;
+}
+
+bool CTxMemCache::GetTxHeight(const uint256 &txid, int32_t &height) const {
+    auto it = txHeights.find(txid);
+    if (it != txHeights.end()) {
+        height = it->second;
+        return true;
     }
+
+    if (pBase == nullptr || !pBase->GetTxHeight(txid, height))
+        return false;
+
+    return !IsHidden(height);
+}
+
+bool CTxMemCache::HaveTx(const uint256 &txid) {
+    int32_t height;
+    return GetTxHeight(txid, height);
 }
 
 void CTxMemCache::Flush() {
     assert(pBase);
 
-    pBase->BatchWrite(txids);
-    txids.clear();
+    for (const auto &bucket : buckets) {
+        if (!bucket.IsEmpty())
+            pBase->WriteBucket(bucket);
+    }
+    Clear();
+}
+
+void CTxMemCache::Clear() {
+    buckets.clear();
+    txHeights.clear();
 }
 
-void CTxMemCache::Clear() { txids.clear(); }
+uint64_t CTxMemCache::GetSize() { return txHeights.size(); }
+
+bool CTxMemCache::WriteSnapshot(const boost::filesystem::path &path) const {
+    assert(pBase == nullptr);
+
+    vector<CTxCacheBucket> snapshot;
+    for (const auto &bucket : buckets) {
+        if (!bucket.IsEmpty())
+            snapshot.push_back(bucket);
+    }
 
-uint64_t CTxMemCache::GetSize() { return txids.size(); }
+    CDataStream ssSnapshot(SER_DISK, CLIENT_VERSION);
+    ssSnapshot << FLATDATA(SysCfg().MessageStart());
+    ssSnapshot << snapshot;
+    uint256 hash = Hash(ssSnapshot.begin(), ssSnapshot.end());
+    ssSnapshot << hash;
+
+    boost::filesystem::path pathTmp = path.string() + ".new";
+    FILE *file        = fopen(pathTmp.string().c_str(), "wb");
+    CAutoFile fileout = CAutoFile(file, SER_DISK, CLIENT_VERSION);
+    if (!fileout)
+        return ERRORMSG("%s : Failed to open file %s", __func__, pathTmp.string());
+
+    try {
+        fileout << ssSnapshot;
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Serialize or I/O error - %s", __func__, e.what());
+    }
+    FileCommit(fileout);
+    fileout.fclose();
+
+    if (!RenameOver(pathTmp, path))
+        return ERRORMSG("%s : Rename-into-place failed", __func__);
+
+    return true;
+}
+
+bool CTxMemCache::ReadSnapshot(const boost::filesystem::path &path, int32_t tipHeight) {
+    assert(pBase == nullptr);
+
+    FILE *file       = fopen(path.string().c_str(), "rb");
+    CAutoFile filein = CAutoFile(file, SER_DISK, CLIENT_VERSION);
+    if (!filein)
+        return ERRORMSG("%s : Failed to open file %s", __func__, path.string());
+
+    int64_t dataSize = (int64_t)boost::filesystem::file_size(path) - sizeof(uint256);
+    if (dataSize < 0)
+        dataSize = 0;
+    vector<uint8_t> vchData(dataSize);
+    uint256 hashIn;
+    try {
+        filein.read((char *)vchData.data(), dataSize);
+        filein >> hashIn;
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+    filein.fclose();
+
+    CDataStream ssSnapshot(vchData, SER_DISK, CLIENT_VERSION);
+    if (hashIn != Hash(ssSnapshot.begin(), ssSnapshot.end()))
+        return ERRORMSG("%s : Checksum mismatch, data corrupted", __func__);
+
+    uint8_t pchMsgTmp[4];
+    vector<CTxCacheBucket> snapshot;
+    try {
+        ssSnapshot >> FLATDATA(pchMsgTmp);
+        if (memcmp(pchMsgTmp, SysCfg().MessageStart(), sizeof(pchMsgTmp)))
+            return ERRORMSG("%s : Invalid network magic number", __func__);
+
+        ssSnapshot >> snapshot;
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+
+    Clear();
+    for (const auto &bucket : snapshot) {
+        if (bucket.height > tipHeight || bucket.height <= tipHeight - SysCfg().GetTxCacheHeight())
+            continue;
+
+        WriteBucket(bucket);
+    }
+
+    return true;
+}
 
 Object CTxMemCache::ToJsonObj() const {
     Array txArray;
-    for (auto &txid : txids) {
-        txArray.push_back(txid.ToString());
+    for (auto &item : txHeights) {
+        txArray.push_back(item.first.ToString());
     }
 
     Object txCacheObj;
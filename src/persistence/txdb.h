@@ -14,12 +14,43 @@
 #include "dbconf.h"
 #include "block.h"
 
+#include <boost/filesystem/path.hpp>
+
 #include <map>
+#include <unordered_map>
 #include <vector>
 
 using namespace std;
 using namespace json_spirit;
 
+/**
+ * The txids of one block in the transaction memory cache. A bucket with fErased set carries no txids,
+ * it hides the bucket of the same height in the base cache.
+ */
+class CTxCacheBucket {
+public:
+    int32_t height;
+    uint256 blockHash;
+    vector<uint256> txids;
+    bool fErased;
+
+    CTxCacheBucket() : height(-1), fErased(false) {}
+
+    bool IsEmpty() const { return height < 0; }
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(height);
+        READWRITE(blockHash);
+        READWRITE(txids);
+    )
+};
+
+/**
+ * Txids of the latest nTxCacheHeight blocks, used to reject duplicated transactions. The txids are kept
+ * in a ring of per-height buckets (slot = height % nTxCacheHeight), so adding the txids of a new block
+ * evicts the block nTxCacheHeight back in place, without reading it from disk. A cache with a base cache
+ * records the replaced and erased buckets, and writes them to the base cache when flushed.
+ */
 class CTxMemCache {
 public:
     CTxMemCache() : pBase(nullptr) {}
@@ -28,23 +59,34 @@ public:
 public:
     bool HaveTx(const uint256 &txid);
 
+    // add the txids of the block, evicting the bucket of the block nTxCacheHeight back
     bool AddBlockTx(const CBlock &block);
     bool RemoveBlockTx(const CBlock &block);
+    // whether the bucket of the given height holds the txids of the given block
+    bool HaveBlockTx(int32_t height, const uint256 &blockHash) const;
 
     void Clear();
     void SetBaseViewPtr(CTxMemCache *pBaseIn) { pBase = pBaseIn; }
     void Flush();
 
+    // the snapshot holds the buckets of a cache without base cache only
+    bool WriteSnapshot(const boost::filesystem::path &path) const;
+    // load the buckets of the snapshot within the nTxCacheHeight blocks up to tipHeight
+    bool ReadSnapshot(const boost::filesystem::path &path, int32_t tipHeight);
+
     Object ToJsonObj() const;
     uint64_t GetSize();
 
 private:
-    bool HaveBlock(const uint256 &blockHash) const;
-    bool HaveBlock(const CBlock &block);
-    void BatchWrite(const UnorderedHashSet &mapBlockTxHashSetIn);
+    bool GetTxHeight(const uint256 &txid, int32_t &height) const;
+    bool IsHidden(int32_t height) const;
+    void WriteBucket(const CTxCacheBucket &bucket);
+    void EraseBucketTxids(const CTxCacheBucket &bucket);
+    CTxCacheBucket &GetSlot(int32_t height);
 
 private:
-    UnorderedHashSet txids;
+    vector<CTxCacheBucket> buckets;  // allocated on first write
+    std::unordered_map<uint256, int32_t, CUint256Hasher> txHeights;  // txid -> height of its bucket
     CTxMemCache *pBase;
 };
 
@@ -35,6 +35,8 @@ public:
 
     void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) { txReceiptCache.SetDbOpLogMap(pDbOpLogMapIn); }
 
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn) { txReceiptCache.SetReadTracker(pReadTrackerIn); }
+
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         txReceiptCache.RegisterUndoFunc(undoDataFuncMap);
     }
@@ -43,7 +45,7 @@ private:
 /*  ----------------   -------------------------   -----------------------  ------------------   ------------------------ */
     /////////// SysParamDB
     // txid -> vector<CReceipt>
-    CCompositeKVCache< dbk::TX_RECEIPT,            TxID,                   vector<CReceipt> >     txReceiptCache;
+    CHashKVCache< dbk::TX_RECEIPT,            TxID,                   vector<CReceipt> >     txReceiptCache;
 };
 
 #endif // PERSIST_RECEIPTDB_H
\ No newline at end of file
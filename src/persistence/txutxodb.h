@@ -36,6 +36,8 @@ public:
 
     void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) { txUtxoCache.SetDbOpLogMap(pDbOpLogMapIn); }
 
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn) { txUtxoCache.SetReadTracker(pReadTrackerIn); }
+
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         txUtxoCache.RegisterUndoFunc(undoDataFuncMap);
     }
@@ -44,7 +46,7 @@ private:
 /*  ----------------   -------------------------   -----------------------  ------------------   ------------------------ */
     /////////// SysParamDB
     // txid -> <block_height, CoinUtxoTx>
-    CCompositeKVCache< dbk::TX_UTXO,            TxID,                      std::tuple<uint64_t, CCoinUTXOTx> >    txUtxoCache;
+    CHashKVCache< dbk::TX_UTXO,            TxID,                      std::tuple<uint64_t, CCoinUTXOTx> >    txUtxoCache;
 };
 
 #endif // PERSIST_TXUTXODB_H
\ No newline at end of file
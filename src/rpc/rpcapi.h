@@ -173,8 +173,11 @@ extern Value decodemulsigscript(const json_spirit::Array& params, bool fHelp);
 
 extern Value getfcoingenesistxinfo(const json_spirit::Array& params, bool fHelp);
 extern Value getblockcount(const json_spirit::Array& params, bool fHelp);
+extern Value getflushinfo(const json_spirit::Array& params, bool fHelp);
+extern Value getcacheinfo(const json_spirit::Array& params, bool fHelp);
 extern Value getdifficulty(const json_spirit::Array& params, bool fHelp);
 extern Value getrawmempool(const json_spirit::Array& params, bool fHelp);
+extern Value gettxadmissioninfo(const json_spirit::Array& params, bool fHelp);
 extern Value getblock(const json_spirit::Array& params, bool fHelp);
 extern Value verifychain(const json_spirit::Array& params, bool fHelp);
 extern Value getcontractregid(const json_spirit::Array& params, bool fHelp);
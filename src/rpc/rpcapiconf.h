@@ -35,8 +35,11 @@ static const CRPCCommand vRPCCommands[] =
     /* Block chain and UTXO */
     { "getfcoingenesistxinfo",          &getfcoingenesistxinfo,             true,      true,        false   },
     { "getblockcount",                  &getblockcount,                     true,      true,        false   },
+    { "getflushinfo",                   &getflushinfo,                      true,      true,        false   },
+    { "getcacheinfo",                   &getcacheinfo,                      true,      true,        false   },
     { "getblock",                       &getblock,                          true,      false,       false   },
     { "getrawmempool",                  &getrawmempool,                     true,      false,       false   },
+    { "gettxadmissioninfo",             &gettxadmissioninfo,                true,      true,        false   },
     { "verifychain",                    &verifychain,                       true,      false,       false   },
     { "getblockundo",                   &getblockundo,                      true,      false,       false   },
 
@@ -18,6 +18,7 @@
 #include "tx/merkletx.h"
 #include "tx/tx.h"
 #include "tx/coinrewardtx.h"
+#include "tx/txadmission.h"
 #include "wallet/wallet.h"
 #include "persistence/blockundo.h"
 
@@ -82,6 +83,99 @@ Value getblockcount(const Array& params, bool fHelp) {
     return chainActive.Height();
 }
 
+Value getflushinfo(const Array& params, bool fHelp) {
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getflushinfo\n"
+            "\nReturns the statistics of writing the chain state to disk in the background (-asyncflush).\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"async_flush\": true|false,     (boolean) whether the chain state is written in the background\n"
+            "  \"pending_flushes\": n,          (numeric) the flushes waiting to be written to disk\n"
+            "  \"max_pending_flushes\": n,      (numeric) a new flush waits when so many flushes are pending\n"
+            "  \"flushes\": n,                  (numeric) the flushes written to disk since startup\n"
+            "  \"last_freeze_time_ms\": n,      (numeric) the time holding cs_main to hand over the last flush\n"
+            "  \"last_write_time_ms\": n,       (numeric) the time from handing over to writing the last flush\n"
+            "  \"avg_write_time_ms\": n,        (numeric) the average time from handing over to writing a flush\n"
+            "  \"max_write_time_ms\": n,        (numeric) the maximum time from handing over to writing a flush\n"
+            "  \"stall_time_ms\": n             (numeric) the total time the flushes waited for max_pending_flushes\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getflushinfo", "") + "\nAs json rpc\n" + HelpExampleRpc("getflushinfo", ""));
+
+    CDBFlushStats stats = pCdMan->flushQueue.GetStats();
+
+    Object obj;
+    obj.push_back(Pair("async_flush",           fAsyncFlush));
+    obj.push_back(Pair("pending_flushes",       (int64_t)stats.nPendingFlushes));
+    obj.push_back(Pair("max_pending_flushes",   (int64_t)MAX_PENDING_FLUSHES));
+    obj.push_back(Pair("flushes",               (int64_t)stats.nFlushes));
+    obj.push_back(Pair("last_freeze_time_ms",   stats.nLastFreezeTime * 0.001));
+    obj.push_back(Pair("last_write_time_ms",    stats.nLastWriteTime * 0.001));
+    obj.push_back(Pair("avg_write_time_ms",     stats.nFlushes ? stats.nTotalWriteTime * 0.001 / stats.nFlushes : 0.0));
+    obj.push_back(Pair("max_write_time_ms",     stats.nMaxWriteTime * 0.001));
+    obj.push_back(Pair("stall_time_ms",         stats.nStallTime * 0.001));
+
+    return obj;
+}
+
+Value getcacheinfo(const Array& params, bool fHelp) {
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getcacheinfo\n"
+            "\nReturns the statistics of the in-memory caches of the node.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"block_read_cache\": {        (object) the cache of the decoded recent blocks (-blockreadcache)\n"
+            "    \"hits\": n,                   (numeric) the block reads served by the cache\n"
+            "    \"misses\": n,                 (numeric) the block reads which went to the disk\n"
+            "    \"blocks\": n,                 (numeric) the cached blocks\n"
+            "    \"size\": n,                   (numeric) the serialized size of the cached blocks in bytes\n"
+            "    \"max_size\": n                (numeric) the maximum size in bytes\n"
+            "  },\n"
+            "  \"signature_cache\": {         (object) the cache of the verified signatures (-maxsigcachesize)\n"
+            "    \"hits\": n,                   (numeric) the verifications served by the cache\n"
+            "    \"misses\": n,                 (numeric) the verifications not found in the cache\n"
+            "    \"hit_rate\": x.xxx,           (numeric) hits / (hits + misses)\n"
+            "    \"inserts\": n,                (numeric) the signatures added to the cache\n"
+            "    \"evictions\": n,              (numeric) the signatures evicted by new ones\n"
+            "    \"erases\": n,                 (numeric) the signatures erased when found by block validation\n"
+            "    \"entries\": n,                (numeric) the cached signatures\n"
+            "    \"max_entries\": n,            (numeric) the maximum number of cached signatures\n"
+            "    \"max_size\": n                (numeric) the size of the cache in bytes\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getcacheinfo", "") + "\nAs json rpc\n" + HelpExampleRpc("getcacheinfo", ""));
+
+    CBlockReadCache::CStats blockStats = blockReadCache.GetStats();
+    Object blockObj;
+    blockObj.push_back(Pair("hits",     (int64_t)blockStats.nHits));
+    blockObj.push_back(Pair("misses",   (int64_t)blockStats.nMisses));
+    blockObj.push_back(Pair("blocks",   (int64_t)blockStats.nBlocks));
+    blockObj.push_back(Pair("size",     (int64_t)blockStats.nSize));
+    blockObj.push_back(Pair("max_size", (int64_t)blockStats.nMaxSize));
+
+    CSignatureCache::CStats sigStats = signatureCache.GetStats();
+    uint64_t nSigLookups             = sigStats.nHits + sigStats.nMisses;
+    Object sigObj;
+    sigObj.push_back(Pair("hits",        (int64_t)sigStats.nHits));
+    sigObj.push_back(Pair("misses",      (int64_t)sigStats.nMisses));
+    sigObj.push_back(Pair("hit_rate",    nSigLookups > 0 ? (double)sigStats.nHits / nSigLookups : 0.0));
+    sigObj.push_back(Pair("inserts",     (int64_t)sigStats.nInserts));
+    sigObj.push_back(Pair("evictions",   (int64_t)sigStats.nEvictions));
+    sigObj.push_back(Pair("erases",      (int64_t)sigStats.nErases));
+    sigObj.push_back(Pair("entries",     (int64_t)sigStats.nEntries));
+    sigObj.push_back(Pair("max_entries", (int64_t)sigStats.nMaxEntries));
+    sigObj.push_back(Pair("max_size",    (int64_t)sigStats.nMaxSize));
+
+    Object obj;
+    obj.push_back(Pair("block_read_cache", blockObj));
+    obj.push_back(Pair("signature_cache", sigObj));
+
+    return obj;
+}
+
 Value getfcoingenesistxinfo(const Array& params, bool fHelp) {
     Object output;
 
@@ -170,6 +264,41 @@ Value getrawmempool(const Array& params, bool fHelp)
     }
 }
 
+Value gettxadmissioninfo(const Array& params, bool fHelp) {
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "gettxadmissioninfo\n"
+            "\nReturns the statistics of admitting the transactions received from peers into the memory pool.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"threads\": n,             (numeric) the running admission threads (-txadmissionthreads)\n"
+            "  \"queued\": n,              (numeric) the transactions waiting for admission\n"
+            "  \"accepted\": n,            (numeric) the transactions accepted into the memory pool\n"
+            "  \"rejected\": n,            (numeric) the transactions rejected\n"
+            "  \"dropped\": n,             (numeric) the transactions dropped when the queue was full\n"
+            "  \"tx_per_second\": x.xxx,   (numeric) the transactions accepted per second in the last minute\n"
+            "  \"avg_latency_ms\": x.xxx,  (numeric) the average time from queued to admitted in the last minute\n"
+            "  \"max_latency_ms\": x.xxx   (numeric) the maximum time from queued to admitted in the last minute\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("gettxadmissioninfo", "") + "\nAs json rpc\n" + HelpExampleRpc("gettxadmissioninfo", ""));
+
+    CTxAdmissionQueue::CStats stats;
+    txAdmissionQueue.GetStats(stats);
+
+    Object obj;
+    obj.push_back(Pair("threads",           (int64_t)stats.nThreads));
+    obj.push_back(Pair("queued",            (int64_t)stats.nQueued));
+    obj.push_back(Pair("accepted",          (int64_t)stats.nAccepted));
+    obj.push_back(Pair("rejected",          (int64_t)stats.nRejected));
+    obj.push_back(Pair("dropped",           (int64_t)stats.nDropped));
+    obj.push_back(Pair("tx_per_second",     stats.dTxPerSecond));
+    obj.push_back(Pair("avg_latency_ms",    stats.dAvgLatencyMs));
+    obj.push_back(Pair("max_latency_ms",    stats.dMaxLatencyMs));
+
+    return obj;
+}
+
 Value getblock(const Array& params, bool fHelp) {
     if (fHelp || params.size() < 1 || params.size() > 2) {
         throw runtime_error(
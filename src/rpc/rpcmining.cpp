@@ -105,10 +105,14 @@ Value getmininginfo(const Array& params, bool fHelp) {
             "  \"blocks\": nnn,             (numeric) The current block\n"
             "  \"currentblocksize\": nnn,   (numeric) The last block size\n"
             "  \"currentblocktx\": nnn,     (numeric) The last block transaction\n"
+            "  \"currentblockpacktime\": x.xxx, (numeric) The milliseconds spent packing the txs of the last block\n"
+            "  \"currentblockpacktps\": x.xxx,  (numeric) The txs packed per second into the last block\n"
             "  \"errors\": \"...\"          (string) Current errors\n"
             "  \"generate\": true|false     (boolean) If the generation is on or off (see getgenerate or setgenerate "
             "calls)\n"
             "  \"pooledtx\": n              (numeric) The size of the mem pool\n"
+            "  \"pooledtx_size\": n         (numeric) The total size of the serialized txs in the mem pool\n"
+            "  \"pooledtx_min_fee_perkb\": n  (numeric) The fees per kB a tx must reach to enter the full mem pool\n"
             "  \"testnet\": true|false      (boolean) If using testnet or not\n"
             "}\n"
             "\nExamples:\n" +
@@ -119,9 +123,14 @@ Value getmininginfo(const Array& params, bool fHelp) {
     obj.push_back(Pair("blocks",           chainActive.Height()));
     obj.push_back(Pair("currentblocksize", (uint64_t)nLastBlockSize));
     obj.push_back(Pair("currentblocktx",   (uint64_t)nLastBlockTx));
+    obj.push_back(Pair("currentblockpacktime", nLastBlockPackTime * 0.001));
+    obj.push_back(Pair("currentblockpacktps",
+                       nLastBlockPackTime > 0 ? nLastBlockTx * 1000000.0 / nLastBlockPackTime : 0.0));
     obj.push_back(Pair("errors",           GetWarnings("statusbar")));
     obj.push_back(Pair("genblocklimit",    1));
     obj.push_back(Pair("pooledtx",         (uint64_t)mempool.Size()));
+    obj.push_back(Pair("pooledtx_size",    mempool.GetTotalTxSize()));
+    obj.push_back(Pair("pooledtx_min_fee_perkb", (uint64_t)mempool.GetMinFeePerKb()));
     obj.push_back(Pair("nettype",          NetTypeNames[SysCfg().NetworkID()]));
     obj.push_back(Pair("posmaxnonce",      (int32_t)SysCfg().GetBlockMaxNonce()));
     obj.push_back(Pair("generate",         GetMiningInfo()));
@@ -92,7 +92,33 @@ Value getpeerinfo(const Array& params, bool fHelp) {
             "    \"inbound\": true|false,     (boolean) Inbound (true) or Outbound (false)\n"
             "    \"startingheight\": n,       (numeric) The starting height (block) of the peer\n"
             "    \"banscore\": n,             (numeric) The ban score (stats.nMisbehavior)\n"
-            "    \"syncnode\" : true|false    (boolean) if sync node\n"
+            "    \"syncnode\" : true|false,   (boolean) if sync node\n"
+            "    \"compactblocks\": {         (json object) The compact block relay with the peer\n"
+            "      \"enabled\": true|false,   (boolean) Whether the peer asked for the new blocks as compact blocks\n"
+            "      \"received\": n,           (numeric) The compact blocks received from the peer\n"
+            "      \"roundtrip\": n,          (numeric) The ones whose missing txs were asked for with getblocktxn\n"
+            "      \"failed\": n,             (numeric) The ones which could not be rebuilt, the full block was asked for\n"
+            "    },\n"
+            "    \"sendqueues\": {           (json object) The send queues of the peer, served in the order listed\n"
+            "      \"class\": {               (json object) \"consensus\", \"block\", \"tx\" or \"bulk\"\n"
+            "        \"queuedmsgs\": n,       (numeric) The messages waiting to be sent\n"
+            "        \"queuedbytes\": n,      (numeric) The bytes waiting to be sent\n"
+            "        \"sentmsgs\": n,         (numeric) The messages sent\n"
+            "        \"sentbytes\": n,        (numeric) The bytes sent\n"
+            "        \"avgwaitms\": n,        (numeric) The average time from being queued until sent, in milliseconds\n"
+            "        \"maxwaitms\": n         (numeric) The longest time from being queued until sent, in milliseconds\n"
+            "      }, ...\n"
+            "    },\n"
+            "    \"msgprocesstime\": {        (json object) The processing times of the received messages\n"
+            "      \"command\": {             (json object) By command, \"*other*\" for the unknown ones\n"
+            "        \"count\": n,            (numeric) The number of messages\n"
+            "        \"totalms\": n,          (numeric) The total processing time in milliseconds\n"
+            "        \"maxms\": n,            (numeric) The longest processing time in milliseconds\n"
+            "        \"histogram\": {         (json object) The number of messages by processing time\n"
+            "          \"<100us\": n, \"<1ms\": n, \"<10ms\": n, \"<100ms\": n, \"<1s\": n, \">=1s\": n\n"
+            "        }\n"
+            "      }, ...\n"
+            "    }\n"
             "  }\n"
             "  ,...\n"
             "}\n"
@@ -140,6 +166,44 @@ Value getpeerinfo(const Array& params, bool fHelp) {
 
         obj.push_back(Pair("syncnode",      stats.fSyncNode));
 
+        Object compactBlocks;
+        compactBlocks.push_back(Pair("enabled",     stats.fSendCompactBlocks));
+        compactBlocks.push_back(Pair("received",    stats.nCmpctBlocksRecv));
+        compactBlocks.push_back(Pair("roundtrip",   stats.nCmpctBlocksRoundTrip));
+        compactBlocks.push_back(Pair("failed",      stats.nCmpctBlocksFailed));
+        obj.push_back(Pair("compactblocks", compactBlocks));
+
+        Object sendQueues;
+        for (size_t i = 0; i < stats.vSendClassStats.size(); i++) {
+            const CSendClassStats& classStats = stats.vSendClassStats[i];
+            Object sendClass;
+            sendClass.push_back(Pair("queuedmsgs",  classStats.nQueuedMsgs));
+            sendClass.push_back(Pair("queuedbytes", classStats.nQueuedBytes));
+            sendClass.push_back(Pair("sentmsgs",    classStats.nSentMsgs));
+            sendClass.push_back(Pair("sentbytes",   classStats.nSentBytes));
+            sendClass.push_back(Pair("avgwaitms",
+                classStats.nSentMsgs > 0 ? classStats.nTotalWaitUsec / 1000.0 / classStats.nSentMsgs : 0.0));
+            sendClass.push_back(Pair("maxwaitms",   classStats.nMaxWaitUsec / 1000.0));
+            sendQueues.push_back(Pair(SEND_CLASS_NAMES[i], sendClass));
+        }
+        obj.push_back(Pair("sendqueues", sendQueues));
+
+        Object processTimes;
+        for (const auto& item : stats.mapCommandTimes) {
+            const CCommandTimeStats& times = item.second;
+            Object histogram;
+            for (int32_t i = 0; i < CCommandTimeStats::BUCKETS; i++)
+                histogram.push_back(Pair(CCommandTimeStats::BUCKET_NAMES[i], times.vBuckets[i]));
+
+            Object command;
+            command.push_back(Pair("count",     times.nCount));
+            command.push_back(Pair("totalms",   times.nTotalUsec / 1000.0));
+            command.push_back(Pair("maxms",     times.nMaxUsec / 1000.0));
+            command.push_back(Pair("histogram", histogram));
+            processTimes.push_back(Pair(item.first, command));
+        }
+        obj.push_back(Pair("msgprocesstime", processTimes));
+
         ret.push_back(obj);
     }
 
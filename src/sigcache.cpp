@@ -6,45 +6,148 @@
 
 #include "sigcache.h"
 
-void CSignatureCache::ComputeEntry(uint256& entry, const uint256& sigHash,
-                                   const std::vector<unsigned char>& vchSig,
-                                   const CPubKey& pubKey) {
-    CSHA256()
-        .Write(sigHash.begin(), 32)
-        .Write(&pubKey[0], pubKey.size())
-        .Write(&vchSig[0], vchSig.size())
-        .Finalize(entry.begin());
+#include "crypto/siphash.h"
+
+#include <limits>
+
+void CSignatureCache::Setup(size_t nMaxSize) {
+    uint64_t nBuckets = nMaxSize / (sizeof(CEntry) * BUCKET_ENTRIES);
+    nShardBuckets     = nBuckets / SHARDS;
+    entries.reset(nShardBuckets > 0 ? new CEntry[nShardBuckets * SHARDS * BUCKET_ENTRIES]() : nullptr);
+
+    for (auto& k : salt)
+        k = GetRand(std::numeric_limits<uint64_t>::max());
+
+    for (uint32_t i = 0; i < SHARDS; i++)
+        shards[i].nRand = (salt[i % 4] ^ i) | 1;
+
+    nEntries = 0;
+}
+
+CSignatureCache::CKey CSignatureCache::ComputeEntry(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
+                                                    const CPubKey& pubKey) const {
+    CKey key;
+    key.k0 = CSipHasher(salt[0], salt[1])
+                 .Write(sigHash.begin(), 32)
+                 .Write(pubKey.begin(), pubKey.size())
+                 .Write(vchSig.data(), vchSig.size())
+                 .Finalize();
+    key.k1 = CSipHasher(salt[2], salt[3])
+                 .Write(sigHash.begin(), 32)
+                 .Write(pubKey.begin(), pubKey.size())
+                 .Write(vchSig.data(), vchSig.size())
+                 .Finalize();
+    if (key.k0 == 0)
+        key.k0 = 1;
+
+    return key;
+}
+
+// The shard is picked by k1 % SHARDS, the buckets of the key within the shard by k0 and k1 / SHARDS.
+CSignatureCache::CEntry* CSignatureCache::GetBucket(const CKey& key, uint32_t n) const {
+    uint64_t shard  = key.k1 % SHARDS;
+    uint64_t bucket = (n == 0 ? key.k0 : key.k1 / SHARDS) % nShardBuckets;
+    return &entries[(shard * nShardBuckets + bucket) * BUCKET_ENTRIES];
+}
+
+bool CSignatureCache::Match(const CEntry& entry, const CKey& key) {
+    if (entry.k0.load(std::memory_order_acquire) != key.k0)
+        return false;
+
+    uint64_t k1 = entry.k1.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // the entry may have been rewritten while reading k1
+    return k1 == key.k1 && entry.k0.load(std::memory_order_relaxed) == key.k0;
+}
+
+void CSignatureCache::Write(CEntry& entry, uint64_t k0, uint64_t k1) {
+    entry.k0.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    entry.k1.store(k1, std::memory_order_relaxed);
+    entry.k0.store(k0, std::memory_order_release);
 }
 
 bool CSignatureCache::Get(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
-                          const CPubKey& pubKey) {
-    uint256 entry;
-    ComputeEntry(entry, sigHash, vchSig, pubKey);
-    std::unique_lock<std::mutex> lock(mtx);
-    return setValid.count(entry);
+                          const CPubKey& pubKey, bool fErase) {
+    if (!entries)
+        return false;
+
+    CKey key = ComputeEntry(sigHash, vchSig, pubKey);
+    for (uint32_t n = 0; n < 2; n++) {
+        CEntry* bucket = GetBucket(key, n);
+        for (uint32_t i = 0; i < BUCKET_ENTRIES; i++) {
+            if (!Match(bucket[i], key))
+                continue;
+
+            if (fErase) {
+                std::unique_lock<std::mutex> lock(GetShard(key).mtx);
+                if (Match(bucket[i], key)) {
+                    Write(bucket[i], 0, 0);
+                    nEntries.fetch_sub(1, std::memory_order_relaxed);
+                    nErases.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+
+            nHits.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    nMisses.fetch_add(1, std::memory_order_relaxed);
+    return false;
 }
 
 void CSignatureCache::Set(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
                           const CPubKey& pubKey) {
-    static int64_t nMaxCacheSize = SysCfg().GetArg("-maxsigcachesize", 50000);
-    if (nMaxCacheSize <= 0) return;
+    if (!entries)
+        return;
 
-    uint256 entry;
-    ComputeEntry(entry, sigHash, vchSig, pubKey);
+    CKey key       = ComputeEntry(sigHash, vchSig, pubKey);
+    CEntry* candidates[2] = {GetBucket(key, 0), GetBucket(key, 1)};
 
-    std::unique_lock<std::mutex> lock(mtx);
+    CShard& shard = GetShard(key);
+    std::unique_lock<std::mutex> lock(shard.mtx);
 
-    while (static_cast<int64_t>(setValid.size()) > nMaxCacheSize) {
-        // Evict a random entry. Random because that helps
+    CEntry* pEmpty = nullptr;
+    for (auto bucket : candidates) {
+        for (uint32_t i = 0; i < BUCKET_ENTRIES; i++) {
+            uint64_t k0 = bucket[i].k0.load(std::memory_order_relaxed);
+            if (k0 == key.k0 && bucket[i].k1.load(std::memory_order_relaxed) == key.k1)
+                return;
+
+            if (k0 == 0 && pEmpty == nullptr)
+                pEmpty = &bucket[i];
+        }
+    }
+
+    if (pEmpty == nullptr) {
+        // Evict a random entry of the candidates. Random because that helps
         // foil would-be DoS attackers who might try to pre-generate
         // and re-use a set of valid signatures just-slightly-greater
         // than our cache size.
-        UnorderedHashSet::size_type s       = GetRand(setValid.bucket_count());
-        UnorderedHashSet::local_iterator it = setValid.begin(s);
-        if (it != setValid.end(s)) {
-            setValid.erase(*it);
-        }
+        shard.nRand ^= shard.nRand << 13;
+        shard.nRand ^= shard.nRand >> 7;
+        shard.nRand ^= shard.nRand << 17;
+        uint32_t n = shard.nRand % (2 * BUCKET_ENTRIES);
+        pEmpty     = &candidates[n / BUCKET_ENTRIES][n % BUCKET_ENTRIES];
+        nEvictions.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        nEntries.fetch_add(1, std::memory_order_relaxed);
     }
 
-    setValid.insert(entry);
+    Write(*pEmpty, key.k0, key.k1);
+    nInserts.fetch_add(1, std::memory_order_relaxed);
+}
+
+CSignatureCache::CStats CSignatureCache::GetStats() const {
+    CStats stats;
+    stats.nHits       = nHits.load(std::memory_order_relaxed);
+    stats.nMisses     = nMisses.load(std::memory_order_relaxed);
+    stats.nInserts    = nInserts.load(std::memory_order_relaxed);
+    stats.nEvictions  = nEvictions.load(std::memory_order_relaxed);
+    stats.nErases     = nErases.load(std::memory_order_relaxed);
+    stats.nEntries    = nEntries.load(std::memory_order_relaxed);
+    stats.nMaxEntries = nShardBuckets * SHARDS * BUCKET_ENTRIES;
+    stats.nMaxSize    = stats.nMaxEntries * sizeof(CEntry);
+    return stats;
 }
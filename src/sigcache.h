@@ -7,11 +7,12 @@
 #ifndef COIN_SIGCACHE_H
 #define COIN_SIGCACHE_H
 
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <vector>
 
 #include "config/chainparams.h"
-#include "crypto/sha256.h"
 #include "entities/key.h"
 #include "commons/random.h"
 #include "commons/uint256.h"
@@ -21,24 +22,79 @@
  * Valid signature cache, to avoid doing expensive ECDSA signature checking
  * twice for every transaction (once when accepted into memory pool, and
  * again when accepted into the block chain)
+ *
+ * An entry is the 128-bit salted SipHash of (signature hash || public key || signature), the salt is
+ * random per instance. The entries live in a fixed table of 4-entry buckets, and every entry has two
+ * candidate buckets (cuckoo style), so a lookup reads at most 8 entries and takes no lock. Writers take
+ * the lock of the shard which owns both buckets of the entry.
  */
 class CSignatureCache {
+public:
+    struct CStats {
+        uint64_t nHits      = 0;
+        uint64_t nMisses    = 0;
+        uint64_t nInserts   = 0;
+        uint64_t nEvictions = 0;
+        uint64_t nErases    = 0;
+        uint64_t nEntries   = 0;
+        uint64_t nMaxEntries = 0;
+        uint64_t nMaxSize   = 0;  //!< in bytes
+    };
+
 private:
-    //! Entries are SHA256(signature hash || public key || signature):
-    UnorderedHashSet setValid;
-    std::mutex mtx;
+    static const uint32_t BUCKET_ENTRIES = 4;
+    static const uint32_t SHARDS         = 64;
+
+    // k0 == 0 marks an empty entry, k0 is written last and checked again by the readers
+    struct CEntry {
+        std::atomic<uint64_t> k0;
+        std::atomic<uint64_t> k1;
+    };
+
+    struct CKey {
+        uint64_t k0;
+        uint64_t k1;
+    };
+
+    struct CShard {
+        std::mutex mtx;
+        uint64_t nRand = 0;  //!< state of the eviction choice
+    };
+
+    std::unique_ptr<CEntry[]> entries;
+    uint64_t nShardBuckets = 0;  //!< buckets in each shard
+    uint64_t salt[4]       = {0, 0, 0, 0};
+    CShard shards[SHARDS];
+
+    std::atomic<uint64_t> nHits{0};
+    std::atomic<uint64_t> nMisses{0};
+    std::atomic<uint64_t> nInserts{0};
+    std::atomic<uint64_t> nEvictions{0};
+    std::atomic<uint64_t> nErases{0};
+    std::atomic<uint64_t> nEntries{0};
 
 public:
     CSignatureCache() {}
     ~CSignatureCache() {}
+
+    // allocate the table of nMaxSize bytes at most and pick a new salt, not thread safe
+    void Setup(size_t nMaxSize);
+
+    // if fErase, a found entry is erased, as it will not be looked up again (block validation)
     bool Get(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
-             const CPubKey& pubKey);
+             const CPubKey& pubKey, bool fErase = false);
     void Set(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
              const CPubKey& pubKey);
 
+    CStats GetStats() const;
+
 private:
-    void ComputeEntry(uint256& entry, const uint256& sigHash,
-                      const std::vector<unsigned char>& vchSig, const CPubKey& pubKey);
+    CKey ComputeEntry(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
+                      const CPubKey& pubKey) const;
+    CShard& GetShard(const CKey& key) { return shards[key.k1 % SHARDS]; }
+    CEntry* GetBucket(const CKey& key, uint32_t n) const;
+    static bool Match(const CEntry& entry, const CKey& key);
+    void Write(CEntry& entry, uint64_t k0, uint64_t k1);
 };
 
-#endif  // COIN_SIGCACHE_H
\ No newline at end of file
+#endif  // COIN_SIGCACHE_H
@@ -0,0 +1,75 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+
+#include <memory>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+// a chain of block indexes in mapBlockIndex, apart from the active chain
+struct AssumeValidTestingSetup {
+    AssumeValidTestingSetup() {
+        for (int32_t height = 0; height < 100; ++height)
+            chain.push_back(NewIndex(height == 0 ? nullptr : chain.back()));
+    }
+
+    ~AssumeValidTestingSetup() {
+        SetAssumeValid(uint256());
+
+        LOCK(cs_main);
+        for (const auto &pIndex : indexes)
+            mapBlockIndex.erase(pIndex->GetBlockHash());
+    }
+
+    CBlockIndex *NewIndex(CBlockIndex *pPrevIndex) {
+        LOCK(cs_main);
+        CBlockIndex *pIndex = new CBlockIndex();
+        pIndex->height      = pPrevIndex == nullptr ? 0 : pPrevIndex->height + 1;
+        pIndex->pprev       = pPrevIndex;
+        pIndex->pBlockHash  = &mapBlockIndex.emplace(GetRandHash(), pIndex).first->first;
+        pIndex->BuildSkip();
+        indexes.emplace_back(pIndex);
+        return pIndex;
+    }
+
+    vector<std::unique_ptr<CBlockIndex>> indexes;
+    vector<CBlockIndex *> chain;
+};
+
+BOOST_FIXTURE_TEST_SUITE(assumevalid_tests, AssumeValidTestingSetup)
+
+BOOST_AUTO_TEST_CASE(unknown_assumevalid_test) {
+    // the blocks are old, but whether they are ancestors of the assumevalid block is unknown
+    SetAssumeValid(GetRandHash());
+
+    LOCK(cs_main);
+    BOOST_CHECK(!IsSignatureAssumedValid(chain[10]));
+    BOOST_CHECK(!IsSignatureAssumedValid(chain[99]));
+}
+
+BOOST_AUTO_TEST_CASE(ancestor_test) {
+    SetAssumeValid(chain[50]->GetBlockHash());
+    CBlockIndex *pForkIndex = NewIndex(chain[20]);
+
+    LOCK(cs_main);
+    BOOST_CHECK(IsSignatureAssumedValid(chain[0]));
+    BOOST_CHECK(IsSignatureAssumedValid(chain[10]));
+    BOOST_CHECK(IsSignatureAssumedValid(chain[50]));
+    BOOST_CHECK(!IsSignatureAssumedValid(chain[51]));
+    BOOST_CHECK(!IsSignatureAssumedValid(chain[99]));
+    BOOST_CHECK(!IsSignatureAssumedValid(pForkIndex));
+    BOOST_CHECK(!IsSignatureAssumedValid(nullptr));
+}
+
+BOOST_AUTO_TEST_CASE(disabled_test) {
+    SetAssumeValid(uint256());
+
+    LOCK(cs_main);
+    BOOST_CHECK(!IsSignatureAssumedValid(chain[10]));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
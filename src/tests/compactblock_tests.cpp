@@ -0,0 +1,163 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "p2p/compactblock.h"
+#include "persistence/block.h"
+#include "tx/blockrewardtx.h"
+#include "tx/cointransfertx.h"
+#include "tx/txserializer.h"
+
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+static std::shared_ptr<CBaseTx> NewTransferTx(uint32_t i) {
+    return std::make_shared<CBaseCoinTransferTx>(CRegID(100, i % 1000), CRegID(200, i % 1000), 1000 + i, 10000 + i,
+                                                 10000, "compact block test");
+}
+
+// a block of a reward tx and nTxs transfers
+static CBlock NewBlock(uint32_t nTxs) {
+    CBlock block;
+    block.SetHeight(1000);
+    block.SetTime(1577836800);
+    block.vptx.push_back(std::make_shared<CBlockRewardTx>(CRegID(1, 1).GetRegIdRaw(), 0, 1000));
+    for (uint32_t i = 0; i < nTxs; i++)
+        block.vptx.push_back(NewTransferTx(i));
+    block.SetMerkleRootHash(block.BuildMerkleTree());
+    return block;
+}
+
+template <typename T>
+static T RoundTrip(const T &obj) {
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << obj;
+    T ret;
+    ss >> ret;
+    return ret;
+}
+
+BOOST_AUTO_TEST_SUITE(compactblock_tests)
+
+BOOST_AUTO_TEST_CASE(short_txid_serialize_test) {
+    CShortTxId shortTxId(0x123456789abcULL);
+    BOOST_CHECK_EQUAL(::GetSerializeSize(shortTxId, SER_NETWORK, PROTOCOL_VERSION), 6U);
+    BOOST_CHECK_EQUAL(RoundTrip(shortTxId).id, 0x123456789abcULL);
+
+    CBlock block = NewBlock(10);
+    CBlockHeaderAndShortTxIDs cmpctBlock(block, 42);
+    for (const auto &pTx : block.vptx)
+        BOOST_CHECK(cmpctBlock.GetShortTxId(pTx->GetHash()) >> 48 == 0);
+
+    // another nonce salts the short txids differently
+    CBlockHeaderAndShortTxIDs otherBlock(block, 43);
+    BOOST_CHECK(cmpctBlock.shortTxIds[0].id != otherBlock.shortTxIds[0].id);
+}
+
+BOOST_AUTO_TEST_CASE(rebuild_from_mempool_test) {
+    CBlock block = NewBlock(1000);
+    CBlockHeaderAndShortTxIDs cmpctBlock = RoundTrip(CBlockHeaderAndShortTxIDs(block, 7));
+    BOOST_CHECK_EQUAL(cmpctBlock.prefilledTxs.size(), 1U);
+    BOOST_CHECK_EQUAL(cmpctBlock.prefilledTxs[0].index, 0U);
+    BOOST_CHECK_EQUAL(cmpctBlock.shortTxIds.size(), 1000U);
+
+    size_t nBlockSize  = ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION);
+    size_t nCmpctSize  = ::GetSerializeSize(cmpctBlock, SER_NETWORK, PROTOCOL_VERSION);
+    BOOST_TEST_MESSAGE(strprintf("block of 1001 txs: %u bytes, compact block: %u bytes", nBlockSize, nCmpctSize));
+    BOOST_CHECK(nCmpctSize * 4 < nBlockSize);
+
+    CPartiallyDownloadedBlock partialBlock;
+    BOOST_CHECK_EQUAL(partialBlock.InitData(cmpctBlock), READ_STATUS_OK);
+    BOOST_CHECK(partialBlock.IsTxAvailable(0));
+    BOOST_CHECK_EQUAL(partialBlock.GetMissingIndexes().size(), 1000U);
+
+    // the mempool holds the txs of the block among others
+    for (uint32_t i = 0; i < 2000; i++) {
+        auto pTx = NewTransferTx(i);
+        partialBlock.AddCandidate(pTx->GetHash(), pTx);
+    }
+    BOOST_CHECK_EQUAL(partialBlock.GetMempoolCount(), 1000U);
+    BOOST_CHECK(partialBlock.GetMissingIndexes().empty());
+
+    CBlock rebuilt;
+    BOOST_CHECK_EQUAL(partialBlock.FillBlock(rebuilt, {}), READ_STATUS_OK);
+    BOOST_CHECK(rebuilt.GetHash() == block.GetHash());
+    BOOST_CHECK_EQUAL(rebuilt.vptx.size(), block.vptx.size());
+}
+
+BOOST_AUTO_TEST_CASE(fill_missing_txs_test) {
+    CBlock block = NewBlock(100);
+    CBlockHeaderAndShortTxIDs cmpctBlock(block, 7);
+
+    CPartiallyDownloadedBlock partialBlock;
+    BOOST_CHECK_EQUAL(partialBlock.InitData(cmpctBlock), READ_STATUS_OK);
+    // every third tx is not in the mempool
+    for (uint32_t i = 1; i < block.vptx.size(); i++) {
+        if (i % 3 != 0)
+            partialBlock.AddCandidate(block.vptx[i]->GetHash(), block.vptx[i]);
+    }
+
+    vector<uint32_t> vMissingIndexes = partialBlock.GetMissingIndexes();
+    BOOST_CHECK_EQUAL(vMissingIndexes.size(), 33U);
+
+    CBlockTxn blockTxn;
+    blockTxn.blockHash = block.GetHash();
+    for (uint32_t index : vMissingIndexes)
+        blockTxn.vptx.push_back(block.vptx[index]);
+    blockTxn = RoundTrip(blockTxn);
+
+    CBlock rebuilt;
+    vector<std::shared_ptr<CBaseTx> > vTooFew(blockTxn.vptx.begin(), blockTxn.vptx.end() - 1);
+    BOOST_CHECK_EQUAL(partialBlock.FillBlock(rebuilt, vTooFew), READ_STATUS_INVALID);
+
+    // txs which do not match the merkle root of the header
+    vector<std::shared_ptr<CBaseTx> > vWrongTxs(blockTxn.vptx);
+    vWrongTxs[0] = NewTransferTx(5000);
+    BOOST_CHECK_EQUAL(partialBlock.FillBlock(rebuilt, vWrongTxs), READ_STATUS_FAILED);
+
+    BOOST_CHECK_EQUAL(partialBlock.FillBlock(rebuilt, blockTxn.vptx), READ_STATUS_OK);
+    BOOST_CHECK(rebuilt.GetHash() == block.GetHash());
+    BOOST_CHECK(rebuilt.BuildMerkleTree() == block.GetMerkleRootHash());
+}
+
+BOOST_AUTO_TEST_CASE(colliding_candidates_test) {
+    CBlock block = NewBlock(10);
+    CBlockHeaderAndShortTxIDs cmpctBlock(block, 7);
+
+    CPartiallyDownloadedBlock partialBlock;
+    BOOST_CHECK_EQUAL(partialBlock.InitData(cmpctBlock), READ_STATUS_OK);
+    // another tx under the short txid of the 5th tx comes first, neither of them is trusted then
+    partialBlock.AddCandidate(block.vptx[5]->GetHash(), NewTransferTx(5000));
+    for (uint32_t i = 1; i < block.vptx.size(); i++)
+        partialBlock.AddCandidate(block.vptx[i]->GetHash(), block.vptx[i]);
+    vector<uint32_t> vMissingIndexes = partialBlock.GetMissingIndexes();
+    BOOST_CHECK_EQUAL(vMissingIndexes.size(), 1U);
+    BOOST_CHECK_EQUAL(vMissingIndexes[0], 5U);
+
+    CBlock rebuilt;
+    BOOST_CHECK_EQUAL(partialBlock.FillBlock(rebuilt, {block.vptx[5]}), READ_STATUS_OK);
+    BOOST_CHECK(rebuilt.GetHash() == block.GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(invalid_compact_block_test) {
+    CBlock block = NewBlock(10);
+
+    CBlockHeaderAndShortTxIDs outOfRange(block, 7);
+    outOfRange.prefilledTxs[0].index = 11;
+    CPartiallyDownloadedBlock partialBlock;
+    BOOST_CHECK_EQUAL(partialBlock.InitData(outOfRange), READ_STATUS_INVALID);
+
+    CBlockHeaderAndShortTxIDs duplicated(block, 7);
+    duplicated.prefilledTxs.push_back(duplicated.prefilledTxs[0]);
+    duplicated.shortTxIds.pop_back();
+    BOOST_CHECK_EQUAL(partialBlock.InitData(duplicated), READ_STATUS_INVALID);
+
+    // two txs of the block with one short txid
+    CBlockHeaderAndShortTxIDs colliding(block, 7);
+    colliding.shortTxIds[1] = colliding.shortTxIds[0];
+    BOOST_CHECK_EQUAL(partialBlock.InitData(colliding), READ_STATUS_FAILED);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
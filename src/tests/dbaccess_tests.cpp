@@ -60,6 +60,78 @@ BOOST_AUTO_TEST_CASE(dbaccess_test)
 
 }
 
+BOOST_AUTO_TEST_CASE(dbaccess_pending_batch_test)
+{
+    bool isWipe = true;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    map<string, string> mapData;
+    mapData["regid-1"] = "keyid-1";
+    mapData["regid-2"] = "keyid-2";
+    mapData["regid-3"] = "keyid-3";
+    pDBAccess->BatchWrite<string, string>(prefix, mapData);
+
+    map<string, string> mapChanges;
+    mapChanges["regid-1"] = "keyid-1-new";
+    mapChanges["regid-2"] = ""; // erase
+    mapChanges["regid-4"] = "keyid-4";
+    CDBStorage &storage = pDBAccess->GetStorage();
+    storage.BeginBatch();
+    pDBAccess->BatchWrite<string, string>(prefix, mapChanges);
+    BOOST_CHECK(storage.FreezeBatch());
+    BOOST_CHECK(storage.GetPendingBatchCount() == 1);
+
+    map<string, string> mapExpected;
+    mapExpected["regid-1"] = "keyid-1-new";
+    mapExpected["regid-3"] = "keyid-3";
+    mapExpected["regid-4"] = "keyid-4";
+    for (int32_t i = 0; i < 2; i++) {
+        string value;
+        BOOST_CHECK(pDBAccess->GetData(prefix, string("regid-1"), value) && value == "keyid-1-new");
+        BOOST_CHECK(!pDBAccess->GetData(prefix, string("regid-2"), value));
+        BOOST_CHECK((!pDBAccess->HaveData<string, string>(prefix, string("regid-2"))));
+        BOOST_CHECK(pDBAccess->GetData(prefix, string("regid-4"), value) && value == "keyid-4");
+
+        map<string, string> elements;
+        BOOST_CHECK(pDBAccess->GetAllElements(prefix, elements));
+        BOOST_CHECK(elements == mapExpected);
+
+        // the same results after the batch is committed
+        storage.CommitPendingBatches();
+        BOOST_CHECK(storage.GetPendingBatchCount() == 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(dbaccess_single_db_test)
+{
+    bool isWipe = true;
+    auto spStorage = make_shared<CDBStorage>(db_dir / kSingleDbName, GetSingleDbCacheSize(), false, isWipe);
+    shared_ptr<CDBAccess> pAccountDb = make_shared<CDBAccess>(DBNameType::ACCOUNT, spStorage);
+    shared_ptr<CDBAccess> pBlockDb   = make_shared<CDBAccess>(DBNameType::BLOCK, spStorage);
+
+    map<string, string> mapAccounts;
+    mapAccounts["regid-1"] = "keyid-1";
+    mapAccounts["regid-2"] = "keyid-2";
+    map<uint256, CDiskTxPos> mapTxPos;
+    mapTxPos[uint256S("1")] = CDiskTxPos(CDiskBlockPos(1, 2), 3);
+
+    spStorage->BeginBatch();
+    pAccountDb->BatchWrite<string, string>(dbk::REGID_KEYID, mapAccounts);
+    pBlockDb->BatchWrite<uint256, CDiskTxPos>(dbk::TXID_DISKINDEX, mapTxPos);
+    BOOST_CHECK(spStorage->FreezeBatch());
+    // one batch for the writes of both dbs
+    BOOST_CHECK(spStorage->GetPendingBatchCount() == 1);
+    spStorage->CommitPendingBatches();
+
+    map<string, string> accounts;
+    BOOST_CHECK(pAccountDb->GetAllElements(dbk::REGID_KEYID, accounts));
+    BOOST_CHECK(accounts == mapAccounts);
+    map<uint256, CDiskTxPos> txPos;
+    BOOST_CHECK(pBlockDb->GetAllElements(dbk::TXID_DISKINDEX, txPos));
+    BOOST_CHECK(txPos.size() == 1 && txPos.begin()->second.nTxOffset == 3);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 
@@ -144,6 +216,35 @@ BOOST_AUTO_TEST_CASE(dbcache_scalar_value_Level3_test)
     BOOST_CHECK( value1 == "keyid-1" );
 }
 
+BOOST_AUTO_TEST_CASE(dbcache_hash_map_Level3_test)
+{
+    const bool isWipe = true;
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+
+    auto pDBCache1 = make_shared< CHashKVCache<prefix, string, string> >(pDBAccess.get());
+    auto pDBCache2 = make_shared< CHashKVCache<prefix, string, string> >(pDBCache1.get());
+    auto pDBCache3 = make_shared< CHashKVCache<prefix, string, string> >(pDBCache2.get());
+    for (int32_t i = 0; i < 1000; i++)
+        pDBCache3->SetData(strprintf("regid-%d", i), strprintf("keyid-%d", i));
+    for (int32_t i = 0; i < 1000; i += 2)
+        pDBCache3->EraseData(strprintf("regid-%d", i));
+    pDBCache3->Flush();
+    pDBCache2->Flush();
+    pDBCache1->Flush();
+
+    for (int32_t i = 0; i < 1000; i++) {
+        string value;
+        if (i % 2 == 0) {
+            BOOST_CHECK(!pDBCache3->GetData(strprintf("regid-%d", i), value));
+        } else {
+            BOOST_CHECK(pDBCache3->GetData(strprintf("regid-%d", i), value));
+            BOOST_CHECK(value == strprintf("keyid-%d", i));
+        }
+    }
+}
+
 template <typename T>
 static uint32_t GetSerSize(const T &t) {
     return ::GetSerializeSize(t, SER_DISK, CLIENT_VERSION);
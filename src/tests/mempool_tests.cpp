@@ -0,0 +1,289 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chain/tipcontext.h"
+#include "main.h"
+#include "testchainstate.h"
+#include "tx/cointransfertx.h"
+#include "tx/txmempool.h"
+
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+static const int32_t TIP_HEIGHT = 1000;
+
+struct MempoolTestingSetup : public TestChainState {
+    MempoolTestingSetup() : TestChainState(TIP_HEIGHT) {
+        AddAccount(senderA, 100 * COIN);
+        AddAccount(senderB, 100 * COIN);
+        AddAccount(senderC, 100 * COIN);
+        AddAccount(recipient, 0);
+    }
+
+    std::shared_ptr<CBaseTx> NewTransfer(const CRegID &sender, uint64_t amount, uint64_t fees,
+                                         int32_t validHeight = TIP_HEIGHT) {
+        return std::make_shared<CBaseCoinTransferTx>(CUserID(sender), CUserID(recipient), validHeight, amount, fees,
+                                                     "mempool test");
+    }
+
+    bool AddTx(const std::shared_ptr<CBaseTx> &pTx, CValidationState &state) {
+        LOCK2(cs_main, mempool.cs);
+        CTxMemPoolEntry entry(pTx.get(), GetTime(), chainActive.Height());
+        return mempool.AddUnchecked(pTx->GetHash(), entry, state);
+    }
+
+    bool AddTx(const std::shared_ptr<CBaseTx> &pTx) {
+        CValidationState state;
+        return AddTx(pTx, state);
+    }
+
+    uint32_t GetTxSize(const std::shared_ptr<CBaseTx> &pTx) {
+        return CTxMemPoolEntry(pTx.get(), 0, 0).GetTxSize();
+    }
+
+    CRegID senderA   = CRegID(10, 1);
+    CRegID senderB   = CRegID(10, 2);
+    CRegID senderC   = CRegID(10, 3);
+    CRegID recipient = CRegID(10, 4);
+};
+
+BOOST_FIXTURE_TEST_SUITE(mempool_tests, MempoolTestingSetup)
+
+BOOST_AUTO_TEST_CASE(indexes_test) {
+    auto pTx1 = NewTransfer(senderA, COIN, 10000);
+    auto pTx2 = NewTransfer(senderB, COIN, 30000);
+    auto pTx3 = NewTransfer(senderC, COIN, 20000);
+    BOOST_CHECK(AddTx(pTx1));
+    BOOST_CHECK(AddTx(pTx2));
+    BOOST_CHECK(AddTx(pTx3));
+    BOOST_CHECK_EQUAL(mempool.Size(), 3);
+    BOOST_CHECK_EQUAL(mempool.GetTotalTxSize(), GetTxSize(pTx1) + GetTxSize(pTx2) + GetTxSize(pTx3));
+
+    LOCK(mempool.cs);
+    // the mining order is by the fees per kB
+    vector<uint256> minedTxids;
+    for (auto it = mempool.MiningOrderBegin(); it != mempool.MiningOrderEnd(); ++it)
+        minedTxids.push_back(it->first.txid);
+    BOOST_CHECK(minedTxids == vector<uint256>({pTx2->GetHash(), pTx3->GetHash(), pTx1->GetHash()}));
+
+    // the sequence order is the order the txs entered the mempool
+    vector<uint256> sequenceTxids;
+    for (auto it = mempool.SequenceUpperBound(0); it != mempool.SequenceEnd(); ++it)
+        sequenceTxids.push_back(it->second->first);
+    BOOST_CHECK(sequenceTxids == vector<uint256>({pTx1->GetHash(), pTx2->GetHash(), pTx3->GetHash()}));
+
+    auto it = mempool.SequenceUpperBound(mempool.GetLastSequence() - 1);
+    BOOST_CHECK(it != mempool.SequenceEnd() && it->second->first == pTx3->GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(trim_to_size_test) {
+    // the later tx of sender A is accepted on top of the first one, both are evicted together
+    auto pTxA1 = NewTransfer(senderA, COIN, 10000);
+    auto pTxA2 = NewTransfer(senderA, 2 * COIN, 50000);
+    auto pTxB  = NewTransfer(senderB, 3 * COIN, 20000);
+    BOOST_CHECK(AddTx(pTxA1));
+    BOOST_CHECK(AddTx(pTxA2));
+    BOOST_CHECK(AddTx(pTxB));
+    BOOST_CHECK_EQUAL(GetMempoolCoins(senderA), 97 * COIN - 60000);
+    BOOST_CHECK_EQUAL(GetMempoolCoins(recipient), 6 * COIN);
+
+    auto pTxC = NewTransfer(senderC, 4 * COIN, 40000);
+    mempool.SetMaxSize(mempool.GetTotalTxSize() + GetTxSize(pTxC) - 1);
+    BOOST_CHECK(AddTx(pTxC));
+
+    BOOST_CHECK(!mempool.Exists(pTxA1->GetHash()));
+    BOOST_CHECK(!mempool.Exists(pTxA2->GetHash()));
+    BOOST_CHECK(mempool.Exists(pTxB->GetHash()));
+    BOOST_CHECK(mempool.Exists(pTxC->GetHash()));
+    BOOST_CHECK_EQUAL(mempool.Size(), 2);
+    BOOST_CHECK_EQUAL(mempool.GetTotalTxSize(), GetTxSize(pTxB) + GetTxSize(pTxC));
+
+    // the writes of the evicted txs are gone from the mempool view after the next rescan
+    {
+        LOCK(cs_main);
+        mempool.ReScanMemPoolTx();
+    }
+    BOOST_CHECK_EQUAL(GetMempoolCoins(senderA), 100 * COIN);
+    BOOST_CHECK_EQUAL(GetMempoolCoins(senderB), 97 * COIN - 20000);
+    BOOST_CHECK_EQUAL(GetMempoolCoins(senderC), 96 * COIN - 40000);
+    BOOST_CHECK_EQUAL(GetMempoolCoins(recipient), 7 * COIN);
+}
+
+BOOST_AUTO_TEST_CASE(full_mempool_reject_test) {
+    auto pTxA = NewTransfer(senderA, COIN, 20000);
+    BOOST_CHECK(AddTx(pTxA));
+    mempool.SetMaxSize(mempool.GetTotalTxSize());
+
+    // the tx of the lowest fees per kB is rejected before it is executed
+    auto pTxB = NewTransfer(senderB, COIN, 10000);
+    CValidationState state;
+    BOOST_CHECK(!AddTx(pTxB, state));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "mempool-full");
+    BOOST_CHECK(!mempool.Exists(pTxB->GetHash()));
+    BOOST_CHECK(mempool.Exists(pTxA->GetHash()));
+    BOOST_CHECK_EQUAL(GetMempoolCoins(senderB), 100 * COIN);
+    BOOST_CHECK_EQUAL(GetMempoolCoins(recipient), COIN);
+
+    // the tx of higher fees per kB evicts the other one
+    auto pTxC = NewTransfer(senderC, COIN, 30000);
+    BOOST_CHECK(AddTx(pTxC));
+    BOOST_CHECK(!mempool.Exists(pTxA->GetHash()));
+    BOOST_CHECK(mempool.Exists(pTxC->GetHash()));
+    {
+        LOCK(cs_main);
+        mempool.ReScanMemPoolTx();
+    }
+    BOOST_CHECK_EQUAL(GetMempoolCoins(senderA), 100 * COIN);
+    BOOST_CHECK_EQUAL(GetMempoolCoins(senderC), 99 * COIN - 30000);
+    BOOST_CHECK_EQUAL(GetMempoolCoins(recipient), COIN);
+}
+
+BOOST_AUTO_TEST_CASE(min_fee_test) {
+    auto pTxA = NewTransfer(senderA, COIN, 20000);
+    BOOST_CHECK(AddTx(pTxA));
+    BOOST_CHECK_EQUAL(mempool.GetMinFeePerKb(), 0);
+    mempool.SetMaxSize(mempool.GetTotalTxSize());
+
+    // the eviction raises the minimum fees per kB above the evicted tx
+    BOOST_CHECK(AddTx(NewTransfer(senderB, COIN, 30000)));
+    BOOST_CHECK(!mempool.Exists(pTxA->GetHash()));
+    BOOST_CHECK(mempool.GetMinFeePerKb() > 0);
+
+    // the mempool has room again, but the tx below the minimum is rejected before it is executed
+    mempool.SetMaxSize((uint64_t)DEFAULT_MAX_MEMPOOL_SIZE << 20);
+    auto pTxC = NewTransfer(senderC, COIN, 19000);
+    CValidationState state;
+    BOOST_CHECK(!AddTx(pTxC, state));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "mempool-min-fee-not-met");
+    BOOST_CHECK_EQUAL(GetMempoolCoins(senderC), 100 * COIN);
+
+    BOOST_CHECK(AddTx(NewTransfer(senderC, COIN, 25000)));
+}
+
+BOOST_AUTO_TEST_CASE(expire_txs_test) {
+    int32_t validHeightRange = SysCfg().GetTxCacheHeight() / 2;
+    auto pTxA = NewTransfer(senderA, COIN, 10000, TIP_HEIGHT - validHeightRange + 5);
+    auto pTxB = NewTransfer(senderB, 2 * COIN, 10000, TIP_HEIGHT);
+    BOOST_CHECK(AddTx(pTxA));
+    BOOST_CHECK(AddTx(pTxB));
+
+    ExtendChain(4);
+    {
+        LOCK(cs_main);
+        mempool.ReScanMemPoolTx();
+    }
+    BOOST_CHECK(mempool.Exists(pTxA->GetHash()));
+
+    ExtendChain(2);
+    {
+        LOCK(cs_main);
+        mempool.ReScanMemPoolTx();
+    }
+    BOOST_CHECK(!mempool.Exists(pTxA->GetHash()));
+    BOOST_CHECK(mempool.Exists(pTxB->GetHash()));
+    BOOST_CHECK_EQUAL(mempool.Size(), 1);
+    BOOST_CHECK_EQUAL(GetMempoolCoins(senderA), 100 * COIN);
+    BOOST_CHECK_EQUAL(GetMempoolCoins(recipient), 2 * COIN);
+}
+
+BOOST_AUTO_TEST_CASE(rescan_height_bound_tx_test) {
+    // the sender identified by pubkey has no regid yet, the tx registers it with a regid of the height
+    CKey key;
+    key.MakeNewKey(true);
+    CAccount account(key.GetPubKey().GetKeyId());
+    account.OperateBalance(SYMB::WICC, BalanceOpType::ADD_FREE, 100 * COIN);
+    BOOST_CHECK(pCdMan->pAccountCache->SetAccount(account.keyid, account));
+    mempool.SetMemPoolCache();
+
+    auto pTx = std::make_shared<CBaseCoinTransferTx>(CUserID(key.GetPubKey()), CUserID(recipient), TIP_HEIGHT, COIN,
+                                                     10000, "mempool test");
+    BOOST_CHECK(AddTx(pTx));
+    int32_t height = GetTipContext()->height;
+    {
+        LOCK(mempool.cs);
+        BOOST_CHECK(mempool.cw->accountCache.GetAccount(account.keyid, account));
+        BOOST_CHECK(account.regid == CRegID(height, 0));
+    }
+
+    // on the new tip, the tx is executed again rather than its writes replayed
+    ExtendChain(1);
+    {
+        LOCK(cs_main);
+        mempool.ReScanMemPoolTx();
+    }
+    BOOST_CHECK(mempool.Exists(pTx->GetHash()));
+    BOOST_CHECK_EQUAL(GetTipContext()->height, height + 1);
+
+    LOCK(mempool.cs);
+    BOOST_CHECK(mempool.cw->accountCache.GetAccount(account.keyid, account));
+    BOOST_CHECK(account.regid == CRegID(height + 1, 0));
+}
+
+// Benchmark of the rescan after a block which changes the accounts of a few senders: the txs of those senders are
+// executed again, the writes of the others are replayed, and the view is the same as after executing all txs.
+BOOST_AUTO_TEST_CASE(rescan_replay_benchmark_test) {
+    const uint32_t nTxs     = 2000;
+    const uint32_t nChanged = 20;
+    vector<CRegID> accounts;
+    for (uint32_t i = 0; i < nTxs; i++) {
+        CRegID sender(20, i), to(21, i);
+        AddAccount(sender, 100 * COIN);
+        AddAccount(to, 0);
+        accounts.push_back(sender);
+        accounts.push_back(to);
+        BOOST_CHECK(AddTx(std::make_shared<CBaseCoinTransferTx>(CUserID(sender), CUserID(to), TIP_HEIGHT, COIN, 10000,
+                                                                "mempool test")));
+    }
+    BOOST_CHECK_EQUAL(mempool.Size(), nTxs);
+
+    // connect a block which credits some senders
+    CDBReadTracker::KeyMap blockWriteKeys;
+    {
+        LOCK(cs_main);
+        CDBOpLogMap blockOpLogMap;
+        pCdMan->pAccountCache->SetDbOpLogMap(&blockOpLogMap);
+        for (uint32_t i = 0; i < nChanged; i++) {
+            CAccount account;
+            BOOST_CHECK(pCdMan->pAccountCache->GetAccount(CUserID(CRegID(20, i * (nTxs / nChanged))), account));
+            account.OperateBalance(SYMB::WICC, BalanceOpType::ADD_FREE, COIN);
+            BOOST_CHECK(pCdMan->pAccountCache->SaveAccount(account));
+        }
+        pCdMan->pAccountCache->SetDbOpLogMap(nullptr);
+        CDBReadTracker::AddWriteKeys(blockOpLogMap, blockWriteKeys);
+    }
+    ExtendChain(1);
+    mempool.RemoveForBlock(CBlock(), blockWriteKeys);
+    {
+        LOCK(cs_main);
+        mempool.ReScanMemPoolTx();
+    }
+    CTxMemPool::CRescanStats incremental = mempool.GetLastRescanStats();
+    vector<uint64_t> incrementalCoins;
+    for (const auto &regid : accounts)
+        incrementalCoins.push_back(GetMempoolCoins(regid));
+
+    mempool.SetFullRescan();
+    {
+        LOCK(cs_main);
+        mempool.ReScanMemPoolTx();
+    }
+    CTxMemPool::CRescanStats full = mempool.GetLastRescanStats();
+    vector<uint64_t> fullCoins;
+    for (const auto &regid : accounts)
+        fullCoins.push_back(GetMempoolCoins(regid));
+
+    BOOST_TEST_MESSAGE(strprintf("mempool rescan of %u txs after a block changing %u senders: execute all %.2fms, "
+                                 "incremental %.2fms (%u executed, %u replayed)", nTxs, nChanged, full.nTime * 0.001,
+                                 incremental.nTime * 0.001, incremental.nExecuted, incremental.nReplayed));
+    BOOST_CHECK_EQUAL(incremental.nTxs, nTxs);
+    BOOST_CHECK_EQUAL(incremental.nExecuted, nChanged);
+    BOOST_CHECK_EQUAL(incremental.nReplayed, nTxs - nChanged);
+    BOOST_CHECK_EQUAL(full.nExecuted, nTxs);
+    BOOST_CHECK_EQUAL(mempool.Size(), nTxs);
+    BOOST_CHECK(incrementalCoins == fullCoins);
+    BOOST_CHECK_EQUAL(GetMempoolCoins(CRegID(20, 0)), 100 * COIN - 10000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,102 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chain/merkletree.h"
+#include "crypto/hash.h"
+#include "crypto/sha256.h"
+#include "persistence/block.h"
+#include "tx/blockrewardtx.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+// the merkle tree hashed one pair at a time, as the reference
+static vector<uint256> BuildReferenceTree(const vector<uint256> &leaves) {
+    vector<uint256> tree(leaves);
+    int32_t j = 0;
+    for (int32_t nSize = leaves.size(); nSize > 1; nSize = (nSize + 1) / 2) {
+        for (int32_t i = 0; i < nSize; i += 2) {
+            int32_t i2 = min(i + 1, nSize - 1);
+            tree.push_back(Hash(BEGIN(tree[j + i]), END(tree[j + i]), BEGIN(tree[j + i2]), END(tree[j + i2])));
+        }
+        j += nSize;
+    }
+    return tree;
+}
+
+static void FillBlock(CBlock &block, uint32_t nTxs) {
+    block.vptx.clear();
+    for (uint32_t i = 0; i < nTxs; i++) {
+        auto pTx          = std::make_shared<CBlockRewardTx>();
+        pTx->valid_height = i;
+        block.vptx.push_back(pTx);
+    }
+}
+
+static vector<uint256> GetTxids(const CBlock &block) {
+    vector<uint256> txids;
+    for (const auto &pTx : block.vptx)
+        txids.push_back(pTx->GetHash());
+    return txids;
+}
+
+BOOST_AUTO_TEST_SUITE(merkle_tests)
+
+BOOST_AUTO_TEST_CASE(merkle_tree_test) {
+    std::mt19937 rng(7);
+    for (uint32_t nTxs : {1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 63, 65, 127, 1000, 1001}) {
+        CBlock block;
+        FillBlock(block, nTxs);
+        vector<uint256> txids = GetTxids(block);
+        vector<uint256> reference = BuildReferenceTree(txids);
+
+        uint256 root = block.BuildMerkleTree();
+        BOOST_CHECK(block.vMerkleTree == reference);
+        BOOST_CHECK(root == reference.back());
+
+        for (uint32_t index : {0u, nTxs / 2, nTxs - 1})
+            BOOST_CHECK(CBlock::CheckMerkleBranch(txids[index], block.GetMerkleBranch(index), index) == root);
+
+        vector<bool> vMatch(nTxs);
+        for (uint32_t i = 0; i < nTxs; i++)
+            vMatch[i] = rng() % 8 == 0;
+
+        CPartialMerkleTree partialTree(txids, vMatch);
+        vector<uint256> vMatched;
+        BOOST_CHECK(partialTree.ExtractMatches(vMatched) == root);
+        BOOST_CHECK_EQUAL(vMatched.size(), (size_t)std::count(vMatch.begin(), vMatch.end(), true));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(merkle_tree_10k_txs_bench) {
+    const uint32_t nTxs  = 10000;
+    const int32_t nLoops = 20;
+
+    CBlock block;
+    FillBlock(block, nTxs);
+    vector<uint256> txids = GetTxids(block);
+
+    int64_t nStart = GetTimeMicros();
+    uint256 root;
+    for (int32_t i = 0; i < nLoops; i++)
+        root = block.BuildMerkleTree();
+    int64_t nBatchedTime = GetTimeMicros() - nStart;
+
+    nStart = GetTimeMicros();
+    vector<uint256> reference;
+    for (int32_t i = 0; i < nLoops; i++)
+        reference = BuildReferenceTree(txids);
+    int64_t nReferenceTime = GetTimeMicros() - nStart;
+
+    BOOST_CHECK(root == reference.back());
+    BOOST_TEST_MESSAGE(strprintf("merkle tree of %u txs with the '%s' SHA256: batched %.3fms, one pair at a time %.3fms",
+                                 nTxs, SHA256AutoDetect(), nBatchedTime * 0.001 / nLoops,
+                                 nReferenceTime * 0.001 / nLoops));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,210 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+#include "miner/miner.h"
+#include "persistence/cachewrapper.h"
+#include "testchainstate.h"
+#include "tx/cointransfertx.h"
+#include "tx/pricefeedtx.h"
+#include "tx/txmempool.h"
+
+#include <algorithm>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+struct MinerTestingSetup : public TestChainState {
+    MinerTestingSetup() : TestChainState(SysCfg().GetFeatureForkHeight() + 20) {
+        AddAccount(SysCfg().GetFcoinGenesisRegId(), 0);
+        AddAccount(recipient, 0);
+        for (const auto &regid : senders)
+            senderKeys.push_back(AddAccount(regid, 100 * COIN));
+
+        // the price feeders are active delegates which have staked enough coins
+        VoteDelegateVector delegates;
+        for (const auto &regid : feeders) {
+            feederKeys.push_back(AddAccount(regid, 300000 * COIN));
+            CAccount account;
+            BOOST_CHECK(pCdMan->pAccountCache->GetAccount(CUserID(regid), account));
+            BOOST_CHECK(account.OperateBalance(SYMB::WICC, BalanceOpType::STAKE, 210000 * COIN));
+            BOOST_CHECK(pCdMan->pAccountCache->SaveAccount(account));
+            delegates.push_back(VoteDelegate{regid, 1});
+        }
+        BOOST_CHECK(pCdMan->pDelegateCache->SetActiveDelegates(delegates));
+        mempool.SetMemPoolCache();
+    }
+
+    std::shared_ptr<CBaseTx> NewTransfer(uint32_t i, uint64_t fees) {
+        auto pTx = std::make_shared<CBaseCoinTransferTx>(CUserID(senders[i]), CUserID(recipient),
+                                                         chainActive.Height(), COIN, fees, "miner test");
+        BOOST_CHECK(senderKeys[i].Sign(pTx->GetHash(), pTx->signature));
+        return pTx;
+    }
+
+    std::shared_ptr<CBaseTx> NewPriceFeed(uint32_t i, uint64_t price) {
+        vector<CPricePoint> pricePoints = {CPricePoint(CoinPricePair(SYMB::WICC, SYMB::USD), price),
+                                           CPricePoint(CoinPricePair(SYMB::WGRT, SYMB::USD), price / 10)};
+        auto pTx = std::make_shared<CPriceFeedTx>(CUserID(feeders[i]), chainActive.Height(), SYMB::WICC,
+                                                  0.01 * COIN, pricePoints);
+        BOOST_CHECK(feederKeys[i].Sign(pTx->GetHash(), pTx->signature));
+        return pTx;
+    }
+
+    // a validated entry is one whose signatures were verified by AcceptToMemoryPool()
+    void AddTx(const std::shared_ptr<CBaseTx> &pTx, bool fValidated = false) {
+        LOCK2(cs_main, mempool.cs);
+        CValidationState state;
+        CTxMemPoolEntry entry(pTx.get(), GetTime(), chainActive.Height());
+        if (fValidated)
+            entry.SetValidated();
+        BOOST_CHECK(mempool.AddUnchecked(pTx->GetHash(), entry, state));
+    }
+
+    // the block created at once from the mempool, as when no block template was built ahead of the slot
+    std::unique_ptr<CBlock> CreateNewBlock(int64_t blockTime) {
+        LOCK(cs_main);
+        std::unique_ptr<CBlock> pBlock(new CBlock());
+        pBlock->SetTime(blockTime);
+        CCacheWrapper cw(pCdMan);
+        BOOST_CHECK(CreateNewBlockStableCoinRelease(GetTimeMillis(), cw, pBlock));
+        return pBlock;
+    }
+
+    static vector<uint256> GetTxids(const CBlock &block) {
+        vector<uint256> txids;
+        for (uint32_t i = 1; i < block.vptx.size(); ++i)
+            txids.push_back(block.vptx[i]->GetHash());
+        return txids;
+    }
+
+    CRegID recipient              = CRegID(10, 1);
+    vector<CRegID> senders        = {CRegID(10, 2), CRegID(10, 3), CRegID(10, 4)};
+    vector<CRegID> feeders        = {CRegID(10, 5), CRegID(10, 6)};
+    vector<CKey> senderKeys;
+    vector<CKey> feederKeys;
+};
+
+BOOST_FIXTURE_TEST_SUITE(miner_tests, MinerTestingSetup)
+
+BOOST_AUTO_TEST_CASE(block_template_layout_test) {
+    auto pTransfer1 = NewTransfer(0, 0.2 * COIN);
+    auto pTransfer2 = NewTransfer(1, 0.4 * COIN);
+    auto pTransfer3 = NewTransfer(2, 0.3 * COIN);
+    auto pPriceFeed = NewPriceFeed(0, 10 * COIN);
+    AddTx(pTransfer1);
+    AddTx(pPriceFeed);
+    AddTx(pTransfer2);
+    AddTx(pTransfer3);
+
+    CBlockIndex *pTip = chainActive.Tip();
+    int64_t blockTime = pTip->GetBlockTime() + GetBlockInterval(pTip->height + 1);
+    UpdateBlockTemplate(pTip, blockTime, GetTimeMillis() + 10000);
+    std::unique_ptr<CBlock> pTemplate;
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(TakeBlockTemplate(pTip, blockTime, pTemplate));
+    }
+    BOOST_REQUIRE(pTemplate);
+    std::unique_ptr<CBlock> pBlock = CreateNewBlock(blockTime);
+
+    // the price feed txs, then the price median tx on the prices they fed, then the other txs by fees per kB
+    BOOST_REQUIRE_EQUAL(pBlock->vptx.size(), 6);
+    BOOST_CHECK(pBlock->vptx[1]->GetHash() == pPriceFeed->GetHash());
+    BOOST_CHECK(pBlock->vptx[2]->IsPriceMedianTx());
+    BOOST_CHECK(pBlock->vptx[3]->GetHash() == pTransfer2->GetHash());
+    BOOST_CHECK(pBlock->vptx[4]->GetHash() == pTransfer3->GetHash());
+    BOOST_CHECK(pBlock->vptx[5]->GetHash() == pTransfer1->GetHash());
+
+    // the block template is laid out the same
+    BOOST_CHECK(GetTxids(*pTemplate) == GetTxids(*pBlock));
+    BOOST_CHECK(pTemplate->GetFuel() == pBlock->GetFuel());
+    BOOST_CHECK(pTemplate->GetFuelRate() == pBlock->GetFuelRate());
+}
+
+BOOST_AUTO_TEST_CASE(block_template_late_price_feed_test) {
+    auto pPriceFeed1 = NewPriceFeed(0, 10 * COIN);
+    auto pTransfer   = NewTransfer(0, 0.2 * COIN);
+    AddTx(pPriceFeed1);
+    AddTx(pTransfer);
+
+    CBlockIndex *pTip = chainActive.Tip();
+    int64_t blockTime = pTip->GetBlockTime() + GetBlockInterval(pTip->height + 1);
+    UpdateBlockTemplate(pTip, blockTime, GetTimeMillis() + 10000);
+
+    // a price feed tx entering the mempool after the price median tx is packed is left to the next block
+    auto pPriceFeed2 = NewPriceFeed(1, 12 * COIN);
+    AddTx(pPriceFeed2);
+    UpdateBlockTemplate(pTip, blockTime, GetTimeMillis() + 10000);
+
+    std::unique_ptr<CBlock> pTemplate;
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(TakeBlockTemplate(pTip, blockTime, pTemplate));
+    }
+    BOOST_REQUIRE(pTemplate);
+    BOOST_REQUIRE_EQUAL(pTemplate->vptx.size(), 4);
+    BOOST_CHECK(pTemplate->vptx[1]->GetHash() == pPriceFeed1->GetHash());
+    BOOST_CHECK(pTemplate->vptx[2]->IsPriceMedianTx());
+    BOOST_CHECK(pTemplate->vptx[3]->GetHash() == pTransfer->GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(block_template_interrupted_pass_test) {
+    auto pPriceFeed1 = NewPriceFeed(0, 10 * COIN);
+    auto pTransfer1  = NewTransfer(0, 0.2 * COIN);
+    auto pTransfer2  = NewTransfer(1, 0.3 * COIN);
+    AddTx(pPriceFeed1);
+    AddTx(pTransfer1);
+    AddTx(pTransfer2);
+
+    // an update past its deadline packs one tx: the price feed tx, then the price median tx
+    CBlockIndex *pTip = chainActive.Tip();
+    int64_t blockTime = pTip->GetBlockTime() + GetBlockInterval(pTip->height + 1);
+    UpdateBlockTemplate(pTip, blockTime, 0);
+    UpdateBlockTemplate(pTip, blockTime, 0);
+
+    // the pass starts over after the price median tx, the price feed tx entered meanwhile is left to the next block
+    auto pPriceFeed2 = NewPriceFeed(1, 12 * COIN);
+    AddTx(pPriceFeed2);
+    UpdateBlockTemplate(pTip, blockTime, GetTimeMillis() + 10000);
+
+    std::unique_ptr<CBlock> pTemplate;
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(TakeBlockTemplate(pTip, blockTime, pTemplate));
+    }
+    BOOST_REQUIRE(pTemplate);
+    BOOST_REQUIRE_EQUAL(pTemplate->vptx.size(), 5);
+    BOOST_CHECK(pTemplate->vptx[1]->GetHash() == pPriceFeed1->GetHash());
+    BOOST_CHECK(pTemplate->vptx[2]->IsPriceMedianTx());
+    BOOST_CHECK(pTemplate->vptx[3]->GetHash() == pTransfer2->GetHash());
+    BOOST_CHECK(pTemplate->vptx[4]->GetHash() == pTransfer1->GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(validated_entry_signature_test) {
+    // both txs are signed by the key of another sender
+    auto pValidated = NewTransfer(0, 0.2 * COIN);
+    auto pUnchecked = NewTransfer(1, 0.3 * COIN);
+    for (const auto &pTx : {pValidated, pUnchecked}) {
+        pTx->signature.clear();
+        BOOST_CHECK(senderKeys[2].Sign(pTx->GetHash(), pTx->signature));
+    }
+    AddTx(pValidated, true);
+    AddTx(pUnchecked);
+
+    // the signatures of the validated entry are not verified again, the other entry fails CheckTx()
+    CBlockIndex *pTip = chainActive.Tip();
+    std::unique_ptr<CBlock> pBlock = CreateNewBlock(pTip->GetBlockTime() + GetBlockInterval(pTip->height + 1));
+    vector<uint256> txids = GetTxids(*pBlock);
+    BOOST_CHECK(std::count(txids.begin(), txids.end(), pValidated->GetHash()) == 1);
+    BOOST_CHECK(std::count(txids.begin(), txids.end(), pUnchecked->GetHash()) == 0);
+
+    // the flag is kept by the copies of the entry, a new entry of the same tx is not validated
+    CTxMemPoolEntry entry(pValidated.get(), GetTime(), chainActive.Height());
+    BOOST_CHECK(!entry.IsValidated());
+    entry.SetValidated();
+    BOOST_CHECK(CTxMemPoolEntry(entry).IsValidated());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
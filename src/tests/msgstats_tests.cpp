@@ -0,0 +1,47 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+#include "net.h"
+#include "p2p/node.h"
+
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(msgstats_tests)
+
+BOOST_AUTO_TEST_CASE(command_time_stats_test) {
+    CCommandTimeStats times;
+    for (int64_t nUsec : {0, 99, 100, 999, 5000, 99999, 100000, 999999, 1000000, 30000000})
+        times.Add(nUsec);
+
+    BOOST_CHECK_EQUAL(times.nCount, 10U);
+    BOOST_CHECK_EQUAL(times.nMaxUsec, 30000000);
+    BOOST_CHECK_EQUAL(times.nTotalUsec, 32206196);
+
+    uint64_t vExpected[CCommandTimeStats::BUCKETS] = {2, 2, 1, 1, 2, 2};
+    for (int32_t i = 0; i < CCommandTimeStats::BUCKETS; i++)
+        BOOST_CHECK_EQUAL(times.vBuckets[i], vExpected[i]);
+}
+
+BOOST_AUTO_TEST_CASE(node_command_times_test) {
+    CNode node(INVALID_SOCKET, CAddress(CService("127.0.0.1", 0)));
+    node.RecordCommandTime(NetMsgType::PING, 50);
+    node.RecordCommandTime(NetMsgType::PING, 150);
+    node.RecordCommandTime(NetMsgType::CONFIRMBLOCK, 2000);
+    // the commands a peer makes up share one entry
+    node.RecordCommandTime("made-up", 10);
+    node.RecordCommandTime("made-up-too", 20);
+
+    CNodeStats stats;
+    node.copyStats(stats);
+    BOOST_CHECK_EQUAL(stats.mapCommandTimes.size(), 3U);
+    BOOST_CHECK_EQUAL(stats.mapCommandTimes[NetMsgType::PING].nCount, 2U);
+    BOOST_CHECK_EQUAL(stats.mapCommandTimes[NetMsgType::PING].nMaxUsec, 150);
+    BOOST_CHECK_EQUAL(stats.mapCommandTimes[NetMsgType::CONFIRMBLOCK].vBuckets[2], 1U);
+    BOOST_CHECK_EQUAL(stats.mapCommandTimes["*other*"].nCount, 2U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
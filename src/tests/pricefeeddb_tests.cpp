@@ -0,0 +1,80 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "persistence/pricefeeddb.h"
+
+#include <random>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(pricefeeddb_tests)
+
+BOOST_AUTO_TEST_CASE(median_price_window_test) {
+    std::mt19937_64 rng(11);
+
+    CMedianPriceWindow window;
+    vector<uint64_t> prices;
+    for (int32_t round = 0; round < 2000; ++round) {
+        // slide the window: drop a few prices and add a few prices, duplicated prices included
+        uint32_t removeCount = prices.empty() ? 0 : rng() % std::min<size_t>(prices.size() + 1, 4);
+        for (uint32_t i = 0; i < removeCount; ++i) {
+            size_t index = rng() % prices.size();
+            window.Remove(prices[index]);
+            prices.erase(prices.begin() + index);
+        }
+
+        uint32_t addCount = rng() % 5;
+        for (uint32_t i = 0; i < addCount; ++i) {
+            uint64_t price = 1000 + rng() % 50;
+            window.Add(price);
+            prices.push_back(price);
+        }
+
+        vector<uint64_t> numbers = prices;
+        BOOST_CHECK_EQUAL(window.Size(), prices.size());
+        BOOST_CHECK_EQUAL(window.GetMedian(), CPricePointMemCache::ComputeMedianNumber(numbers));
+
+        // the median with the prices of a child view applied, without changing the window
+        vector<uint64_t> removed, added;
+        numbers = prices;
+        for (uint32_t i = 0; i < 3 && !numbers.empty(); ++i) {
+            size_t index = rng() % numbers.size();
+            removed.push_back(numbers[index]);
+            numbers.erase(numbers.begin() + index);
+        }
+        for (uint32_t i = 0; i < 3; ++i) {
+            added.push_back(1000 + rng() % 60);
+            numbers.push_back(added.back());
+        }
+
+        uint64_t median = 0;
+        if (window.GetMedian(removed, added, median))
+            BOOST_CHECK_EQUAL(median, CPricePointMemCache::ComputeMedianNumber(numbers));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(deleted_block_price_test) {
+    CRegID regId(100, 1);
+    vector<CPricePoint> pps = {CPricePoint(CoinPricePair(SYMB::WICC, SYMB::USD), 1000)};
+
+    CPricePointMemCache base;
+    BOOST_CHECK(base.AddPrice(10, regId, pps));
+    BOOST_CHECK(!base.AddPrice(10, regId, pps));
+
+    // a fork view disconnects the block and connects another block at the same height
+    CPricePointMemCache view(&base);
+    CBlock block;
+    block.SetHeight(10);
+    BOOST_CHECK(view.DeleteBlockFromCache(block));
+    BOOST_CHECK(view.AddPrice(10, regId, pps));
+    BOOST_CHECK(!view.AddPrice(10, regId, pps));
+
+    CPricePointMemCache child(&view);
+    BOOST_CHECK(!child.AddPrice(10, regId, pps));
+    BOOST_CHECK(child.AddPrice(11, regId, pps));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
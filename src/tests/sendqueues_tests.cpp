@@ -0,0 +1,140 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "p2p/netmessage.h"
+
+#include <string.h>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+static CSendMessage NewMessage(size_t nSize, char tag) {
+    CSendMessage msg;
+    msg.data.assign(nSize, tag);
+    return msg;
+}
+
+// send the queued messages whole, return their tags in the order sent
+static string SendAll(CSendQueues &queues, int64_t nNow = 0) {
+    string tags;
+    const CSendMessage *pMsg;
+    while ((pMsg = queues.Front(false)) != nullptr) {
+        tags += pMsg->data[0];
+        queues.PopFront(nNow);
+    }
+    return tags;
+}
+
+BOOST_AUTO_TEST_SUITE(sendqueues_tests)
+
+BOOST_AUTO_TEST_CASE(send_class_test) {
+    BOOST_CHECK_EQUAL(GetSendClass(NetMsgType::CONFIRMBLOCK), SEND_CONSENSUS);
+    BOOST_CHECK_EQUAL(GetSendClass(NetMsgType::FINALITYBLOCK), SEND_CONSENSUS);
+    BOOST_CHECK_EQUAL(GetSendClass(NetMsgType::BLOCK), SEND_BLOCK);
+    BOOST_CHECK_EQUAL(GetSendClass(NetMsgType::CMPCTBLOCK), SEND_BLOCK);
+    BOOST_CHECK_EQUAL(GetSendClass(NetMsgType::PING), SEND_BLOCK);
+    BOOST_CHECK_EQUAL(GetSendClass(NetMsgType::TX), SEND_TX);
+    BOOST_CHECK_EQUAL(GetSendClass(NetMsgType::INV), SEND_BULK);
+    BOOST_CHECK_EQUAL(GetSendClass(NetMsgType::ADDR), SEND_BULK);
+    BOOST_CHECK_EQUAL(GetSendClass("merkleblock"), SEND_BULK);
+}
+
+BOOST_AUTO_TEST_CASE(priority_order_test) {
+    CSendQueues queues;
+    BOOST_CHECK(queues.empty());
+    BOOST_CHECK(queues.Front(false) == nullptr);
+
+    queues.Push(SEND_BULK, NewMessage(100, 'i'), 0);
+    queues.Push(SEND_TX, NewMessage(100, 't'), 0);
+    queues.Push(SEND_BLOCK, NewMessage(100, 'b'), 0);
+    queues.Push(SEND_CONSENSUS, NewMessage(100, 'f'), 0);
+    BOOST_CHECK_EQUAL(queues.GetQueuedBytes(SEND_BULK), 100U);
+    BOOST_CHECK_EQUAL(SendAll(queues), "fbti");
+    BOOST_CHECK(queues.empty());
+    BOOST_CHECK_EQUAL(queues.GetQueuedBytes(SEND_BULK), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(deficit_round_robin_test) {
+    CSendQueues queues;
+    // 8 kB messages: a round lets 8 blocks, 2 txs and 1 inv through
+    for (int32_t i = 0; i < 20; i++) {
+        queues.Push(SEND_BLOCK, NewMessage(8 * 1024, 'b'), 0);
+        queues.Push(SEND_TX, NewMessage(8 * 1024, 't'), 0);
+        queues.Push(SEND_BULK, NewMessage(8 * 1024, 'i'), 0);
+    }
+    string tags = SendAll(queues);
+    BOOST_CHECK_EQUAL(tags.substr(0, 22), "bbbbbbbbttibbbbbbbbtti");
+
+    // a bulk message larger than its quantum waits for rounds enough, but is not starved by a flood of txs
+    CSendQueues flood;
+    flood.Push(SEND_BULK, NewMessage(100 * 1024, 'i'), 0);
+    for (int32_t i = 0; i < 1000; i++)
+        flood.Push(SEND_TX, NewMessage(1024, 't'), 0);
+    tags = SendAll(flood);
+    size_t nPos = tags.find('i');
+    BOOST_CHECK(nPos != string::npos && nPos < 1000);
+    BOOST_CHECK_EQUAL(nPos, 13U * 16);
+}
+
+BOOST_AUTO_TEST_CASE(partly_sent_test) {
+    CSendQueues queues;
+    queues.Push(SEND_BULK, NewMessage(1000, 'i'), 0);
+    BOOST_CHECK_EQUAL(queues.Front(false)->data[0], 'i');
+
+    // a finality message overtakes the bulk message unless the latter is partly sent already
+    queues.Push(SEND_CONSENSUS, NewMessage(200, 'f'), 0);
+    BOOST_CHECK_EQUAL(queues.Front(true)->data[0], 'i');
+    queues.PopFront(0);
+    BOOST_CHECK_EQUAL(SendAll(queues), "f");
+
+    queues.Push(SEND_BULK, NewMessage(1000, 'i'), 0);
+    BOOST_CHECK_EQUAL(queues.Front(false)->data[0], 'i');
+    queues.Push(SEND_CONSENSUS, NewMessage(200, 'f'), 0);
+    BOOST_CHECK_EQUAL(SendAll(queues), "fi");
+}
+
+BOOST_AUTO_TEST_CASE(finality_under_load_test) {
+    // a peer syncing old blocks and flooded with inv and txs, on a link of 1 MB/s
+    const int64_t nBytesPerSec = 1000 * 1000;
+    CSendQueues queues;
+    for (int32_t i = 0; i < 40; i++)
+        queues.Push(SEND_BULK, NewMessage(100 * 1000, 'o'), 0);
+    for (int32_t i = 0; i < 2000; i++) {
+        queues.Push(SEND_BULK, NewMessage(1800, 'i'), 0);
+        queues.Push(SEND_TX, NewMessage(250, 't'), 0);
+    }
+
+    // the link is busy with a bulk message when the finality message is queued
+    int64_t nNow = 0;
+    const CSendMessage *pMsg = queues.Front(false);
+    BOOST_CHECK_EQUAL(pMsg->data[0], 't');
+    while (pMsg->data[0] != 'o') {
+        nNow += pMsg->size() * 1000000 / nBytesPerSec;
+        queues.PopFront(nNow);
+        pMsg = queues.Front(false);
+    }
+    nNow += pMsg->size() / 2 * 1000000 / nBytesPerSec;
+    int64_t nQueuedTime = nNow;
+    queues.Push(SEND_CONSENSUS, NewMessage(300, 'f'), nQueuedTime);
+
+    // the rest of the partly sent message goes first, then the finality message
+    BOOST_CHECK_EQUAL(queues.Front(true)->data[0], 'o');
+    nNow += pMsg->size() / 2 * 1000000 / nBytesPerSec;
+    queues.PopFront(nNow);
+    pMsg = queues.Front(false);
+    BOOST_CHECK_EQUAL(pMsg->data[0], 'f');
+    nNow += pMsg->size() * 1000000 / nBytesPerSec;
+    queues.PopFront(nNow);
+
+    vector<CSendClassStats> stats;
+    queues.GetStats(stats);
+    BOOST_CHECK_EQUAL(stats[SEND_CONSENSUS].nSentMsgs, 1U);
+    BOOST_CHECK_EQUAL(stats[SEND_CONSENSUS].nMaxWaitUsec, nNow - nQueuedTime);
+    BOOST_TEST_MESSAGE(strprintf("finality message sent %d ms after queued behind %u bytes",
+                                 (nNow - nQueuedTime) / 1000, stats[SEND_BULK].nQueuedBytes + stats[SEND_TX].nQueuedBytes));
+    // well within a block slot of 3 seconds, a single queue would have sent the 8 MB ahead of it first
+    BOOST_CHECK(nNow - nQueuedTime < 100 * 1000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
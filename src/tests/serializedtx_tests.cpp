@@ -0,0 +1,112 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/hash.h"
+#include "p2p/netmessage.h"
+#include "tx/cointransfertx.h"
+#include "tx/serializedtx.h"
+#include "tx/txmempool.h"
+#include "tx/txserializer.h"
+
+#include <string.h>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+static std::shared_ptr<CBaseTx> NewTransferTx(uint32_t i) {
+    return std::make_shared<CBaseCoinTransferTx>(CRegID(100, i), CRegID(200, i), 1000 + i, 10000 + i, 10000,
+                                                 "serialized tx test");
+}
+
+BOOST_AUTO_TEST_SUITE(serializedtx_tests)
+
+BOOST_AUTO_TEST_CASE(serialize_once_test) {
+    std::shared_ptr<CBaseTx> pTx = NewTransferTx(1);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << pTx;
+
+    CSerializedTxRef pSerializedTx = MakeSerializedTx(*pTx);
+    BOOST_CHECK_EQUAL(pSerializedTx->size(), ss.size());
+    BOOST_CHECK(std::equal(ss.begin(), ss.end(), pSerializedTx->GetData().begin()));
+
+    uint256 hash       = Hash(ss.begin(), ss.end());
+    uint32_t nChecksum = 0;
+    memcpy(&nChecksum, &hash, sizeof(nChecksum));
+    BOOST_CHECK_EQUAL(pSerializedTx->GetChecksum(), nChecksum);
+
+    // the bytes as received make the same serialized tx
+    CSerializeData received(ss.begin(), ss.end());
+    CSerializedTxRef pReceived = MakeSerializedTx(*pTx, std::move(received));
+    BOOST_CHECK(pReceived->GetData() == pSerializedTx->GetData());
+    BOOST_CHECK_EQUAL(pReceived->GetChecksum(), nChecksum);
+
+    std::shared_ptr<CBaseTx> pReadTx;
+    CDataStream ssRead(pReceived->GetData(), SER_NETWORK, PROTOCOL_VERSION);
+    ssRead >> pReadTx;
+    BOOST_CHECK(pReadTx->GetHash() == pTx->GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(overlong_encoding_test) {
+    std::shared_ptr<CBaseTx> pTx = NewTransferTx(4);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << pTx;
+
+    // the valid height as a 64-bit varint reads back as the same tx, but in 4 more bytes
+    uint32_t nHeightPos = 1 + GetSizeOfVarInt(pTx->nVersion);
+    uint32_t nHeightEnd = nHeightPos + GetSizeOfVarInt(pTx->valid_height);
+    uint64_t nOverlong  = (uint64_t)pTx->valid_height + ((uint64_t)1 << 32);
+    CDataStream ssOverlong(SER_NETWORK, PROTOCOL_VERSION);
+    ssOverlong.write(&ss[0], nHeightPos);
+    ssOverlong << VARINT(nOverlong);
+    ssOverlong.write(&ss[nHeightEnd], ss.size() - nHeightEnd);
+    BOOST_CHECK_EQUAL(ssOverlong.size(), ss.size() + 4);
+
+    CSerializeData received(ssOverlong.begin(), ssOverlong.end());
+    std::shared_ptr<CBaseTx> pReadTx;
+    ssOverlong >> pReadTx;
+    BOOST_CHECK(pReadTx->GetHash() == pTx->GetHash());
+
+    // the tx is serialized again, the entry is charged for the size of the bytes relayed
+    CSerializedTxRef pSerializedTx = MakeSerializedTx(*pReadTx, std::move(received));
+    BOOST_CHECK_EQUAL(pSerializedTx->size(), ss.size());
+    BOOST_CHECK(std::equal(ss.begin(), ss.end(), pSerializedTx->GetData().begin()));
+
+    CTxMemPoolEntry entry(pReadTx.get(), 0, 0, pSerializedTx);
+    BOOST_CHECK_EQUAL(entry.GetTxSize(), pTx->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION));
+}
+
+BOOST_AUTO_TEST_CASE(shared_by_mempool_entry_test) {
+    std::shared_ptr<CBaseTx> pTx   = NewTransferTx(2);
+    CSerializedTxRef pSerializedTx = MakeSerializedTx(*pTx);
+
+    CTxMemPoolEntry entry(pTx.get(), 0, 0, pSerializedTx);
+    CTxMemPoolEntry copy(entry);
+    BOOST_CHECK(entry.GetSerializedTx() == pSerializedTx);
+    BOOST_CHECK(copy.GetSerializedTx() == pSerializedTx);
+    BOOST_CHECK_EQUAL(entry.GetTxSize(), pTx->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION));
+
+    // serialized by the entry when not given
+    CTxMemPoolEntry ownEntry(pTx.get(), 0, 0);
+    BOOST_CHECK(ownEntry.GetSerializedTx()->GetData() == pSerializedTx->GetData());
+    BOOST_CHECK_EQUAL(ownEntry.GetTxSize(), entry.GetTxSize());
+}
+
+BOOST_AUTO_TEST_CASE(send_message_payload_test) {
+    CSerializedTxRef pSerializedTx = MakeSerializedTx(*NewTransferTx(3));
+
+    // the messages of many peers hold their own headers and one payload
+    vector<CSendMessage> vMsgs(8);
+    for (auto &msg : vMsgs) {
+        msg.data.assign(CMessageHeader::HEADER_SIZE, 0);
+        msg.pPayload = pSerializedTx;
+        BOOST_CHECK_EQUAL(msg.size(), (size_t)CMessageHeader::HEADER_SIZE + pSerializedTx->size());
+    }
+    BOOST_CHECK_EQUAL(pSerializedTx.use_count(), 9);
+
+    CSendMessage plain;
+    plain.data.assign(100, 0);
+    BOOST_CHECK_EQUAL(plain.size(), 100U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
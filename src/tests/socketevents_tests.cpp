@@ -0,0 +1,178 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "p2p/socketevents.h"
+#include "commons/util/util.h"
+
+#include <set>
+#include <thread>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+#ifdef USE_EPOLL
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(socketevents_tests)
+
+#ifdef USE_EPOLL
+
+// the socket pairs of the connections, the first socket is waited for and the second is the peer
+static void OpenPairs(vector<pair<SOCKET, SOCKET>> &pairs, uint32_t nPairs) {
+    for (uint32_t i = 0; i < nPairs; i++) {
+        int32_t fds[2];
+        BOOST_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0);
+        pairs.emplace_back(fds[0], fds[1]);
+    }
+}
+
+static void ClosePairs(vector<pair<SOCKET, SOCKET>> &pairs) {
+    for (const auto &socketPair : pairs) {
+        close(socketPair.first);
+        close(socketPair.second);
+    }
+    pairs.clear();
+}
+
+// consume the edges of the sockets which turned writable when they were added
+static void DrainEvents(CSocketEvents &socketEvents) {
+    vector<CSocketEvents::CEvent> events;
+    do {
+        BOOST_REQUIRE(socketEvents.Wait(0, events));
+    } while (!events.empty());
+}
+
+static void ReadAll(SOCKET hSocket) {
+    char pchBuf[256];
+    while (read(hSocket, pchBuf, sizeof(pchBuf)) > 0) {}
+}
+
+BOOST_AUTO_TEST_CASE(socketevents_test) {
+    CSocketEvents socketEvents;
+    string strError;
+    BOOST_REQUIRE(socketEvents.Init(strError));
+
+    vector<pair<SOCKET, SOCKET>> pairs;
+    OpenPairs(pairs, 64);
+    for (uint32_t i = 0; i < pairs.size(); i++)
+        BOOST_REQUIRE(socketEvents.Add(pairs[i].first, i));
+
+    vector<CSocketEvents::CEvent> events;
+    BOOST_REQUIRE(socketEvents.Wait(1000, events));
+    BOOST_CHECK(!events.empty());
+    for (const auto &event : events)
+        BOOST_CHECK(event.fSend && !event.fRecv);
+    DrainEvents(socketEvents);
+
+    // the readable sockets are reported once, until they are read to the end
+    set<uint64_t> expected = {3, 17, 40, 63};
+    for (uint64_t nTag : expected)
+        BOOST_REQUIRE(write(pairs[nTag].second, "x", 1) == 1);
+
+    set<uint64_t> received;
+    BOOST_REQUIRE(socketEvents.Wait(1000, events));
+    for (const auto &event : events) {
+        BOOST_CHECK(event.fRecv && !event.fError);
+        received.insert(event.nTag);
+    }
+    BOOST_CHECK(received == expected);
+
+    BOOST_REQUIRE(socketEvents.Wait(0, events));
+    BOOST_CHECK(events.empty());
+
+    // a closed peer is reported as an error
+    ReadAll(pairs[3].first);
+    close(pairs[3].second);
+    pairs[3].second = socket(AF_UNIX, SOCK_STREAM, 0);
+    BOOST_REQUIRE(socketEvents.Wait(1000, events));
+    BOOST_REQUIRE_EQUAL(events.size(), 1U);
+    BOOST_CHECK(events[0].nTag == 3 && events[0].fError);
+
+    // a wake-up ends the wait, and is not returned as an event
+    int64_t nStart = GetTimeMillis();
+    std::thread waker([&socketEvents]() {
+        MilliSleep(50);
+        socketEvents.Wake();
+    });
+    BOOST_REQUIRE(socketEvents.Wait(5000, events));
+    waker.join();
+    BOOST_CHECK(events.empty());
+    BOOST_CHECK(GetTimeMillis() - nStart < 5000);
+
+    ClosePairs(pairs);
+}
+
+// The latency of a wait for a few active connections among many idle ones: select() scans all the sockets in
+// every pass and is limited to FD_SETSIZE, epoll only returns the active ones.
+BOOST_AUTO_TEST_CASE(socketevents_scaling_bench) {
+    const uint32_t nActive = 10;
+    const int32_t nLoops   = 100;
+    RaiseFileDescriptorLimit(2 * 4000 + 64);
+
+    for (uint32_t nPairs : {10, 100, 400, 1000, 4000}) {
+        CSocketEvents socketEvents;
+        string strError;
+        BOOST_REQUIRE(socketEvents.Init(strError));
+
+        vector<pair<SOCKET, SOCKET>> pairs;
+        OpenPairs(pairs, nPairs);
+        SOCKET hSocketMax = 0;
+        for (uint32_t i = 0; i < pairs.size(); i++) {
+            BOOST_REQUIRE(socketEvents.Add(pairs[i].first, i));
+            hSocketMax = max(hSocketMax, pairs[i].first);
+        }
+        DrainEvents(socketEvents);
+
+        int64_t nEpollTime  = 0;
+        int64_t nSelectTime = 0;
+        bool fSelect        = hSocketMax < FD_SETSIZE;
+        vector<CSocketEvents::CEvent> events;
+        for (int32_t loop = 0; loop < nLoops; loop++) {
+            for (uint32_t i = 0; i < nActive; i++)
+                BOOST_REQUIRE(write(pairs[(loop * 7919 + i * 104729) % nPairs].second, "x", 1) == 1);
+
+            int64_t nStart = GetTimeMicros();
+            BOOST_REQUIRE(socketEvents.Wait(1000, events));
+            nEpollTime += GetTimeMicros() - nStart;
+            BOOST_CHECK(!events.empty());
+
+            if (fSelect) {
+                nStart = GetTimeMicros();
+                fd_set fdsetRecv;
+                FD_ZERO(&fdsetRecv);
+                for (const auto &socketPair : pairs)
+                    FD_SET(socketPair.first, &fdsetRecv);
+                struct timeval timeout = {1, 0};
+                BOOST_CHECK(select(hSocketMax + 1, &fdsetRecv, nullptr, nullptr, &timeout) > 0);
+                nSelectTime += GetTimeMicros() - nStart;
+            }
+
+            for (const auto &event : events)
+                ReadAll(pairs[event.nTag].first);
+        }
+
+        BOOST_TEST_MESSAGE(strprintf("%u connections, %u active: epoll wait %.1fus, select %s", nPairs, nActive,
+                                     nEpollTime * 1.0 / nLoops,
+                                     fSelect ? strprintf("%.1fus", nSelectTime * 1.0 / nLoops)
+                                             : string("over FD_SETSIZE")));
+        ClosePairs(pairs);
+    }
+}
+
+#else
+
+BOOST_AUTO_TEST_CASE(socketevents_unsupported_test) {
+    CSocketEvents socketEvents;
+    string strError;
+    BOOST_CHECK(!socketEvents.Init(strError));
+    BOOST_CHECK(!strError.empty());
+}
+
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
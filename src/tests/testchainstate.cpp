@@ -0,0 +1,98 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "testchainstate.h"
+
+#include "chain/tipcontext.h"
+#include "commons/util/util.h"
+#include "main.h"
+#include "persistence/cachewrapper.h"
+#include "tx/txmempool.h"
+
+#include <boost/test/unit_test.hpp>
+
+TestChainState::TestChainState(int32_t tipHeight, uint32_t nBlocks) {
+    ECC_Start();
+
+    dataDir = boost::filesystem::path("/tmp/coind_unit_test") / "chainstate";
+    boost::filesystem::remove_all(dataDir);
+    BOOST_CHECK_NO_THROW(boost::filesystem::create_directories(dataDir));
+    CBaseParams::SoftSetArgCover("-datadir", dataDir.string());
+    ClearDatadirCache();
+
+    pCdMan = new CCacheDBManager(true, false);
+
+    // the first block of the chain has no predecessor, the heights below it are not in the active chain
+    LOCK(cs_main);
+    uint32_t nTime = GetTime() - nBlocks * GetBlockInterval(tipHeight);
+    for (int32_t height = tipHeight - nBlocks + 1; height <= tipHeight; ++height) {
+        CBlockIndex *pIndex = new CBlockIndex();
+        pIndex->height      = height;
+        pIndex->nTime       = nTime;
+        pIndex->pprev       = blockIndexes.empty() ? nullptr : blockIndexes.back().get();
+        pIndex->pBlockHash  = &mapBlockIndex.emplace(GetRandHash(), pIndex).first->first;
+        pIndex->BuildSkip();
+        blockIndexes.emplace_back(pIndex);
+        nTime += GetBlockInterval(height);
+    }
+    chainActive.SetTip(blockIndexes.back().get());
+
+    mempool.Clear();
+}
+
+TestChainState::~TestChainState() {
+    LOCK(cs_main);
+    mempool.Clear();
+    mempool.cw.reset();
+    mempool.SetMaxSize((uint64_t)DEFAULT_MAX_MEMPOOL_SIZE << 20);
+
+    // the cached tip context must not outlive the block indexes
+    chainActive.SetTip(nullptr);
+    GetTipContext();
+    for (const auto &pIndex : blockIndexes)
+        mapBlockIndex.erase(pIndex->GetBlockHash());
+
+    delete pCdMan;
+    pCdMan = nullptr;
+    BOOST_CHECK_NO_THROW(boost::filesystem::remove_all(dataDir));
+
+    ECC_Stop();
+}
+
+CKey TestChainState::AddAccount(const CRegID &regid, uint64_t coins) {
+    CKey key;
+    key.MakeNewKey(true);
+
+    CAccount account(key.GetPubKey().GetKeyId());
+    account.regid        = regid;
+    account.owner_pubkey = key.GetPubKey();
+    account.OperateBalance(SYMB::WICC, BalanceOpType::ADD_FREE, coins);
+    BOOST_CHECK(pCdMan->pAccountCache->SaveAccount(account));
+
+    LOCK(mempool.cs);
+    mempool.cw.reset(new CCacheWrapper(pCdMan));
+    return key;
+}
+
+uint64_t TestChainState::GetMempoolCoins(const CRegID &regid) {
+    LOCK(mempool.cs);
+    CAccount account;
+    BOOST_CHECK(mempool.cw->accountCache.GetAccount(CUserID(regid), account));
+    return account.GetToken(SYMB::WICC).free_amount;
+}
+
+void TestChainState::ExtendChain(uint32_t nBlocks) {
+    LOCK(cs_main);
+    for (uint32_t i = 0; i < nBlocks; ++i) {
+        CBlockIndex *pPrevIndex = blockIndexes.back().get();
+        CBlockIndex *pIndex     = new CBlockIndex();
+        pIndex->height          = pPrevIndex->height + 1;
+        pIndex->nTime           = pPrevIndex->nTime + GetBlockInterval(pIndex->height);
+        pIndex->pprev           = pPrevIndex;
+        pIndex->pBlockHash      = &mapBlockIndex.emplace(GetRandHash(), pIndex).first->first;
+        pIndex->BuildSkip();
+        blockIndexes.emplace_back(pIndex);
+    }
+    chainActive.SetTip(blockIndexes.back().get());
+}
@@ -0,0 +1,40 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef TESTS_TESTCHAINSTATE_H
+#define TESTS_TESTCHAINSTATE_H
+
+#include "entities/key.h"
+#include "entities/id.h"
+#include "persistence/block.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+/**
+ * The chain state of the tests which execute txs: pCdMan on a data dir of its own, an active chain of block
+ * indexes ending at the given tip height, also in mapBlockIndex, the empty mempool on top of them, and the
+ * accounts of the tx senders. The globals are reset when the test ends.
+ */
+struct TestChainState {
+    explicit TestChainState(int32_t tipHeight, uint32_t nBlocks = 120);
+    ~TestChainState();
+
+    // a new account of the regid with the WICC coins, returns the key which signs its txs
+    CKey AddAccount(const CRegID &regid, uint64_t coins);
+    // the WICC coins of the account in the mempool view
+    uint64_t GetMempoolCoins(const CRegID &regid);
+    // append blocks to the active chain
+    void ExtendChain(uint32_t nBlocks);
+
+    boost::filesystem::path dataDir;
+    std::vector<std::unique_ptr<CBlockIndex>> blockIndexes;
+
+private:
+    ECCVerifyHandle verifyHandle;
+};
+
+#endif  // TESTS_TESTCHAINSTATE_H
@@ -0,0 +1,197 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+#include "net.h"
+#include "tx/pricefeedtx.h"
+#include "tx/txadmission.h"
+
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+// records the txs in the order they are admitted, the admission of the first tx waits until the gate is open
+struct TxAdmissionTestingSetup {
+    TxAdmissionTestingSetup() : node(INVALID_SOCKET, CAddress(), "txadmission test", true) {}
+
+    std::shared_ptr<CBaseTx> NewTx(int32_t i) {
+        vector<CPricePoint> pricePoints = {CPricePoint(CoinPricePair(SYMB::WICC, SYMB::USD), 10 * COIN)};
+        return std::make_shared<CPriceFeedTx>(CUserID(CRegID(10, 1)), i, SYMB::WICC, 0.01 * COIN, pricePoints);
+    }
+
+    CTxAdmissionQueue::AdmitFunc Recorder(bool fGate) {
+        return [this, fGate](CNode *pFrom, const string &strCommand, CBaseTx *pBaseTx,
+                             const CSerializedTxRef &pSerializedTx, CValidationState &state) {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (fGate && admitted.empty()) {
+                fEntered = true;
+                cond.notify_all();
+                while (!fOpen)
+                    cond.wait(lock);
+            }
+            admitted.push_back(pBaseTx->GetHash());
+            cond.notify_all();
+            return state.IsValid();
+        };
+    }
+
+    void StartThreads(CTxAdmissionQueue &queue, uint32_t nThreads) {
+        for (uint32_t i = 0; i < nThreads; i++)
+            threads.create_thread(boost::bind(&CTxAdmissionQueue::Thread, &queue));
+
+        CTxAdmissionQueue::CStats stats;
+        for (queue.GetStats(stats); stats.nThreads < nThreads; queue.GetStats(stats))
+            MilliSleep(1);
+    }
+
+    void StopThreads(CTxAdmissionQueue &queue) {
+        queue.Quit();
+        threads.join_all();
+    }
+
+    void WaitAdmitted(size_t nCount) {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        while (admitted.size() < nCount)
+            cond.wait(lock);
+    }
+
+    void WaitEntered() {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        while (!fEntered)
+            cond.wait(lock);
+    }
+
+    void OpenGate() {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fOpen = true;
+        cond.notify_all();
+    }
+
+    CNode node;
+    boost::thread_group threads;
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    bool fEntered = false;
+    bool fOpen    = false;
+    vector<uint256> admitted;
+};
+
+BOOST_FIXTURE_TEST_SUITE(txadmission_tests, TxAdmissionTestingSetup)
+
+BOOST_AUTO_TEST_CASE(admission_order_test) {
+    CTxAdmissionQueue queue(4, 1000, Recorder(false));
+    StartThreads(queue, 3);
+
+    // the batches are verified concurrently, but admitted in the order the txs were queued
+    vector<uint256> pushed;
+    for (int32_t i = 0; i < 200; i++) {
+        auto pTx = NewTx(i);
+        pushed.push_back(pTx->GetHash());
+        BOOST_CHECK(queue.Push(&node, NetMsgType::TX, pTx, MakeSerializedTx(*pTx)));
+    }
+    WaitAdmitted(pushed.size());
+    StopThreads(queue);
+
+    BOOST_CHECK(admitted == pushed);
+    CTxAdmissionQueue::CStats stats;
+    queue.GetStats(stats);
+    BOOST_CHECK_EQUAL(stats.nAccepted, 200U);
+    BOOST_CHECK_EQUAL(stats.nRejected, 0U);
+    BOOST_CHECK_EQUAL(stats.nDropped, 0U);
+    BOOST_CHECK(stats.dTxPerSecond > 0);
+    BOOST_CHECK_EQUAL(node.GetRefCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(full_queue_test) {
+    CTxAdmissionQueue queue(1, 2, Recorder(true));
+    StartThreads(queue, 1);
+
+    // the worker is busy with the first tx, the queue holds the next two, the last one is dropped
+    vector<std::shared_ptr<CBaseTx>> txs;
+    for (int32_t i = 0; i < 4; i++)
+        txs.push_back(NewTx(i));
+    BOOST_CHECK(queue.Push(&node, NetMsgType::TX, txs[0], MakeSerializedTx(*txs[0])));
+    WaitEntered();
+    BOOST_CHECK(queue.Push(&node, NetMsgType::TX, txs[1], MakeSerializedTx(*txs[1])));
+    BOOST_CHECK(queue.Push(&node, NetMsgType::TX, txs[2], MakeSerializedTx(*txs[2])));
+    BOOST_CHECK(queue.Push(&node, NetMsgType::TX, txs[3], MakeSerializedTx(*txs[3])));
+
+    CTxAdmissionQueue::CStats stats;
+    queue.GetStats(stats);
+    BOOST_CHECK_EQUAL(stats.nQueued, 2U);
+    BOOST_CHECK_EQUAL(stats.nDropped, 1U);
+
+    OpenGate();
+    WaitAdmitted(3);
+    StopThreads(queue);
+
+    BOOST_CHECK(admitted == vector<uint256>({txs[0]->GetHash(), txs[1]->GetHash(), txs[2]->GetHash()}));
+    BOOST_CHECK_EQUAL(node.GetRefCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(admit_exception_test) {
+    // the admission of the second tx throws, the tx is rejected and the txs after it are still admitted
+    auto recorder = Recorder(false);
+    auto pFailTx  = NewTx(1);
+    CTxAdmissionQueue queue(1, 1000, [&](CNode *pFrom, const string &strCommand, CBaseTx *pBaseTx,
+                                         const CSerializedTxRef &pSerializedTx, CValidationState &state) -> bool {
+        if (pBaseTx->GetHash() == pFailTx->GetHash())
+            throw std::runtime_error("admission test");
+        return recorder(pFrom, strCommand, pBaseTx, pSerializedTx, state);
+    });
+    StartThreads(queue, 2);
+
+    vector<std::shared_ptr<CBaseTx>> txs = {NewTx(0), pFailTx, NewTx(2)};
+    for (const auto &pTx : txs)
+        BOOST_CHECK(queue.Push(&node, NetMsgType::TX, pTx, MakeSerializedTx(*pTx)));
+    WaitAdmitted(2);
+    StopThreads(queue);
+
+    BOOST_CHECK(admitted == vector<uint256>({txs[0]->GetHash(), txs[2]->GetHash()}));
+    CTxAdmissionQueue::CStats stats;
+    queue.GetStats(stats);
+    BOOST_CHECK_EQUAL(stats.nAccepted, 2U);
+    BOOST_CHECK_EQUAL(stats.nRejected, 1U);
+    BOOST_CHECK_EQUAL(node.GetRefCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(quit_waiting_batch_test) {
+    // the worker of the second batch waits for the turn of its batch, it quits with the others
+    CTxAdmissionQueue queue(1, 1000, Recorder(true));
+    StartThreads(queue, 2);
+
+    auto pTx0 = NewTx(0);
+    auto pTx1 = NewTx(1);
+    BOOST_CHECK(queue.Push(&node, NetMsgType::TX, pTx0, MakeSerializedTx(*pTx0)));
+    WaitEntered();
+    BOOST_CHECK(queue.Push(&node, NetMsgType::TX, pTx1, MakeSerializedTx(*pTx1)));
+
+    CTxAdmissionQueue::CStats stats;
+    for (queue.GetStats(stats); stats.nQueued > 0; queue.GetStats(stats))
+        MilliSleep(1);
+
+    queue.Quit();
+    OpenGate();
+    threads.join_all();
+
+    BOOST_CHECK(admitted == vector<uint256>({pTx0->GetHash()}));
+    BOOST_CHECK_EQUAL(node.GetRefCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(no_thread_test) {
+    // the caller admits the tx by itself when no worker is running
+    CTxAdmissionQueue queue(4, 1000, Recorder(false));
+    auto pTx = NewTx(0);
+    BOOST_CHECK(!queue.Push(&node, NetMsgType::TX, pTx, MakeSerializedTx(*pTx)));
+    BOOST_CHECK_EQUAL(node.GetRefCount(), 0);
+
+    CTxAdmissionQueue::CStats stats;
+    queue.GetStats(stats);
+    BOOST_CHECK_EQUAL(stats.nDropped, 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
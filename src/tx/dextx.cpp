@@ -336,7 +336,7 @@ namespace dex {
                     TX_ERR_TITLE, operator_signature.size()), REJECT_INVALID, "bad-operator-sig-size");
             }
             uint256 sighash = GetHash();
-            if (!::VerifySignature(sighash, operator_signature, operatorAccount.owner_pubkey)) {
+            if (!CheckSignature(context, sighash, operator_signature, operatorAccount.owner_pubkey)) {
                 return context.pState->DoS(100, ERRORMSG("%s, check operator signature error",
                     TX_ERR_TITLE), REJECT_INVALID, "bad-operator-signature");
             }
@@ -0,0 +1,44 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "serializedtx.h"
+
+#include "config/version.h"
+#include "crypto/hash.h"
+#include "tx/txserializer.h"
+
+#include <string.h>
+
+static uint32_t GetChecksum(const CSerializeData &data) {
+    uint256 hash       = Hash(data.begin(), data.end());
+    uint32_t nChecksum = 0;
+    memcpy(&nChecksum, &hash, sizeof(nChecksum));
+    return nChecksum;
+}
+
+CSerializedTx::CSerializedTx(CSerializeData &&dataIn) : data(std::move(dataIn)), nChecksum(::GetChecksum(data)) {}
+
+// an unowned pointer to the tx, only to pick its serializer
+static std::shared_ptr<CBaseTx> GetUnownedPtr(const CBaseTx &tx) {
+    return std::shared_ptr<CBaseTx>(std::shared_ptr<CBaseTx>(), const_cast<CBaseTx *>(&tx));
+}
+
+CSerializedTxRef MakeSerializedTx(const CBaseTx &tx) {
+    std::shared_ptr<CBaseTx> pTx = GetUnownedPtr(tx);
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss.reserve(::GetSerializeSize(pTx, SER_NETWORK, PROTOCOL_VERSION));
+    ss << pTx;
+
+    CSerializeData data;
+    ss.GetAndClear(data);
+    return std::make_shared<const CSerializedTx>(std::move(data));
+}
+
+CSerializedTxRef MakeSerializedTx(const CBaseTx &tx, CSerializeData &&received) {
+    if (received.size() != ::GetSerializeSize(GetUnownedPtr(tx), SER_NETWORK, PROTOCOL_VERSION))
+        return MakeSerializedTx(tx);
+
+    return std::make_shared<const CSerializedTx>(std::move(received));
+}
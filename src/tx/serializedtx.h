@@ -0,0 +1,42 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef TX_SERIALIZEDTX_H
+#define TX_SERIALIZEDTX_H
+
+#include "commons/serialize.h"
+
+#include <stdint.h>
+#include <memory>
+
+class CBaseTx;
+
+/**
+ * The network serialization of a tx, i.e. the payload of its "tx" message, with the message checksum. It is
+ * made once, from the bytes received or by serializing the tx, and never modified, so that the mempool entry,
+ * the relay map and the send queues of the peers share one buffer instead of copying the bytes each.
+ */
+class CSerializedTx {
+public:
+    explicit CSerializedTx(CSerializeData &&dataIn);
+
+    const CSerializeData &GetData() const { return data; }
+    size_t size() const { return data.size(); }
+    uint32_t GetChecksum() const { return nChecksum; }
+
+private:
+    const CSerializeData data;
+    const uint32_t nChecksum;
+};
+
+typedef std::shared_ptr<const CSerializedTx> CSerializedTxRef;
+
+/** Serialize the tx for the network, the tx is not copied */
+CSerializedTxRef MakeSerializedTx(const CBaseTx &tx);
+/** Take the bytes of the tx as received, they must hold exactly the tx which was read from them. The tx is
+ *  serialized again if their size differs from its own, e.g. with an overlong varint, so that the size the
+ *  fees are charged on is the size of the bytes relayed. */
+CSerializedTxRef MakeSerializedTx(const CBaseTx &tx, CSerializeData &&received);
+
+#endif  // TX_SERIALIZEDTX_H
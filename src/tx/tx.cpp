@@ -22,6 +22,7 @@
 #include "main.h"
 #include "vm/luavm/luavmrunenv.h"
 #include "miner/miner.h"
+#include "chain/tipcontext.h"
 #include "config/version.h"
 
 using namespace json_spirit;
@@ -40,7 +41,7 @@ string GetTxType(const TxType txType) {
 }
 
 bool GetTxMinFee(const TxType nTxType, int height, const TokenSymbol &symbol, uint64_t &feeOut) {
-    if (pCdMan->pSysParamCache->GetMinerFee(nTxType, symbol, feeOut))
+    if (GetTipContext()->GetMinerFee(nTxType, symbol, feeOut))
         return true ;
 
     const auto &iter = kTxFeeTable.find(nTxType);
@@ -206,13 +207,31 @@ bool CBaseTx::CheckMinFee(CTxExecuteContext &context, uint64_t minFee) const {
 }
 
 
+bool CSignatureCheck::operator()() const {
+    // only the block validation collects the signature checks, see CheckBlock()
+    if (!::VerifySignature(sigHash, signature, pubKey, true))
+        return ERRORMSG("CSignatureCheck() : signature verification failed, sighash: %s", sigHash.GetHex());
+
+    return true;
+}
+
+bool CBaseTx::CheckSignature(CTxExecuteContext &context, const uint256 &sighash, const UnsignedCharArray &sig,
+                             const CPubKey &pubkey) const {
+    if (context.pSigChecks != nullptr) {
+        context.pSigChecks->emplace_back(sighash, sig, pubkey);
+        return true;
+    }
+
+    return ::VerifySignature(sighash, sig, pubkey);
+}
+
 bool CBaseTx::VerifySignature(CTxExecuteContext &context, const CPubKey &pubkey) {
     if (!CheckSignatureSize(signature)) {
         return context.pState->DoS(100, ERRORMSG("%s, tx signature size invalid", BASE_TX_TITLE), REJECT_INVALID,
                          "bad-tx-sig-size");
     }
     uint256 sighash = GetHash();
-    if (!::VerifySignature(sighash, signature, pubkey)) {
+    if (!CheckSignature(context, sighash, signature, pubkey)) {
         return context.pState->DoS(100, ERRORMSG("%s, tx signature error", BASE_TX_TITLE),
             REJECT_INVALID, "bad-tx-signature");
     }
@@ -63,6 +63,32 @@ inline const string& GetTxTypeName(TxType txType) {
     return EMPTY_STRING;
 }
 
+/**
+ * Closure representing one ECDSA signature verification of a tx, deferred so that
+ * the signatures of a whole block can be checked in parallel by the check queue.
+ */
+class CSignatureCheck {
+private:
+    TxID sigHash;
+    UnsignedCharArray signature;
+    CPubKey pubKey;
+
+public:
+    CSignatureCheck() {}
+    CSignatureCheck(const TxID &sigHashIn, const UnsignedCharArray &signatureIn, const CPubKey &pubKeyIn)
+        : sigHash(sigHashIn), signature(signatureIn), pubKey(pubKeyIn) {}
+
+    bool operator()() const;
+
+    void swap(CSignatureCheck &check) {
+        std::swap(sigHash, check.sigHash);
+        signature.swap(check.signature);
+        std::swap(pubKey, check.pubKey);
+    }
+
+    const TxID& GetSigHash() const { return sigHash; }
+};
+
 class CTxExecuteContext {
 public:
     int32_t                       height;
@@ -73,6 +99,7 @@ public:
     CCacheWrapper*                pCw;
     CValidationState*             pState;
     transaction_status_type       transaction_status;
+    vector<CSignatureCheck>*      pSigChecks;   //!< if set, signature verifications are deferred into it
 
     CTxExecuteContext()
         : height(0),
@@ -82,7 +109,8 @@ public:
           prev_block_time(0),
           pCw(nullptr),
           pState(nullptr),
-          transaction_status(transaction_status_type::syncing){}
+          transaction_status(transaction_status_type::syncing),
+          pSigChecks(nullptr) {}
 
     CTxExecuteContext(const int32_t heightIn, const int32_t indexIn, const uint32_t fuelRateIn,
                       const uint32_t blockTimeIn, const uint32_t preBlockTimeIn,
@@ -94,7 +122,8 @@ public:
           prev_block_time(preBlockTimeIn),
           pCw(pCwIn),
           pState(pStateIn),
-          transaction_status(trx_status){}
+          transaction_status(trx_status),
+          pSigChecks(nullptr) {}
 };
 
 class CBaseTx {
@@ -189,9 +218,12 @@ public:
     bool CheckMinFee(CTxExecuteContext &context, uint64_t minFee) const;
 
     bool VerifySignature(CTxExecuteContext &context, const CPubKey &pubkey);
+    // Verify the signature right away, or defer it into context.pSigChecks when the caller collects them.
+    bool CheckSignature(CTxExecuteContext &context, const uint256 &sighash, const UnsignedCharArray &sig,
+                        const CPubKey &pubkey) const;
+    bool CheckSignatureSize(const vector<unsigned char> &signature) const;
 protected:
     bool CheckTxFeeSufficient(const TokenSymbol &feeSymbol, const uint64_t llFees, const int32_t height) const;
-    bool CheckSignatureSize(const vector<unsigned char> &signature) const;
     bool CheckCoinRange(const TokenSymbol &symbol, const int64_t amount) const;
 
     static bool AddInvolvedKeyIds(vector<CUserID> uids, CCacheWrapper &cw, set<CKeyID> &keyIds);
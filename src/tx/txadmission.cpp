@@ -0,0 +1,300 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txadmission.h"
+
+#include "commons/util/util.h"
+#include "config/const.h"
+#include "main.h"
+#include "net.h"
+#include "tx/tx.h"
+
+#include <algorithm>
+
+CTxAdmissionQueue txAdmissionQueue(TX_ADMISSION_BATCH_SIZE, MAX_TX_ADMISSION_QUEUE_SIZE);
+
+bool AdmitTxFromPeer(CNode *pFrom, const string &strCommand, CBaseTx *pBaseTx, const CSerializedTxRef &pSerializedTx,
+                     CValidationState &state) {
+    AssertLockHeld(cs_main);
+
+    CInv inv(MSG_TX, pBaseTx->GetHash());
+    bool fAccepted = state.IsValid() && AcceptToMemoryPool(mempool, state, pBaseTx, true, false, pSerializedTx);
+    if (fAccepted) {
+        RelayTransaction(pBaseTx, inv.hash, pSerializedTx);
+        mapAlreadyAskedFor.erase(inv);
+
+        LogPrint(BCLog::INFO, "AcceptToMemoryPool: %s %s : accepted %s (poolsz %u)\n", pFrom->addr.ToString(),
+                 pFrom->cleanSubVer, pBaseTx->GetHash().ToString(), mempool.memPoolTxs.size());
+    }
+
+    int32_t nDoS = 0;
+    if (state.IsInvalid(nDoS)) {
+        LogPrint(BCLog::INFO, "%s [%d] from %s %s was not accepted into the memory pool: %s\n",
+                pBaseTx->GetHash().ToString(), pBaseTx->valid_height,
+                pFrom->addr.ToString(), pFrom->cleanSubVer, state.GetRejectReason());
+
+        pFrom->PushMessage(NetMsgType::REJECT, strCommand, state.GetRejectCode(), state.GetRejectReason(), inv.hash);
+        // if (nDoS > 0) {
+        //     LogPrint(BCLog::INFO, "Misebehaving, add to tx hash %s mempool error, Misbehavior add %d",
+        //     pBaseTx->GetHash().GetHex(), nDoS); Misbehaving(pFrom->GetId(), nDoS);
+        // }
+    }
+
+    return fAccepted;
+}
+
+CTxAdmissionQueue::CTxAdmissionQueue(uint32_t nBatchSizeIn, uint32_t nMaxSizeIn, AdmitFunc admitFuncIn)
+    : nBatchSize(nBatchSizeIn),
+      nMaxSize(nMaxSizeIn),
+      admitFunc(admitFuncIn),
+      nThreads(0),
+      fQuit(false),
+      nNextBatch(0),
+      nNextAdmitBatch(0),
+      nAccepted(0),
+      nRejected(0),
+      nDropped(0),
+      nStartTime(0) {}
+
+bool CTxAdmissionQueue::Push(CNode *pFrom, const string &strCommand, const std::shared_ptr<CBaseTx> &pBaseTx,
+                             const CSerializedTxRef &pSerializedTx) {
+    {
+        LOCK(cs_vNodes);
+        pFrom->AddRef();
+    }
+
+    bool fRunning;
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fRunning = nThreads > 0 && !fQuit;
+        if (fRunning && queue.size() < nMaxSize) {
+            queue.push_back(CItem{pFrom, strCommand, pBaseTx, pSerializedTx, GetTimeMicros()});
+            condWorker.notify_one();
+            return true;
+        }
+
+        if (fRunning)
+            nDropped++;
+    }
+
+    {
+        LOCK(cs_vNodes);
+        pFrom->Release();
+    }
+
+    if (fRunning)
+        LogPrint(BCLog::INFO, "CTxAdmissionQueue::Push, the queue is full, drop tx %s from peer %s\n",
+                 pBaseTx->GetHash().GetHex(), pFrom->addr.ToString());
+
+    return fRunning;
+}
+
+void CTxAdmissionQueue::Thread() {
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (nStartTime == 0)
+            nStartTime = GetTime();
+        nThreads++;
+    }
+
+    vector<CItem> batch;
+    vector<CValidationState> states;
+    while (true) {
+        uint64_t nBatch;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (queue.empty() && !fQuit)
+                condWorker.wait(lock);
+
+            if (fQuit) {
+                nThreads--;
+                return;
+            }
+
+            uint32_t nNow = std::min<uint32_t>(nBatchSize, queue.size());
+            batch.assign(queue.begin(), queue.begin() + nNow);
+            queue.erase(queue.begin(), queue.begin() + nNow);
+            nBatch = nNextBatch++;
+        }
+
+        // the checks are only done ahead, the txs of a batch whose checks failed are left to CheckTx()
+        states.assign(batch.size(), CValidationState());
+        try {
+            PreCheck(batch, states);
+        } catch (const std::exception &e) {
+            LogPrint(BCLog::ERROR, "CTxAdmissionQueue::Thread, precheck error: %s\n", e.what());
+            states.assign(batch.size(), CValidationState());
+        }
+
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (nNextAdmitBatch != nBatch && !fQuit)
+                condAdmit.wait(lock);
+
+            if (fQuit) {
+                nThreads--;
+                lock.unlock();
+                ReleaseNodes(batch);
+                return;
+            }
+        }
+
+        Admit(batch, states);
+
+        ReleaseNodes(batch);
+        batch.clear();
+    }
+}
+
+void CTxAdmissionQueue::PreCheck(const vector<CItem> &batch, vector<CValidationState> &states) {
+    // The checks below are the ones of AcceptToMemoryPool() and CheckTx() which do not read the chain state.
+    // Only the sender signature of the speculative tx types is verified here, which is signed by the owner
+    // pubkey of the sender for all of them.
+    vector<CPubKey> pubKeys(batch.size());
+    bool fLookupAccount = false;
+    for (size_t i = 0; i < batch.size(); i++) {
+        CBaseTx *pBaseTx = batch[i].pBaseTx.get();
+        CValidationState &state = states[i];
+
+        string reason;
+        if (SysCfg().NetworkID() == MAIN_NET && !IsStandardTx(pBaseTx, reason)) {
+            state.DoS(0, ERRORMSG("CTxAdmissionQueue::PreCheck, txid: %s is nonstandard transaction due to %s",
+                      pBaseTx->GetHash().GetHex(), reason), REJECT_NONSTANDARD, reason);
+            continue;
+        }
+
+        if (!IsSpeculativeTxType(pBaseTx->nTxType))
+            continue;
+
+        if (!pBaseTx->CheckSignatureSize(pBaseTx->signature)) {
+            state.DoS(100, ERRORMSG("CTxAdmissionQueue::PreCheck, txid: %s signature size invalid",
+                      pBaseTx->GetHash().GetHex()), REJECT_INVALID, "bad-tx-sig-size");
+            continue;
+        }
+
+        if (pBaseTx->txUid.is<CPubKey>())
+            pubKeys[i] = pBaseTx->txUid.get<CPubKey>();
+        else
+            fLookupAccount = true;
+    }
+
+    // the owner pubkeys of the senders identified by regid are looked up in one brief cs_main section
+    if (fLookupAccount) {
+        LOCK(cs_main);
+        for (size_t i = 0; i < batch.size(); i++) {
+            CBaseTx *pBaseTx = batch[i].pBaseTx.get();
+            if (!states[i].IsValid() || !IsSpeculativeTxType(pBaseTx->nTxType) || pBaseTx->txUid.is<CPubKey>())
+                continue;
+
+            CAccount account;
+            if (mempool.cw->accountCache.GetAccount(pBaseTx->txUid, account))
+                pubKeys[i] = account.owner_pubkey;
+        }
+    }
+
+    // the sender is unknown or unregistered yet, leave the tx to CheckTx()
+    for (size_t i = 0; i < batch.size(); i++) {
+        CBaseTx *pBaseTx = batch[i].pBaseTx.get();
+        if (!states[i].IsValid() || !pubKeys[i].IsFullyValid())
+            continue;
+
+        if (!::VerifySignature(pBaseTx->GetHash(), pBaseTx->signature, pubKeys[i]))
+            states[i].DoS(100, ERRORMSG("CTxAdmissionQueue::PreCheck, txid: %s signature error",
+                          pBaseTx->GetHash().GetHex()), REJECT_INVALID, "bad-tx-signature");
+    }
+}
+
+void CTxAdmissionQueue::Admit(const vector<CItem> &batch, vector<CValidationState> &states) {
+    uint64_t nBatchAccepted = 0;
+    {
+        LOCK(cs_main);
+        for (size_t i = 0; i < batch.size(); i++) {
+            // a tx failing with an exception is rejected, the batches after it must still be admitted
+            try {
+                if (admitFunc(batch[i].pFrom, batch[i].strCommand, batch[i].pBaseTx.get(), batch[i].pSerializedTx,
+                              states[i]))
+                    nBatchAccepted++;
+            } catch (const std::exception &e) {
+                states[i].Invalid(ERRORMSG("CTxAdmissionQueue::Admit, txid: %s admission error: %s",
+                                  batch[i].pBaseTx->GetHash().GetHex(), e.what()), REJECT_INVALID, "admission-error");
+            }
+        }
+    }
+
+    int64_t nNow = GetTimeMicros();
+    boost::unique_lock<boost::mutex> lock(mutex);
+    nAccepted += nBatchAccepted;
+    nRejected += batch.size() - nBatchAccepted;
+
+    CStatsSlot &slot = statsSlots[(nNow / 1000000) % STATS_WINDOW];
+    if (slot.nTime != nNow / 1000000)
+        slot = CStatsSlot();
+    slot.nTime = nNow / 1000000;
+    slot.nAccepted += nBatchAccepted;
+    for (const auto &item : batch) {
+        int64_t nLatency = nNow - item.nQueuedTime;
+        slot.nCount++;
+        slot.nLatencySum += nLatency;
+        slot.nLatencyMax = std::max(slot.nLatencyMax, nLatency);
+    }
+
+    nNextAdmitBatch++;
+    condAdmit.notify_all();
+}
+
+void CTxAdmissionQueue::ReleaseNodes(const vector<CItem> &items) {
+    LOCK(cs_vNodes);
+    for (const auto &item : items)
+        item.pFrom->Release();
+}
+
+void CTxAdmissionQueue::Quit() {
+    vector<CItem> items;
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fQuit = true;
+        items.assign(queue.begin(), queue.end());
+        queue.clear();
+        condWorker.notify_all();
+        condAdmit.notify_all();
+    }
+
+    ReleaseNodes(items);
+}
+
+void CTxAdmissionQueue::GetStats(CStats &stats) {
+    int64_t nNow = GetTime();
+    boost::unique_lock<boost::mutex> lock(mutex);
+    stats.nQueued   = queue.size();
+    stats.nThreads  = nThreads;
+    stats.nAccepted = nAccepted;
+    stats.nRejected = nRejected;
+    stats.nDropped  = nDropped;
+
+    uint64_t nCount         = 0;
+    uint64_t nCountAccepted = 0;
+    int64_t nLatencySum     = 0;
+    int64_t nLatencyMax     = 0;
+    for (const auto &slot : statsSlots) {
+        if (slot.nTime <= nNow - STATS_WINDOW)
+            continue;
+
+        nCount += slot.nCount;
+        nCountAccepted += slot.nAccepted;
+        nLatencySum += slot.nLatencySum;
+        nLatencyMax = std::max(nLatencyMax, slot.nLatencyMax);
+    }
+
+    int64_t nSeconds = nStartTime > 0 ? std::min<int64_t>(STATS_WINDOW, std::max<int64_t>(1, nNow - nStartTime)) : 1;
+    stats.dTxPerSecond  = (double)nCountAccepted / nSeconds;
+    stats.dAvgLatencyMs = nCount > 0 ? nLatencySum * 0.001 / nCount : 0;
+    stats.dMaxLatencyMs = nLatencyMax * 0.001;
+}
+
+void ThreadTxAdmission() {
+    RenameThread("coin-txadmit");
+    txAdmissionQueue.Thread();
+}
+
+void StopTxAdmissionThreads() { txAdmissionQueue.Quit(); }
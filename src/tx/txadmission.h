@@ -0,0 +1,120 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef TX_TXADMISSION_H
+#define TX_TXADMISSION_H
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "tx/serializedtx.h"
+
+using namespace std;
+
+class CBaseTx;
+class CNode;
+class CValidationState;
+
+/** Admit a tx received from the peer into the mempool, relay it if accepted, otherwise reject it to the peer */
+bool AdmitTxFromPeer(CNode *pFrom, const string &strCommand, CBaseTx *pBaseTx, const CSerializedTxRef &pSerializedTx,
+                     CValidationState &state);
+
+/**
+ * Admits the transactions received from peers into the mempool. The worker threads take the queued txs in
+ * batches and run the checks which need no chain state (version, size and the sender signature) without
+ * holding cs_main, so that the ECDSA verifications no longer stall block processing. A verified signature
+ * is kept in the signature cache, where CheckTx finds it when the batch is admitted to the mempool under
+ * one brief cs_main section. The batches are admitted in the order they were queued, so a tx never
+ * overtakes an earlier tx it depends on. When the queue is full, the txs received are dropped.
+ */
+class CTxAdmissionQueue {
+public:
+    struct CStats {
+        uint32_t nQueued         = 0;  //!< txs waiting in the queue
+        uint32_t nThreads        = 0;
+        uint64_t nAccepted       = 0;
+        uint64_t nRejected       = 0;
+        uint64_t nDropped        = 0;  //!< received when the queue was full
+        double dTxPerSecond      = 0;  //!< txs accepted into the mempool per second, over the last minute
+        double dAvgLatencyMs     = 0;  //!< from queued to admitted, over the last minute
+        double dMaxLatencyMs     = 0;
+    };
+
+    // admits a tx under cs_main, AdmitTxFromPeer() but for the tests
+    typedef std::function<bool(CNode *, const string &, CBaseTx *, const CSerializedTxRef &, CValidationState &)>
+        AdmitFunc;
+
+    CTxAdmissionQueue(uint32_t nBatchSizeIn, uint32_t nMaxSizeIn, AdmitFunc admitFuncIn = AdmitTxFromPeer);
+
+    // Queue a tx of the peer, return false if no worker is running, then the caller should admit the tx by
+    // itself. The tx is dropped if the queue is full, so that it does not overtake the queued txs.
+    bool Push(CNode *pFrom, const string &strCommand, const std::shared_ptr<CBaseTx> &pBaseTx,
+              const CSerializedTxRef &pSerializedTx);
+
+    //! Worker thread
+    void Thread();
+
+    //! Stop all worker threads, the txs still queued or waiting for their turn are dropped
+    void Quit();
+
+    void GetStats(CStats &stats);
+
+private:
+    struct CItem {
+        CNode *pFrom;          //!< referenced until the tx is admitted
+        string strCommand;
+        std::shared_ptr<CBaseTx> pBaseTx;
+        CSerializedTxRef pSerializedTx;  //!< the bytes received, relayed as they are
+        int64_t nQueuedTime;   //!< in micro seconds
+    };
+
+    struct CStatsSlot {
+        int64_t nTime       = 0;  //!< in seconds
+        uint64_t nCount     = 0;
+        uint64_t nAccepted  = 0;
+        int64_t nLatencySum = 0;  //!< in micro seconds
+        int64_t nLatencyMax = 0;
+    };
+
+    static const int32_t STATS_WINDOW = 60;  //!< in seconds, one slot per second
+
+    void PreCheck(const vector<CItem> &batch, vector<CValidationState> &states);
+    void Admit(const vector<CItem> &batch, vector<CValidationState> &states);
+    void ReleaseNodes(const vector<CItem> &items);
+
+    boost::mutex mutex;
+    boost::condition_variable condWorker;  //!< workers wait on it for queued txs
+    boost::condition_variable condAdmit;   //!< workers wait on it for the turn of their batch
+
+    std::deque<CItem> queue;
+    uint32_t nBatchSize;
+    uint32_t nMaxSize;
+    AdmitFunc admitFunc;
+    uint32_t nThreads;
+    bool fQuit;
+    uint64_t nNextBatch;       //!< sequence of the next batch taken from the queue
+    uint64_t nNextAdmitBatch;  //!< sequence of the next batch to be admitted
+
+    uint64_t nAccepted;
+    uint64_t nRejected;
+    uint64_t nDropped;
+    int64_t nStartTime;
+    CStatsSlot statsSlots[STATS_WINDOW];
+};
+
+extern CTxAdmissionQueue txAdmissionQueue;
+
+/** Run an instance of the tx admission thread */
+void ThreadTxAdmission();
+/** Stop all tx admission threads */
+void StopTxAdmissionThreads();
+
+#endif  // TX_TXADMISSION_H
@@ -9,32 +9,55 @@
 #include "persistence/txdb.h"
 #include "tx/tx.h"
 #include "miner/miner.h"
+#include "chain/tipcontext.h"
+
+#include <cmath>
 
 using namespace std;
 
 CTxMemPoolEntry::CTxMemPoolEntry() {
     nTxSize   = 0;
     dPriority = 0.0;
+    dFeePerKb = 0.0;
 
     nTime   = 0;
     height = 0;
+
+    nSequence = 0;
+
+    fValidated = false;
+    nFuel      = 0;
+    nRunStep = 0;
 }
 
-CTxMemPoolEntry::CTxMemPoolEntry(CBaseTx *pBaseTx, int64_t time, uint32_t height) : nTime(time), height(height) {
-    pTx       = pBaseTx->GetNewInstance();
-    nFees     = pTx->GetFees();
-    nTxSize   = ::GetSerializeSize(*pTx, SER_NETWORK, PROTOCOL_VERSION);
-    dPriority = pTx->GetPriority();
+CTxMemPoolEntry::CTxMemPoolEntry(CBaseTx *pBaseTx, int64_t time, uint32_t height,
+                                 const CSerializedTxRef &pSerializedTxIn)
+    : nTime(time), height(height), nSequence(0), fValidated(false), nFuel(0), nRunStep(0) {
+    pTx           = pBaseTx->GetNewInstance();
+    pSerializedTx = pSerializedTxIn ? pSerializedTxIn : MakeSerializedTx(*pTx);
+    nFees         = pTx->GetFees();
+    nTxSize       = pSerializedTx->size() - 1;  // less the tx type, as the miner counts the tx size
+    dPriority     = pTx->GetPriority();
+    dFeePerKb     = 0.0;
 }
 
 CTxMemPoolEntry::CTxMemPoolEntry(const CTxMemPoolEntry &other) {
-    this->pTx       = other.pTx->GetNewInstance();
-    this->nFees     = other.nFees;
-    this->nTxSize   = other.nTxSize;
-    this->dPriority = other.dPriority;
+    this->pTx           = other.pTx->GetNewInstance();
+    this->pSerializedTx = other.pSerializedTx;
+    this->nFees         = other.nFees;
+    this->nTxSize       = other.nTxSize;
+    this->dPriority     = other.dPriority;
+    this->dFeePerKb     = other.dFeePerKb;
 
     this->nTime  = other.nTime;
     this->height = other.height;
+
+    this->nSequence  = other.nSequence;
+    this->pFootprint = other.pFootprint;
+
+    this->fValidated = other.fValidated;
+    this->nFuel      = other.nFuel;
+    this->nRunStep   = other.nRunStep;
 }
 
 CTxMemPool::CTxMemPool() {
@@ -42,15 +65,130 @@ CTxMemPool::CTxMemPool() {
     // accepting transactions becomes O(N^2) where N is the number
     // of transactions in the pool
     fSanityCheck         = false;
+
+    nMaxSize     = (uint64_t)DEFAULT_MAX_MEMPOOL_SIZE << 20;
+    nTotalTxSize = 0;
+
+    rollingMinFeePerKb = 0;
+    nLastMinFeeUpdate  = 0;
+
+    nLastSequence = 0;
+    fFullRescan   = false;
+}
+
+static void AddKeys(const CDBReadTracker::KeyMap &keys, CDBReadTracker::KeyMap &toKeys) {
+    for (const auto &item : keys)
+        toKeys[item.first].insert(item.second.begin(), item.second.end());
+}
+
+// The writes of the tx hold the height it is executed at, so they can not be replayed on a new tip: a DEX order
+// records its tx cord, and a sender identified by pubkey is registered with a regid of the height.
+static bool IsHeightBoundTx(const CBaseTx &tx) {
+    if (tx.txUid.is<CPubKey>())
+        return true;
+
+    switch (tx.nTxType) {
+        case DEX_LIMIT_BUY_ORDER_TX:
+        case DEX_LIMIT_SELL_ORDER_TX:
+        case DEX_MARKET_BUY_ORDER_TX:
+        case DEX_MARKET_SELL_ORDER_TX:
+        case DEX_ORDER_TX:
+        case DEX_OPERATOR_ORDER_TX:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static CTxPriorityKey GetPriorityKey(const uint256 &txid, const CTxMemPoolEntry &entry) {
+    double priority = entry.GetPriority();
+    return CTxPriorityKey{priority > TRANSACTION_PRIORITY_CEILING ? priority : 0, entry.GetFeePerKb(), txid};
+}
+
+void CTxMemPool::AddToIndexes(TxIter iterTx) {
+    const CTxMemPoolEntry &entry = iterTx->second;
+    CBaseTx *pBaseTx             = entry.GetTransaction().get();
+    priorityIndex.emplace(GetPriorityKey(iterTx->first, entry), iterTx);
+    sequenceIndex.emplace(entry.GetSequence(), iterTx);
+    senderIndex.emplace(make_pair(pBaseTx->txUid.ToString(), entry.GetSequence()), iterTx);
+    validHeightIndex.emplace(make_pair(pBaseTx->valid_height, entry.GetSequence()), iterTx);
+    nTotalTxSize += entry.GetTxSize();
+}
+
+void CTxMemPool::RemoveEntry(TxIter iterTx) {
+    const CTxMemPoolEntry &entry = iterTx->second;
+    CBaseTx *pBaseTx             = entry.GetTransaction().get();
+    priorityIndex.erase(GetPriorityKey(iterTx->first, entry));
+    sequenceIndex.erase(entry.GetSequence());
+    senderIndex.erase(make_pair(pBaseTx->txUid.ToString(), entry.GetSequence()));
+    validHeightIndex.erase(make_pair(pBaseTx->valid_height, entry.GetSequence()));
+    nTotalTxSize -= entry.GetTxSize();
+
+    auto pFootprint = entry.GetFootprint();
+    if (pFootprint)
+        AddKeys(pFootprint->writeKeys, changedKeys);
+
+    memPoolTxs.erase(iterTx);
+}
+
+// Remove the txs which are beyond the valid height range, from the lowest valid height, so that only the
+// stale txs are visited.
+void CTxMemPool::ExpireTxs() {
+    static int32_t validHeight = SysCfg().GetTxCacheHeight();
+    int32_t minValidHeight     = chainActive.Height() - validHeight / 2;
+    uint32_t nExpired          = 0;
+    while (!validHeightIndex.empty() && validHeightIndex.begin()->first.first < minValidHeight) {
+        TxIter iterTx = validHeightIndex.begin()->second;
+        uint256 txid  = iterTx->first;
+        RemoveEntry(iterTx);
+        EraseTransaction(txid);
+        ++nExpired;
+    }
+
+    if (nExpired > 0)
+        LogPrint(BCLog::INFO, "ExpireTxs() : %u txs expired below valid height %d\n", nExpired, minValidHeight);
+}
+
+// Evict the txs of the lowest fees per kB until the mempool is within its size limit, return the number evicted.
+// The minimum fees per kB are raised above the evicted ones, so that the next tx has to pay more than the
+// relay fee on top of them to enter the mempool.
+uint32_t CTxMemPool::TrimToSize() {
+    uint32_t nEvicted = 0;
+    while (nTotalTxSize > nMaxSize && !priorityIndex.empty()) {
+        if (priorityIndex.begin()->first.priorityClass == 0) {
+            rollingMinFeePerKb = std::max(rollingMinFeePerKb, priorityIndex.begin()->first.feePerKb + MIN_RELAY_TX_FEE);
+            nLastMinFeeUpdate  = GetTime();
+        }
+
+        // The later txs of the sender have been accepted on top of the writes of the evicted tx to the sender
+        // account, they are evicted together.
+        const CTxMemPoolEntry &entry = priorityIndex.begin()->second->second;
+        auto it = senderIndex.find(make_pair(entry.GetTransaction()->txUid.ToString(), entry.GetSequence()));
+        assert(it != senderIndex.end());
+        const string sender = it->first.first;
+        while (it != senderIndex.end() && it->first.first == sender) {
+            TxIter iterTx = (it++)->second;
+            uint256 txid  = iterTx->first;
+            RemoveEntry(iterTx);
+            EraseTransaction(txid);
+            ++nEvicted;
+        }
+    }
+
+    if (nEvicted > 0)
+        LogPrint(BCLog::INFO, "TrimToSize() : %u txs evicted, mempool size: %llu bytes\n", nEvicted, nTotalTxSize);
+
+    return nEvicted;
 }
 
 void CTxMemPool::Remove(CBaseTx *pBaseTx, list<std::shared_ptr<CBaseTx> > &removed, bool fRecursive) {
     // Remove transaction from memory pool
     LOCK(cs);
     uint256 txid = pBaseTx->GetHash();
-    if (memPoolTxs.count(txid)) {
-        removed.push_front(std::shared_ptr<CBaseTx>(memPoolTxs[txid].GetTransaction()));
-        memPoolTxs.erase(txid);
+    auto iterTx  = memPoolTxs.find(txid);
+    if (iterTx != memPoolTxs.end()) {
+        removed.push_front(std::shared_ptr<CBaseTx>(iterTx->second.GetTransaction()));
+        RemoveEntry(iterTx);
         EraseTransaction(txid);
     }
 }
@@ -61,10 +199,47 @@ bool CTxMemPool::AddUnchecked(const uint256 &txid, const CTxMemPoolEntry &entry,
     // all the appropriate checks.
     LOCK(cs);
     {
-        if (!CheckTxInMemPool(txid, entry, state))
+        // The fees per kB of the tx are at most its fees per kB without the fuel. If even these are below the
+        // minimum raised by the evictions, or the lowest of a full mempool, so that the tx would be evicted at
+        // once, the tx is rejected before it is executed.
+        CTxMemPoolEntry boundEntry(entry);
+        boundEntry.SetFeePerKb(std::get<1>(entry.GetFees()) / (double)entry.GetTxSize() * 1000.0);
+        CTxPriorityKey boundKey = GetPriorityKey(txid, boundEntry);
+        if (boundKey.priorityClass == 0 && boundKey.feePerKb < GetMinFeePerKb())
+            return state.Invalid(ERRORMSG("AddUnchecked() : txid: %s fees too low, below the mempool min fee",
+                                 txid.GetHex()), REJECT_INSUFFICIENTFEE, "mempool-min-fee-not-met");
+
+        if (nTotalTxSize + entry.GetTxSize() > nMaxSize && !priorityIndex.empty() &&
+            boundKey < priorityIndex.begin()->first)
+            return state.Invalid(ERRORMSG("AddUnchecked() : txid: %s fees too low, the mempool is full",
+                                 txid.GetHex()), REJECT_INSUFFICIENTFEE, "mempool-full");
+
+        auto pFootprint = NewFootprint();
+        if (!CheckTxInMemPool(txid, entry, state, true, pFootprint.get()))
             return false;
 
-        memPoolTxs.insert(make_pair(txid, entry));
+        TxIter iterTx             = memPoolTxs.insert(make_pair(txid, entry)).first;
+        CTxMemPoolEntry &newEntry = iterTx->second;
+        newEntry.SetSequence(++nLastSequence);
+        newEntry.SetFootprint(pFootprint);
+
+        // the fuel is known after the tx is executed, the fees per kB are computed as the miner does
+        CBaseTx *pBaseTx  = newEntry.GetTransaction().get();
+        uint32_t fuelRate = GetTipContext()->fuelRate;
+        double fuel       = pBaseTx->GetFuel(chainActive.Height() + 1, fuelRate);
+        newEntry.SetFeePerKb((std::get<1>(newEntry.GetFees()) - fuel) / newEntry.GetTxSize() * 1000.0);
+        newEntry.SetExecuteCost((uint64_t)fuel, pBaseTx->nRunStep);
+        AddToIndexes(iterTx);
+
+        // The evicted txs, the new one included, have written to the mempool view already. Building the view
+        // again for each eviction would cost a rescan per admission to a full mempool, so the view keeps their
+        // writes until the rescan of the next block, which executes again the txs having read them, see
+        // RemoveEntry().
+        TrimToSize();
+
+        if (!memPoolTxs.count(txid))
+            return state.Invalid(ERRORMSG("AddUnchecked() : txid: %s evicted, the mempool is full", txid.GetHex()),
+                                 REJECT_INSUFFICIENTFEE, "mempool-full");
     }
     return true;
 }
@@ -80,7 +255,7 @@ void CTxMemPool::QueryHash(vector<uint256> &txids) {
 }
 
 bool CTxMemPool::CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &memPoolEntry, CValidationState &state,
-                                  bool bExecute) {
+                                  bool bExecute, CTxMemPoolFootprint *pFootprint) {
     // is it within valid height
     static int validHeight = SysCfg().GetTxCacheHeight();
     if (!memPoolEntry.GetTransaction()->IsValidHeight(chainActive.Height(), validHeight))
@@ -92,19 +267,29 @@ bool CTxMemPool::CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &me
         return state.Invalid(ERRORMSG("CheckTxInMemPool() : txid: %s has been confirmed", txid.GetHex()), REJECT_INVALID,
                              "tx-duplicate-confirmed");
 
+    if (!bExecute)
+        return true;
+
     auto spCW = std::make_shared<CCacheWrapper>(cw.get());
+    CDBOpLogMap dbOpLogMap;
+    if (pFootprint != nullptr) {
+        dbOpLogMap.SetRedoLogMap(&pFootprint->redoLogMap);
+        spCW->SetDbOpLogMap(&dbOpLogMap);
+        spCW->SetReadTracker(&pFootprint->readTracker);
+    }
 
-    if (bExecute) {
-        CBlockIndex *pTip =  chainActive.Tip();
-        uint32_t fuelRate  = GetElementForBurn(pTip);
-        uint32_t blockTime = pTip->GetBlockTime();
-        uint32_t prevBlockTime = pTip->pprev != nullptr ? pTip->pprev->GetBlockTime() : pTip->GetBlockTime();
-        CTxExecuteContext context(chainActive.Height(), 0, fuelRate, blockTime, prevBlockTime, spCW.get(), &state, transaction_status_type::validating);
-        if (!memPoolEntry.GetTransaction()->ExecuteTx(context)) {
-            pCdMan->pLogCache->SetExecuteFail(chainActive.Height(), memPoolEntry.GetTransaction()->GetHash(),
-                                              state.GetRejectCode(), state.GetRejectReason());
-            return false;
-        }
+    auto pTipContext = GetTipContext();
+    CTxExecuteContext context(pTipContext->height, 0, pTipContext->fuelRate, pTipContext->blockTime,
+                              pTipContext->prevBlockTime, spCW.get(), &state, transaction_status_type::validating);
+    if (!memPoolEntry.GetTransaction()->ExecuteTx(context)) {
+        pCdMan->pLogCache->SetExecuteFail(chainActive.Height(), memPoolEntry.GetTransaction()->GetHash(),
+                                          state.GetRejectCode(), state.GetRejectReason());
+        return false;
+    }
+
+    if (pFootprint != nullptr) {
+        CDBReadTracker::AddWriteKeys(dbOpLogMap, pFootprint->writeKeys);
+        pFootprint->redoLogMap.KeepLastLogs();
     }
 
     spCW->Flush();
@@ -112,6 +297,24 @@ bool CTxMemPool::CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &me
     return true;
 }
 
+std::shared_ptr<CTxMemPoolFootprint> CTxMemPool::NewFootprint() {
+    return std::make_shared<CTxMemPoolFootprint>(footprintMutex, GetTipContext()->forkVersion);
+}
+
+bool CTxMemPool::ReplayFootprint(const CTxMemPoolFootprint &footprint, const UndoDataFuncMap &redoFuncMap) {
+    // check all prefixes first, nothing is written if the tx has to be executed instead
+    for (const auto &item : footprint.redoLogMap.GetMap()) {
+        if (!redoFuncMap.count(dbk::ParseKeyPrefixType(item.first)))
+            return false;
+    }
+
+    // the redo log holds only the last value of each key, the undo functions set the keys to these values
+    for (const auto &item : footprint.redoLogMap.GetMap())
+        redoFuncMap.at(dbk::ParseKeyPrefixType(item.first))(item.second);
+
+    return true;
+}
+
 void CTxMemPool::SetMemPoolCache() {
     cw.reset(new CCacheWrapper(pCdMan));
 }
@@ -120,23 +323,109 @@ void CTxMemPool::ReScanMemPoolTx() {
     cw.reset(new CCacheWrapper(pCdMan));
 
     LOCK(cs);
+    int64_t nStart = GetTimeMicros();
+
+    uint32_t nTxs = memPoolTxs.size();
+    ExpireTxs();
+
+    // The txs are applied to the new view in the order they entered the mempool. A tx is executed again if it
+    // has read a key changed since it was executed, by the connected blocks or by an earlier tx executed again
+    // or removed here, or if its writes hold the height, otherwise its writes are replayed. GetTxMinFee() reads
+    // the fees from the tip context, not from the view, so all txs are executed again when they are changed.
+    bool fExecuteAll = fFullRescan || changedKeys.count(dbk::GetKeyPrefix(dbk::SYS_PARAM)) ||
+                       changedKeys.count(dbk::GetKeyPrefix(dbk::MINER_FEE));
+
+    auto pTipContext                   = GetTipContext();
+    FeatureForkVersionEnum forkVersion = pTipContext->forkVersion;
+    UndoDataFuncMap redoFuncMap        = cw->GetUndoDataFuncMap();
+    uint32_t fuelRate                  = pTipContext->fuelRate;
+    uint32_t nExecuted = 0;
+    uint32_t nReplayed = 0;
     CValidationState state;
-    for (map<uint256, CTxMemPoolEntry>::iterator iterTx = memPoolTxs.begin(); iterTx != memPoolTxs.end();) {
-        if (!CheckTxInMemPool(iterTx->first, iterTx->second, state, true)) {
+    for (auto it = sequenceIndex.begin(); it != sequenceIndex.end();) {
+        TxIter iterTx          = (it++)->second;
+        CTxMemPoolEntry &entry = iterTx->second;
+        auto pOldFootprint     = entry.GetFootprint();
+        // without its footprint, the writes of the tx are unknown to the txs after it
+        if (!pOldFootprint)
+            fExecuteAll = true;
+
+        bool fValid = CheckTxInMemPool(iterTx->first, entry, state, false);
+        if (fValid && !fExecuteAll && pOldFootprint->forkVersion == forkVersion &&
+            IsSpeculativeTxType(entry.GetTransaction()->nTxType) && !IsHeightBoundTx(*entry.GetTransaction()) &&
+            !pOldFootprint->readTracker.IsConflict(changedKeys) && ReplayFootprint(*pOldFootprint, redoFuncMap)) {
+            ++nReplayed;
+            continue;
+        }
+
+        if (pOldFootprint)
+            AddKeys(pOldFootprint->writeKeys, changedKeys);
+
+        if (fValid) {
+            auto pFootprint = NewFootprint();
+            fValid = CheckTxInMemPool(iterTx->first, entry, state, true, pFootprint.get());
+            ++nExecuted;
+            if (fValid) {
+                AddKeys(pFootprint->writeKeys, changedKeys);
+                entry.SetFootprint(pFootprint);
+                CBaseTx *pBaseTx = entry.GetTransaction().get();
+                entry.SetExecuteCost(pBaseTx->GetFuel(chainActive.Height() + 1, fuelRate), pBaseTx->nRunStep);
+            }
+        }
+
+        if (!fValid) {
             uint256 txid = iterTx->first;
-            iterTx       = memPoolTxs.erase(iterTx++);
+            RemoveEntry(iterTx);
             EraseTransaction(txid);
-            continue;
         }
-        ++iterTx;
     }
+    changedKeys.clear();
+    fFullRescan = false;
+
+    lastRescanStats.nTxs      = nTxs;
+    lastRescanStats.nExecuted = nExecuted;
+    lastRescanStats.nReplayed = nReplayed;
+    lastRescanStats.nTime     = GetTimeMicros() - nStart;
+    if (SysCfg().IsBenchmark())
+        LogPrint(BCLog::INFO, "- Rescan mempool: %u txs, %u executed, %u replayed, %.2fms\n", nTxs, nExecuted,
+                 nReplayed, lastRescanStats.nTime * 0.001);
+}
+
+void CTxMemPool::RemoveForBlock(const CBlock &block, const CDBReadTracker::KeyMap &blockWriteKeys) {
+    LOCK(cs);
+    AddKeys(blockWriteKeys, changedKeys);
+    for (const auto &pTx : block.vptx) {
+        auto iterTx = memPoolTxs.find(pTx->GetHash());
+        if (iterTx != memPoolTxs.end())
+            RemoveEntry(iterTx);
+    }
+}
+
+void CTxMemPool::SetFullRescan() {
+    LOCK(cs);
+    fFullRescan = true;
+}
+
+CTxMemPool::CRescanStats CTxMemPool::GetLastRescanStats() {
+    LOCK(cs);
+    return lastRescanStats;
 }
 
 void CTxMemPool::Clear() {
     LOCK(cs);
 
     memPoolTxs.clear();
+    priorityIndex.clear();
+    sequenceIndex.clear();
+    senderIndex.clear();
+    validHeightIndex.clear();
+    nTotalTxSize       = 0;
+    rollingMinFeePerKb = 0;
+    nLastMinFeeUpdate  = 0;
     cw.reset(new CCacheWrapper(pCdMan));
+    changedKeys.clear();
+    fFullRescan     = false;
+    lastRescanStats = CRescanStats();
 }
 
 uint64_t CTxMemPool::Size() {
@@ -144,6 +433,34 @@ uint64_t CTxMemPool::Size() {
     return memPoolTxs.size();
 }
 
+uint64_t CTxMemPool::GetTotalTxSize() {
+    LOCK(cs);
+    return nTotalTxSize;
+}
+
+double CTxMemPool::GetMinFeePerKb() {
+    LOCK(cs);
+    if (rollingMinFeePerKb == 0)
+        return 0;
+
+    // the minimum decays faster when the mempool is far from full
+    int64_t nNow = GetTime();
+    if (nNow > nLastMinFeeUpdate) {
+        double halflife = MEMPOOL_MIN_FEE_HALFLIFE;
+        if (nTotalTxSize < nMaxSize / 4)
+            halflife /= 4;
+        else if (nTotalTxSize < nMaxSize / 2)
+            halflife /= 2;
+
+        rollingMinFeePerKb /= pow(2.0, (nNow - nLastMinFeeUpdate) / halflife);
+        nLastMinFeeUpdate = nNow;
+        if (rollingMinFeePerKb < MIN_RELAY_TX_FEE / 2)
+            rollingMinFeePerKb = 0;
+    }
+
+    return rollingMinFeePerKb;
+}
+
 bool CTxMemPool::Exists(const uint256 txid) {
     LOCK(cs);
     return ((memPoolTxs.count(txid) != 0));
@@ -7,46 +7,115 @@
 #ifndef COIN_TXMEMPOOL_H
 #define COIN_TXMEMPOOL_H
 
+#include "config/version.h"
 #include "entities/account.h"
 #include "persistence/cachewrapper.h"
 #include "sync.h"
+#include "tx/serializedtx.h"
 
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 
 using namespace std;
 
 class CValidationState;
 class CBaseTx;
+class CBlock;
 class uint256;
 
+/**
+ * What a mempool tx did when it was last executed on the mempool view: the keys it read through to the view,
+ * the keys it wrote and the values it wrote. CTxMemPool::ReScanMemPoolTx() replays the writes instead of
+ * executing the tx again, unless the tx has read a key which has been changed since.
+ */
+class CTxMemPoolFootprint {
+public:
+    CDBReadTracker readTracker;
+    CDBReadTracker::KeyMap writeKeys;
+    CDBOpLogMap redoLogMap;
+    FeatureForkVersionEnum forkVersion;
+
+    CTxMemPoolFootprint(std::mutex &baseMutex, FeatureForkVersionEnum forkVersionIn)
+        : readTracker(baseMutex), forkVersion(forkVersionIn) {}
+};
+
 /*
  * CTxMemPool stores these:
  */
 class CTxMemPoolEntry {
 private:
     std::shared_ptr<CBaseTx> pTx;
+    CSerializedTxRef pSerializedTx;          // Shared by the copies, the relay map and the peer send queues
     std::pair<TokenSymbol, uint64_t> nFees;  // Cached to avoid expensive parent-transaction lookups
     uint32_t nTxSize;                     // Cached to avoid recomputing tx size
     double dPriority;                     // Cached to avoid recomputing priority
 
+    double dFeePerKb;                     // Fees less the fuel per kB, known after the tx is executed
+
     int64_t nTime;     // Local time when entering the mempool
     uint32_t height;  // Chain height when entering the mempool
 
+    uint64_t nSequence;  // Order of entering the mempool, the txs are executed again in this order
+    std::shared_ptr<const CTxMemPoolFootprint> pFootprint;  // Shared by the copies, never modified
+
+    bool fValidated;    // CheckTx() passed at the entry height, the signatures of the tx have been verified
+    uint64_t nFuel;     // Fuel and run steps of the tx when it was last executed on the mempool view
+    uint64_t nRunStep;
+
 public:
-    CTxMemPoolEntry(CBaseTx *ptx, int64_t time, uint32_t height);
+    // the tx is serialized unless its serialization, e.g. as received from a peer, is given
+    CTxMemPoolEntry(CBaseTx *ptx, int64_t time, uint32_t height, const CSerializedTxRef &pSerializedTxIn = nullptr);
     CTxMemPoolEntry();
     CTxMemPoolEntry(const CTxMemPoolEntry &other);
 
     std::shared_ptr<CBaseTx> GetTransaction() const { return pTx; }
+    inline CSerializedTxRef GetSerializedTx() const { return pSerializedTx; }
 
     inline std::pair<TokenSymbol, uint64_t> GetFees() const { return nFees; }
     inline uint32_t GetTxSize() const { return nTxSize; }
     inline double GetPriority() const { return dPriority; }
+    inline double GetFeePerKb() const { return dFeePerKb; }
+    inline void SetFeePerKb(double dFeePerKbIn) { dFeePerKb = dFeePerKbIn; }
 
     inline int64_t GetTime() const { return nTime; }
     inline uint32_t GetHeight() const { return height; }
+
+    inline uint64_t GetSequence() const { return nSequence; }
+    inline void SetSequence(uint64_t nSequenceIn) { nSequence = nSequenceIn; }
+    inline std::shared_ptr<const CTxMemPoolFootprint> GetFootprint() const { return pFootprint; }
+    inline void SetFootprint(const std::shared_ptr<const CTxMemPoolFootprint> &pFootprintIn) { pFootprint = pFootprintIn; }
+
+    // the tx of the entry is the one CheckTx() passed, the entry holds its own copy, which is never modified
+    inline void SetValidated() { fValidated = true; }
+    // whether CheckTx() passed when the tx entered the mempool, at the entry height, not whether it still would
+    inline bool IsValidated() const { return fValidated; }
+
+    inline uint64_t GetFuel() const { return nFuel; }
+    inline uint64_t GetRunStep() const { return nRunStep; }
+    inline void SetExecuteCost(uint64_t nFuelIn, uint64_t nRunStepIn) {
+        nFuel    = nFuelIn;
+        nRunStep = nRunStepIn;
+    }
+};
+
+/**
+ * The mining order of the mempool txs, ascending: the txs of a higher priority class, i.e. the price feed txs,
+ * come after the ordinary txs, which are ordered by their fees per kB.
+ */
+struct CTxPriorityKey {
+    double priorityClass;  // the priority if it is above TRANSACTION_PRIORITY_CEILING, otherwise 0
+    double feePerKb;
+    uint256 txid;
+
+    bool operator<(const CTxPriorityKey &other) const {
+        if (priorityClass != other.priorityClass)
+            return priorityClass < other.priorityClass;
+        if (feePerKb != other.feePerKb)
+            return feePerKb < other.feePerKb;
+        return txid < other.txid;
+    }
 };
 
 /*
@@ -61,8 +130,19 @@ public:
  */
 class CTxMemPool {
 public:
+    struct CRescanStats {
+        uint32_t nTxs      = 0;
+        uint32_t nExecuted = 0;
+        uint32_t nReplayed = 0;
+        int64_t nTime      = 0;  //!< in microseconds
+    };
+
+    typedef map<uint256, CTxMemPoolEntry>::iterator TxIter;
+    typedef map<CTxPriorityKey, TxIter>::const_reverse_iterator MiningOrderIter;
+    typedef map<uint64_t, TxIter>::const_iterator SequenceIter;
+
     mutable CCriticalSection cs;
-    map<uint256, CTxMemPoolEntry > memPoolTxs;
+    map<uint256, CTxMemPoolEntry > memPoolTxs;  // only modified through the methods, which keep the indexes
     std::shared_ptr<CCacheWrapper> cw;
 
 public:
@@ -70,21 +150,67 @@ public:
 
 public:
     void SetSanityCheck(bool fSanityCheckIn) { fSanityCheck = fSanityCheckIn; }
+    // limit the total size of the serialized txs, the txs of the lowest fees per kB are evicted beyond it
+    void SetMaxSize(uint64_t nMaxSizeIn) { nMaxSize = nMaxSizeIn; }
     bool AddUnchecked(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state);
     void Remove(CBaseTx *pBaseTx, list<std::shared_ptr<CBaseTx> > &removed, bool fRecursive = false);
     void QueryHash(vector<uint256> &txids);
     bool CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state,
-                          bool bExecute = true);
+                          bool bExecute = true, CTxMemPoolFootprint *pFootprint = nullptr);
     void SetMemPoolCache();
     void ReScanMemPoolTx();
+    // remove the txs of a block connected to the tip, blockWriteKeys are the keys written by the block
+    void RemoveForBlock(const CBlock &block, const CDBReadTracker::KeyMap &blockWriteKeys);
+    // execute all txs on the next rescan, the keys changed since the last rescan are unknown
+    void SetFullRescan();
     void Clear();
+    CRescanStats GetLastRescanStats();
 
     uint64_t Size();
+    uint64_t GetTotalTxSize();
+    // the fees per kB an ordinary tx must reach to enter the mempool, raised by the evictions, decaying after
+    double GetMinFeePerKb();
     bool Exists(const uint256 txid);
     std::shared_ptr<CBaseTx> Lookup(const uint256 txid) const;
+    CSerializedTxRef LookupSerialized(const uint256 txid) const;
+
+    // the txs in mining order, i.e. descending priority and fees per kB, the caller must hold cs
+    MiningOrderIter MiningOrderBegin() const { return priorityIndex.rbegin(); }
+    MiningOrderIter MiningOrderEnd() const { return priorityIndex.rend(); }
+
+    // the txs which entered the mempool after the given sequence, in the order they entered, the caller must hold cs
+    SequenceIter SequenceUpperBound(uint64_t nSequence) const { return sequenceIndex.upper_bound(nSequence); }
+    SequenceIter SequenceEnd() const { return sequenceIndex.end(); }
+    uint64_t GetLastSequence() const { return nLastSequence; }
 
 private:
+    std::shared_ptr<CTxMemPoolFootprint> NewFootprint();
+    bool ReplayFootprint(const CTxMemPoolFootprint &footprint, const UndoDataFuncMap &redoFuncMap);
+
+    void AddToIndexes(TxIter iterTx);
+    // remove an entry, the txs after it which have read its writes are executed again on the next rescan
+    void RemoveEntry(TxIter iterTx);
+    void ExpireTxs();
+    uint32_t TrimToSize();
+
     bool fSanityCheck; // Normally false, true if -checkmempool or -regtest
+    uint64_t nMaxSize;
+    uint64_t nTotalTxSize;
+    double rollingMinFeePerKb;
+    int64_t nLastMinFeeUpdate;  // in seconds
+
+    // The indexes of memPoolTxs, for mining, for applying the txs in the order they entered the mempool, for
+    // evicting the later txs of a sender together, and for expiring the txs by their valid heights.
+    map<CTxPriorityKey, TxIter> priorityIndex;
+    map<uint64_t, TxIter> sequenceIndex;
+    map<pair<string, uint64_t>, TxIter> senderIndex;
+    map<pair<int32_t, uint64_t>, TxIter> validHeightIndex;
+
+    uint64_t nLastSequence;
+    std::mutex footprintMutex;            // the base mutex of the footprint read trackers
+    CDBReadTracker::KeyMap changedKeys;   // keys changed on the chain state since the last rescan
+    bool fFullRescan;
+    CRescanStats lastRescanStats;
 };
 
 